@@ -0,0 +1,774 @@
+/*******************************************************************************
+* File Name: cy_ble_host.h
+*
+* Version: 1.00
+*
+* Description:
+*  Host (Linux) stand-in for the subset of the PSoC 6 PDL and BLE middleware
+*  used by the IPSP Router and Node applications. The types, constants and
+*  function names match the PDL so that the application sources compile
+*  unmodified; the implementation lives in cy_ble_host.c and models the
+*  radio link in simulated time.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef CY_BLE_HOST_H
+
+    #define CY_BLE_HOST_H
+
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <string.h>
+
+    /***************************************
+    *       PDL basic types and macros
+    ***************************************/
+    typedef uint8_t     uint8;
+    typedef uint16_t    uint16;
+    typedef uint32_t    uint32;
+    typedef int8_t      int8;
+    typedef int16_t     int16;
+    typedef int32_t     int32;
+    typedef char        char8;
+
+    #define __STATIC_INLINE                 static inline
+    #define CY_ASSERT(x)                    HostSim_Assert((x) ? 1u : 0u, __FILE__, __LINE__)
+    #define __enable_irq()
+    #define __disable_irq()
+
+    /* Upper bound of connections any simulated device may request */
+    #define HOSTSIM_MAX_CONN                (4u)
+
+    /* Values normally taken from the generated cycfg_ble.h. The host Makefile
+    *  passes the per-application values extracted from GeneratedSource. */
+    #ifndef CY_BLE_CONN_COUNT
+        #define CY_BLE_CONN_COUNT           (0x01u)
+    #endif
+    #ifndef CY_BLE_CONFIG_L2CAP_MTU
+        #define CY_BLE_CONFIG_L2CAP_MTU     (0x500u)
+    #endif
+    #ifndef CY_BLE_CONFIG_LL_MAX_TX_PAYLOAD_SIZE
+        #define CY_BLE_CONFIG_LL_MAX_TX_PAYLOAD_SIZE (0x1Bu)
+    #endif
+    /* Discovery rows of cy_ble_serverInfo, one per connection like the Router */
+    #ifndef CY_BLE_GATTC_COUNT
+        #define CY_BLE_GATTC_COUNT          (CY_BLE_CONN_COUNT)
+    #endif
+
+    #define CY_BLE_L2CAP_MTU                (CY_BLE_CONFIG_L2CAP_MTU)
+    #define CY_BLE_L2CAP_MPS                (CY_BLE_CONFIG_L2CAP_MTU)
+    #define CY_BLE_GAP_BD_ADDR_SIZE         (0x06u)
+
+    #define CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX (0x00u)
+    #define CY_BLE_CENTRAL_CONFIGURATION_0_INDEX    (0x00u)
+    #define CY_BLE_SECURITY_CONFIGURATION_0_INDEX   (0x00u)
+
+    #define CY_BLE_UUID_INTERNET_PROTOCOL_SUPPORT_SERVICE   (0x1820u)
+    #define CY_BLE_UUID_CHAR_SERVICE_CHANGED    (0x2A05u)
+    #define CY_BLE_UUID_CHAR_CLIENT_CONFIG      (0x2902u)
+    #define CY_BLE_GATT_16_BIT_UUID_FORMAT      (0x01u)
+    #define CY_BLE_L2CAP_PSM_LE_PSM_IPSP    (0x0023u)
+
+    /***************************************
+    *       API results and events
+    ***************************************/
+    typedef enum
+    {
+        CY_BLE_SUCCESS = 0x00u,
+        CY_BLE_ERROR_INVALID_PARAMETER,
+        CY_BLE_ERROR_INVALID_OPERATION,
+        CY_BLE_ERROR_MEMORY_ALLOCATION_FAILED,
+        CY_BLE_ERROR_INSUFFICIENT_RESOURCES,
+        CY_BLE_ERROR_NO_DEVICE_ENTITY,
+        CY_BLE_ERROR_L2CAP_CONNECTION_ENTITY_NOT_FOUND,
+        CY_BLE_ERROR_NTF_DISABLED,
+        CY_BLE_ERROR_MAX = 0xFFFFu
+    } cy_en_ble_api_result_t;
+
+    typedef enum
+    {
+        CY_BLE_EVT_STACK_ON = 0x01u,
+        CY_BLE_EVT_TIMEOUT,
+        CY_BLE_EVT_HARDWARE_ERROR,
+        CY_BLE_EVT_STACK_BUSY_STATUS,
+        CY_BLE_EVT_SET_TX_PWR_COMPLETE,
+        CY_BLE_EVT_LE_SET_EVENT_MASK_COMPLETE,
+        CY_BLE_EVT_SET_DEVICE_ADDR_COMPLETE,
+        CY_BLE_EVT_GET_DEVICE_ADDR_COMPLETE,
+        CY_BLE_EVT_STACK_SHUTDOWN_COMPLETE,
+        CY_BLE_EVT_PENDING_FLASH_WRITE,
+
+        CY_BLE_EVT_GAPC_SCAN_PROGRESS_RESULT = 0x20u,
+        CY_BLE_EVT_GAPC_SCAN_START_STOP,
+        CY_BLE_EVT_GAPP_ADVERTISEMENT_START_STOP,
+        CY_BLE_EVT_GAP_AUTH_REQ,
+        CY_BLE_EVT_GAP_PASSKEY_ENTRY_REQUEST,
+        CY_BLE_EVT_GAP_PASSKEY_DISPLAY_REQUEST,
+        CY_BLE_EVT_GAP_KEYINFO_EXCHNGE_CMPLT,
+        CY_BLE_EVT_GAP_SMP_NEGOTIATED_AUTH_INFO,
+        CY_BLE_EVT_GAP_AUTH_COMPLETE,
+        CY_BLE_EVT_GAP_AUTH_FAILED,
+        CY_BLE_EVT_GAP_DEVICE_CONNECTED,
+        CY_BLE_EVT_GAP_CONNECTION_UPDATE_COMPLETE,
+        CY_BLE_EVT_GAP_KEYS_GEN_COMPLETE,
+        CY_BLE_EVT_GAP_DEVICE_DISCONNECTED,
+        CY_BLE_EVT_GAP_ENCRYPT_CHANGE,
+
+        CY_BLE_EVT_GATT_CONNECT_IND = 0x40u,
+        CY_BLE_EVT_GATT_DISCONNECT_IND,
+        CY_BLE_EVT_GATTC_ERROR_RSP,
+        CY_BLE_EVT_GATTS_READ_CHAR_VAL_ACCESS_REQ,
+        CY_BLE_EVT_GATTC_DISCOVERY_COMPLETE,
+        CY_BLE_EVT_GATTC_DISC_SKIPPED_SERVICE,
+        CY_BLE_EVT_GATTC_CHAR_DISCOVERY_COMPLETE,
+        CY_BLE_EVT_GATTC_HANDLE_VALUE_IND,
+        CY_BLE_EVT_GATTC_READ_BY_TYPE_RSP,
+        CY_BLE_EVT_GATTC_FIND_INFO_RSP,
+        CY_BLE_EVT_GATTC_WRITE_RSP,
+        CY_BLE_EVT_GATTC_LONG_PROCEDURE_END,
+
+        CY_BLE_EVT_L2CAP_CBFC_CONN_IND = 0x60u,
+        CY_BLE_EVT_L2CAP_CBFC_CONN_CNF,
+        CY_BLE_EVT_L2CAP_CBFC_DISCONN_IND,
+        CY_BLE_EVT_L2CAP_CBFC_DATA_READ,
+        CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND,
+        CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND,
+        CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND
+    } cy_en_ble_event_t;
+
+    typedef void (* cy_ble_callback_t)(uint32_t eventCode, void *eventParam);
+
+    #define CY_BLE_STACK_STATE_BUSY         (0x01u)
+    #define CY_BLE_STACK_STATE_FREE         (0x00u)
+
+    typedef enum
+    {
+        CY_BLE_GAP_ADV_FLAGS                = 0x01u,
+        CY_BLE_GAP_ADV_INCOMPL_16UUID       = 0x02u,
+        CY_BLE_GAP_ADV_COMPL_16UUID         = 0x03u,
+        CY_BLE_GAP_ADV_INCOMPL_128_UUID     = 0x06u,
+        CY_BLE_GAP_ADV_COMPL_128_UUID       = 0x07u,
+        CY_BLE_GAP_ADV_SHORT_NAME           = 0x08u,
+        CY_BLE_GAP_ADV_COMPL_NAME           = 0x09u,
+        CY_BLE_GAP_ADV_TX_PWR_LEVEL         = 0x0Au
+    } cy_en_ble_gap_adv_types_t;
+
+    /***************************************
+    *       Generic / stack types
+    ***************************************/
+    typedef struct
+    {
+        uint8_t  bdHandle;
+        uint8_t  attId;
+    } cy_stc_ble_conn_handle_t;
+
+    typedef struct
+    {
+        uint8_t  bdAddr[CY_BLE_GAP_BD_ADDR_SIZE];
+        uint8_t  type;
+    } cy_stc_ble_gap_bd_addr_t;
+
+    typedef struct
+    {
+        uint8_t  publicBdAddr[CY_BLE_GAP_BD_ADDR_SIZE];
+        uint8_t  privateBdAddr[CY_BLE_GAP_BD_ADDR_SIZE];
+    } cy_stc_ble_bd_addrs_t;
+
+    typedef struct
+    {
+        uint16_t status;
+        void     *eventParams;
+    } cy_stc_ble_events_param_generic_t;
+
+    typedef struct
+    {
+        uint8_t  majorVersion;
+        uint8_t  minorVersion;
+        uint8_t  patch;
+        uint8_t  buildNumber;
+    } cy_stc_ble_stack_lib_version_t;
+
+    typedef enum
+    {
+        CY_BLE_GAP_ADV_TO = 0x00u,
+        CY_BLE_GAP_SCAN_TO,
+        CY_BLE_GATT_RSP_TO,
+        CY_BLE_GENERIC_APP_TO
+    } cy_en_ble_to_reason_code_t;
+
+    typedef struct
+    {
+        cy_en_ble_to_reason_code_t reasonCode;
+        cy_stc_ble_conn_handle_t   connHandle;
+        uint8_t                    timerHandle;
+    } cy_stc_ble_timeout_param_t;
+
+    typedef struct
+    {
+        uint16_t timeout;           /* In seconds */
+        uint8_t  timerHandle;
+    } cy_stc_ble_timer_info_t;
+
+    /***************************************
+    *       GAP types
+    ***************************************/
+    #define CY_BLE_SCANNING_FAST            (0x00u)
+    #define CY_BLE_SCANNING_SLOW            (0x01u)
+    #define CY_BLE_ADVERTISING_FAST         (0x00u)
+    #define CY_BLE_ADVERTISING_SLOW         (0x01u)
+
+    typedef enum
+    {
+        CY_BLE_SCAN_STATE_STOPPED,
+        CY_BLE_SCAN_STATE_SCAN_INITIATED,
+        CY_BLE_SCAN_STATE_SCANNING,
+        CY_BLE_SCAN_STATE_STOP_INITIATED
+    } cy_en_ble_scan_state_t;
+
+    typedef enum
+    {
+        CY_BLE_ADV_STATE_STOPPED,
+        CY_BLE_ADV_STATE_ADV_INITIATED,
+        CY_BLE_ADV_STATE_ADVERTISING,
+        CY_BLE_ADV_STATE_STOP_INITIATED
+    } cy_en_ble_adv_state_t;
+
+    typedef struct
+    {
+        uint8_t  eventType;
+        uint8_t  peerAddrType;
+        uint8_t  *peerBdAddr;
+        uint8_t  dataLen;
+        uint8_t  *data;
+        int8_t   rssi;
+    } cy_stc_ble_gapc_adv_report_param_t;
+
+    typedef struct
+    {
+        uint8_t  status;
+        uint8_t  bdHandle;
+        uint8_t  role;
+        uint8_t  peerAddrType;
+        uint8_t  peerAddr[CY_BLE_GAP_BD_ADDR_SIZE];
+        uint16_t connIntv;
+        uint16_t connLatency;
+        uint16_t supervisionTO;
+    } cy_stc_ble_gap_connected_param_t;
+
+    typedef struct
+    {
+        uint8_t  status;
+        uint8_t  bdHandle;
+        uint16_t connIntv;
+        uint16_t connLatency;
+        uint16_t supervisionTO;
+    } cy_stc_ble_gap_conn_param_updated_in_controller_t;
+
+    #define CY_BLE_HCI_ERROR_OTHER_END_TERMINATED_USER      (0x13u)
+    #define CY_BLE_HCI_ERROR_CONNECTION_TIMEOUT             (0x08u)
+
+    typedef struct
+    {
+        uint8_t  bdHandle;
+        uint8_t  reason;
+    } cy_stc_ble_gap_disconnect_info_t;
+
+    typedef struct
+    {
+        uint8_t  status;
+        uint8_t  bdHandle;
+        uint8_t  reason;
+    } cy_stc_ble_gap_disconnect_param_t;
+
+    #define CY_BLE_GAP_SEC_MODE_1           (0x10u)
+    #define CY_BLE_GAP_SEC_LEVEL_1          (0x00u)
+    #define CY_BLE_GAP_BONDING_NONE         (0x00u)
+    #define CY_BLE_GAP_AUTH_ERROR_PAIRING_NOT_SUPPORTED     (0x05u)
+
+    typedef struct
+    {
+        uint8_t  security;
+        uint8_t  bonding;
+        uint8_t  ekeySize;
+        uint8_t  authErr;
+        uint8_t  pairingProperties;
+        uint8_t  bdHandle;
+    } cy_stc_ble_gap_auth_info_t;
+
+    #define CY_BLE_GAP_SMP_INIT_ENC_KEY_DIST    (0x01u)
+    #define CY_BLE_GAP_SMP_INIT_IRK_KEY_DIST    (0x02u)
+    #define CY_BLE_GAP_SMP_INIT_CSRK_KEY_DIST   (0x04u)
+    #define CY_BLE_GAP_SMP_RESP_ENC_KEY_DIST    (0x10u)
+    #define CY_BLE_GAP_SMP_RESP_IRK_KEY_DIST    (0x20u)
+    #define CY_BLE_GAP_SMP_RESP_CSRK_KEY_DIST   (0x40u)
+
+    typedef struct
+    {
+        uint8_t  bdHandle;
+        uint8_t  irkInfo[16u];
+    } cy_stc_ble_gap_sec_key_param_t;
+
+    typedef struct
+    {
+        cy_stc_ble_gap_sec_key_param_t SecKeyParam;
+        uint8_t  localKeysFlag;
+        uint8_t  exchangeKeysFlag;
+    } cy_stc_ble_gap_sec_key_info_t;
+
+    /***************************************
+    *       GATT types
+    ***************************************/
+    typedef struct
+    {
+        uint16_t startHandle;
+        uint16_t endHandle;
+    } cy_stc_ble_gatt_attr_handle_range_t;
+
+    typedef struct
+    {
+        cy_stc_ble_gatt_attr_handle_range_t range;
+        uint16_t uuid;
+    } cy_stc_ble_disc_srvc_info_t;
+
+    typedef struct
+    {
+        uint8_t  *val;
+        uint16_t len;
+        uint16_t actualLen;
+    } cy_stc_ble_gatt_value_t;
+
+    typedef struct
+    {
+        cy_stc_ble_gatt_value_t value;
+        uint16_t attrHandle;
+    } cy_stc_ble_gatt_handle_value_pair_t;
+
+    typedef struct
+    {
+        cy_stc_ble_conn_handle_t connHandle;
+        cy_stc_ble_gatt_handle_value_pair_t handleValPair;
+    } cy_stc_ble_gattc_handle_value_ind_param_t;
+
+    typedef struct
+    {
+        cy_stc_ble_gatt_attr_handle_range_t range;
+        cy_stc_ble_conn_handle_t connHandle;
+    } cy_stc_ble_gattc_read_by_type_req_t;
+
+    typedef struct
+    {
+        cy_stc_ble_gatt_attr_handle_range_t range;
+        cy_stc_ble_conn_handle_t connHandle;
+    } cy_stc_ble_gattc_find_info_req_t;
+
+    typedef struct
+    {
+        cy_stc_ble_gatt_handle_value_pair_t handleValPair;
+        cy_stc_ble_conn_handle_t connHandle;
+    } cy_stc_ble_gattc_write_req_t;
+
+    typedef struct
+    {
+        uint8_t  *attrValue;
+        uint16_t length;
+        uint16_t attrLen;
+    } cy_stc_ble_gattc_grp_attr_data_list_t;
+
+    typedef struct
+    {
+        cy_stc_ble_conn_handle_t connHandle;
+        cy_stc_ble_gattc_grp_attr_data_list_t attrData;
+    } cy_stc_ble_gattc_read_by_type_rsp_param_t;
+
+    typedef struct
+    {
+        uint8_t  *list;
+        uint16_t byteCount;
+    } cy_stc_ble_gattc_handle_uuid_list_param_t;
+
+    typedef struct
+    {
+        cy_stc_ble_conn_handle_t connHandle;
+        cy_stc_ble_gattc_handle_uuid_list_param_t handleValueList;
+        uint8_t  uuidFormat;
+    } cy_stc_ble_gattc_find_info_rsp_param_t;
+
+    typedef struct
+    {
+        cy_stc_ble_conn_handle_t connHandle;
+        uint8_t  opcode;
+    } cy_stc_ble_gattc_long_procedure_end_param_t;
+
+    typedef enum
+    {
+        CY_BLE_SRVI_GAP,
+        CY_BLE_SRVI_GATT,
+        CY_BLE_SRVI_IPSS,
+        CY_BLE_SRVI_COUNT
+    } cy_en_ble_srvi_t;
+
+    typedef struct
+    {
+        struct
+        {
+            uint8_t  opCode;
+            uint16_t attrHandle;
+            uint8_t  errorCode;
+        } errInfo;
+        cy_stc_ble_conn_handle_t connHandle;
+    } cy_stc_ble_gatt_err_param_t;
+
+    typedef struct
+    {
+        cy_stc_ble_conn_handle_t connHandle;
+        uint16_t attrHandle;
+        uint8_t  gattErrorCode;
+    } cy_stc_ble_gatts_char_val_read_req_t;
+
+    /***************************************
+    *       L2CAP types
+    ***************************************/
+    #define CY_BLE_L2CAP_CONNECTION_SUCCESSFUL              (0x0000u)
+    #define CY_BLE_L2CAP_CONNECTION_REFUSED_PSM_UNSUPPORTED (0x0002u)
+    #define CY_BLE_L2CAP_RESULT_SUCCESS                     (0x0000u)
+
+    typedef struct
+    {
+        uint16_t mtu;
+        uint16_t mps;
+        uint16_t credit;
+    } cy_stc_ble_l2cap_cbfc_connection_info_t;
+
+    typedef struct
+    {
+        uint16_t l2capPsm;
+        uint16_t creditLwm;
+    } cy_stc_ble_l2cap_cbfc_psm_info_t;
+
+    typedef struct
+    {
+        uint8_t  bdHandle;
+        uint16_t remotePsm;
+        uint16_t localPsm;
+        cy_stc_ble_l2cap_cbfc_connection_info_t connParam;
+    } cy_stc_ble_l2cap_cbfc_conn_req_info_t;
+
+    typedef struct
+    {
+        uint8_t  bdHandle;
+        uint16_t lCid;
+        uint16_t psm;
+        cy_stc_ble_l2cap_cbfc_connection_info_t connParam;
+    } cy_stc_ble_l2cap_cbfc_conn_ind_param_t;
+
+    typedef struct
+    {
+        uint16_t localCid;
+        uint16_t response;
+        cy_stc_ble_l2cap_cbfc_connection_info_t connParam;
+    } cy_stc_ble_l2cap_cbfc_conn_resp_info_t;
+
+    typedef struct
+    {
+        uint8_t  bdHandle;
+        uint16_t lCid;
+        uint16_t response;
+        cy_stc_ble_l2cap_cbfc_connection_info_t connParam;
+    } cy_stc_ble_l2cap_cbfc_conn_cnf_param_t;
+
+    typedef struct
+    {
+        uint16_t localCid;
+        uint16_t bufferLength;
+        uint8_t  *buffer;
+    } cy_stc_ble_l2cap_cbfc_tx_data_info_t;
+
+    typedef struct
+    {
+        uint16_t lCid;
+        uint16_t result;
+        uint8_t  *rxData;
+        uint16_t rxDataLength;
+    } cy_stc_ble_l2cap_cbfc_rx_param_t;
+
+    typedef struct
+    {
+        uint16_t lCid;
+        uint16_t result;
+        uint8_t  *buffer;
+        uint16_t bufferLength;
+    } cy_stc_ble_l2cap_cbfc_data_write_param_t;
+
+    typedef cy_stc_ble_l2cap_cbfc_data_write_param_t cy_ble_l2cap_cbfc_data_write_param_t;
+    typedef cy_stc_ble_l2cap_cbfc_data_write_param_t cy_stc_ble_l2cap_cbfc_rx_data_param_t;
+
+    typedef struct
+    {
+        uint16_t lCid;
+        uint16_t credit;
+    } cy_stc_ble_l2cap_cbfc_low_rx_credit_param_t;
+
+    typedef struct
+    {
+        uint16_t lCid;
+        uint16_t result;
+        uint16_t credit;
+    } cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t;
+
+    typedef struct
+    {
+        uint16_t localCid;
+        uint16_t credit;
+    } cy_stc_ble_l2cap_cbfc_credit_info_t;
+
+    /* Parameter of CY_BLE_EVT_STACK_BUSY_STATUS */
+    typedef struct
+    {
+        uint8_t  flowControlFlag;
+        cy_stc_ble_conn_handle_t connHandle;
+    } cy_stc_ble_l2cap_state_info_t;
+
+    /***************************************
+    *       Configuration structures
+    ***************************************/
+    typedef enum
+    {
+        bless_interrupt_IRQn            = 24,
+        srss_interrupt_mcwdt_0_IRQn     = 19,
+        scb_5_interrupt_IRQn            = 46
+    } IRQn_Type;
+
+    typedef struct
+    {
+        IRQn_Type intrSrc;
+        uint32_t  intrPriority;
+    } cy_stc_sysint_t;
+
+    typedef void (* cy_israddress)(void);
+
+    typedef struct
+    {
+        const cy_stc_sysint_t *blessIsrConfig;
+    } cy_stc_ble_hw_config_t;
+
+    typedef struct
+    {
+        cy_stc_ble_hw_config_t      *hw;
+        cy_stc_ble_gap_auth_info_t  *authInfo;
+        cy_stc_ble_gap_bd_addr_t    *deviceAddress;
+    } cy_stc_ble_config_t;
+
+    /***************************************
+    *       SysPm, GPIO and SCB
+    ***************************************/
+    #define CY_SYSPM_WAIT_FOR_INTERRUPT     (0u)
+
+    typedef struct { uint32_t dummy; } GPIO_PRT_Type;
+    typedef struct { uint32_t dummy; } CySCB_Type;
+
+    typedef struct
+    {
+        uint32_t dummy;
+    } cy_stc_scb_uart_context_t;
+
+    typedef struct
+    {
+        uint32_t oversample;
+    } cy_stc_scb_uart_config_t;
+
+    #define CY_SCB_UART_RX_NO_DATA          (0xFFFFFFFFUL)
+    #define CY_SCB_TX_INTR_LEVEL            (0x1UL)
+    #define CY_SCB_RX_INTR_NOT_EMPTY        (0x4UL)
+
+    extern CySCB_Type                       HostSim_KitUart;
+    extern const cy_stc_scb_uart_config_t   KIT_UART_config;
+    extern GPIO_PRT_Type                    HostSim_Port;
+
+    #define KIT_UART_HW                     (&HostSim_KitUart)
+    #define KIT_UART_IRQ                    scb_5_interrupt_IRQn
+    #define KIT_RGB_R_PORT                  (&HostSim_Port)
+    #define KIT_RGB_G_PORT                  (&HostSim_Port)
+    #define KIT_RGB_B_PORT                  (&HostSim_Port)
+    #define KIT_RGB_R_PIN                   (1u)
+    #define KIT_RGB_G_PIN                   (2u)
+    #define KIT_RGB_B_PIN                   (3u)
+
+    /***************************************
+    *       Core debug (DWT cycle counter)
+    ***************************************/
+    /* CYCCNT counts the cycles of a 1 GHz core: the host thread CPU time in
+    *  nanoseconds. Like the DWT of a core in deep sleep it does not count
+    *  the simulated time spent waiting for the radio; the MCWDT does. */
+    typedef struct
+    {
+        volatile uint32_t CTRL;
+        volatile uint32_t CYCCNT;
+    } DWT_Type;
+
+    typedef struct
+    {
+        volatile uint32_t DEMCR;
+    } CoreDebug_Type;
+
+    #define DWT_CTRL_CYCCNTENA_Msk          (1UL)
+    #define CoreDebug_DEMCR_TRCENA_Msk      (1UL << 24u)
+    #define DWT                             (HostSim_Dwt())
+    #define CoreDebug                       (&HostSim_CoreDebug)
+
+    extern CoreDebug_Type                   HostSim_CoreDebug;
+    extern uint32_t                         SystemCoreClock;
+    DWT_Type *HostSim_Dwt(void);
+
+    /***************************************
+    *       MCWDT
+    ***************************************/
+    /* Counter 2 counts the 32768 Hz LFCLK in simulated time, the only
+    *  counter and mode the applications use */
+    typedef struct { uint32_t dummy; } MCWDT_STRUCT_Type;
+
+    typedef enum
+    {
+        CY_MCWDT_MODE_NONE,
+        CY_MCWDT_MODE_INT,
+        CY_MCWDT_MODE_RESET,
+        CY_MCWDT_MODE_INT_RESET
+    } cy_en_mcwdtmode_t;
+
+    typedef enum
+    {
+        CY_MCWDT_COUNTER0,
+        CY_MCWDT_COUNTER1,
+        CY_MCWDT_COUNTER2
+    } cy_en_mcwdtcounter_t;
+
+    typedef enum
+    {
+        CY_MCWDT_SUCCESS                = 0x00u,
+        CY_MCWDT_BAD_PARAM              = 0x01u
+    } cy_en_mcwdt_status_t;
+
+    typedef struct
+    {
+        uint16_t            c0Match;
+        uint16_t            c1Match;
+        cy_en_mcwdtmode_t   c0Mode;
+        cy_en_mcwdtmode_t   c1Mode;
+        uint32_t            c2ToggleBit;
+        cy_en_mcwdtmode_t   c2Mode;
+        bool                c0ClearOnMatch;
+        bool                c1ClearOnMatch;
+        bool                c0c1Cascade;
+        bool                c1c2Cascade;
+    } cy_stc_mcwdt_config_t;
+
+    #define CY_MCWDT_CTR0                   (1UL)
+    #define CY_MCWDT_CTR1                   (2UL)
+    #define CY_MCWDT_CTR2                   (4UL)
+    #define CY_MCWDT_TWO_LF_CLK_CYCLES_DELAY (62u)
+    #define MCWDT_HW                        (&HostSim_Mcwdt)
+    #define MCWDT_IRQ                       srss_interrupt_mcwdt_0_IRQn
+
+    extern MCWDT_STRUCT_Type                HostSim_Mcwdt;
+    extern const cy_stc_mcwdt_config_t      MCWDT_config;
+    cy_en_mcwdt_status_t Cy_MCWDT_Init(MCWDT_STRUCT_Type *base, cy_stc_mcwdt_config_t const *config);
+    void Cy_MCWDT_Enable(MCWDT_STRUCT_Type *base, uint32_t counters, uint16_t waitUs);
+    uint32_t Cy_MCWDT_GetCount(MCWDT_STRUCT_Type const *base, cy_en_mcwdtcounter_t counter);
+
+    /***************************************
+    *       Per-device stack state
+    ***************************************/
+    /* Each simulated board has its own copy of the globals the PDL exposes.
+    *  The macros below resolve them for the board that is currently running. */
+    #define cy_ble_config                   (*HostSim_Config())
+    #define cy_ble_configPtr                (HostSim_Config())
+    #define cy_ble_deviceAddress            (*HostSim_DeviceAddress())
+    #define cy_ble_busyStatus               (HostSim_BusyStatus())
+    #define cy_ble_serverInfo               (HostSim_ServerInfo())
+
+    cy_stc_ble_config_t *HostSim_Config(void);
+    cy_stc_ble_gap_bd_addr_t *HostSim_DeviceAddress(void);
+    uint8_t *HostSim_BusyStatus(void);
+    cy_stc_ble_disc_srvc_info_t (*HostSim_ServerInfo(void))[CY_BLE_SRVI_COUNT];
+    void HostSim_Assert(uint32_t cond, const char *file, int line);
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void init_cycfg_all(void);
+
+    bool Cy_SysPm_GetIoFreezeStatus(void);
+    void Cy_SysPm_IoUnfreeze(void);
+    uint32_t Cy_SysPm_DeepSleep(uint32_t waitFor);
+    uint32_t Cy_SysPm_CpuEnterDeepSleep(uint32_t waitFor);
+    uint32_t Cy_SysPm_CpuEnterSleep(uint32_t waitFor);
+    uint32_t Cy_SysLib_EnterCriticalSection(void);
+    void Cy_SysLib_ExitCriticalSection(uint32_t savedIntrStatus);
+    uint32_t Cy_SysInt_Init(const cy_stc_sysint_t *config, cy_israddress userIsr);
+    void NVIC_EnableIRQ(IRQn_Type IRQn);
+    void Cy_GPIO_Write(GPIO_PRT_Type *base, uint32_t pinNum, uint32_t value);
+
+    uint32_t Cy_SCB_UART_Init(CySCB_Type *base, const cy_stc_scb_uart_config_t *config,
+                              cy_stc_scb_uart_context_t *context);
+    void Cy_SCB_UART_Enable(CySCB_Type *base);
+    uint32_t Cy_SCB_UART_Get(CySCB_Type const *base);
+    uint32_t Cy_SCB_UART_Put(CySCB_Type const *base, uint32_t data);
+    uint32_t Cy_SCB_GetNumInTxFifo(CySCB_Type const *base);
+    uint32_t Cy_SCB_GetTxSrValid(CySCB_Type const *base);
+    void Cy_SCB_SetTxFifoLevel(CySCB_Type *base, uint32_t level);
+    void Cy_SCB_SetTxInterruptMask(CySCB_Type *base, uint32_t interruptMask);
+    void Cy_SCB_ClearTxInterrupt(CySCB_Type *base, uint32_t interruptMask);
+    void Cy_SCB_SetRxInterruptMask(CySCB_Type *base, uint32_t interruptMask);
+    uint32_t Cy_SCB_GetRxInterruptStatusMasked(CySCB_Type const *base);
+    void Cy_SCB_ClearRxInterrupt(CySCB_Type *base, uint32_t interruptMask);
+
+    void Cy_BLE_BlessIsrHandler(void);
+    cy_en_ble_api_result_t Cy_BLE_RegisterEventCallback(cy_ble_callback_t callbackFunc);
+    cy_en_ble_api_result_t Cy_BLE_Init(cy_stc_ble_config_t *config);
+    cy_en_ble_api_result_t Cy_BLE_Enable(void);
+    cy_en_ble_api_result_t Cy_BLE_EnableLowPowerMode(void);
+    cy_en_ble_api_result_t Cy_BLE_GetStackLibraryVersion(cy_stc_ble_stack_lib_version_t *stackLibVersion);
+    void Cy_BLE_ProcessEvents(void);
+    cy_en_ble_api_result_t Cy_BLE_StartTimer(cy_stc_ble_timer_info_t *param);
+    cy_en_ble_api_result_t Cy_BLE_StopTimer(cy_stc_ble_timer_info_t *param);
+    uint8_t Cy_BLE_GetNumOfActiveConn(void);
+    cy_stc_ble_conn_handle_t Cy_BLE_GetConnHandleByBdHandle(uint8_t bdHandle);
+    uint8_t Cy_BLE_GetDiscoveryIdx(cy_stc_ble_conn_handle_t connHandle);
+    uint16_t Cy_BLE_Get16ByPtr(const uint8_t ptr[]);
+
+    cy_en_ble_api_result_t Cy_BLE_GAP_GenerateKeys(cy_stc_ble_gap_sec_key_info_t *param);
+    cy_en_ble_api_result_t Cy_BLE_GAP_SetSecurityKeys(cy_stc_ble_gap_sec_key_info_t *param);
+    cy_en_ble_api_result_t Cy_BLE_GAP_SetIdAddress(const cy_stc_ble_gap_bd_addr_t *param);
+    cy_en_ble_api_result_t Cy_BLE_GAP_GetBdAddress(void);
+    cy_en_ble_api_result_t Cy_BLE_GAP_Disconnect(cy_stc_ble_gap_disconnect_info_t *param);
+    cy_en_ble_api_result_t Cy_BLE_GAP_RemoveOldestDeviceFromBondedList(void);
+    cy_en_ble_api_result_t Cy_BLE_GAPP_AuthReqReply(cy_stc_ble_gap_auth_info_t *param);
+    cy_en_ble_api_result_t Cy_BLE_GAPP_StartAdvertisement(uint8_t advertisingIntervalType, uint8_t advertisingParamIndex);
+    cy_en_ble_api_result_t Cy_BLE_GAPP_StopAdvertisement(void);
+    cy_en_ble_adv_state_t Cy_BLE_GetAdvertisementState(void);
+    cy_en_ble_api_result_t Cy_BLE_GAPC_StartScan(uint32_t scanningIntervalType, uint8_t scanParamIndex);
+    cy_en_ble_api_result_t Cy_BLE_GAPC_StopScan(void);
+    cy_en_ble_scan_state_t Cy_BLE_GetScanState(void);
+    cy_en_ble_api_result_t Cy_BLE_GAPC_ConnectDevice(const cy_stc_ble_gap_bd_addr_t *address, uint8_t centralConnParamIndex);
+    cy_en_ble_api_result_t Cy_BLE_GAPC_CancelDeviceConnection(void);
+
+    cy_en_ble_api_result_t Cy_BLE_GATTC_StartDiscovery(cy_stc_ble_conn_handle_t connHandle);
+    cy_en_ble_api_result_t Cy_BLE_GATTC_SendConfirmation(const cy_stc_ble_conn_handle_t *connHandle);
+    cy_en_ble_api_result_t Cy_BLE_GATTC_DiscoverCharacteristics(cy_stc_ble_gattc_read_by_type_req_t *param);
+    cy_en_ble_api_result_t Cy_BLE_GATTC_DiscoverCharacteristicDescriptors(cy_stc_ble_gattc_find_info_req_t *param);
+    cy_en_ble_api_result_t Cy_BLE_GATTC_WriteCharacteristicDescriptors(cy_stc_ble_gattc_write_req_t *param);
+
+    cy_en_ble_api_result_t Cy_BLE_L2CAP_CbfcRegisterPsm(const cy_stc_ble_l2cap_cbfc_psm_info_t *param);
+    cy_en_ble_api_result_t Cy_BLE_L2CAP_CbfcConnectReq(const cy_stc_ble_l2cap_cbfc_conn_req_info_t *param);
+    cy_en_ble_api_result_t Cy_BLE_L2CAP_CbfcConnectRsp(const cy_stc_ble_l2cap_cbfc_conn_resp_info_t *param);
+    cy_en_ble_api_result_t Cy_BLE_L2CAP_CbfcSendFlowControlCredit(const cy_stc_ble_l2cap_cbfc_credit_info_t *param);
+    cy_en_ble_api_result_t Cy_BLE_L2CAP_ChannelDataWrite(const cy_stc_ble_l2cap_cbfc_tx_data_info_t *param);
+
+#endif /* CY_BLE_HOST_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,25 @@
+/*******************************************************************************
+* File Name: cycfg.h
+*
+* Version: 1.00
+*
+* Description:
+*  Host build shadow of the PDL/configurator header of the same name. All
+*  definitions live in cy_ble_host.h.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef HOSTSIM_CYCFG_H
+
+    #define HOSTSIM_CYCFG_H
+
+    #include "cy_ble_host.h"
+
+#endif
+
+/* [] END OF FILE */
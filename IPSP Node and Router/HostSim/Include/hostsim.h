@@ -0,0 +1,94 @@
+/*******************************************************************************
+* File Name: hostsim.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants used by the host loopback
+*  harness to drive the simulated BLE stack (cy_ble_host.c).
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef HOSTSIM_H
+
+    #define HOSTSIM_H
+
+    #include <stdio.h>
+    #include "cy_ble_host.h"
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    #define HOSTSIM_MAX_DEVICES         (1u + HOSTSIM_MAX_CONN)
+    #define HOSTSIM_NO_EVENT            (UINT64_MAX)
+
+    /* Simulated time is kept in microseconds */
+    #define HOSTSIM_US_PER_SEC          (1000000ull)
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    typedef struct
+    {
+        uint16_t connIntv;          /* Connection interval in 1.25 ms units */
+        uint16_t advIntv;           /* Advertising interval in 0.625 ms units */
+        uint8_t  llPayload;         /* LL data PDU payload size (27 without DLE) */
+        uint8_t  pdusPerEvent;      /* Max LL PDU exchanges per connection event */
+        uint8_t  txBuffers;         /* Stack TX buffers per connection before busy */
+        uint8_t  discEvents;        /* Connection events spent on GATT discovery */
+        uint32_t faultEvery;        /* Damage every Nth SDU delivered, 0 for none */
+    } hostsim_link_cfg_t;
+
+    typedef struct
+    {
+        uint32_t txSdu;             /* L2CAP SDUs accepted by ChannelDataWrite */
+        uint32_t txRejected;        /* ChannelDataWrite calls that failed */
+        uint64_t txBytes;
+        uint32_t rxSdu;             /* L2CAP SDUs delivered to the application */
+        uint64_t rxBytes;
+        uint32_t creditPdus;        /* Flow control credit PDUs sent */
+        uint64_t firstTx;           /* Time of first accepted SDU */
+        uint64_t lastRx;            /* Time of last delivered SDU */
+    } hostsim_dev_stats_t;
+
+    typedef struct
+    {
+        uint32_t echoed;            /* Intact echoes matched to an outstanding SDU */
+        uint32_t lost;              /* Outstanding SDUs without an echo within the echo timeout */
+        uint32_t corrupted;         /* Echoes with a wrong sent length or payload */
+        uint32_t truncated;         /* Echoes shorter than their SDU */
+        uint32_t reordered;         /* Echoes older than one already received */
+        uint32_t inFlight;          /* Outstanding SDUs when their connection closed */
+        uint32_t unmatched;         /* Echoes that matched nothing outstanding */
+        uint32_t count;             /* Number of RTT samples */
+        uint64_t *samples;          /* RTT samples in microseconds */
+    } hostsim_rtt_stats_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void HostSim_Configure(const hostsim_link_cfg_t *cfg);
+    uint8_t HostSim_AddDevice(const char *name, uint8_t addrLsb, uint8_t maxConn, int8_t rssi);
+    void HostSim_Select(uint8_t dev);
+    void HostSim_SetVerbose(bool verbose);
+    void HostSim_SetUartCapture(uint8_t dev, FILE *file);
+    void HostSim_TrackRtt(uint8_t dev);
+
+    uint64_t HostSim_Now(void);
+    uint32_t HostSim_Activity(void);
+    uint64_t HostSim_NextEventTime(void);
+    void HostSim_Advance(uint64_t time);
+
+    void HostSim_UartInject(uint8_t dev, const char *text);
+
+    const hostsim_dev_stats_t *HostSim_DevStats(uint8_t dev);
+    const hostsim_rtt_stats_t *HostSim_RttStats(void);
+
+#endif /* HOSTSIM_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,30 @@
+/*******************************************************************************
+* File Name: hostsim_app.h
+*
+* Version: 1.00
+*
+* Description:
+*  Forced include (-include) for application sources built by the host
+*  harness. Routes the applications' printf output through the simulator so
+*  that it can be tagged with the board name or suppressed.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef HOSTSIM_APP_H
+
+    #define HOSTSIM_APP_H
+
+    #include <stdio.h>
+
+    int HostSim_Printf(const char *format, ...);
+
+    #define printf                      HostSim_Printf
+
+#endif /* HOSTSIM_APP_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,68 @@
+/*******************************************************************************
+* File Name: trace_decode.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the decoder of the
+*  tokenized debug trace (DEBUG_UART_TRACE in debug.h). The decoder rebuilds
+*  the text of the records from the formats in the trace_fmt section; bytes
+*  outside records are passed through as text.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef TRACE_DECODE_H
+
+    #define TRACE_DECODE_H
+
+    #include <stdbool.h>
+    #include <stdint.h>
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    /* Record layout, the same as in debug.h */
+    #define TRACE_SYNC                  (0xA5u)
+    #define TRACE_ID_DATA               (0xFFFFu)
+    #define TRACE_ID_DROPPED            (0xFFFEu)
+
+    /* Longest text of one record */
+    #define TRACE_TEXT_MAX              (1024u)
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    typedef struct
+    {
+        const char      *formats;       /* Contents of the trace_fmt section */
+        uint32_t        formatsLen;
+        uint32_t        cpuHz;          /* Cycle counter clock, 0 for no timestamps */
+
+        uint8_t         state;
+        uint8_t         len;
+        uint8_t         pos;
+        uint8_t         rec[256u];
+        uint64_t        cycles;         /* Time of the last record */
+        bool            lineStart;
+
+        /* Statistics */
+        uint32_t        records;
+        uint32_t        recordBytes;
+        uint32_t        textBytes;      /* Text rebuilt from the records */
+        uint32_t        errors;         /* Records with an unknown ID or too short */
+    } trace_decoder_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void TraceDecode_Init(trace_decoder_t *dec, const char *formats, uint32_t formatsLen, uint32_t cpuHz);
+    uint32_t TraceDecode_Byte(trace_decoder_t *dec, uint8_t byte, char *text, uint32_t size);
+
+#endif /* TRACE_DECODE_H */
+
+/* [] END OF FILE */
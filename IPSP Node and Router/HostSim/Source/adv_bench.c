@@ -0,0 +1,418 @@
+/*******************************************************************************
+* File Name: adv_bench.c
+*
+* Version: 1.00
+*
+* Description:
+*  Host micro-benchmark of the Router scan report path.
+*
+*  Deduplication: feeds random advertising reports from 10, 100 and 1000
+*  advertisers to the advertiser table (adv_table.c) and to the linear search
+*  it replaced, and prints the cost per report and the share of reports from
+*  devices already known.
+*
+*  Parsing: runs well formed and malformed reports through the AD structure
+*  iterator, the match and the parser (adv_data.c), checks that each one is
+*  walked, accepted or rejected as expected and prints the cost per report
+*  of the match the Router runs on every report and of the full parse next
+*  to the byte walk they replaced.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "adv_table.h"
+#include "adv_data.h"
+
+/***************************************
+*           Constants
+***************************************/
+#define BENCH_REPORTS               (1000000u)
+#define BENCH_REPORTS_PER_SEC       (1000u)     /* Reports per simulated second */
+#define BENCH_MAX_ADVERTISERS       (1000u)
+#define LEGACY_MAX_ADV_DEVICES      (10u)       /* Old CY_BLE_MAX_ADV_DEVICES */
+#define PARSE_ROUNDS                (1000000u)
+#define PARSE_REPEAT                (5u)
+#define IPSS_UUID                   (0x1820u)
+
+typedef struct
+{
+    const char      *name;
+    uint8_t         len;
+    uint8_t         data[40u];
+    bool            wellFormed;         /* The old byte walk can be run on it */
+    adv_data_result_t result;           /* Expected parser result */
+    bool            match;              /* Expected IPSS match */
+    uint8_t         fields;             /* Structures the iterator returns */
+    adv_data_result_t iterEnd;          /* Expected end of the iteration */
+} parse_case_t;
+
+static const parse_case_t parseCase[] =
+{
+    { "IPSS node", 7u, { 0x02u, 0x01u, 0x06u, 0x03u, 0x03u, 0x20u, 0x18u },
+      true, ADV_DATA_OK, true, 2u, ADV_DATA_END },
+    { "crowded, no IPSS", 31u, { 0x02u, 0x01u, 0x06u, 0x09u, 0x03u, 0x0Fu, 0x18u, 0x0Au, 0x18u, 0x0Du, 0x18u,
+      0x1Au, 0x18u, 0x02u, 0x0Au, 0xF8u, 0x0Du, 0x09u, 'S', 'e', 'n', 's', 'o', 'r', '-', '1', '2', '3', '4', 0x00u,
+      0x00u },
+      true, ADV_DATA_OK, false, 4u, ADV_DATA_END },
+    { "128-bit list, IPSS last", 27u, { 0x11u, 0x07u, 0xFBu, 0x34u, 0x9Bu, 0x5Fu, 0x80u, 0x00u, 0x00u, 0x80u, 0x00u,
+      0x10u, 0x00u, 0x00u, 0x0Fu, 0x18u, 0x00u, 0x00u, 0x02u, 0x0Au, 0x00u, 0x05u, 0x03u, 0x0Fu, 0x18u, 0x20u,
+      0x18u },
+      true, ADV_DATA_OK, true, 3u, ADV_DATA_END },
+    { "empty report", 0u, { 0x00u },
+      false, ADV_DATA_OK, false, 0u, ADV_DATA_END },
+    { "zero length padding", 9u, { 0x03u, 0x03u, 0x20u, 0x18u, 0x00u, 0xFFu, 0xFFu, 0x03u, 0x03u },
+      false, ADV_DATA_OK, true, 1u, ADV_DATA_END },
+    { "zero length first", 4u, { 0x00u, 0x03u, 0x20u, 0x18u },
+      false, ADV_DATA_OK, false, 0u, ADV_DATA_END },
+    { "zero length, IPSS after", 8u, { 0x02u, 0x01u, 0x06u, 0x00u, 0x03u, 0x03u, 0x20u, 0x18u },
+      false, ADV_DATA_OK, false, 1u, ADV_DATA_END },
+    { "length past end", 7u, { 0x02u, 0x01u, 0x06u, 0x09u, 0x03u, 0x20u, 0x18u },
+      false, ADV_DATA_MALFORMED, false, 1u, ADV_DATA_MALFORMED },
+    { "length 0xFF at end", 4u, { 0x02u, 0x01u, 0x06u, 0xFFu },
+      false, ADV_DATA_MALFORMED, false, 1u, ADV_DATA_MALFORMED },
+    { "length byte last", 5u, { 0x03u, 0x03u, 0x20u, 0x18u, 0x01u },
+      false, ADV_DATA_MALFORMED, false, 1u, ADV_DATA_MALFORMED },
+    { "IPSS, then truncated name", 8u, { 0x03u, 0x03u, 0x20u, 0x18u, 0x05u, 0x09u, 'I', 'P' },
+      false, ADV_DATA_MALFORMED, false, 1u, ADV_DATA_MALFORMED },
+    { "truncated 128-bit list", 17u, { 0x11u, 0x07u, 0xFBu, 0x34u, 0x9Bu, 0x5Fu, 0x80u, 0x00u, 0x00u, 0x80u, 0x00u,
+      0x10u, 0x00u, 0x00u, 0x20u, 0x18u, 0x00u },
+      false, ADV_DATA_MALFORMED, false, 0u, ADV_DATA_MALFORMED },
+    { "odd UUID16 list", 5u, { 0x04u, 0x03u, 0x20u, 0x18u, 0x00u },
+      false, ADV_DATA_MALFORMED, false, 1u, ADV_DATA_END },
+    { "empty flags", 5u, { 0x01u, 0x01u, 0x03u, 0x03u, 0x20u },
+      false, ADV_DATA_MALFORMED, false, 1u, ADV_DATA_MALFORMED },
+    { "report over 31 bytes", 35u, { 0x03u, 0x03u, 0x20u, 0x18u, 0x1Fu, 0xFFu },
+      false, ADV_DATA_MALFORMED, false, 1u, ADV_DATA_MALFORMED },
+};
+
+typedef uint32_t (*bench_fn_t)(uint32_t advertisers);
+
+static uint8_t  benchAddr[BENCH_MAX_ADVERTISERS][CY_BLE_GAP_BD_ADDR_SIZE];
+static uint16_t benchPick[BENCH_REPORTS];
+static cy_stc_ble_gap_bd_addr_t linearAddr[BENCH_MAX_ADVERTISERS];
+volatile uint32_t benchSink;
+static const uint8_t * volatile benchData;
+
+/*******************************************************************************
+* Function Name: Random
+*******************************************************************************/
+static uint32_t Random(void)
+{
+    static uint32_t state = 0x2545F491u;
+
+    state ^= state << 13u;
+    state ^= state >> 17u;
+    state ^= state << 5u;
+    return(state);
+}
+
+/*******************************************************************************
+* Function Name: NowNs
+*******************************************************************************/
+static uint64_t NowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return(((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec);
+}
+
+/*******************************************************************************
+* Function Name: RunLinear
+********************************************************************************
+*
+* Summary:
+*  The search the Router used before: memcmp over every logged device, new
+*  devices are logged while there is room.
+*
+*******************************************************************************/
+static uint32_t RunLinear(uint32_t capacity)
+{
+    uint32_t devices = 0u;
+    uint32_t known = 0u;
+    uint32_t r;
+    uint32_t i;
+
+    for(r = 0u; r < BENCH_REPORTS; r++)
+    {
+        const uint8_t *addr = benchAddr[benchPick[r]];
+        for(i = 0u; i < devices; i++)
+        {
+            if(memcmp(linearAddr[i].bdAddr, addr, CY_BLE_GAP_BD_ADDR_SIZE) == 0)
+            {
+                break;
+            }
+        }
+        if(i < devices)
+        {
+            known++;
+        }
+        else if(devices < capacity)
+        {
+            memcpy(linearAddr[devices].bdAddr, addr, CY_BLE_GAP_BD_ADDR_SIZE);
+            devices++;
+        }
+        else
+        {
+        }
+    }
+    return(known);
+}
+
+static uint32_t RunLinearLegacy(uint32_t advertisers)
+{
+    (void)advertisers;
+    return(RunLinear(LEGACY_MAX_ADV_DEVICES));
+}
+
+static uint32_t RunLinearUnbounded(uint32_t advertisers)
+{
+    return(RunLinear(advertisers));
+}
+
+/*******************************************************************************
+* Function Name: RunHashTable
+*******************************************************************************/
+static uint32_t RunHashTable(uint32_t advertisers)
+{
+    uint32_t known = 0u;
+    uint32_t now = 0u;
+    uint32_t r;
+    bool     newDevice;
+
+    (void)advertisers;
+    AdvTable_Init();
+    for(r = 0u; r < BENCH_REPORTS; r++)
+    {
+        if((r % BENCH_REPORTS_PER_SEC) == 0u)
+        {
+            AdvTable_Age(++now);
+        }
+        benchSink += AdvTable_Update(benchAddr[benchPick[r]], 0u, (int8_t)-60, now, &newDevice);
+        if(newDevice == false)
+        {
+            known++;
+        }
+    }
+    return(known);
+}
+
+/*******************************************************************************
+* Function Name: LegacyCheckIpss
+********************************************************************************
+*
+* Summary:
+*  The byte walk the Router used before. It has no bounds checks, so it is
+*  only run on well formed reports.
+*
+*******************************************************************************/
+static __attribute__((noinline)) uint32_t LegacyCheckIpss(const uint8_t data[], uint8_t dataLen, uint16_t uuid)
+{
+    uint32_t servicePresent = 0u;
+    uint32_t advIndex = 0u;
+    uint32_t i;
+
+    do
+    {
+        if((data[advIndex + 1u] == (uint8_t)CY_BLE_GAP_ADV_INCOMPL_16UUID) ||
+           (data[advIndex + 1u] == (uint8_t)CY_BLE_GAP_ADV_COMPL_16UUID))
+        {
+            for(i = 0u; (i < (data[advIndex] - 1u)) && (servicePresent == 0u); i += sizeof(uint16_t))
+            {
+                if((uint16_t)(data[advIndex + 2u + i] | ((uint16_t)data[advIndex + 3u + i] << 8u)) == uuid)
+                {
+                    servicePresent = 1u;
+                }
+            }
+        }
+        advIndex += data[advIndex] + 1u;
+    }while((advIndex < dataLen) && (servicePresent == 0u));
+
+    return(servicePresent);
+}
+
+/*******************************************************************************
+* Function Name: IterCount
+********************************************************************************
+*
+* Summary:
+*  Walks a report with AdvData_Next() and returns the number of structures,
+*  the result that ended the walk goes to end.
+*
+*******************************************************************************/
+static uint32_t IterCount(const uint8_t data[], uint8_t len, adv_data_result_t *end)
+{
+    adv_data_iter_t iter;
+    adv_data_field_t field;
+    uint32_t count = 0u;
+
+    AdvData_IterInit(&iter, data, len);
+    while((*end = AdvData_Next(&iter, &field)) == ADV_DATA_OK)
+    {
+        count++;
+    }
+    return(count);
+}
+
+/*******************************************************************************
+* Function Name: RunParse
+********************************************************************************
+*
+* Summary:
+*  Checks every parse case against its expected result and prints the cost
+*  per report. Returns the number of cases that did not behave as expected.
+*
+*******************************************************************************/
+static uint32_t RunParse(void)
+{
+    static const adv_data_uuid_t ipss = { .size = ADV_DATA_UUID16_SIZE, .uuid16 = IPSS_UUID };
+    adv_data_info_t info;
+    adv_data_result_t result;
+    adv_data_result_t iterEnd;
+    uint32_t fields;
+    uint32_t match;
+    uint32_t failed = 0u;
+    uint32_t c;
+    uint32_t r;
+    uint32_t k;
+
+    printf("\nAD structure parsing, %u rounds per report\n", (unsigned)PARSE_ROUNDS);
+    printf("%-26s %-10s %5s %6s %12s %12s %12s\n", "report", "result", "ipss", "fields", "ns (match)", "ns (parser)",
+        "ns (old)");
+    for(c = 0u; c < (sizeof(parseCase) / sizeof(parseCase[0u])); c++)
+    {
+        const parse_case_t *t = &parseCase[c];
+        uint64_t start;
+        uint64_t matchNs;
+        uint64_t parseNs;
+        uint64_t legacyNs;
+        uint64_t elapsed;
+        bool     ok;
+
+        benchData = t->data;
+
+        result = AdvData_Parse(t->data, t->len, &ipss, 1u, &info);
+        match = AdvData_Match(t->data, t->len, &ipss, 1u);
+        fields = IterCount(t->data, t->len, &iterEnd);
+        ok = (result == t->result) && ((info.match != 0u) == t->match) && (match == info.match) &&
+             (fields == t->fields) && (iterEnd == t->iterEnd);
+        if((t->wellFormed == true) && ((LegacyCheckIpss(t->data, t->len, IPSS_UUID) != 0u) != t->match))
+        {
+            ok = false;
+        }
+
+        /* Best of several runs, the report is read through a volatile
+         * pointer so that the compiler cannot hoist the call */
+        matchNs = UINT64_MAX;
+        parseNs = UINT64_MAX;
+        legacyNs = UINT64_MAX;
+        for(k = 0u; k < PARSE_REPEAT; k++)
+        {
+            start = NowNs();
+            for(r = 0u; r < PARSE_ROUNDS; r++)
+            {
+                benchSink += AdvData_Match(benchData, t->len, &ipss, 1u);
+            }
+            elapsed = NowNs() - start;
+            matchNs = (elapsed < matchNs) ? elapsed : matchNs;
+            start = NowNs();
+            for(r = 0u; r < PARSE_ROUNDS; r++)
+            {
+                benchSink += AdvData_Parse(benchData, t->len, &ipss, 1u, &info);
+            }
+            elapsed = NowNs() - start;
+            parseNs = (elapsed < parseNs) ? elapsed : parseNs;
+            if(t->wellFormed == true)
+            {
+                start = NowNs();
+                for(r = 0u; r < PARSE_ROUNDS; r++)
+                {
+                    benchSink += LegacyCheckIpss(benchData, t->len, IPSS_UUID);
+                }
+                elapsed = NowNs() - start;
+                legacyNs = (elapsed < legacyNs) ? elapsed : legacyNs;
+            }
+        }
+
+        printf("%-26s %-10s %5s %6u %12.1f %12.1f ", t->name, (result == ADV_DATA_OK) ? "ok" : "malformed",
+            (info.match != 0u) ? "yes" : "no", (unsigned)fields, (double)matchNs / (double)PARSE_ROUNDS,
+            (double)parseNs / (double)PARSE_ROUNDS);
+        if(t->wellFormed == true)
+        {
+            printf("%12.1f", (double)legacyNs / (double)PARSE_ROUNDS);
+        }
+        else
+        {
+            printf("%12s", "unsafe");
+        }
+        printf("%s\n", ok ? "" : "  UNEXPECTED");
+        if(!ok)
+        {
+            failed++;
+        }
+    }
+    return(failed);
+}
+
+/*******************************************************************************
+* Function Name: main
+*******************************************************************************/
+int main(void)
+{
+    static const uint32_t advertisers[] = { 10u, 100u, 1000u };
+    static const struct
+    {
+        const char *name;
+        bench_fn_t run;
+    } method[] =
+    {
+        { "linear, 10 devices", RunLinearLegacy },
+        { "linear, unbounded",  RunLinearUnbounded },
+        { "hash table",         RunHashTable },
+    };
+    uint32_t a;
+    uint32_t m;
+    uint32_t i;
+
+    for(i = 0u; i < BENCH_MAX_ADVERTISERS; i++)
+    {
+        uint32_t r = Random();
+        benchAddr[i][0u] = (uint8_t)r;
+        benchAddr[i][1u] = (uint8_t)(r >> 8u);
+        benchAddr[i][2u] = (uint8_t)(r >> 16u);
+        benchAddr[i][3u] = 0x50u;
+        benchAddr[i][4u] = 0xA0u;
+        benchAddr[i][5u] = 0x00u;
+    }
+
+    printf("Scan report deduplication, %u reports, advertiser table of %u entries\n",
+        (unsigned)BENCH_REPORTS, (unsigned)ADV_TABLE_SIZE);
+    printf("%-12s %-20s %10s %8s\n", "advertisers", "method", "ns/report", "known");
+    for(a = 0u; a < (sizeof(advertisers) / sizeof(advertisers[0u])); a++)
+    {
+        for(i = 0u; i < BENCH_REPORTS; i++)
+        {
+            benchPick[i] = (uint16_t)(Random() % advertisers[a]);
+        }
+        for(m = 0u; m < (sizeof(method) / sizeof(method[0u])); m++)
+        {
+            uint64_t start = NowNs();
+            uint32_t known = method[m].run(advertisers[a]);
+            uint64_t ns = NowNs() - start;
+
+            printf("%-12u %-20s %10.1f %7.1f%%\n", (unsigned)advertisers[a], method[m].name,
+                (double)ns / (double)BENCH_REPORTS, (100.0 * (double)known) / (double)BENCH_REPORTS);
+        }
+    }
+    return((RunParse() == 0u) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,2032 @@
+/*******************************************************************************
+* File Name: cy_ble_host.c
+*
+* Version: 1.00
+*
+* Description:
+*  Host (Linux) stand-in for the BLE stack calls used by the IPSP Router and
+*  Node applications. Several simulated boards share one process; the harness
+*  selects the board that runs next with HostSim_Select() and every Cy_BLE_*
+*  call operates on that board.
+*
+*  The radio is modelled per connection event: LL data PDUs of llPayload bytes
+*  are exchanged master/slave with T_IFS spacing until the event runs out of
+*  time or pdusPerEvent exchanges. L2CAP SDUs are segmented into K-frames of
+*  the peer's MPS, consume one TX credit per K-frame and are delivered as
+*  CY_BLE_EVT_L2CAP_CBFC_DATA_READ once their last byte is on the air.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+#include "hostsim.h"
+#include "trace_decode.h"
+
+/***************************************
+*           Constants
+***************************************/
+#define HOSTSIM_EVT_QUEUE_LEN       (512u)
+#define HOSTSIM_PDU_QUEUE_LEN       (64u)
+#define HOSTSIM_MAX_TIMERS          (4u)
+#define HOSTSIM_UART_RX_LEN         (256u)
+#define HOSTSIM_MAX_LINKS           (HOSTSIM_MAX_CONN)
+#define HOSTSIM_MAX_OUTSTANDING     (256u)
+#define HOSTSIM_CID_BASE            (0x0040u)
+#define HOSTSIM_T_IFS_US            (150u)
+#define HOSTSIM_LL_OVERHEAD         (10u)       /* Preamble, AA, header, CRC */
+#define HOSTSIM_L2CAP_HDR           (4u)
+#define HOSTSIM_SDU_LEN_FIELD       (2u)
+#define HOSTSIM_SIG_PDU_LEN         (14u)       /* L2CAP signaling PDU on air */
+#define HOSTSIM_CONN_SETUP_US       (2500u)
+/* Longest headers in front of the loopback payload: the 6LoWPAN dispatch
+ * and uncompressed IPv6 and UDP headers */
+#define HOSTSIM_ECHO_HEADER_LEN     (49u)
+/* The Router declares an SDU lost on the first timer tick at least
+ * LOOPBACK_ECHO_TIMEOUT (2 s) after its send */
+#define HOSTSIM_ECHO_TIMEOUT_US     (2000000u)
+/* Loopback header of the Router payload: sequence number and sent length */
+#define HOSTSIM_LOOPBACK_HEADER_LEN (4u)
+#define HOSTSIM_NO_HEADER           (0xFFFFu)
+#define HOSTSIM_PRINTF_BUF          (1024u)
+
+/* IPSS advertising payload: flags + complete list of 16-bit UUIDs */
+static const uint8_t hostsimAdvData[] = { 0x02u, 0x01u, 0x06u, 0x03u, 0x03u, 0x20u, 0x18u };
+
+typedef enum
+{
+    HOSTSIM_PDU_DATA,
+    HOSTSIM_PDU_CONN_REQ,
+    HOSTSIM_PDU_CONN_RSP,
+    HOSTSIM_PDU_CREDIT
+} hostsim_pdu_kind_t;
+
+typedef enum
+{
+    HOSTSIM_ATT_NONE,
+    HOSTSIM_ATT_READ_BY_TYPE,
+    HOSTSIM_ATT_FIND_INFO,
+    HOSTSIM_ATT_WRITE
+} hostsim_att_op_t;
+
+typedef enum
+{
+    HOSTSIM_CHAN_CLOSED,
+    HOSTSIM_CHAN_PENDING,
+    HOSTSIM_CHAN_OPEN
+} hostsim_chan_state_t;
+
+/***************************************
+*       Data Types
+***************************************/
+typedef struct
+{
+    uint32_t event;
+    union
+    {
+        cy_stc_ble_timeout_param_t                  timeout;
+        cy_stc_ble_gapc_adv_report_param_t          advReport;
+        cy_stc_ble_gap_connected_param_t            connected;
+        cy_stc_ble_gap_disconnect_param_t           disconnected;
+        cy_stc_ble_conn_handle_t                    connHandle;
+        cy_stc_ble_l2cap_cbfc_conn_ind_param_t      connInd;
+        cy_stc_ble_l2cap_cbfc_conn_cnf_param_t      connCnf;
+        cy_stc_ble_l2cap_cbfc_rx_param_t            rx;
+        cy_stc_ble_l2cap_cbfc_low_rx_credit_param_t rxCredit;
+        cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t txCredit;
+        cy_stc_ble_l2cap_cbfc_data_write_param_t    dataWrite;
+        cy_stc_ble_l2cap_state_info_t               busy;
+        cy_stc_ble_gap_sec_key_param_t              keys;
+        cy_stc_ble_events_param_generic_t           generic;
+        cy_stc_ble_gatt_err_param_t                 err;
+        cy_stc_ble_gattc_read_by_type_rsp_param_t   readByType;
+        cy_stc_ble_gattc_find_info_rsp_param_t      findInfo;
+        cy_stc_ble_gattc_long_procedure_end_param_t longEnd;
+        uint16_t                                    cid;
+    } param;
+    cy_stc_ble_bd_addrs_t   addrs;
+    uint8_t                 peerAddr[CY_BLE_GAP_BD_ADDR_SIZE];
+    uint8_t                 *blob;
+    uint16_t                blobLen;
+} hostsim_evt_t;
+
+typedef struct
+{
+    uint8_t  kind;
+    uint16_t value;                 /* Credits (CREDIT) or response (CONN_RSP) */
+    uint16_t psm;
+    cy_stc_ble_l2cap_cbfc_connection_info_t connParam;
+    uint8_t  *data;
+    uint16_t len;
+    uint16_t kframes;
+    uint32_t airLeft;               /* L2CAP bytes still to go over the air */
+} hostsim_pdu_t;
+
+typedef struct
+{
+    hostsim_pdu_t pdu[HOSTSIM_PDU_QUEUE_LEN];
+    uint8_t  head;
+    uint8_t  count;
+    uint8_t  dataCount;
+} hostsim_pdu_queue_t;
+
+typedef struct
+{
+    bool     active;
+    uint8_t  dev[2u];               /* [0] = central, [1] = peripheral */
+    uint8_t  slot[2u];              /* bdHandle/attId of the link on each side */
+    uint64_t nextEvent;
+    uint8_t  discLeft;
+    bool     discBound;             /* StartDiscovery bound a cy_ble_serverInfo row */
+    uint8_t  attOp;                 /* ATT request of the central waiting for its response */
+    cy_stc_ble_gatt_attr_handle_range_t attRange;
+    bool     terminate;
+    uint8_t  reason;
+    uint8_t  chan[2u];
+    uint16_t psm;
+    uint16_t cid[2u];
+    uint16_t mtu[2u];               /* Receive MTU/MPS announced by each side */
+    uint16_t mps[2u];
+    uint32_t txCredits[2u];         /* K-frames each side may still send */
+    uint32_t rxCredits[2u];         /* K-frames each side still accepts */
+    bool     lowSignalled[2u];
+    hostsim_pdu_queue_t q[2u];      /* Indexed by sending side */
+} hostsim_link_t;
+
+typedef struct
+{
+    bool     active;
+    uint8_t  handle;
+    uint64_t expiry;
+} hostsim_timer_t;
+
+typedef struct
+{
+    bool                            used;
+    char                            name[16u];
+    uint8_t                         maxConn;
+    int8_t                          rssi;
+    cy_ble_callback_t               callback;
+    cy_stc_ble_config_t             config;
+    cy_stc_ble_hw_config_t          hw;
+    cy_stc_ble_gap_auth_info_t      authInfo[1u];
+    cy_stc_ble_gap_bd_addr_t        address;
+    uint8_t                         busyStatus[HOSTSIM_MAX_CONN];
+    cy_stc_ble_disc_srvc_info_t     serverInfo[HOSTSIM_MAX_CONN][CY_BLE_SRVI_COUNT];
+    int8_t                          link[HOSTSIM_MAX_CONN];
+
+    hostsim_evt_t                   evt[HOSTSIM_EVT_QUEUE_LEN];
+    uint16_t                        evtHead;
+    uint16_t                        evtCount;
+
+    cy_en_ble_scan_state_t          scanState;
+    cy_en_ble_adv_state_t           advState;
+    uint64_t                        nextAdv;
+    bool                            connectPending;
+    cy_stc_ble_gap_bd_addr_t        connectAddr;
+    uint16_t                        creditLwm;
+
+    hostsim_timer_t                 timer[HOSTSIM_MAX_TIMERS];
+    uint8_t                         nextTimerHandle;
+
+    char                            uart[HOSTSIM_UART_RX_LEN];
+    uint16_t                        uartRd;
+    uint16_t                        uartWr;
+    bool                            lineStart;
+    cy_israddress                   uartIsr;
+    bool                            uartIrqEnabled;
+    uint32_t                        uartTxMask;
+    uint32_t                        uartRxMask;
+    bool                            uartInIsr;
+    trace_decoder_t                 trace;              /* Decodes DEBUG_UART_TRACE records */
+    FILE                            *uartCapture;       /* Receives the raw UART output */
+
+    hostsim_dev_stats_t             stats;
+} hostsim_dev_t;
+
+typedef struct
+{
+    uint64_t time;
+    uint32_t seq;               /* Send order on the connection, from 1 */
+    uint16_t len;
+    uint16_t id;                /* Sequence number in the loopback header */
+    uint8_t  *data;
+} hostsim_outstanding_t;
+
+/* Attribute of the peripheral GATT database. A characteristic declaration
+ * (0x2803) has its value in the next handle. */
+typedef struct
+{
+    uint16_t handle;
+    uint16_t type;
+    uint8_t  props;                 /* Characteristic declaration only */
+    uint16_t uuid;                  /* Characteristic declaration only */
+} hostsim_attr_t;
+
+/* GATT database of every peripheral, in the service ranges the discovery
+ * reports: GAP, GATT with Service Changed, and IPSS */
+static const hostsim_attr_t hostsimGattDb[] =
+{
+    { 0x0001u, 0x2800u, 0x00u, 0x0000u },
+    { 0x0002u, 0x2803u, 0x02u, 0x2A00u },
+    { 0x0003u, 0x2A00u, 0x00u, 0x0000u },
+    { 0x0004u, 0x2803u, 0x02u, 0x2A01u },
+    { 0x0005u, 0x2A01u, 0x00u, 0x0000u },
+    { 0x0006u, 0x2803u, 0x02u, 0x2A04u },
+    { 0x0007u, 0x2A04u, 0x00u, 0x0000u },
+    { 0x0008u, 0x2800u, 0x00u, 0x0000u },
+    { 0x0009u, 0x2803u, 0x20u, CY_BLE_UUID_CHAR_SERVICE_CHANGED },
+    { 0x000Au, CY_BLE_UUID_CHAR_SERVICE_CHANGED, 0x00u, 0x0000u },
+    { 0x000Bu, CY_BLE_UUID_CHAR_CLIENT_CONFIG, 0x00u, 0x0000u },
+    { 0x000Cu, 0x2800u, 0x00u, 0x0000u }
+};
+#define HOSTSIM_GATT_DB_LEN         (sizeof(hostsimGattDb) / sizeof(hostsimGattDb[0u]))
+
+/***************************************
+*       Module state
+***************************************/
+/* Formats of the applications built with DEBUG_UART_TRACE, if any */
+extern const char                   __start_trace_fmt[] __attribute__((weak));
+extern const char                   __stop_trace_fmt[] __attribute__((weak));
+
+CySCB_Type                          HostSim_KitUart;
+GPIO_PRT_Type                       HostSim_Port;
+const cy_stc_scb_uart_config_t      KIT_UART_config = { .oversample = 12u };
+CoreDebug_Type                      HostSim_CoreDebug;
+uint32_t                            SystemCoreClock = 1000000000u;    /* The DWT counts nanoseconds */
+MCWDT_STRUCT_Type                   HostSim_Mcwdt;
+const cy_stc_mcwdt_config_t         MCWDT_config = { .c2Mode = CY_MCWDT_MODE_NONE, .c2ToggleBit = 16u };
+static DWT_Type                     simDwt;
+
+static hostsim_link_cfg_t           simCfg =
+{
+    .connIntv     = 6u,             /* 7.5 ms, gapcConnectionIntervalMin */
+    .advIntv      = 0x20u,          /* 20 ms, fastAdvIntervalMin */
+    .llPayload    = CY_BLE_CONFIG_LL_MAX_TX_PAYLOAD_SIZE,
+    .pdusPerEvent = 6u,
+    .txBuffers    = 4u,
+    .discEvents   = 8u,
+    .faultEvery   = 0u
+};
+static hostsim_dev_t                simDev[HOSTSIM_MAX_DEVICES];
+static uint32_t                     simFaultCount;              /* SDUs delivered, for fault injection */
+static hostsim_link_t               simLink[HOSTSIM_MAX_LINKS];
+static uint8_t                      simCur;
+static uint64_t                     simNow;
+static uint64_t                     simStamp;       /* Time inside the current connection event */
+static uint32_t                     simActivity;
+static bool                         simVerbose;
+static int16_t                      simLineDev = -1;    /* Device whose output line is open */
+static int16_t                      simRttDev = -1;
+static hostsim_outstanding_t        simOut[HOSTSIM_MAX_CONN][HOSTSIM_MAX_OUTSTANDING];
+static uint16_t                     simOutHead[HOSTSIM_MAX_CONN];   /* Per connection of the tracked device */
+static uint16_t                     simOutCount[HOSTSIM_MAX_CONN];
+static uint32_t                     simOutSeq[HOSTSIM_MAX_CONN];    /* Last SDU sent */
+static uint32_t                     simOutNewest[HOSTSIM_MAX_CONN]; /* Newest SDU echoed */
+static uint16_t                     simOutHdr[HOSTSIM_MAX_CONN];    /* Loopback header offset */
+static hostsim_rtt_stats_t          simRtt;
+static uint32_t                     simRttCap;
+
+static void UartIrq(void);
+
+/*******************************************************************************
+*        Internal helpers
+*******************************************************************************/
+static hostsim_dev_t *Cur(void)
+{
+    return(&simDev[simCur]);
+}
+
+static uint32_t ConnIntvUs(void)
+{
+    return((uint32_t)simCfg.connIntv * 1250u);
+}
+
+static hostsim_evt_t *Post(uint8_t dev, uint32_t event)
+{
+    hostsim_dev_t *d = &simDev[dev];
+    hostsim_evt_t *e;
+
+    if(d->evtCount >= HOSTSIM_EVT_QUEUE_LEN)
+    {
+        fprintf(stderr, "hostsim: %s event queue overflow\n", d->name);
+        abort();
+    }
+    e = &d->evt[(d->evtHead + d->evtCount) % HOSTSIM_EVT_QUEUE_LEN];
+    d->evtCount++;
+    memset(e, 0, sizeof(*e));
+    e->event = event;
+    simActivity++;
+    return(e);
+}
+
+static void PostConnHandle(uint8_t dev, uint32_t event, uint8_t slot)
+{
+    hostsim_evt_t *e = Post(dev, event);
+    e->param.connHandle.bdHandle = slot;
+    e->param.connHandle.attId = slot;
+}
+
+static uint8_t SideOf(const hostsim_link_t *l, uint8_t dev)
+{
+    return((l->dev[0u] == dev) ? 0u : 1u);
+}
+
+static hostsim_link_t *LinkBySlot(uint8_t dev, uint8_t slot)
+{
+    if((slot < HOSTSIM_MAX_CONN) && (simDev[dev].link[slot] >= 0))
+    {
+        return(&simLink[simDev[dev].link[slot]]);
+    }
+    return(NULL);
+}
+
+static hostsim_link_t *LinkByCid(uint8_t dev, uint16_t cid, uint8_t *side)
+{
+    uint32_t i;
+
+    for(i = 0u; i < HOSTSIM_MAX_LINKS; i++)
+    {
+        hostsim_link_t *l = &simLink[i];
+        if(l->active)
+        {
+            uint8_t s = SideOf(l, dev);
+            if((l->dev[s] == dev) && (l->chan[s] != HOSTSIM_CHAN_CLOSED) && (l->cid[s] == cid))
+            {
+                *side = s;
+                return(l);
+            }
+        }
+    }
+    return(NULL);
+}
+
+static void UpdateBusy(hostsim_link_t *l, uint8_t side)
+{
+    hostsim_dev_t *d = &simDev[l->dev[side]];
+    uint8_t slot = l->slot[side];
+    uint8_t busy = (l->q[side].dataCount >= simCfg.txBuffers) ? CY_BLE_STACK_STATE_BUSY : CY_BLE_STACK_STATE_FREE;
+
+    if(d->busyStatus[slot] != busy)
+    {
+        hostsim_evt_t *e = Post(l->dev[side], CY_BLE_EVT_STACK_BUSY_STATUS);
+        d->busyStatus[slot] = busy;
+        e->param.busy.flowControlFlag = busy;
+        e->param.busy.connHandle.bdHandle = slot;
+        e->param.busy.connHandle.attId = slot;
+    }
+}
+
+static hostsim_pdu_t *Enqueue(hostsim_link_t *l, uint8_t side, uint8_t kind)
+{
+    hostsim_pdu_queue_t *q = &l->q[side];
+    hostsim_pdu_t *p;
+
+    if(q->count >= HOSTSIM_PDU_QUEUE_LEN)
+    {
+        return(NULL);
+    }
+    p = &q->pdu[(q->head + q->count) % HOSTSIM_PDU_QUEUE_LEN];
+    q->count++;
+    memset(p, 0, sizeof(*p));
+    p->kind = kind;
+    p->airLeft = HOSTSIM_SIG_PDU_LEN;
+    simActivity++;
+    return(p);
+}
+
+static void FlushQueue(hostsim_pdu_queue_t *q)
+{
+    while(q->count != 0u)
+    {
+        free(q->pdu[q->head].data);
+        q->head = (uint8_t)((q->head + 1u) % HOSTSIM_PDU_QUEUE_LEN);
+        q->count--;
+    }
+    q->dataCount = 0u;
+}
+
+static uint32_t AirTimeUs(uint32_t payload)
+{
+    return((HOSTSIM_LL_OVERHEAD + payload) * 8u);
+}
+
+/*******************************************************************************
+*        RTT bookkeeping for the tracked (Router) device
+*******************************************************************************/
+static void RttDrop(uint8_t slot)
+{
+    free(simOut[slot][simOutHead[slot]].data);
+    simOutHead[slot] = (uint16_t)((simOutHead[slot] + 1u) % HOSTSIM_MAX_OUTSTANDING);
+    simOutCount[slot]--;
+}
+
+/* Removes an outstanding SDU that is not the oldest, keeping the send order */
+static void RttRemove(uint8_t slot, uint16_t index)
+{
+    uint16_t i;
+
+    free(simOut[slot][(simOutHead[slot] + index) % HOSTSIM_MAX_OUTSTANDING].data);
+    for(i = index; (i + 1u) < simOutCount[slot]; i++)
+    {
+        simOut[slot][(simOutHead[slot] + i) % HOSTSIM_MAX_OUTSTANDING] =
+            simOut[slot][(simOutHead[slot] + i + 1u) % HOSTSIM_MAX_OUTSTANDING];
+    }
+    simOutCount[slot]--;
+}
+
+static uint16_t Le16(const uint8_t *data)
+{
+    return((uint16_t)(data[0u] | ((uint16_t)data[1u] << 8u)));
+}
+
+/* Offset of the loopback header in an SDU of the Router: the first one past
+ * the compressed headers whose sent length is the rest of the SDU. The
+ * compressed headers of a connection have one length, so it is taken from
+ * the first SDU only. */
+static uint16_t RttHeader(uint8_t slot, const uint8_t *data, uint16_t len)
+{
+    uint16_t h;
+
+    if(simOutHdr[slot] != HOSTSIM_NO_HEADER)
+    {
+        return(simOutHdr[slot]);
+    }
+    for(h = 0u; (h <= HOSTSIM_ECHO_HEADER_LEN) && ((h + HOSTSIM_LOOPBACK_HEADER_LEN) <= len); h++)
+    {
+        if(Le16(&data[h + 2u]) == (uint16_t)(len - h))
+        {
+            simOutHdr[slot] = h;
+            break;
+        }
+    }
+    return(simOutHdr[slot]);
+}
+
+static void RttOnTx(uint8_t slot, const uint8_t *data, uint16_t len)
+{
+    hostsim_outstanding_t *o;
+
+    if(simOutCount[slot] >= HOSTSIM_MAX_OUTSTANDING)
+    {
+        RttDrop(slot);
+        simRtt.lost++;
+    }
+    o = &simOut[slot][(simOutHead[slot] + simOutCount[slot]) % HOSTSIM_MAX_OUTSTANDING];
+    o->time = simNow;
+    o->seq = ++simOutSeq[slot];
+    o->len = len;
+    o->id = (RttHeader(slot, data, len) != HOSTSIM_NO_HEADER) ? Le16(&data[simOutHdr[slot]]) : 0u;
+    o->data = malloc(len);
+    memcpy(o->data, data, len);
+    simOutCount[slot]++;
+}
+
+/* Lost as the Router counts them: on its timer tick, the SDUs sent at least
+ * the echo timeout before */
+static void RttExpire(void)
+{
+    uint8_t slot;
+    uint16_t i;
+
+    for(slot = 0u; slot < HOSTSIM_MAX_CONN; slot++)
+    {
+        for(i = 0u; i < simOutCount[slot]; )
+        {
+            hostsim_outstanding_t *o = &simOut[slot][(simOutHead[slot] + i) % HOSTSIM_MAX_OUTSTANDING];
+
+            if(simNow >= (o->time + HOSTSIM_ECHO_TIMEOUT_US))
+            {
+                simRtt.lost++;
+                RttRemove(slot, i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+}
+
+/* Finds the SDU of an echo by the sequence number in its loopback header,
+ * then classifies the echo the way LoopbackCheckEcho() of the Router does.
+ * The echo of the Node has compressed headers as long as the request. */
+static void RttOnRx(uint8_t slot, const uint8_t *data, uint16_t len)
+{
+    hostsim_outstanding_t *o = NULL;
+    uint16_t hdr = simOutHdr[slot];
+    uint16_t i;
+    uint16_t sent;
+
+    if(hdr == HOSTSIM_NO_HEADER)
+    {
+        simRtt.unmatched++;
+        return;
+    }
+    if(len < (hdr + HOSTSIM_LOOPBACK_HEADER_LEN))
+    {
+        /* The SDU cannot be identified, it times out */
+        simRtt.truncated++;
+        return;
+    }
+    for(i = 0u; i < simOutCount[slot]; i++)
+    {
+        o = &simOut[slot][(simOutHead[slot] + i) % HOSTSIM_MAX_OUTSTANDING];
+        if(o->id == Le16(&data[hdr]))
+        {
+            break;
+        }
+    }
+    if(i == simOutCount[slot])
+    {
+        simRtt.unmatched++;
+        return;
+    }
+
+    /* SDUs sent before the matched one stay outstanding, their echo may
+     * still come; the Router counts an echo older than one it already
+     * received as reordered */
+    if(o->seq < simOutNewest[slot])
+    {
+        simRtt.reordered++;
+    }
+    else
+    {
+        simOutNewest[slot] = o->seq;
+    }
+
+    sent = Le16(&data[hdr + 2u]);
+    if((sent != (uint16_t)(o->len - hdr)) || (len > o->len))
+    {
+        simRtt.corrupted++;
+    }
+    else if(len < o->len)
+    {
+        simRtt.truncated++;
+    }
+    else if(memcmp(&o->data[hdr], &data[hdr], len - hdr) != 0)
+    {
+        simRtt.corrupted++;
+    }
+    else
+    {
+        if(simRtt.count >= simRttCap)
+        {
+            simRttCap = (simRttCap == 0u) ? 1024u : (simRttCap * 2u);
+            simRtt.samples = realloc(simRtt.samples, simRttCap * sizeof(uint64_t));
+        }
+        simRtt.samples[simRtt.count++] = simStamp - o->time;
+        simRtt.echoed++;
+    }
+    RttRemove(slot, i);
+}
+
+/*******************************************************************************
+*        Link layer model
+*******************************************************************************/
+static void CreateLink(uint8_t central, uint8_t peripheral)
+{
+    hostsim_dev_t *c = &simDev[central];
+    hostsim_dev_t *p = &simDev[peripheral];
+    hostsim_link_t *l = NULL;
+    uint8_t cSlot;
+    uint8_t pSlot;
+    uint32_t i;
+    hostsim_evt_t *e;
+
+    for(cSlot = 0u; (cSlot < c->maxConn) && (c->link[cSlot] >= 0); cSlot++)
+    {
+    }
+    for(pSlot = 0u; (pSlot < p->maxConn) && (p->link[pSlot] >= 0); pSlot++)
+    {
+    }
+    for(i = 0u; i < HOSTSIM_MAX_LINKS; i++)
+    {
+        if(!simLink[i].active)
+        {
+            l = &simLink[i];
+            break;
+        }
+    }
+    if((l == NULL) || (cSlot >= c->maxConn) || (pSlot >= p->maxConn))
+    {
+        return;
+    }
+
+    memset(l, 0, sizeof(*l));
+    l->active = true;
+    l->dev[0u] = central;
+    l->dev[1u] = peripheral;
+    l->slot[0u] = cSlot;
+    l->slot[1u] = pSlot;
+    l->nextEvent = simNow + HOSTSIM_CONN_SETUP_US;
+    c->link[cSlot] = (int8_t)i;
+    p->link[pSlot] = (int8_t)i;
+    c->connectPending = false;
+
+    p->advState = CY_BLE_ADV_STATE_STOPPED;
+    (void)Post(peripheral, CY_BLE_EVT_GAPP_ADVERTISEMENT_START_STOP);
+
+    e = Post(central, CY_BLE_EVT_GAP_DEVICE_CONNECTED);
+    e->param.connected.bdHandle = cSlot;
+    e->param.connected.role = 0u;
+    e->param.connected.connIntv = simCfg.connIntv;
+    e->param.connected.supervisionTO = 0x03E8u;
+    memcpy(e->param.connected.peerAddr, p->address.bdAddr, CY_BLE_GAP_BD_ADDR_SIZE);
+    PostConnHandle(central, CY_BLE_EVT_GATT_CONNECT_IND, cSlot);
+
+    e = Post(peripheral, CY_BLE_EVT_GAP_DEVICE_CONNECTED);
+    e->param.connected.bdHandle = pSlot;
+    e->param.connected.role = 1u;
+    e->param.connected.connIntv = simCfg.connIntv;
+    e->param.connected.supervisionTO = 0x03E8u;
+    memcpy(e->param.connected.peerAddr, c->address.bdAddr, CY_BLE_GAP_BD_ADDR_SIZE);
+    PostConnHandle(peripheral, CY_BLE_EVT_GATT_CONNECT_IND, pSlot);
+}
+
+static void TeardownLink(hostsim_link_t *l)
+{
+    uint8_t side;
+
+    l->active = false;
+    for(side = 0u; side < 2u; side++)
+    {
+        uint8_t dev = l->dev[side];
+        uint8_t slot = l->slot[side];
+        hostsim_evt_t *e;
+
+        simDev[dev].link[slot] = -1;
+        simDev[dev].busyStatus[slot] = CY_BLE_STACK_STATE_FREE;
+        FlushQueue(&l->q[side]);
+        if((int16_t)dev == simRttDev)
+        {
+            /* Echoes still outstanding on this connection never come back.
+             * They were not lost, the run ended first. */
+            simRtt.inFlight += simOutCount[slot];
+            while(simOutCount[slot] != 0u)
+            {
+                RttDrop(slot);
+            }
+            simOutSeq[slot] = 0u;
+            simOutNewest[slot] = 0u;
+            simOutHdr[slot] = HOSTSIM_NO_HEADER;
+        }
+
+        if(l->chan[side] == HOSTSIM_CHAN_OPEN)
+        {
+            e = Post(dev, CY_BLE_EVT_L2CAP_CBFC_DISCONN_IND);
+            e->param.cid = l->cid[side];
+        }
+        PostConnHandle(dev, CY_BLE_EVT_GATT_DISCONNECT_IND, slot);
+        e = Post(dev, CY_BLE_EVT_GAP_DEVICE_DISCONNECTED);
+        e->param.disconnected.bdHandle = slot;
+        e->param.disconnected.reason = l->reason;
+    }
+}
+
+static void DeliverPdu(hostsim_link_t *l, uint8_t from, hostsim_pdu_t *p)
+{
+    uint8_t to = (uint8_t)(1u - from);
+    uint8_t dev = l->dev[to];
+    hostsim_evt_t *e;
+
+    switch(p->kind)
+    {
+        case HOSTSIM_PDU_CONN_REQ:
+            l->cid[to] = (uint16_t)(HOSTSIM_CID_BASE + l->slot[to]);
+            l->chan[to] = HOSTSIM_CHAN_PENDING;
+            l->txCredits[to] = p->connParam.credit;
+            e = Post(dev, CY_BLE_EVT_L2CAP_CBFC_CONN_IND);
+            e->param.connInd.bdHandle = l->slot[to];
+            e->param.connInd.lCid = l->cid[to];
+            e->param.connInd.psm = p->psm;
+            e->param.connInd.connParam = p->connParam;
+            break;
+
+        case HOSTSIM_PDU_CONN_RSP:
+            l->txCredits[to] = p->connParam.credit;
+            l->chan[to] = (p->value == CY_BLE_L2CAP_CONNECTION_SUCCESSFUL) ? HOSTSIM_CHAN_OPEN : HOSTSIM_CHAN_CLOSED;
+            e = Post(dev, CY_BLE_EVT_L2CAP_CBFC_CONN_CNF);
+            e->param.connCnf.bdHandle = l->slot[to];
+            e->param.connCnf.lCid = l->cid[to];
+            e->param.connCnf.response = p->value;
+            e->param.connCnf.connParam = p->connParam;
+            break;
+
+        case HOSTSIM_PDU_CREDIT:
+            l->txCredits[to] += p->value;
+            e = Post(dev, CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND);
+            e->param.txCredit.lCid = l->cid[to];
+            e->param.txCredit.result = CY_BLE_L2CAP_RESULT_SUCCESS;
+            e->param.txCredit.credit = p->value;
+            break;
+
+        case HOSTSIM_PDU_DATA:
+        default:
+            /* Sender is told the SDU has left its buffers */
+            e = Post(l->dev[from], CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND);
+            e->param.dataWrite.lCid = l->cid[from];
+            e->param.dataWrite.result = CY_BLE_L2CAP_RESULT_SUCCESS;
+
+            l->rxCredits[to] = (l->rxCredits[to] > p->kframes) ? (l->rxCredits[to] - p->kframes) : 0u;
+            if((simCfg.faultEvery != 0u) && ((++simFaultCount % simCfg.faultEvery) == 0u))
+            {
+                /* Alternate between a flipped payload bit and a truncated SDU */
+                if(((simFaultCount / simCfg.faultEvery) & 1u) != 0u)
+                {
+                    p->data[p->len / 2u] ^= 0x10u;
+                }
+                else
+                {
+                    p->len /= 2u;
+                }
+            }
+            simDev[dev].stats.rxSdu++;
+            simDev[dev].stats.rxBytes += p->len;
+            simDev[dev].stats.lastRx = simStamp;
+            if((int16_t)dev == simRttDev)
+            {
+                RttOnRx(l->slot[to], p->data, p->len);
+            }
+
+            e = Post(dev, CY_BLE_EVT_L2CAP_CBFC_DATA_READ);
+            e->param.rx.lCid = l->cid[to];
+            e->param.rx.result = CY_BLE_L2CAP_RESULT_SUCCESS;
+            e->param.rx.rxDataLength = p->len;
+            e->blob = p->data;
+            e->blobLen = p->len;
+            p->data = NULL;
+
+            if((l->rxCredits[to] <= simDev[dev].creditLwm) && !l->lowSignalled[to])
+            {
+                l->lowSignalled[to] = true;
+                e = Post(dev, CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND);
+                e->param.rxCredit.lCid = l->cid[to];
+                e->param.rxCredit.credit = (uint16_t)l->rxCredits[to];
+            }
+            break;
+    }
+}
+
+static uint32_t LinksOf(uint8_t dev)
+{
+    uint32_t n = 0u;
+    uint32_t i;
+
+    for(i = 0u; i < HOSTSIM_MAX_LINKS; i++)
+    {
+        if(simLink[i].active && ((simLink[i].dev[0u] == dev) || (simLink[i].dev[1u] == dev)))
+        {
+            n++;
+        }
+    }
+    return(n);
+}
+
+/* Answers the ATT request of the central from the GATT database of the
+ * peripheral. A discovery procedure gets all its attributes in one response
+ * and ends with CY_BLE_EVT_GATTC_LONG_PROCEDURE_END, or with an error
+ * response when the range has none. */
+static void AttResponse(hostsim_link_t *l)
+{
+    uint8_t dev = l->dev[0u];
+    uint8_t slot = l->slot[0u];
+    uint8_t op = l->attOp;
+    uint8_t *list = malloc(HOSTSIM_GATT_DB_LEN * 7u);
+    uint16_t len = 0u;
+    uint32_t i;
+    hostsim_evt_t *e;
+
+    l->attOp = HOSTSIM_ATT_NONE;
+    for(i = 0u; i < HOSTSIM_GATT_DB_LEN; i++)
+    {
+        const hostsim_attr_t *a = &hostsimGattDb[i];
+
+        if((a->handle < l->attRange.startHandle) || (a->handle > l->attRange.endHandle))
+        {
+            continue;
+        }
+        if((op == HOSTSIM_ATT_READ_BY_TYPE) && (a->type == 0x2803u))
+        {
+            /* Declaration handle, properties, value handle, UUID */
+            list[len++] = (uint8_t)a->handle;
+            list[len++] = (uint8_t)(a->handle >> 8u);
+            list[len++] = a->props;
+            list[len++] = (uint8_t)(a->handle + 1u);
+            list[len++] = (uint8_t)((a->handle + 1u) >> 8u);
+            list[len++] = (uint8_t)a->uuid;
+            list[len++] = (uint8_t)(a->uuid >> 8u);
+        }
+        else if((op == HOSTSIM_ATT_FIND_INFO) || ((op == HOSTSIM_ATT_WRITE) && (a->type == CY_BLE_UUID_CHAR_CLIENT_CONFIG)))
+        {
+            /* Handle, 16-bit UUID */
+            list[len++] = (uint8_t)a->handle;
+            list[len++] = (uint8_t)(a->handle >> 8u);
+            list[len++] = (uint8_t)a->type;
+            list[len++] = (uint8_t)(a->type >> 8u);
+        }
+    }
+
+    if(op == HOSTSIM_ATT_WRITE)
+    {
+        free(list);
+        if(len != 0u)
+        {
+            PostConnHandle(dev, CY_BLE_EVT_GATTC_WRITE_RSP, slot);
+        }
+        else
+        {
+            /* Only a CCCD is writable */
+            e = Post(dev, CY_BLE_EVT_GATTC_ERROR_RSP);
+            e->param.err.connHandle.bdHandle = slot;
+            e->param.err.connHandle.attId = slot;
+            e->param.err.errInfo.opCode = 0x12u;
+            e->param.err.errInfo.attrHandle = l->attRange.startHandle;
+            e->param.err.errInfo.errorCode = 0x03u;
+        }
+        return;
+    }
+    if(len != 0u)
+    {
+        e = Post(dev, (op == HOSTSIM_ATT_READ_BY_TYPE) ? CY_BLE_EVT_GATTC_READ_BY_TYPE_RSP : CY_BLE_EVT_GATTC_FIND_INFO_RSP);
+        e->blob = list;
+        e->blobLen = len;
+        if(op == HOSTSIM_ATT_READ_BY_TYPE)
+        {
+            e->param.readByType.connHandle.bdHandle = slot;
+            e->param.readByType.connHandle.attId = slot;
+            e->param.readByType.attrData.length = len;
+            e->param.readByType.attrData.attrLen = 7u;
+        }
+        else
+        {
+            e->param.findInfo.connHandle.bdHandle = slot;
+            e->param.findInfo.connHandle.attId = slot;
+            e->param.findInfo.handleValueList.byteCount = len;
+            e->param.findInfo.uuidFormat = CY_BLE_GATT_16_BIT_UUID_FORMAT;
+        }
+    }
+    else
+    {
+        free(list);
+        e = Post(dev, CY_BLE_EVT_GATTC_ERROR_RSP);
+        e->param.err.connHandle.bdHandle = slot;
+        e->param.err.connHandle.attId = slot;
+        e->param.err.errInfo.opCode = (op == HOSTSIM_ATT_READ_BY_TYPE) ? 0x08u : 0x04u;
+        e->param.err.errInfo.attrHandle = l->attRange.startHandle;
+        e->param.err.errInfo.errorCode = 0x0Au;     /* Attribute Not Found */
+    }
+    e = Post(dev, CY_BLE_EVT_GATTC_LONG_PROCEDURE_END);
+    e->param.longEnd.connHandle.bdHandle = slot;
+    e->param.longEnd.connHandle.attId = slot;
+    e->param.longEnd.opcode = (op == HOSTSIM_ATT_READ_BY_TYPE) ? 0x08u : 0x04u;
+}
+
+static void ConnectionEvent(hostsim_link_t *l)
+{
+    uint32_t used = 0u;
+    uint32_t budget;
+    uint8_t  exchanges = 0u;
+
+    if(l->terminate)
+    {
+        TeardownLink(l);
+        return;
+    }
+
+    /* The central has one radio: its connections share every interval */
+    budget = (ConnIntvUs() / LinksOf(l->dev[0u])) - HOSTSIM_T_IFS_US;
+
+    if(l->discLeft != 0u)
+    {
+        /* One ATT request/response pair per event while discovery runs */
+        used += 2u * (AirTimeUs(simCfg.llPayload) + HOSTSIM_T_IFS_US);
+        exchanges++;
+        if(--l->discLeft == 0u)
+        {
+            hostsim_dev_t *c = &simDev[l->dev[0u]];
+            uint8_t slot = l->slot[0u];
+
+            c->serverInfo[slot][CY_BLE_SRVI_GAP].range.startHandle = 0x0001u;
+            c->serverInfo[slot][CY_BLE_SRVI_GAP].range.endHandle = 0x0007u;
+            c->serverInfo[slot][CY_BLE_SRVI_GATT].range.startHandle = 0x0008u;
+            c->serverInfo[slot][CY_BLE_SRVI_GATT].range.endHandle = 0x000Bu;
+            c->serverInfo[slot][CY_BLE_SRVI_IPSS].range.startHandle = 0x000Cu;
+            c->serverInfo[slot][CY_BLE_SRVI_IPSS].range.endHandle = 0x000Cu;
+            PostConnHandle(l->dev[0u], CY_BLE_EVT_GATTC_DISCOVERY_COMPLETE, slot);
+        }
+    }
+    else if(l->attOp != HOSTSIM_ATT_NONE)
+    {
+        used += 2u * (AirTimeUs(simCfg.llPayload) + HOSTSIM_T_IFS_US);
+        exchanges++;
+        AttResponse(l);
+    }
+
+    while(exchanges < simCfg.pdusPerEvent)
+    {
+        uint32_t len[2u] = { 0u, 0u };
+        uint32_t dt;
+        uint8_t side;
+
+        for(side = 0u; side < 2u; side++)
+        {
+            hostsim_pdu_queue_t *q = &l->q[side];
+            if(q->count != 0u)
+            {
+                uint32_t left = q->pdu[q->head].airLeft;
+                len[side] = (left < simCfg.llPayload) ? left : simCfg.llPayload;
+            }
+        }
+        if((len[0u] == 0u) && (len[1u] == 0u) && (exchanges != 0u))
+        {
+            break;
+        }
+
+        dt = AirTimeUs(len[0u]) + HOSTSIM_T_IFS_US + AirTimeUs(len[1u]) + HOSTSIM_T_IFS_US;
+        if((used + dt) > budget)
+        {
+            break;
+        }
+        used += dt;
+        exchanges++;
+        simStamp = simNow + used;
+
+        for(side = 0u; side < 2u; side++)
+        {
+            hostsim_pdu_queue_t *q = &l->q[side];
+            if(len[side] != 0u)
+            {
+                hostsim_pdu_t *p = &q->pdu[q->head];
+                p->airLeft -= len[side];
+                if(p->airLeft == 0u)
+                {
+                    q->head = (uint8_t)((q->head + 1u) % HOSTSIM_PDU_QUEUE_LEN);
+                    q->count--;
+                    if(p->kind == HOSTSIM_PDU_DATA)
+                    {
+                        q->dataCount--;
+                    }
+                    DeliverPdu(l, side, p);
+                    free(p->data);
+                    UpdateBusy(l, side);
+                }
+            }
+        }
+    }
+    simStamp = simNow;
+    l->nextEvent += ConnIntvUs();
+}
+
+static void AdvertisingEvent(uint8_t adv)
+{
+    hostsim_dev_t *a = &simDev[adv];
+    uint8_t dev;
+
+    a->nextAdv = simNow + ((uint64_t)simCfg.advIntv * 625u);
+    for(dev = 0u; dev < HOSTSIM_MAX_DEVICES; dev++)
+    {
+        hostsim_dev_t *s = &simDev[dev];
+        if(!s->used || (dev == adv))
+        {
+            continue;
+        }
+        if(s->connectPending &&
+           (memcmp(s->connectAddr.bdAddr, a->address.bdAddr, CY_BLE_GAP_BD_ADDR_SIZE) == 0))
+        {
+            CreateLink(dev, adv);
+            return;
+        }
+        if(s->scanState == CY_BLE_SCAN_STATE_SCANNING)
+        {
+            hostsim_evt_t *e = Post(dev, CY_BLE_EVT_GAPC_SCAN_PROGRESS_RESULT);
+            e->param.advReport.eventType = 0u;
+            e->param.advReport.peerAddrType = a->address.type;
+            e->param.advReport.dataLen = sizeof(hostsimAdvData);
+            e->param.advReport.rssi = a->rssi;
+            memcpy(e->peerAddr, a->address.bdAddr, CY_BLE_GAP_BD_ADDR_SIZE);
+            e->blob = malloc(sizeof(hostsimAdvData));
+            memcpy(e->blob, hostsimAdvData, sizeof(hostsimAdvData));
+            e->blobLen = sizeof(hostsimAdvData);
+        }
+    }
+}
+
+/*******************************************************************************
+*        Harness interface
+*******************************************************************************/
+void HostSim_Configure(const hostsim_link_cfg_t *cfg)
+{
+    simCfg = *cfg;
+}
+
+uint8_t HostSim_AddDevice(const char *name, uint8_t addrLsb, uint8_t maxConn, int8_t rssi)
+{
+    uint8_t dev;
+    uint8_t i;
+
+    for(dev = 0u; (dev < HOSTSIM_MAX_DEVICES) && simDev[dev].used; dev++)
+    {
+    }
+    CY_ASSERT(dev < HOSTSIM_MAX_DEVICES);
+
+    hostsim_dev_t *d = &simDev[dev];
+    memset(d, 0, sizeof(*d));
+    d->used = true;
+    snprintf(d->name, sizeof(d->name), "%s", name);
+    d->maxConn = (maxConn > HOSTSIM_MAX_CONN) ? HOSTSIM_MAX_CONN : maxConn;
+    d->rssi = rssi;
+    d->lineStart = true;
+    TraceDecode_Init(&d->trace, __start_trace_fmt, (uint32_t)(__stop_trace_fmt - __start_trace_fmt), 0u);
+    d->address.bdAddr[0u] = addrLsb;
+    d->address.bdAddr[3u] = 0x50u;
+    d->address.bdAddr[4u] = 0xA0u;
+    d->config.hw = &d->hw;
+    d->config.authInfo = d->authInfo;
+    d->config.deviceAddress = &d->address;
+    d->authInfo[0u].security = CY_BLE_GAP_SEC_MODE_1 | CY_BLE_GAP_SEC_LEVEL_1;
+    d->authInfo[0u].ekeySize = 0x10u;
+    for(i = 0u; i < HOSTSIM_MAX_CONN; i++)
+    {
+        d->link[i] = -1;
+    }
+    return(dev);
+}
+
+void HostSim_Select(uint8_t dev)
+{
+    simCur = dev;
+}
+
+void HostSim_SetVerbose(bool verbose)
+{
+    simVerbose = verbose;
+}
+
+void HostSim_SetUartCapture(uint8_t dev, FILE *file)
+{
+    simDev[dev].uartCapture = file;
+}
+
+void HostSim_TrackRtt(uint8_t dev)
+{
+    uint8_t slot;
+
+    simRttDev = (int16_t)dev;
+    for(slot = 0u; slot < HOSTSIM_MAX_CONN; slot++)
+    {
+        simOutHdr[slot] = HOSTSIM_NO_HEADER;
+    }
+}
+
+uint64_t HostSim_Now(void)
+{
+    return(simNow);
+}
+
+uint32_t HostSim_Activity(void)
+{
+    return(simActivity);
+}
+
+uint64_t HostSim_NextEventTime(void)
+{
+    uint64_t next = HOSTSIM_NO_EVENT;
+    uint32_t i;
+    uint32_t t;
+
+    for(i = 0u; i < HOSTSIM_MAX_LINKS; i++)
+    {
+        if(simLink[i].active && (simLink[i].nextEvent < next))
+        {
+            next = simLink[i].nextEvent;
+        }
+    }
+    for(i = 0u; i < HOSTSIM_MAX_DEVICES; i++)
+    {
+        hostsim_dev_t *d = &simDev[i];
+        if(!d->used)
+        {
+            continue;
+        }
+        if((d->advState == CY_BLE_ADV_STATE_ADVERTISING) && (d->nextAdv < next))
+        {
+            next = d->nextAdv;
+        }
+        for(t = 0u; t < HOSTSIM_MAX_TIMERS; t++)
+        {
+            if(d->timer[t].active && (d->timer[t].expiry < next))
+            {
+                next = d->timer[t].expiry;
+            }
+        }
+    }
+    return(next);
+}
+
+void HostSim_Advance(uint64_t time)
+{
+    uint32_t i;
+    uint32_t t;
+
+    simNow = time;
+    simStamp = time;
+
+    for(i = 0u; i < HOSTSIM_MAX_DEVICES; i++)
+    {
+        hostsim_dev_t *d = &simDev[i];
+        if(!d->used)
+        {
+            continue;
+        }
+        for(t = 0u; t < HOSTSIM_MAX_TIMERS; t++)
+        {
+            if(d->timer[t].active && (d->timer[t].expiry <= time))
+            {
+                hostsim_evt_t *e = Post((uint8_t)i, CY_BLE_EVT_TIMEOUT);
+                d->timer[t].active = false;
+                e->param.timeout.reasonCode = CY_BLE_GENERIC_APP_TO;
+                e->param.timeout.timerHandle = d->timer[t].handle;
+            }
+        }
+        if((d->advState == CY_BLE_ADV_STATE_ADVERTISING) && (d->nextAdv <= time))
+        {
+            AdvertisingEvent((uint8_t)i);
+        }
+    }
+    for(i = 0u; i < HOSTSIM_MAX_LINKS; i++)
+    {
+        if(simLink[i].active && (simLink[i].nextEvent <= time))
+        {
+            ConnectionEvent(&simLink[i]);
+        }
+    }
+}
+
+void HostSim_UartInject(uint8_t dev, const char *text)
+{
+    hostsim_dev_t *d = &simDev[dev];
+    uint8_t cur = simCur;
+
+    while(*text != '\0')
+    {
+        d->uart[d->uartWr] = *text++;
+        d->uartWr = (uint16_t)((d->uartWr + 1u) % HOSTSIM_UART_RX_LEN);
+    }
+
+    /* The RX interrupt of the board takes the bytes at once */
+    simCur = dev;
+    UartIrq();
+    simCur = cur;
+}
+
+const hostsim_dev_stats_t *HostSim_DevStats(uint8_t dev)
+{
+    return(&simDev[dev].stats);
+}
+
+const hostsim_rtt_stats_t *HostSim_RttStats(void)
+{
+    return(&simRtt);
+}
+
+int HostSim_Printf(const char *format, ...)
+{
+    char buf[HOSTSIM_PRINTF_BUF];
+    hostsim_dev_t *d = Cur();
+    va_list args;
+    int len;
+    char *c;
+
+    va_start(args, format);
+    len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if(simVerbose)
+    {
+        if((simLineDev >= 0) && (simLineDev != (int16_t)simCur) && !simDev[simLineDev].lineStart)
+        {
+            /* Another board left its line open, do not mix the two */
+            putchar('\n');
+            simDev[simLineDev].lineStart = true;
+        }
+        simLineDev = (int16_t)simCur;
+        for(c = buf; *c != '\0'; c++)
+        {
+            if(*c == '\r')
+            {
+                continue;
+            }
+            if(d->lineStart)
+            {
+                printf("%10.3f %-6s| ", (double)simNow / 1000.0, d->name);
+                d->lineStart = false;
+            }
+            putchar(*c);
+            if(*c == '\n')
+            {
+                d->lineStart = true;
+            }
+        }
+    }
+    return(len);
+}
+
+void HostSim_Assert(uint32_t cond, const char *file, int line)
+{
+    if(cond == 0u)
+    {
+        fprintf(stderr, "hostsim: assertion failed at %s:%d\n", file, line);
+        abort();
+    }
+}
+
+cy_stc_ble_config_t *HostSim_Config(void)
+{
+    return(&Cur()->config);
+}
+
+cy_stc_ble_gap_bd_addr_t *HostSim_DeviceAddress(void)
+{
+    return(&Cur()->address);
+}
+
+uint8_t *HostSim_BusyStatus(void)
+{
+    return(Cur()->busyStatus);
+}
+
+cy_stc_ble_disc_srvc_info_t (*HostSim_ServerInfo(void))[CY_BLE_SRVI_COUNT]
+{
+    return(Cur()->serverInfo);
+}
+
+/*******************************************************************************
+*        PDL stand-ins
+*******************************************************************************/
+void init_cycfg_all(void)
+{
+}
+
+DWT_Type *HostSim_Dwt(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    simDwt.CYCCNT = (uint32_t)(((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec);
+    return(&simDwt);
+}
+
+cy_en_mcwdt_status_t Cy_MCWDT_Init(MCWDT_STRUCT_Type *base, cy_stc_mcwdt_config_t const *config)
+{
+    (void)base;
+    (void)config;
+    return(CY_MCWDT_SUCCESS);
+}
+
+void Cy_MCWDT_Enable(MCWDT_STRUCT_Type *base, uint32_t counters, uint16_t waitUs)
+{
+    (void)base;
+    (void)counters;
+    (void)waitUs;
+}
+
+/* Counter 2 runs on the 32768 Hz LFCLK, in deep sleep too, so it follows the
+ * simulated time. The other counters are not modelled. */
+uint32_t Cy_MCWDT_GetCount(MCWDT_STRUCT_Type const *base, cy_en_mcwdtcounter_t counter)
+{
+    (void)base;
+    return((counter == CY_MCWDT_COUNTER2) ? (uint32_t)((simNow * 32768u) / HOSTSIM_US_PER_SEC) : 0u);
+}
+
+bool Cy_SysPm_GetIoFreezeStatus(void)
+{
+    return(false);
+}
+
+void Cy_SysPm_IoUnfreeze(void)
+{
+}
+
+uint32_t Cy_SysPm_DeepSleep(uint32_t waitFor)
+{
+    (void)waitFor;
+    return(0u);
+}
+
+uint32_t Cy_SysPm_CpuEnterDeepSleep(uint32_t waitFor)
+{
+    (void)waitFor;
+    return(0u);
+}
+
+uint32_t Cy_SysPm_CpuEnterSleep(uint32_t waitFor)
+{
+    (void)waitFor;
+    return(0u);
+}
+
+/* The simulation runs the stack events and the main loop on one thread, an
+ * interrupt cannot preempt a critical section */
+uint32_t Cy_SysLib_EnterCriticalSection(void)
+{
+    return(0u);
+}
+
+void Cy_SysLib_ExitCriticalSection(uint32_t savedIntrStatus)
+{
+    (void)savedIntrStatus;
+}
+
+/* The UART sends at once, so its TX FIFO is always below the trigger level:
+ * an enabled TX level interrupt runs right away, as it would preempt the
+ * application on the kit, until the handler masks it. The RX not empty
+ * interrupt runs while injected bytes wait. */
+static bool UartIrqPending(const hostsim_dev_t *d)
+{
+    return(((d->uartTxMask & CY_SCB_TX_INTR_LEVEL) != 0u) ||
+           (((d->uartRxMask & CY_SCB_RX_INTR_NOT_EMPTY) != 0u) && (d->uartRd != d->uartWr)));
+}
+
+static void UartIrq(void)
+{
+    hostsim_dev_t *d = Cur();
+
+    if((d->uartIsr == NULL) || !d->uartIrqEnabled || d->uartInIsr)
+    {
+        return;
+    }
+    d->uartInIsr = true;
+    while(UartIrqPending(d))
+    {
+        d->uartIsr();
+    }
+    d->uartInIsr = false;
+}
+
+uint32_t Cy_SysInt_Init(const cy_stc_sysint_t *config, cy_israddress userIsr)
+{
+    if(config->intrSrc == scb_5_interrupt_IRQn)
+    {
+        Cur()->uartIsr = userIsr;
+    }
+    return(0u);
+}
+
+void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    if(IRQn == scb_5_interrupt_IRQn)
+    {
+        Cur()->uartIrqEnabled = true;
+        UartIrq();
+    }
+}
+
+void Cy_GPIO_Write(GPIO_PRT_Type *base, uint32_t pinNum, uint32_t value)
+{
+    (void)base;
+    (void)pinNum;
+    (void)value;
+}
+
+uint32_t Cy_SCB_UART_Init(CySCB_Type *base, const cy_stc_scb_uart_config_t *config,
+                          cy_stc_scb_uart_context_t *context)
+{
+    (void)base;
+    (void)config;
+    (void)context;
+    return(0u);
+}
+
+void Cy_SCB_UART_Enable(CySCB_Type *base)
+{
+    (void)base;
+}
+
+uint32_t Cy_SCB_UART_Get(CySCB_Type const *base)
+{
+    hostsim_dev_t *d = Cur();
+    uint32_t ch;
+
+    (void)base;
+    if(d->uartRd == d->uartWr)
+    {
+        return(CY_SCB_UART_RX_NO_DATA);
+    }
+    ch = (uint8_t)d->uart[d->uartRd];
+    d->uartRd = (uint16_t)((d->uartRd + 1u) % HOSTSIM_UART_RX_LEN);
+    simActivity++;
+    return(ch);
+}
+
+uint32_t Cy_SCB_UART_Put(CySCB_Type const *base, uint32_t data)
+{
+    hostsim_dev_t *d = Cur();
+    char text[TRACE_TEXT_MAX];
+
+    (void)base;
+    if(d->uartCapture != NULL)
+    {
+        (void)fputc((int)(uint8_t)data, d->uartCapture);
+    }
+    if(TraceDecode_Byte(&d->trace, (uint8_t)data, text, sizeof(text)) != 0u)
+    {
+        (void)HostSim_Printf("%s", text);
+    }
+    return(1u);
+}
+
+uint32_t Cy_SCB_GetNumInTxFifo(CySCB_Type const *base)
+{
+    (void)base;
+    return(0u);
+}
+
+uint32_t Cy_SCB_GetTxSrValid(CySCB_Type const *base)
+{
+    (void)base;
+    return(0u);
+}
+
+void Cy_SCB_SetTxFifoLevel(CySCB_Type *base, uint32_t level)
+{
+    (void)base;
+    (void)level;
+}
+
+void Cy_SCB_SetTxInterruptMask(CySCB_Type *base, uint32_t interruptMask)
+{
+    (void)base;
+    Cur()->uartTxMask = interruptMask;
+    UartIrq();
+}
+
+void Cy_SCB_ClearTxInterrupt(CySCB_Type *base, uint32_t interruptMask)
+{
+    (void)base;
+    (void)interruptMask;
+}
+
+void Cy_SCB_SetRxInterruptMask(CySCB_Type *base, uint32_t interruptMask)
+{
+    (void)base;
+    Cur()->uartRxMask = interruptMask;
+    UartIrq();
+}
+
+uint32_t Cy_SCB_GetRxInterruptStatusMasked(CySCB_Type const *base)
+{
+    hostsim_dev_t *d = Cur();
+
+    (void)base;
+    return((d->uartRd != d->uartWr) ? (d->uartRxMask & CY_SCB_RX_INTR_NOT_EMPTY) : 0u);
+}
+
+void Cy_SCB_ClearRxInterrupt(CySCB_Type *base, uint32_t interruptMask)
+{
+    (void)base;
+    (void)interruptMask;
+}
+
+/*******************************************************************************
+*        BLE stack stand-ins
+*******************************************************************************/
+void Cy_BLE_BlessIsrHandler(void)
+{
+}
+
+cy_en_ble_api_result_t Cy_BLE_RegisterEventCallback(cy_ble_callback_t callbackFunc)
+{
+    Cur()->callback = callbackFunc;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_Init(cy_stc_ble_config_t *config)
+{
+    return((config != NULL) ? CY_BLE_SUCCESS : CY_BLE_ERROR_INVALID_PARAMETER);
+}
+
+cy_en_ble_api_result_t Cy_BLE_Enable(void)
+{
+    (void)Post(simCur, CY_BLE_EVT_STACK_ON);
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_EnableLowPowerMode(void)
+{
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GetStackLibraryVersion(cy_stc_ble_stack_lib_version_t *stackLibVersion)
+{
+    stackLibVersion->majorVersion = 5u;
+    stackLibVersion->minorVersion = 0u;
+    stackLibVersion->patch = 0u;
+    stackLibVersion->buildNumber = 0u;
+    return(CY_BLE_SUCCESS);
+}
+
+void Cy_BLE_ProcessEvents(void)
+{
+    hostsim_dev_t *d = Cur();
+    uint16_t pending = d->evtCount;
+
+    /* Only events pending on entry are handled, like one pass of the stack */
+    while((pending-- != 0u) && (d->evtCount != 0u))
+    {
+        hostsim_evt_t e = d->evt[d->evtHead];
+        d->evtHead = (uint16_t)((d->evtHead + 1u) % HOSTSIM_EVT_QUEUE_LEN);
+        d->evtCount--;
+
+        switch(e.event)
+        {
+            case CY_BLE_EVT_GAPC_SCAN_PROGRESS_RESULT:
+                e.param.advReport.peerBdAddr = e.peerAddr;
+                e.param.advReport.data = e.blob;
+                break;
+            case CY_BLE_EVT_L2CAP_CBFC_DATA_READ:
+                e.param.rx.rxData = e.blob;
+                break;
+            case CY_BLE_EVT_GATTC_READ_BY_TYPE_RSP:
+                e.param.readByType.attrData.attrValue = e.blob;
+                break;
+            case CY_BLE_EVT_GATTC_FIND_INFO_RSP:
+                e.param.findInfo.handleValueList.list = e.blob;
+                break;
+            case CY_BLE_EVT_GET_DEVICE_ADDR_COMPLETE:
+                e.param.generic.eventParams = &e.addrs;
+                break;
+            default:
+                break;
+        }
+        simActivity++;
+        if((e.event == CY_BLE_EVT_TIMEOUT) && ((int16_t)simCur == simRttDev))
+        {
+            /* Echoes delivered so far are handled before the tick of the Router */
+            RttExpire();
+        }
+        if(d->callback != NULL)
+        {
+            d->callback(e.event, &e.param);
+        }
+        /* The receive buffer belongs to the stack and is released here */
+        free(e.blob);
+    }
+}
+
+cy_en_ble_api_result_t Cy_BLE_StartTimer(cy_stc_ble_timer_info_t *param)
+{
+    hostsim_dev_t *d = Cur();
+    hostsim_timer_t *tmr = NULL;
+    uint32_t i;
+
+    for(i = 0u; i < HOSTSIM_MAX_TIMERS; i++)
+    {
+        if(d->timer[i].active && (d->timer[i].handle == param->timerHandle))
+        {
+            tmr = &d->timer[i];
+        }
+    }
+    for(i = 0u; (tmr == NULL) && (i < HOSTSIM_MAX_TIMERS); i++)
+    {
+        if(!d->timer[i].active)
+        {
+            tmr = &d->timer[i];
+            tmr->handle = ++d->nextTimerHandle;
+        }
+    }
+    if(tmr == NULL)
+    {
+        return(CY_BLE_ERROR_INSUFFICIENT_RESOURCES);
+    }
+    tmr->active = true;
+    tmr->expiry = simNow + ((uint64_t)param->timeout * HOSTSIM_US_PER_SEC);
+    param->timerHandle = tmr->handle;
+    simActivity++;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_StopTimer(cy_stc_ble_timer_info_t *param)
+{
+    hostsim_dev_t *d = Cur();
+    uint32_t i;
+
+    for(i = 0u; i < HOSTSIM_MAX_TIMERS; i++)
+    {
+        if(d->timer[i].active && (d->timer[i].handle == param->timerHandle))
+        {
+            d->timer[i].active = false;
+        }
+    }
+    return(CY_BLE_SUCCESS);
+}
+
+uint8_t Cy_BLE_GetNumOfActiveConn(void)
+{
+    hostsim_dev_t *d = Cur();
+    uint8_t n = 0u;
+    uint8_t i;
+
+    for(i = 0u; i < HOSTSIM_MAX_CONN; i++)
+    {
+        if(d->link[i] >= 0)
+        {
+            n++;
+        }
+    }
+    return(n);
+}
+
+cy_stc_ble_conn_handle_t Cy_BLE_GetConnHandleByBdHandle(uint8_t bdHandle)
+{
+    cy_stc_ble_conn_handle_t h = { .bdHandle = bdHandle, .attId = bdHandle };
+    return(h);
+}
+
+/* Like the PDL, a connection has a discovery row only once
+ * Cy_BLE_GATTC_StartDiscovery() bound one to it */
+uint8_t Cy_BLE_GetDiscoveryIdx(cy_stc_ble_conn_handle_t connHandle)
+{
+    hostsim_link_t *l = LinkBySlot(simCur, connHandle.bdHandle);
+
+    return(((l != NULL) && (l->discBound == true)) ? connHandle.attId : (uint8_t)CY_BLE_GATTC_COUNT);
+}
+
+uint16_t Cy_BLE_Get16ByPtr(const uint8_t ptr[])
+{
+    return((uint16_t)(ptr[0u] | ((uint16_t)ptr[1u] << 8u)));
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAP_GenerateKeys(cy_stc_ble_gap_sec_key_info_t *param)
+{
+    (void)param;
+    (void)Post(simCur, CY_BLE_EVT_GAP_KEYS_GEN_COMPLETE);
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAP_SetSecurityKeys(cy_stc_ble_gap_sec_key_info_t *param)
+{
+    (void)param;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAP_SetIdAddress(const cy_stc_ble_gap_bd_addr_t *param)
+{
+    (void)param;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAP_GetBdAddress(void)
+{
+    hostsim_evt_t *e = Post(simCur, CY_BLE_EVT_GET_DEVICE_ADDR_COMPLETE);
+    memcpy(e->addrs.publicBdAddr, Cur()->address.bdAddr, CY_BLE_GAP_BD_ADDR_SIZE);
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAP_Disconnect(cy_stc_ble_gap_disconnect_info_t *param)
+{
+    hostsim_link_t *l = LinkBySlot(simCur, param->bdHandle);
+
+    if(l == NULL)
+    {
+        return(CY_BLE_ERROR_NO_DEVICE_ENTITY);
+    }
+    l->terminate = true;
+    l->reason = param->reason;
+    simActivity++;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAP_RemoveOldestDeviceFromBondedList(void)
+{
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAPP_AuthReqReply(cy_stc_ble_gap_auth_info_t *param)
+{
+    (void)param;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAPP_StartAdvertisement(uint8_t advertisingIntervalType, uint8_t advertisingParamIndex)
+{
+    hostsim_dev_t *d = Cur();
+
+    (void)advertisingIntervalType;
+    (void)advertisingParamIndex;
+    if(d->advState != CY_BLE_ADV_STATE_STOPPED)
+    {
+        return(CY_BLE_ERROR_INVALID_OPERATION);
+    }
+    d->advState = CY_BLE_ADV_STATE_ADVERTISING;
+    d->nextAdv = simNow + ((uint64_t)simCfg.advIntv * 625u);
+    (void)Post(simCur, CY_BLE_EVT_GAPP_ADVERTISEMENT_START_STOP);
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAPP_StopAdvertisement(void)
+{
+    hostsim_dev_t *d = Cur();
+
+    if(d->advState == CY_BLE_ADV_STATE_STOPPED)
+    {
+        return(CY_BLE_ERROR_INVALID_OPERATION);
+    }
+    d->advState = CY_BLE_ADV_STATE_STOPPED;
+    (void)Post(simCur, CY_BLE_EVT_GAPP_ADVERTISEMENT_START_STOP);
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_adv_state_t Cy_BLE_GetAdvertisementState(void)
+{
+    return(Cur()->advState);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAPC_StartScan(uint32_t scanningIntervalType, uint8_t scanParamIndex)
+{
+    hostsim_dev_t *d = Cur();
+
+    (void)scanningIntervalType;
+    (void)scanParamIndex;
+    if(d->scanState != CY_BLE_SCAN_STATE_STOPPED)
+    {
+        return(CY_BLE_ERROR_INVALID_OPERATION);
+    }
+    d->scanState = CY_BLE_SCAN_STATE_SCANNING;
+    (void)Post(simCur, CY_BLE_EVT_GAPC_SCAN_START_STOP);
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAPC_StopScan(void)
+{
+    hostsim_dev_t *d = Cur();
+
+    if(d->scanState == CY_BLE_SCAN_STATE_STOPPED)
+    {
+        return(CY_BLE_ERROR_INVALID_OPERATION);
+    }
+    d->scanState = CY_BLE_SCAN_STATE_STOPPED;
+    (void)Post(simCur, CY_BLE_EVT_GAPC_SCAN_START_STOP);
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_scan_state_t Cy_BLE_GetScanState(void)
+{
+    return(Cur()->scanState);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAPC_ConnectDevice(const cy_stc_ble_gap_bd_addr_t *address, uint8_t centralConnParamIndex)
+{
+    hostsim_dev_t *d = Cur();
+
+    (void)centralConnParamIndex;
+    if(d->connectPending || (Cy_BLE_GetNumOfActiveConn() >= d->maxConn))
+    {
+        return(CY_BLE_ERROR_INVALID_OPERATION);
+    }
+    d->connectPending = true;
+    d->connectAddr = *address;
+    simActivity++;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GAPC_CancelDeviceConnection(void)
+{
+    hostsim_dev_t *d = Cur();
+
+    if(!d->connectPending)
+    {
+        return(CY_BLE_ERROR_INVALID_OPERATION);
+    }
+    d->connectPending = false;
+    simActivity++;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GATTC_StartDiscovery(cy_stc_ble_conn_handle_t connHandle)
+{
+    hostsim_link_t *l = LinkBySlot(simCur, connHandle.bdHandle);
+
+    if((l == NULL) || (l->dev[0u] != simCur))
+    {
+        return(CY_BLE_ERROR_NO_DEVICE_ENTITY);
+    }
+    if((l->discLeft != 0u) || (l->attOp != HOSTSIM_ATT_NONE))
+    {
+        return(CY_BLE_ERROR_INVALID_OPERATION);
+    }
+    l->discLeft = simCfg.discEvents;
+    l->discBound = true;
+    simActivity++;
+    return(CY_BLE_SUCCESS);
+}
+
+/* One ATT request of the central at a time, answered on the next connection
+ * event */
+static cy_en_ble_api_result_t AttRequest(cy_stc_ble_conn_handle_t connHandle, uint8_t op,
+                                         cy_stc_ble_gatt_attr_handle_range_t range)
+{
+    hostsim_link_t *l = LinkBySlot(simCur, connHandle.bdHandle);
+
+    if((l == NULL) || (l->dev[0u] != simCur))
+    {
+        return(CY_BLE_ERROR_NO_DEVICE_ENTITY);
+    }
+    if((l->discLeft != 0u) || (l->attOp != HOSTSIM_ATT_NONE))
+    {
+        return(CY_BLE_ERROR_INVALID_OPERATION);
+    }
+    l->attOp = op;
+    l->attRange = range;
+    simActivity++;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_GATTC_DiscoverCharacteristics(cy_stc_ble_gattc_read_by_type_req_t *param)
+{
+    return(AttRequest(param->connHandle, HOSTSIM_ATT_READ_BY_TYPE, param->range));
+}
+
+cy_en_ble_api_result_t Cy_BLE_GATTC_DiscoverCharacteristicDescriptors(cy_stc_ble_gattc_find_info_req_t *param)
+{
+    return(AttRequest(param->connHandle, HOSTSIM_ATT_FIND_INFO, param->range));
+}
+
+cy_en_ble_api_result_t Cy_BLE_GATTC_WriteCharacteristicDescriptors(cy_stc_ble_gattc_write_req_t *param)
+{
+    cy_stc_ble_gatt_attr_handle_range_t range =
+    {
+        .startHandle = param->handleValPair.attrHandle,
+        .endHandle   = param->handleValPair.attrHandle
+    };
+
+    return(AttRequest(param->connHandle, HOSTSIM_ATT_WRITE, range));
+}
+
+/* The simulated peers send no indications, there is nothing to confirm */
+cy_en_ble_api_result_t Cy_BLE_GATTC_SendConfirmation(const cy_stc_ble_conn_handle_t *connHandle)
+{
+    (void)connHandle;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_L2CAP_CbfcRegisterPsm(const cy_stc_ble_l2cap_cbfc_psm_info_t *param)
+{
+    Cur()->creditLwm = param->creditLwm;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_L2CAP_CbfcConnectReq(const cy_stc_ble_l2cap_cbfc_conn_req_info_t *param)
+{
+    hostsim_link_t *l = LinkBySlot(simCur, param->bdHandle);
+    hostsim_pdu_t *p;
+    uint8_t side;
+
+    if(l == NULL)
+    {
+        return(CY_BLE_ERROR_NO_DEVICE_ENTITY);
+    }
+    side = SideOf(l, simCur);
+    if(l->chan[side] != HOSTSIM_CHAN_CLOSED)
+    {
+        return(CY_BLE_ERROR_INVALID_OPERATION);
+    }
+    p = Enqueue(l, side, HOSTSIM_PDU_CONN_REQ);
+    if(p == NULL)
+    {
+        return(CY_BLE_ERROR_MEMORY_ALLOCATION_FAILED);
+    }
+    l->chan[side] = HOSTSIM_CHAN_PENDING;
+    l->cid[side] = (uint16_t)(HOSTSIM_CID_BASE + l->slot[side]);
+    l->psm = param->remotePsm;
+    l->mtu[side] = param->connParam.mtu;
+    l->mps[side] = param->connParam.mps;
+    l->rxCredits[side] = param->connParam.credit;
+    p->psm = param->remotePsm;
+    p->connParam = param->connParam;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_L2CAP_CbfcConnectRsp(const cy_stc_ble_l2cap_cbfc_conn_resp_info_t *param)
+{
+    uint8_t side;
+    hostsim_link_t *l = LinkByCid(simCur, param->localCid, &side);
+    hostsim_pdu_t *p;
+
+    if((l == NULL) || (l->chan[side] != HOSTSIM_CHAN_PENDING))
+    {
+        return(CY_BLE_ERROR_L2CAP_CONNECTION_ENTITY_NOT_FOUND);
+    }
+    p = Enqueue(l, side, HOSTSIM_PDU_CONN_RSP);
+    if(p == NULL)
+    {
+        return(CY_BLE_ERROR_MEMORY_ALLOCATION_FAILED);
+    }
+    p->value = param->response;
+    p->connParam = param->connParam;
+    if(param->response == CY_BLE_L2CAP_CONNECTION_SUCCESSFUL)
+    {
+        l->chan[side] = HOSTSIM_CHAN_OPEN;
+        l->mtu[side] = param->connParam.mtu;
+        l->mps[side] = param->connParam.mps;
+        l->rxCredits[side] = param->connParam.credit;
+    }
+    else
+    {
+        l->chan[side] = HOSTSIM_CHAN_CLOSED;
+    }
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_L2CAP_CbfcSendFlowControlCredit(const cy_stc_ble_l2cap_cbfc_credit_info_t *param)
+{
+    uint8_t side;
+    hostsim_link_t *l = LinkByCid(simCur, param->localCid, &side);
+    hostsim_pdu_t *p;
+
+    if((l == NULL) || (l->chan[side] != HOSTSIM_CHAN_OPEN))
+    {
+        return(CY_BLE_ERROR_L2CAP_CONNECTION_ENTITY_NOT_FOUND);
+    }
+    p = Enqueue(l, side, HOSTSIM_PDU_CREDIT);
+    if(p == NULL)
+    {
+        return(CY_BLE_ERROR_MEMORY_ALLOCATION_FAILED);
+    }
+    p->value = param->credit;
+    l->rxCredits[side] += param->credit;
+    l->lowSignalled[side] = false;
+    Cur()->stats.creditPdus++;
+    return(CY_BLE_SUCCESS);
+}
+
+cy_en_ble_api_result_t Cy_BLE_L2CAP_ChannelDataWrite(const cy_stc_ble_l2cap_cbfc_tx_data_info_t *param)
+{
+    hostsim_dev_t *d = Cur();
+    uint8_t side;
+    hostsim_link_t *l = LinkByCid(simCur, param->localCid, &side);
+    hostsim_pdu_t *p;
+    uint16_t peerMps;
+    uint16_t kframes;
+    uint32_t sduLen;
+
+    if((l == NULL) || (l->chan[side] != HOSTSIM_CHAN_OPEN))
+    {
+        d->stats.txRejected++;
+        return(CY_BLE_ERROR_L2CAP_CONNECTION_ENTITY_NOT_FOUND);
+    }
+    peerMps = l->mps[1u - side];
+    sduLen = (uint32_t)param->bufferLength + HOSTSIM_SDU_LEN_FIELD;
+    kframes = (uint16_t)((sduLen + peerMps - 1u) / peerMps);
+    if((param->bufferLength > l->mtu[1u - side]) || (param->buffer == NULL))
+    {
+        d->stats.txRejected++;
+        return(CY_BLE_ERROR_INVALID_PARAMETER);
+    }
+    if(l->txCredits[side] < kframes)
+    {
+        d->stats.txRejected++;
+        return(CY_BLE_ERROR_INSUFFICIENT_RESOURCES);
+    }
+    if(l->q[side].dataCount >= (2u * simCfg.txBuffers))
+    {
+        d->stats.txRejected++;
+        return(CY_BLE_ERROR_MEMORY_ALLOCATION_FAILED);
+    }
+    p = Enqueue(l, side, HOSTSIM_PDU_DATA);
+    if(p == NULL)
+    {
+        d->stats.txRejected++;
+        return(CY_BLE_ERROR_MEMORY_ALLOCATION_FAILED);
+    }
+
+    /* The stack copies the SDU into its own buffers */
+    p->len = param->bufferLength;
+    p->data = malloc((param->bufferLength != 0u) ? param->bufferLength : 1u);
+    memcpy(p->data, param->buffer, param->bufferLength);
+    p->kframes = kframes;
+    p->airLeft = sduLen + ((uint32_t)kframes * HOSTSIM_L2CAP_HDR);
+    l->q[side].dataCount++;
+    l->txCredits[side] -= kframes;
+
+    if(d->stats.txSdu == 0u)
+    {
+        d->stats.firstTx = simNow;
+    }
+    d->stats.txSdu++;
+    d->stats.txBytes += param->bufferLength;
+    if((int16_t)simCur == simRttDev)
+    {
+        RttOnTx(l->slot[side], param->buffer, param->bufferLength);
+    }
+    UpdateBusy(l, side);
+    return(CY_BLE_SUCCESS);
+}
+
+/* [] END OF FILE */
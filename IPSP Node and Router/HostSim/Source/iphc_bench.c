@@ -0,0 +1,383 @@
+/*******************************************************************************
+* File Name: iphc_bench.c
+*
+* Version: 1.00
+*
+* Description:
+*  Host measurement of the 6LoWPAN header compression (iphc.c) used on the
+*  IPSP channel.
+*
+*  Headers: compresses a set of IPv6/UDP headers, decompresses them on the
+*  receiving side of the link and checks that every field comes back. The
+*  compressed length is printed next to the uncompressed IPv6 dispatch.
+*
+*  Bytes on air: for UDP datagrams of several sizes between the link-local
+*  addresses of the Router and the Node, prints the LL data PDUs and bytes
+*  the sender puts on air with and without compression, without and with
+*  LE Data Length Extension.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "iphc.h"
+
+/***************************************
+*           Constants
+***************************************/
+#define BENCH_ROUNDS                (1000000u)
+#define L2CAP_HEADER_LEN            (4u)        /* Length and CID of every K-frame */
+#define L2CAP_SDU_LEN_FIELD         (2u)        /* SDU length in the first K-frame */
+#define LL_OVERHEAD                 (10u)       /* Preamble, AA, header, CRC */
+#define LL_PAYLOAD_DLE              (251u)
+
+typedef struct
+{
+    const char      *name;
+    iphc_header_t   hdr;
+} header_case_t;
+
+static const uint8_t routerBdAddr[CY_BLE_GAP_BD_ADDR_SIZE] = { 0x00u, 0x00u, 0x00u, 0x50u, 0xA0u, 0x00u };
+static const uint8_t nodeBdAddr[CY_BLE_GAP_BD_ADDR_SIZE]   = { 0x01u, 0x00u, 0x00u, 0x50u, 0xA0u, 0x00u };
+static const uint16_t payloadSize[] = { 8u, 16u, 32u, 64u, 128u, 512u, IPV6_MTU - IPV6_HEADER_LEN - UDP_HEADER_LEN };
+
+static iphc_link_t  routerLink;         /* Router sends to the Node */
+static iphc_link_t  nodeLink;           /* Node receives from the Router */
+volatile uint32_t   benchSink;
+
+/*******************************************************************************
+* Function Name: NowNs
+*******************************************************************************/
+static uint64_t NowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return(((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec);
+}
+
+/*******************************************************************************
+* Function Name: SetAddr
+*******************************************************************************/
+static void SetAddr(uint8_t addr[], const char *text)
+{
+    uint32_t i;
+    unsigned int byte;
+
+    for(i = 0u; i < IPV6_ADDR_LEN; i++)
+    {
+        (void)sscanf(&text[i * 2u], "%2x", &byte);
+        addr[i] = (uint8_t)byte;
+    }
+}
+
+/*******************************************************************************
+* Function Name: BuildCases
+********************************************************************************
+*
+* Summary:
+*  Fills the header cases. Every datagram carries a 32-byte UDP payload.
+*
+*******************************************************************************/
+static uint32_t BuildCases(header_case_t cases[])
+{
+    uint32_t n = 0u;
+    uint32_t i;
+
+    /* Loopback datagram of the Router: both addresses from the BD addresses */
+    cases[n].name = "link-local, IID from BD address";
+    Iphc_LinkLocal(cases[n].hdr.src, routerLink.ownIid);
+    Iphc_LinkLocal(cases[n].hdr.dst, routerLink.peerIid);
+    cases[n].hdr.hopLimit = 64u;
+    cases[n].hdr.srcPort = 0xF0B1u;
+    cases[n].hdr.dstPort = 0xF0B7u;
+    n++;
+
+    cases[n].name = "link-local, other 64-bit IID";
+    SetAddr(cases[n].hdr.src, "fe800000000000000211223344556677");
+    SetAddr(cases[n].hdr.dst, "fe8000000000000002aabbfffecc0001");
+    cases[n].hdr.hopLimit = 255u;
+    cases[n].hdr.srcPort = 0xF0B1u;
+    cases[n].hdr.dstPort = 0xF0B7u;
+    n++;
+
+    cases[n].name = "link-local, 16-bit IID";
+    SetAddr(cases[n].hdr.src, "fe80000000000000000000fffe001234");
+    Iphc_LinkLocal(cases[n].hdr.dst, routerLink.peerIid);
+    cases[n].hdr.hopLimit = 1u;
+    cases[n].hdr.srcPort = 0xF012u;
+    cases[n].hdr.dstPort = 5683u;
+    n++;
+
+    cases[n].name = "global unicast, CoAP";
+    SetAddr(cases[n].hdr.src, "20010db8000000000000000000000001");
+    SetAddr(cases[n].hdr.dst, "20010db8000000000000000000000002");
+    cases[n].hdr.hopLimit = 64u;
+    cases[n].hdr.srcPort = 5683u;
+    cases[n].hdr.dstPort = 5683u;
+    n++;
+
+    cases[n].name = "multicast ff02::1";
+    Iphc_LinkLocal(cases[n].hdr.src, routerLink.ownIid);
+    SetAddr(cases[n].hdr.dst, "ff020000000000000000000000000001");
+    cases[n].hdr.hopLimit = 255u;
+    cases[n].hdr.srcPort = 5683u;
+    cases[n].hdr.dstPort = 0xF0B7u;
+    n++;
+
+    cases[n].name = "multicast ff05::1:3";
+    Iphc_LinkLocal(cases[n].hdr.src, routerLink.ownIid);
+    SetAddr(cases[n].hdr.dst, "ff050000000000000000000000010003");
+    cases[n].hdr.hopLimit = 64u;
+    cases[n].hdr.srcPort = 547u;
+    cases[n].hdr.dstPort = 547u;
+    n++;
+
+    cases[n].name = "traffic class and flow label";
+    Iphc_LinkLocal(cases[n].hdr.src, routerLink.ownIid);
+    Iphc_LinkLocal(cases[n].hdr.dst, routerLink.peerIid);
+    cases[n].hdr.trafficClass = 0xB9u;
+    cases[n].hdr.flowLabel = 0xABCDEu;
+    cases[n].hdr.hopLimit = 7u;
+    cases[n].hdr.srcPort = 0xF0B1u;
+    cases[n].hdr.dstPort = 0xF0B7u;
+    n++;
+
+    cases[n].name = "ECN and flow label";
+    Iphc_LinkLocal(cases[n].hdr.src, routerLink.ownIid);
+    Iphc_LinkLocal(cases[n].hdr.dst, routerLink.peerIid);
+    cases[n].hdr.trafficClass = 0x01u;
+    cases[n].hdr.flowLabel = 0x12345u;
+    cases[n].hdr.hopLimit = 64u;
+    cases[n].hdr.srcPort = 0xF0B1u;
+    cases[n].hdr.dstPort = 0xF0B7u;
+    n++;
+
+    cases[n].name = "unspecified source";
+    memset(cases[n].hdr.src, 0, IPV6_ADDR_LEN);
+    SetAddr(cases[n].hdr.dst, "ff020000000000000000000000000002");
+    cases[n].hdr.hopLimit = 255u;
+    cases[n].hdr.srcPort = 546u;
+    cases[n].hdr.dstPort = 547u;
+    n++;
+
+    for(i = 0u; i < n; i++)
+    {
+        cases[i].hdr.nextHeader = IPV6_NEXT_HEADER_UDP;
+        cases[i].hdr.payloadLength = UDP_HEADER_LEN + 32u;
+        cases[i].hdr.checksum = (uint16_t)(0x1234u + i);
+    }
+    return(n);
+}
+
+/*******************************************************************************
+* Function Name: SameHeader
+*******************************************************************************/
+static bool SameHeader(const iphc_header_t *a, const iphc_header_t *b)
+{
+    return((a->trafficClass == b->trafficClass) && (a->flowLabel == b->flowLabel) &&
+           (a->nextHeader == b->nextHeader) && (a->hopLimit == b->hopLimit) &&
+           (memcmp(a->src, b->src, IPV6_ADDR_LEN) == 0) && (memcmp(a->dst, b->dst, IPV6_ADDR_LEN) == 0) &&
+           (a->payloadLength == b->payloadLength) && (a->srcPort == b->srcPort) &&
+           (a->dstPort == b->dstPort) && (a->checksum == b->checksum));
+}
+
+/*******************************************************************************
+* Function Name: RunHeaders
+********************************************************************************
+*
+* Summary:
+*  Compresses every header case, decompresses it as the Node would and
+*  checks the result. The uncompressed IPv6 dispatch and a truncated SDU are
+*  checked as well. Returns the number of failures.
+*
+*******************************************************************************/
+static uint32_t RunHeaders(void)
+{
+    header_case_t cases[16u];
+    uint8_t       sdu[IPHC_UNCOMPRESSED_LEN + 32u];
+    iphc_header_t out;
+    uint16_t      len;
+    uint16_t      headerLen;
+    uint32_t      failed = 0u;
+    uint32_t      n;
+    uint32_t      i;
+    uint16_t      cut;
+    bool          ok;
+    bool          okRaw;
+    bool          okShort;
+
+    memset(cases, 0, sizeof(cases));
+    n = BuildCases(cases);
+
+    printf("Header compression, UDP datagrams with a 32-byte payload\n");
+    printf("%-34s %10s %12s %6s\n", "case", "IPHC [B]", "IPv6+UDP [B]", "check");
+    for(i = 0u; i < n; i++)
+    {
+        memset(sdu, 0xA5, sizeof(sdu));
+        len = Iphc_Compress(&cases[i].hdr, &routerLink, sdu);
+        ok = (Iphc_Decompress(sdu, (uint16_t)(len + 32u), &nodeLink, &out, &headerLen) == IPHC_OK) &&
+             (headerLen == len) && SameHeader(&cases[i].hdr, &out);
+
+        /* Every shorter SDU must be rejected as truncated, never read past */
+        okShort = true;
+        for(cut = 0u; cut < len; cut++)
+        {
+            okShort = okShort && (Iphc_Decompress(sdu, cut, &nodeLink, &out, &headerLen) == IPHC_TRUNCATED);
+        }
+
+        (void)Iphc_WriteUncompressed(&cases[i].hdr, sdu);
+        okRaw = (Iphc_Decompress(sdu, IPHC_UNCOMPRESSED_LEN + 32u, &nodeLink, &out, &headerLen) == IPHC_OK) &&
+                (headerLen == IPHC_UNCOMPRESSED_LEN) && SameHeader(&cases[i].hdr, &out);
+
+        printf("%-34s %10u %12u %6s\n", cases[i].name, (unsigned)len, (unsigned)IPHC_UNCOMPRESSED_LEN,
+            (ok && okRaw && okShort) ? "ok" : "FAILED");
+        failed += (ok && okRaw && okShort) ? 0u : 1u;
+    }
+    return(failed);
+}
+
+/*******************************************************************************
+* Function Name: AirBytes
+********************************************************************************
+*
+* Summary:
+*  Returns the bytes the sender puts on air for one SDU and the number of LL
+*  data PDUs. The SDU is split into K-frames of at most MPS bytes, the first
+*  one also carries the SDU length, and every K-frame into LL PDUs.
+*
+*******************************************************************************/
+static uint32_t AirBytes(uint32_t sduLen, uint32_t llPayload, uint32_t *pdus)
+{
+    uint32_t left = sduLen + L2CAP_SDU_LEN_FIELD;
+    uint32_t bytes = 0u;
+    uint32_t frame;
+    uint32_t n;
+
+    *pdus = 0u;
+    while(left != 0u)
+    {
+        frame = (left < CY_BLE_L2CAP_MPS) ? left : CY_BLE_L2CAP_MPS;
+        left -= frame;
+        frame += L2CAP_HEADER_LEN;
+        n = (frame + llPayload - 1u) / llPayload;
+        *pdus += n;
+        bytes += frame + (n * LL_OVERHEAD);
+    }
+    return(bytes);
+}
+
+/*******************************************************************************
+* Function Name: RunAir
+*******************************************************************************/
+static void RunAir(void)
+{
+    static const uint32_t llPayload[2u] = { CY_BLE_CONFIG_LL_MAX_TX_PAYLOAD_SIZE, LL_PAYLOAD_DLE };
+    iphc_header_t hdr;
+    uint8_t       compressed[IPHC_MAX_HEADER_LEN];
+    uint32_t      hdrLen;
+    uint32_t      pdusRaw;
+    uint32_t      pdusIphc;
+    uint32_t      airRaw;
+    uint32_t      airIphc;
+    uint32_t      i;
+    uint32_t      l;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.nextHeader = IPV6_NEXT_HEADER_UDP;
+    hdr.hopLimit = 64u;
+    Iphc_LinkLocal(hdr.src, routerLink.ownIid);
+    Iphc_LinkLocal(hdr.dst, routerLink.peerIid);
+    hdr.srcPort = 0xF0B1u;
+    hdr.dstPort = 0xF0B7u;
+    hdrLen = Iphc_Compress(&hdr, &routerLink, compressed);
+
+    printf("\nBytes on air per datagram, Router to Node, MPS %u\n", (unsigned)CY_BLE_L2CAP_MPS);
+    printf("%8s %8s %9s %9s %6s %6s %9s %9s %7s\n", "LL [B]", "UDP [B]", "SDU raw", "SDU IPHC",
+        "PDUs", "PDUs", "air raw", "air IPHC", "saved");
+    for(l = 0u; l < 2u; l++)
+    {
+        for(i = 0u; i < (sizeof(payloadSize) / sizeof(payloadSize[0u])); i++)
+        {
+            airRaw = AirBytes(IPHC_UNCOMPRESSED_LEN + payloadSize[i], llPayload[l], &pdusRaw);
+            airIphc = AirBytes(hdrLen + payloadSize[i], llPayload[l], &pdusIphc);
+            printf("%8u %8u %9u %9u %6u %6u %9u %9u %6.1f%%\n", (unsigned)llPayload[l], (unsigned)payloadSize[i],
+                (unsigned)(IPHC_UNCOMPRESSED_LEN + payloadSize[i]), (unsigned)(hdrLen + payloadSize[i]),
+                (unsigned)pdusRaw, (unsigned)pdusIphc, (unsigned)airRaw, (unsigned)airIphc,
+                100.0 * (double)(airRaw - airIphc) / (double)airRaw);
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: RunTiming
+*******************************************************************************/
+static void RunTiming(void)
+{
+    iphc_header_t hdr;
+    iphc_header_t out;
+    uint8_t       sdu[IPHC_MAX_HEADER_LEN + 32u];
+    uint16_t      len;
+    uint16_t      headerLen;
+    uint64_t      start;
+    uint64_t      compressNs;
+    uint32_t      r;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memset(sdu, 0, sizeof(sdu));
+    hdr.nextHeader = IPV6_NEXT_HEADER_UDP;
+    hdr.hopLimit = 64u;
+    Iphc_LinkLocal(hdr.src, routerLink.ownIid);
+    Iphc_LinkLocal(hdr.dst, routerLink.peerIid);
+    hdr.payloadLength = UDP_HEADER_LEN + 32u;
+    hdr.srcPort = 0xF0B1u;
+    hdr.dstPort = 0xF0B7u;
+
+    start = NowNs();
+    for(r = 0u; r < BENCH_ROUNDS; r++)
+    {
+        hdr.checksum = (uint16_t)r;
+        benchSink += Iphc_Compress(&hdr, &routerLink, sdu);
+    }
+    compressNs = NowNs() - start;
+
+    len = Iphc_Compress(&hdr, &routerLink, sdu);
+    start = NowNs();
+    for(r = 0u; r < BENCH_ROUNDS; r++)
+    {
+        sdu[len - 1u] = (uint8_t)r;
+        benchSink += (uint32_t)Iphc_Decompress(sdu, (uint16_t)(len + 32u), &nodeLink, &out, &headerLen) + out.checksum;
+    }
+    printf("\nLoopback header: compress %.1f ns, decompress %.1f ns\n",
+        (double)compressNs / BENCH_ROUNDS, (double)(NowNs() - start) / BENCH_ROUNDS);
+}
+
+/*******************************************************************************
+* Function Name: main
+*******************************************************************************/
+int main(void)
+{
+    uint32_t failed;
+
+    Iphc_LinkInit(&routerLink, routerBdAddr, nodeBdAddr);
+    Iphc_LinkInit(&nodeLink, nodeBdAddr, routerBdAddr);
+
+    failed = RunHeaders();
+    RunAir();
+    RunTiming();
+    if(failed != 0u)
+    {
+        printf("%u header case(s) FAILED\n", (unsigned)failed);
+        return(EXIT_FAILURE);
+    }
+    return(EXIT_SUCCESS);
+}
+
+/* [] END OF FILE */
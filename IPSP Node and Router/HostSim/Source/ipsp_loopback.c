@@ -0,0 +1,496 @@
+/*******************************************************************************
+* File Name: ipsp_loopback.c
+*
+* Version: 1.00
+*
+* Description:
+*  Host loopback harness. Runs the unmodified IPSP Router application against
+*  one or more IPSP Node applications on top of the simulated BLE stack and
+*  reports L2CAP echo throughput, loss and round-trip time.
+*
+*  Each application is linked as a separate relocatable object with only its
+*  entry points exported (see Makefile), so the Router and every Node keep
+*  their own copy of the application globals.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "hostsim.h"
+
+/***************************************
+*           Constants
+***************************************/
+#define MAX_NODES                   (HOSTSIM_MAX_CONN)
+#define DEFAULT_DURATION_S          (65u)
+#define DEFAULT_PDUS_PER_EVENT      (6u)
+#define COMMAND_TIME_US             (1u * HOSTSIM_US_PER_SEC)
+#define COMMAND_GAP_US              (HOSTSIM_US_PER_SEC / 2u)  /* Between connect commands */
+/* Command lines of the Router debug UART */
+#define ROUTER_COMMAND              "connect %u\r"
+#define ROUTER_WINDOW_COMMAND       "window %u\r"
+#define ROUTER_AUTO_COMMAND         "auto on\r"
+#define ROUTER_BENCH_COMMAND        "bench start dur=%u size=%u warmup=%u\r"
+#define MAX_PASSES                  (64u)   /* App passes per simulated instant */
+#define MAX_SCRIPT_LINES            (64u)
+#define SCRIPT_LINE_LEN             (96u)   /* The longest input line of the applications */
+#define RTT_BUCKETS                 (8u)
+
+/***************************************
+*       Application entry points
+***************************************/
+typedef void (*app_fn_t)(void);
+
+void Router_HostInit(void);
+void BleIPSPRouter_Process(void);
+void Node0_HostInit(void);
+void Node0_Process(void);
+void Node1_HostInit(void);
+void Node1_Process(void);
+void Node2_HostInit(void);
+void Node2_Process(void);
+void Node3_HostInit(void);
+void Node3_Process(void);
+
+static const app_fn_t nodeInit[MAX_NODES] =
+    { Node0_HostInit, Node1_HostInit, Node2_HostInit, Node3_HostInit };
+static const app_fn_t nodeProcess[MAX_NODES] =
+    { Node0_Process, Node1_Process, Node2_Process, Node3_Process };
+
+typedef struct
+{
+    uint8_t  dev;
+    app_fn_t init;
+    app_fn_t process;
+} board_t;
+
+static board_t  board[1u + MAX_NODES];
+static uint8_t  boards;
+
+/* Command lines of a script file, in time order */
+typedef struct
+{
+    uint64_t time;
+    uint8_t  board;
+    char     line[SCRIPT_LINE_LEN];
+} script_line_t;
+
+static script_line_t script[MAX_SCRIPT_LINES];
+static uint32_t      scriptLines;
+
+/*******************************************************************************
+* Function Name: Usage
+*******************************************************************************/
+static void Usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [-n nodes] [-t seconds] [-i connIntv] [-p pdusPerEvent] [-b txBuffers] [-w window] [-B s,bytes,s] [-f faultEvery] [-a] [-s file] [-u file] [-v]\n"
+        "  -n  Number of IPSP nodes, 1..%u (default 1)\n"
+        "  -t  Simulated run time in seconds (default %u)\n"
+        "  -i  Connection interval in 1.25 ms units (default 6)\n"
+        "  -p  LL PDU exchanges per connection event (default %u)\n"
+        "  -b  Stack TX buffers per connection before it reports busy (default 4)\n"
+        "  -w  Router loopback transmit window, 1..8 (default: Router setting)\n"
+        "  -B  Router benchmark mode: duration, payload and warm-up (sent as 'bench start'),\n"
+        "      the BENCH line is in the Router output (-v)\n"
+        "  -f  Damage every Nth SDU delivered, alternately corrupted and truncated (default 0, none)\n"
+        "  -a  Switch the Router to auto-connect in place of typing a connect command per node\n"
+        "  -s  Type the command lines of a script file in place of the commands above:\n"
+        "      one '<seconds> <router|node0..3> <command>' per line, '#' starts a comment\n"
+        "  -u  Write the raw Router UART output to file, for trace_decode\n"
+        "  -v  Print the application UART output\n",
+        prog, MAX_NODES, DEFAULT_DURATION_S, DEFAULT_PDUS_PER_EVENT);
+}
+
+/*******************************************************************************
+* Function Name: LoadScript
+********************************************************************************
+*
+* Summary:
+*  Reads a script file: each line is the simulated time in seconds, the board
+*  and the command line it gets on its UART. Times must not go back.
+*
+* Return:
+*  false when the file cannot be read or a line is wrong, with a message.
+*
+*******************************************************************************/
+static bool LoadScript(const char *path, uint32_t nodes)
+{
+    FILE     *file = fopen(path, "r");
+    char     text[256u];
+    char     name[16u];
+    double   seconds;
+    int      used;
+    uint32_t lineNo = 0u;
+    uint32_t node;
+    script_line_t *entry;
+
+    if(file == NULL)
+    {
+        fprintf(stderr, "cannot read %s\n", path);
+        return(false);
+    }
+    while(fgets(text, sizeof(text), file) != NULL)
+    {
+        char *hash = strchr(text, '#');
+
+        lineNo++;
+        if(hash != NULL)
+        {
+            *hash = '\0';
+        }
+        text[strcspn(text, "\r\n")] = '\0';
+        if(sscanf(text, " %lf %15s %n", &seconds, name, &used) < 2)
+        {
+            if(strspn(text, " \t") != strlen(text))
+            {
+                fprintf(stderr, "%s:%u: expected '<seconds> <board> <command>'\n", path, (unsigned)lineNo);
+                fclose(file);
+                return(false);
+            }
+            continue;
+        }
+        if(scriptLines == MAX_SCRIPT_LINES)
+        {
+            fprintf(stderr, "%s:%u: more than %u lines\n", path, (unsigned)lineNo, (unsigned)MAX_SCRIPT_LINES);
+            fclose(file);
+            return(false);
+        }
+        entry = &script[scriptLines];
+        if(strcmp(name, "router") == 0)
+        {
+            entry->board = 0u;
+        }
+        else if((sscanf(name, "node%u", &node) == 1) && (node < nodes))
+        {
+            entry->board = (uint8_t)(1u + node);
+        }
+        else
+        {
+            fprintf(stderr, "%s:%u: no board %s\n", path, (unsigned)lineNo, name);
+            fclose(file);
+            return(false);
+        }
+        entry->time = (uint64_t)(seconds * (double)HOSTSIM_US_PER_SEC);
+        if((seconds < 0.0) || ((scriptLines != 0u) && (entry->time < script[scriptLines - 1u].time)) ||
+           ((strlen(&text[used]) + 2u) > SCRIPT_LINE_LEN))
+        {
+            fprintf(stderr, "%s:%u: time goes back or line too long\n", path, (unsigned)lineNo);
+            fclose(file);
+            return(false);
+        }
+        snprintf(entry->line, sizeof(entry->line), "%s\r", &text[used]);
+        scriptLines++;
+    }
+    fclose(file);
+    return(true);
+}
+
+/*******************************************************************************
+* Function Name: RunPasses
+********************************************************************************
+*
+* Summary:
+*  Runs main loop passes of every board until none of them makes progress,
+*  i.e. all pending stack events are handled and the applications are idle.
+*
+*******************************************************************************/
+static void RunPasses(void)
+{
+    uint32_t pass;
+    uint32_t activity;
+    uint8_t  i;
+
+    for(pass = 0u; pass < MAX_PASSES; pass++)
+    {
+        activity = HostSim_Activity();
+        for(i = 0u; i < boards; i++)
+        {
+            HostSim_Select(board[i].dev);
+            board[i].process();
+        }
+        if(HostSim_Activity() == activity)
+        {
+            break;
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: CompareU64
+*******************************************************************************/
+static int CompareU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return((x > y) - (x < y));
+}
+
+/*******************************************************************************
+* Function Name: PrintReport
+*******************************************************************************/
+static void PrintReport(uint32_t duration)
+{
+    const hostsim_dev_stats_t *router = HostSim_DevStats(board[0u].dev);
+    const hostsim_rtt_stats_t *rtt = HostSim_RttStats();
+    static const uint32_t bucketMs[RTT_BUCKETS] = { 10u, 20u, 50u, 100u, 200u, 500u, 1000u, UINT32_MAX };
+    uint32_t bucket[RTT_BUCKETS] = { 0u };
+    uint64_t span;
+    uint64_t p50 = 0u;
+    uint64_t p99 = 0u;
+    uint64_t max = 0u;
+    double   pps = 0.0;
+    double   bps = 0.0;
+    uint32_t nodeCreditPdus = 0u;
+    uint32_t i;
+    uint32_t b;
+
+    for(i = 1u; i < boards; i++)
+    {
+        nodeCreditPdus += HostSim_DevStats(board[i].dev)->creditPdus;
+    }
+    span = (router->lastRx > router->firstTx) ? (router->lastRx - router->firstTx) : 0u;
+    if(span != 0u)
+    {
+        pps = (double)rtt->echoed * (double)HOSTSIM_US_PER_SEC / (double)span;
+        bps = (double)router->rxBytes * (double)HOSTSIM_US_PER_SEC / (double)span;
+    }
+    if(rtt->count != 0u)
+    {
+        qsort(rtt->samples, rtt->count, sizeof(uint64_t), CompareU64);
+        p50 = rtt->samples[(rtt->count - 1u) / 2u];
+        p99 = rtt->samples[((rtt->count - 1u) * 99u) / 100u];
+        max = rtt->samples[rtt->count - 1u];
+        for(i = 0u; i < rtt->count; i++)
+        {
+            for(b = 0u; (rtt->samples[i] / 1000u) >= bucketMs[b]; b++)
+            {
+            }
+            bucket[b]++;
+        }
+    }
+
+    printf("\r\nIPSP loopback: %u node(s), %u s simulated\r\n", (unsigned)(boards - 1u), (unsigned)duration);
+    printf("  Router TX SDU   : %u (rejected %u)\r\n", (unsigned)router->txSdu, (unsigned)router->txRejected);
+    printf("  Echoes received : %u\r\n", (unsigned)rtt->echoed);
+    printf("  Lost            : %u\r\n", (unsigned)rtt->lost);
+    printf("  In flight       : %u\r\n", (unsigned)rtt->inFlight);
+    printf("  Corrupted       : %u\r\n", (unsigned)rtt->corrupted);
+    printf("  Truncated       : %u\r\n", (unsigned)rtt->truncated);
+    printf("  Reordered       : %u\r\n", (unsigned)rtt->reordered);
+    printf("  Unmatched       : %u\r\n", (unsigned)rtt->unmatched);
+    printf("  Throughput      : %.2f packets/s, %.0f bytes/s\r\n", pps, bps);
+    printf("  Credit PDUs     : Router %u, Nodes %u\r\n", (unsigned)router->creditPdus, (unsigned)nodeCreditPdus);
+    printf("  RTT (ms)        : p50 %.2f, p99 %.2f, max %.2f\r\n",
+        (double)p50 / 1000.0, (double)p99 / 1000.0, (double)max / 1000.0);
+    for(b = 0u; b < RTT_BUCKETS; b++)
+    {
+        if(bucketMs[b] != UINT32_MAX)
+        {
+            printf("    < %4u ms : %u\r\n", (unsigned)bucketMs[b], (unsigned)bucket[b]);
+        }
+        else
+        {
+            printf("    >= %3u ms : %u\r\n", (unsigned)bucketMs[b - 1u], (unsigned)bucket[b]);
+        }
+    }
+    printf("RESULT nodes=%u echoed=%u lost=%u in_flight=%u corrupted=%u truncated=%u reordered=%u unmatched=%u pps=%.2f bps=%.0f rtt_p50_us=%llu rtt_p99_us=%llu "
+        "rtt_max_us=%llu credit_pdus=%u\n",
+        (unsigned)(boards - 1u), (unsigned)rtt->echoed, (unsigned)rtt->lost, (unsigned)rtt->inFlight,
+        (unsigned)rtt->corrupted, (unsigned)rtt->truncated, (unsigned)rtt->reordered, (unsigned)rtt->unmatched,
+        pps, bps, (unsigned long long)p50, (unsigned long long)p99, (unsigned long long)max,
+        (unsigned)(router->creditPdus + nodeCreditPdus));
+}
+
+/*******************************************************************************
+* Function Name: main
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+    hostsim_link_cfg_t cfg =
+    {
+        .connIntv     = 6u,
+        .advIntv      = 0x20u,
+        .llPayload    = CY_BLE_CONFIG_LL_MAX_TX_PAYLOAD_SIZE,
+        .pdusPerEvent = DEFAULT_PDUS_PER_EVENT,
+        .txBuffers    = 4u,
+        .discEvents   = 8u,
+        .faultEvery   = 0u
+    };
+    uint32_t duration = DEFAULT_DURATION_S;
+    uint32_t nodes = 1u;
+    uint32_t window = 0u;
+    bool     bench = false;
+    unsigned benchArg[3u];
+    char     command[64u];
+    uint64_t end;
+    uint64_t next;
+    uint64_t commandTime = COMMAND_TIME_US;
+    uint32_t commandsSent = 0u;
+    FILE     *capture = NULL;
+    const char *scriptPath = NULL;
+    uint32_t scriptNext = 0u;
+    bool     autoConnect = false;
+    int      opt;
+    uint8_t  i;
+
+    while((opt = getopt(argc, argv, "n:t:i:p:b:w:B:f:as:u:vh")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n':
+                nodes = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                duration = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                cfg.connIntv = (uint16_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                cfg.pdusPerEvent = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                cfg.txBuffers = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                window = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'B':
+                if(sscanf(optarg, "%u,%u,%u", &benchArg[0u], &benchArg[1u], &benchArg[2u]) != 3)
+                {
+                    Usage(argv[0]);
+                    return(EXIT_FAILURE);
+                }
+                bench = true;
+                break;
+            case 'f':
+                cfg.faultEvery = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'a':
+                autoConnect = true;
+                break;
+            case 's':
+                scriptPath = optarg;
+                break;
+            case 'u':
+                capture = fopen(optarg, "wb");
+                if(capture == NULL)
+                {
+                    fprintf(stderr, "%s: cannot write %s\n", argv[0], optarg);
+                    return(EXIT_FAILURE);
+                }
+                break;
+            case 'v':
+                HostSim_SetVerbose(true);
+                break;
+            default:
+                Usage(argv[0]);
+                return((opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    if((nodes < 1u) || (nodes > MAX_NODES) || (cfg.connIntv < 6u) || (cfg.pdusPerEvent == 0u) || (cfg.txBuffers == 0u) || (duration == 0u) ||
+       (window > 8u))
+    {
+        Usage(argv[0]);
+        return(EXIT_FAILURE);
+    }
+
+    if(scriptPath != NULL)
+    {
+        if(LoadScript(scriptPath, nodes) == false)
+        {
+            return(EXIT_FAILURE);
+        }
+        /* The script types every command */
+        commandsSent = nodes;
+    }
+
+    HostSim_Configure(&cfg);
+
+    /* Board 0 is the Router, the remaining boards are Nodes */
+    board[0u].dev = HostSim_AddDevice("Router", 0x00u, CY_BLE_CONN_COUNT, 0);
+    board[0u].init = Router_HostInit;
+    board[0u].process = BleIPSPRouter_Process;
+    HostSim_SetUartCapture(board[0u].dev, capture);
+    for(i = 0u; i < nodes; i++)
+    {
+        char name[8u];
+        snprintf(name, sizeof(name), "Node%u", (unsigned)i);
+        board[1u + i].dev = HostSim_AddDevice(name, (uint8_t)(1u + i), 1u, (int8_t)(-40 - (10 * (int)i)));
+        board[1u + i].init = nodeInit[i];
+        board[1u + i].process = nodeProcess[i];
+    }
+    boards = (uint8_t)(1u + nodes);
+    HostSim_TrackRtt(board[0u].dev);
+
+    for(i = 0u; i < boards; i++)
+    {
+        HostSim_Select(board[i].dev);
+        board[i].init();
+    }
+
+    end = (uint64_t)duration * HOSTSIM_US_PER_SEC;
+    for(;;)
+    {
+        RunPasses();
+
+        next = HostSim_NextEventTime();
+        if((scriptNext < scriptLines) && (next >= script[scriptNext].time) && (script[scriptNext].time <= end))
+        {
+            HostSim_Advance(script[scriptNext].time);
+            HostSim_UartInject(board[script[scriptNext].board].dev, script[scriptNext].line);
+            scriptNext++;
+            continue;
+        }
+        if((commandsSent < nodes) && (next >= commandTime))
+        {
+            /* Same command lines an operator types on the Router terminal,
+             * one connect command per Node */
+            HostSim_Advance(commandTime);
+            if((window != 0u) && (commandsSent == 0u))
+            {
+                snprintf(command, sizeof(command), ROUTER_WINDOW_COMMAND, (unsigned)window);
+                HostSim_UartInject(board[0u].dev, command);
+            }
+            if((bench == true) && (commandsSent == 0u))
+            {
+                snprintf(command, sizeof(command), ROUTER_BENCH_COMMAND, benchArg[0u], benchArg[1u], benchArg[2u]);
+                HostSim_UartInject(board[0u].dev, command);
+            }
+            if(autoConnect == true)
+            {
+                /* The Router finds and connects the Nodes on its own */
+                HostSim_UartInject(board[0u].dev, ROUTER_AUTO_COMMAND);
+                commandsSent = nodes;
+                continue;
+            }
+            snprintf(command, sizeof(command), ROUTER_COMMAND, (unsigned)commandsSent);
+            HostSim_UartInject(board[0u].dev, command);
+            commandsSent++;
+            commandTime += COMMAND_GAP_US;
+            continue;
+        }
+        if((next == HOSTSIM_NO_EVENT) || (next > end))
+        {
+            break;
+        }
+        HostSim_Advance(next);
+    }
+
+    PrintReport(duration);
+    if(capture != NULL)
+    {
+        fclose(capture);
+    }
+    return(EXIT_SUCCESS);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,440 @@
+/*******************************************************************************
+* File Name: trace_decode.c
+*
+* Version: 1.00
+*
+* Description:
+*  Decoder of the tokenized debug trace of the Router and Node applications
+*  (DEBUG_UART_TRACE in debug.h). A record holds the offset of its format in
+*  the trace_fmt section and the raw arguments; the decoder walks the format
+*  the same way the firmware did and prints every argument with its own
+*  conversion, so the text is the one printf would have sent.
+*
+*  The decoder is fed the UART byte stream one byte at a time. Bytes outside
+*  records are text of an application built without the trace and are passed
+*  through unchanged.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "trace_decode.h"
+
+/***************************************
+*           Constants
+***************************************/
+#define TRACE_STATE_TEXT            (0u)
+#define TRACE_STATE_LEN             (1u)
+#define TRACE_STATE_BODY            (2u)
+
+#define TRACE_SPEC_MAX              (32u)
+
+typedef struct
+{
+    char        *text;
+    uint32_t    size;
+    uint32_t    len;
+} trace_out_t;
+
+/*******************************************************************************
+* Function Name: Put
+********************************************************************************
+*
+* Summary:
+*  Appends text to the output, with the time of the last record in front of
+*  every line when the cycle counter clock is known.
+*
+*******************************************************************************/
+static void Put(trace_decoder_t *dec, trace_out_t *out, const char *text, uint32_t len)
+{
+    char     stamp[24u];
+    uint32_t stampLen;
+    uint32_t i;
+
+    for(i = 0u; i < len; i++)
+    {
+        if(dec->lineStart && (dec->cpuHz != 0u))
+        {
+            stampLen = (uint32_t)snprintf(stamp, sizeof(stamp), "[%12.6f] ", (double)dec->cycles / (double)dec->cpuHz);
+            if((out->len + stampLen) < out->size)
+            {
+                memcpy(&out->text[out->len], stamp, stampLen);
+                out->len += stampLen;
+            }
+        }
+        if((out->len + 1u) < out->size)
+        {
+            out->text[out->len++] = text[i];
+        }
+        dec->lineStart = (text[i] == '\n');
+    }
+}
+
+/*******************************************************************************
+* Function Name: Varint
+********************************************************************************
+*
+* Summary:
+*  Reads a LEB128 varint.
+*
+* Return:
+*  false when the record ends inside the varint.
+*
+*******************************************************************************/
+static bool Varint(const uint8_t **p, const uint8_t *end, uint64_t *value)
+{
+    uint32_t shift = 0u;
+    uint8_t  byte;
+
+    *value = 0u;
+    while((*p < end) && (shift < 64u))
+    {
+        byte = *(*p)++;
+        *value |= ((uint64_t)(byte & 0x7Fu)) << shift;
+        if((byte & 0x80u) == 0u)
+        {
+            return(true);
+        }
+        shift += 7u;
+    }
+    return(false);
+}
+
+/*******************************************************************************
+* Function Name: Unzigzag
+*******************************************************************************/
+static int64_t Unzigzag(uint64_t value)
+{
+    return((int64_t)((value >> 1u) ^ (~(value & 1u) + 1u)));
+}
+
+/*******************************************************************************
+* Function Name: Format
+********************************************************************************
+*
+* Summary:
+*  Prints the arguments of a record with its format. A record that ends
+*  before its format, because the firmware cut it, ends with "...".
+*
+*******************************************************************************/
+static void Format(trace_decoder_t *dec, trace_out_t *out, const char *f, const uint8_t *p, const uint8_t *end)
+{
+    char        spec[TRACE_SPEC_MAX];
+    char        arg[TRACE_TEXT_MAX];
+    const char  *lit;
+    const char  *start;
+    uint32_t    n;
+    uint64_t    value;
+    uint64_t    len;
+    int         prec;
+    bool        hasPrec;
+    double      real;
+    char        conv;
+    int         argLen = 0;
+
+    while((*f != '\0') && (argLen >= 0))
+    {
+        if(*f != '%')
+        {
+            lit = f;
+            while((*f != '\0') && (*f != '%'))
+            {
+                f++;
+            }
+            Put(dec, out, lit, (uint32_t)(f - lit));
+            continue;
+        }
+        if(f[1] == '%')
+        {
+            Put(dec, out, "%", 1u);
+            f += 2;
+            continue;
+        }
+
+        /* Rebuild the conversion with the '*' values filled in */
+        start = f;
+        spec[0u] = *f++;
+        n = 1u;
+        while((*f != '\0') && (strchr("-+ #0", *f) != NULL) && (n < (TRACE_SPEC_MAX / 2u)))
+        {
+            spec[n++] = *f++;
+        }
+        if(*f == '*')
+        {
+            if(!Varint(&p, end, &value))
+            {
+                argLen = -1;
+                break;
+            }
+            n += (uint32_t)snprintf(&spec[n], TRACE_SPEC_MAX - n, "%d", (int)Unzigzag(value));
+            f++;
+        }
+        while((*f >= '0') && (*f <= '9') && (n < (TRACE_SPEC_MAX / 2u)))
+        {
+            spec[n++] = *f++;
+        }
+        hasPrec = false;
+        prec = 0;
+        if(*f == '.')
+        {
+            f++;
+            hasPrec = true;
+            if(*f == '*')
+            {
+                if(!Varint(&p, end, &value))
+                {
+                    argLen = -1;
+                    break;
+                }
+                prec = (int)Unzigzag(value);
+                f++;
+            }
+            while((*f >= '0') && (*f <= '9'))
+            {
+                prec = (prec * 10) + (*f++ - '0');
+            }
+        }
+        while((*f != '\0') && (strchr("hljztL", *f) != NULL))
+        {
+            f++;
+        }
+        conv = *f;
+        if(conv != '\0')
+        {
+            f++;
+        }
+        if(hasPrec && (conv != 's'))
+        {
+            n += (uint32_t)snprintf(&spec[n], TRACE_SPEC_MAX - n, ".%d", prec);
+        }
+
+        argLen = -1;
+        switch(conv)
+        {
+            case 'd':
+            case 'i':
+                if(Varint(&p, end, &value))
+                {
+                    snprintf(&spec[n], TRACE_SPEC_MAX - n, "ll%c", conv);
+                    argLen = snprintf(arg, sizeof(arg), spec, (long long)Unzigzag(value));
+                }
+                break;
+
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                if(Varint(&p, end, &value))
+                {
+                    snprintf(&spec[n], TRACE_SPEC_MAX - n, "ll%c", conv);
+                    argLen = snprintf(arg, sizeof(arg), spec, (unsigned long long)value);
+                }
+                break;
+
+            case 'c':
+                if(Varint(&p, end, &value))
+                {
+                    snprintf(&spec[n], TRACE_SPEC_MAX - n, "c");
+                    argLen = snprintf(arg, sizeof(arg), spec, (int)value);
+                }
+                break;
+
+            case 'p':
+                if(Varint(&p, end, &value))
+                {
+                    snprintf(&spec[n], TRACE_SPEC_MAX - n, "p");
+                    argLen = snprintf(arg, sizeof(arg), spec, (void *)(uintptr_t)value);
+                }
+                break;
+
+            case 's':
+                /* The firmware already applied the precision */
+                if(Varint(&p, end, &len) && (len <= (uint64_t)(end - p)))
+                {
+                    snprintf(&spec[n], TRACE_SPEC_MAX - n, ".*s");
+                    argLen = snprintf(arg, sizeof(arg), spec, (int)len, (const char *)p);
+                    p += len;
+                }
+                break;
+
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                if((end - p) >= (int)sizeof(real))
+                {
+                    memcpy(&real, p, sizeof(real));
+                    p += sizeof(real);
+                    snprintf(&spec[n], TRACE_SPEC_MAX - n, "%c", conv);
+                    argLen = snprintf(arg, sizeof(arg), spec, real);
+                }
+                break;
+
+            default:
+                /* The firmware did not encode anything past this point */
+                Put(dec, out, start, (uint32_t)strlen(start));
+                return;
+        }
+        if(argLen >= 0)
+        {
+            Put(dec, out, arg, ((uint32_t)argLen < sizeof(arg)) ? (uint32_t)argLen : (uint32_t)(sizeof(arg) - 1u));
+        }
+    }
+    if(argLen < 0)
+    {
+        Put(dec, out, "...\r\n", 5u);
+    }
+}
+
+/*******************************************************************************
+* Function Name: Record
+********************************************************************************
+*
+* Summary:
+*  Prints a complete record.
+*
+*******************************************************************************/
+static void Record(trace_decoder_t *dec, trace_out_t *out)
+{
+    const uint8_t *p = &dec->rec[2u];
+    const uint8_t *end = &dec->rec[dec->len];
+    const char    *format;
+    char          text[48u];
+    uint64_t      value;
+    uint32_t      id;
+    uint32_t      before = out->len;
+    int           len;
+
+    dec->records++;
+    dec->recordBytes += 2u + (uint32_t)dec->len;
+    if(dec->len < 2u)
+    {
+        dec->errors++;
+        Put(dec, out, "<bad trace record>\r\n", 20u);
+        return;
+    }
+    id = (uint32_t)dec->rec[0u] | ((uint32_t)dec->rec[1u] << 8u);
+
+    if(id == TRACE_ID_DATA)
+    {
+        for(; p < end; p++)
+        {
+            snprintf(text, sizeof(text), "%2.2x", *p);
+            Put(dec, out, text, 2u);
+        }
+    }
+    else if(id == TRACE_ID_DROPPED)
+    {
+        (void)Varint(&p, end, &value);
+        len = snprintf(text, sizeof(text), "<%llu log lines dropped>\r\n", (unsigned long long)value);
+        Put(dec, out, text, (uint32_t)len);
+    }
+    else if((id < dec->formatsLen) && (memchr(&dec->formats[id], '\0', dec->formatsLen - id) != NULL) &&
+            Varint(&p, end, &value))
+    {
+        /* The firmware sends 32 bit cycle deltas */
+        dec->cycles += (uint32_t)value;
+        format = &dec->formats[id];
+        Format(dec, out, format, p, end);
+    }
+    else
+    {
+        dec->errors++;
+        Put(dec, out, "<bad trace record>\r\n", 20u);
+    }
+    dec->textBytes += out->len - before;
+}
+
+/*******************************************************************************
+* Function Name: TraceDecode_Init
+********************************************************************************
+*
+* Summary:
+*  Starts a decoder.
+*
+* Parameters:
+*  dec: the decoder.
+*  formats: contents of the trace_fmt section, NULL if there is none.
+*  formatsLen: size of the section.
+*  cpuHz: clock of the cycle counter, 0 to print no timestamps.
+*
+*******************************************************************************/
+void TraceDecode_Init(trace_decoder_t *dec, const char *formats, uint32_t formatsLen, uint32_t cpuHz)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->formats = formats;
+    dec->formatsLen = (formats != NULL) ? formatsLen : 0u;
+    dec->cpuHz = cpuHz;
+    dec->lineStart = true;
+    dec->state = TRACE_STATE_TEXT;
+}
+
+/*******************************************************************************
+* Function Name: TraceDecode_Byte
+********************************************************************************
+*
+* Summary:
+*  Feeds one byte of the UART stream.
+*
+* Parameters:
+*  dec: the decoder.
+*  byte: the byte received.
+*  text: receives the text the byte completes, NUL terminated.
+*  size: size of text, TRACE_TEXT_MAX holds any record.
+*
+* Return:
+*  Length of the text, 0 while a record is incomplete.
+*
+*******************************************************************************/
+uint32_t TraceDecode_Byte(trace_decoder_t *dec, uint8_t byte, char *text, uint32_t size)
+{
+    trace_out_t out = { .text = text, .size = size, .len = 0u };
+    char        c = (char)byte;
+
+    switch(dec->state)
+    {
+        case TRACE_STATE_LEN:
+            dec->len = byte;
+            dec->pos = 0u;
+            dec->state = TRACE_STATE_BODY;
+            if(byte == 0u)
+            {
+                Record(dec, &out);
+                dec->state = TRACE_STATE_TEXT;
+            }
+            break;
+
+        case TRACE_STATE_BODY:
+            dec->rec[dec->pos++] = byte;
+            if(dec->pos == dec->len)
+            {
+                Record(dec, &out);
+                dec->state = TRACE_STATE_TEXT;
+            }
+            break;
+
+        default:
+            if(byte == TRACE_SYNC)
+            {
+                dec->state = TRACE_STATE_LEN;
+            }
+            else
+            {
+                Put(dec, &out, &c, 1u);
+            }
+            break;
+    }
+    text[out.len] = '\0';
+    return(out.len);
+}
+
+/* [] END OF FILE */
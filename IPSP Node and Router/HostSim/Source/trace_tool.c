@@ -0,0 +1,231 @@
+/*******************************************************************************
+* File Name: trace_tool.c
+*
+* Version: 1.00
+*
+* Description:
+*  Host decoder of a captured debug UART stream of a Router or Node built
+*  with DEBUG_UART_TRACE. The formats are read from the trace_fmt section of
+*  the ELF file of the firmware, or of build/ipsp_loopback for a capture of
+*  the harness (ipsp_loopback -u).
+*
+*      trace_decode [-c cpuHz] firmware.elf [capture]
+*
+*  The capture is read from stdin when no file is given. With -c every line
+*  starts with the time of its record in seconds.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <elf.h>
+#include "trace_decode.h"
+
+/***************************************
+*           Constants
+***************************************/
+#define TRACE_SECTION_NAME          "trace_fmt"
+
+/*******************************************************************************
+* Function Name: ReadFile
+********************************************************************************
+*
+* Summary:
+*  Reads a whole file into memory.
+*
+*******************************************************************************/
+static uint8_t *ReadFile(const char *name, size_t *size)
+{
+    FILE    *file = fopen(name, "rb");
+    uint8_t *data = NULL;
+    long    len;
+
+    if(file == NULL)
+    {
+        return(NULL);
+    }
+    if((fseek(file, 0, SEEK_END) == 0) && ((len = ftell(file)) > 0) && (fseek(file, 0, SEEK_SET) == 0))
+    {
+        data = malloc((size_t)len);
+        if((data != NULL) && (fread(data, 1u, (size_t)len, file) != (size_t)len))
+        {
+            free(data);
+            data = NULL;
+        }
+        *size = (size_t)len;
+    }
+    fclose(file);
+    return(data);
+}
+
+/*******************************************************************************
+* Function Name: FindSection
+********************************************************************************
+*
+* Summary:
+*  Finds a section of a little endian ELF file, 32 or 64 bit.
+*
+* Return:
+*  Pointer to the section contents, NULL when the file has no such section.
+*
+*******************************************************************************/
+static const char *FindSection(const uint8_t *elf, size_t size, const char *name, uint32_t *len)
+{
+    uint64_t shoff;
+    uint64_t offset;
+    uint64_t secSize;
+    uint64_t strOffset;
+    uint32_t shentsize;
+    uint32_t shnum;
+    uint32_t shstrndx;
+    uint32_t secName;
+    uint32_t secType;
+    uint32_t i;
+    bool     is64;
+
+    if((size < sizeof(Elf32_Ehdr)) || (memcmp(elf, ELFMAG, SELFMAG) != 0) || (elf[EI_DATA] != ELFDATA2LSB))
+    {
+        return(NULL);
+    }
+    is64 = (elf[EI_CLASS] == ELFCLASS64);
+    if(is64)
+    {
+        const Elf64_Ehdr *eh = (const Elf64_Ehdr *)elf;
+
+        shoff = eh->e_shoff;
+        shentsize = eh->e_shentsize;
+        shnum = eh->e_shnum;
+        shstrndx = eh->e_shstrndx;
+    }
+    else
+    {
+        const Elf32_Ehdr *eh = (const Elf32_Ehdr *)elf;
+
+        shoff = eh->e_shoff;
+        shentsize = eh->e_shentsize;
+        shnum = eh->e_shnum;
+        shstrndx = eh->e_shstrndx;
+    }
+    if((shstrndx >= shnum) || ((shoff + ((uint64_t)shnum * shentsize)) > size))
+    {
+        return(NULL);
+    }
+
+    strOffset = is64 ? ((const Elf64_Shdr *)&elf[shoff + ((uint64_t)shstrndx * shentsize)])->sh_offset
+                     : ((const Elf32_Shdr *)&elf[shoff + ((uint64_t)shstrndx * shentsize)])->sh_offset;
+    for(i = 0u; i < shnum; i++)
+    {
+        const uint8_t *sh = &elf[shoff + ((uint64_t)i * shentsize)];
+
+        if(is64)
+        {
+            secName = ((const Elf64_Shdr *)sh)->sh_name;
+            secType = ((const Elf64_Shdr *)sh)->sh_type;
+            offset = ((const Elf64_Shdr *)sh)->sh_offset;
+            secSize = ((const Elf64_Shdr *)sh)->sh_size;
+        }
+        else
+        {
+            secName = ((const Elf32_Shdr *)sh)->sh_name;
+            secType = ((const Elf32_Shdr *)sh)->sh_type;
+            offset = ((const Elf32_Shdr *)sh)->sh_offset;
+            secSize = ((const Elf32_Shdr *)sh)->sh_size;
+        }
+        if(((strOffset + secName + strlen(name) + 1u) <= size) &&
+           (strcmp((const char *)&elf[strOffset + secName], name) == 0) &&
+           (secType != SHT_NOBITS) && ((offset + secSize) <= size))
+        {
+            *len = (uint32_t)secSize;
+            return((const char *)&elf[offset]);
+        }
+    }
+    return(NULL);
+}
+
+/*******************************************************************************
+* Function Name: main
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+    trace_decoder_t dec;
+    char            text[TRACE_TEXT_MAX];
+    const char      *formats;
+    uint8_t         *elf;
+    size_t          elfSize = 0u;
+    uint32_t        formatsLen = 0u;
+    uint32_t        cpuHz = 0u;
+    FILE            *capture = stdin;
+    int             opt;
+    int             c;
+
+    while((opt = getopt(argc, argv, "c:h")) != -1)
+    {
+        switch(opt)
+        {
+            case 'c':
+                cpuHz = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-c cpuHz] firmware.elf [capture]\n", argv[0]);
+                return((opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    if((optind >= argc) || ((argc - optind) > 2))
+    {
+        fprintf(stderr, "Usage: %s [-c cpuHz] firmware.elf [capture]\n", argv[0]);
+        return(EXIT_FAILURE);
+    }
+
+    elf = ReadFile(argv[optind], &elfSize);
+    if(elf == NULL)
+    {
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[optind]);
+        return(EXIT_FAILURE);
+    }
+    formats = FindSection(elf, elfSize, TRACE_SECTION_NAME, &formatsLen);
+    if(formats == NULL)
+    {
+        fprintf(stderr, "%s: %s has no %s section, was it built with DEBUG_UART_TRACE?\n",
+            argv[0], argv[optind], TRACE_SECTION_NAME);
+        free(elf);
+        return(EXIT_FAILURE);
+    }
+    if((argc - optind) == 2)
+    {
+        capture = fopen(argv[optind + 1], "rb");
+        if(capture == NULL)
+        {
+            fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[optind + 1]);
+            free(elf);
+            return(EXIT_FAILURE);
+        }
+    }
+
+    TraceDecode_Init(&dec, formats, formatsLen, cpuHz);
+    while((c = fgetc(capture)) != EOF)
+    {
+        if(TraceDecode_Byte(&dec, (uint8_t)c, text, sizeof(text)) != 0u)
+        {
+            fputs(text, stdout);
+        }
+    }
+    fprintf(stderr, "%lu records, %lu bytes decoded to %lu bytes of text, %lu bad records\n",
+        (unsigned long)dec.records, (unsigned long)dec.recordBytes, (unsigned long)dec.textBytes,
+        (unsigned long)dec.errors);
+
+    if(capture != stdin)
+    {
+        fclose(capture);
+    }
+    free(elf);
+    return((dec.errors == 0u) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/* [] END OF FILE */
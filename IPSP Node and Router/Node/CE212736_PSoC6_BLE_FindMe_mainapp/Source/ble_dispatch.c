@@ -0,0 +1,237 @@
+/*******************************************************************************
+* File Name: ble_dispatch.c
+*
+* Version: 1.00
+*
+* Description:
+*  This file contains the BLE event dispatcher. BleDispatch_Event() is the
+*  callback registered with the BLE stack: it finds the slot of the event
+*  code in an open addressed hash table, calls the registered handler or the
+*  default handler and adds the handler cycles, read from the DWT cycle
+*  counter, to the statistics of the event. The first event of a code that
+*  has no handler takes a slot of its own, so the statistics cover every
+*  event the stack sends.
+*
+*  Cycles of a handler include any event the stack delivers from inside it.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include "ble_dispatch.h"
+#include "debug.h"
+
+#define BLE_DISPATCH_MASK           (BLE_DISPATCH_SLOTS - 1u)
+
+static ble_dispatch_entry_t         dispatchTable[BLE_DISPATCH_SLOTS];
+static ble_dispatch_handler_t       dispatchDefault;
+static uint32_t                     dispatchUncounted;      /* Events past a full table */
+
+/******************************************************************************
+* Function Name: BleDispatch_Slot
+*******************************************************************************
+*
+* Summary:
+*  Returns the slot of an event code, a new one when the code has none.
+*
+* Return:
+*  Pointer to the slot, NULL when the table is full.
+*
+******************************************************************************/
+static ble_dispatch_entry_t *BleDispatch_Slot(uint32_t event)
+{
+    /* Stack events are numbered in groups, service events start at 0x10000 */
+    uint32_t index = (event ^ (event >> 8u) ^ (event >> 16u)) & BLE_DISPATCH_MASK;
+    uint32_t probe;
+
+    for(probe = 0u; probe < BLE_DISPATCH_SLOTS; probe++)
+    {
+        ble_dispatch_entry_t *entry = &dispatchTable[(index + probe) & BLE_DISPATCH_MASK];
+
+        if(entry->event == event)
+        {
+            return(entry);
+        }
+        if(entry->event == BLE_DISPATCH_EMPTY)
+        {
+            entry->event = event;
+            entry->minCycles = UINT32_MAX;
+            return(entry);
+        }
+    }
+    return(NULL);
+}
+
+/******************************************************************************
+* Function Name: BleDispatch_Init
+*******************************************************************************
+*
+* Summary:
+*  Clears the table and starts the DWT cycle counter.
+*
+* Parameters:
+*  defaultHandler: called for the events without a registered handler.
+*
+******************************************************************************/
+void BleDispatch_Init(ble_dispatch_handler_t defaultHandler)
+{
+    uint32_t i;
+
+    for(i = 0u; i < BLE_DISPATCH_SLOTS; i++)
+    {
+        dispatchTable[i].event = BLE_DISPATCH_EMPTY;
+        dispatchTable[i].handler = NULL;
+    }
+    BleDispatch_ResetStats();
+    dispatchDefault = defaultHandler;
+
+    CYCLES_INIT();
+}
+
+/******************************************************************************
+* Function Name: BleDispatch_Register
+*******************************************************************************
+*
+* Summary:
+*  Sets the handler of an event code, replacing the previous one.
+*
+* Return:
+*  false when the table is full.
+*
+******************************************************************************/
+bool BleDispatch_Register(uint32_t event, ble_dispatch_handler_t handler)
+{
+    ble_dispatch_entry_t *entry = BleDispatch_Slot(event);
+
+    if(entry == NULL)
+    {
+        return(false);
+    }
+    entry->handler = handler;
+    return(true);
+}
+
+/******************************************************************************
+* Function Name: BleDispatch_Event
+*******************************************************************************
+*
+* Summary:
+*  Event callback of the BLE stack, register it with
+*  Cy_BLE_RegisterEventCallback().
+*
+******************************************************************************/
+void BleDispatch_Event(uint32_t event, void *eventParam)
+{
+    ble_dispatch_entry_t   *entry = BleDispatch_Slot(event);
+    ble_dispatch_handler_t handler;
+    uint32_t               startCycles;
+    uint32_t               cycles;
+
+    if(entry == NULL)
+    {
+        dispatchUncounted++;
+        if(dispatchDefault != NULL)
+        {
+            dispatchDefault(event, eventParam);
+        }
+        return;
+    }
+
+    handler = (entry->handler != NULL) ? entry->handler : dispatchDefault;
+    startCycles = CYCLES_GET();
+    if(handler != NULL)
+    {
+        handler(event, eventParam);
+    }
+    cycles = CYCLES_GET() - startCycles;
+
+    entry->count++;
+    entry->totalCycles += cycles;
+    if(cycles < entry->minCycles)
+    {
+        entry->minCycles = cycles;
+    }
+    if(cycles > entry->maxCycles)
+    {
+        entry->maxCycles = cycles;
+    }
+}
+
+/******************************************************************************
+* Function Name: BleDispatch_ResetStats
+*******************************************************************************
+*
+* Summary:
+*  Clears the statistics, the handlers stay registered.
+*
+******************************************************************************/
+void BleDispatch_ResetStats(void)
+{
+    uint32_t i;
+
+    for(i = 0u; i < BLE_DISPATCH_SLOTS; i++)
+    {
+        dispatchTable[i].count = 0u;
+        dispatchTable[i].minCycles = UINT32_MAX;
+        dispatchTable[i].maxCycles = 0u;
+        dispatchTable[i].totalCycles = 0u;
+    }
+    dispatchUncounted = 0u;
+}
+
+/******************************************************************************
+* Function Name: BleDispatch_PrintStats
+*******************************************************************************
+*
+* Summary:
+*  Prints the events seen, most handler cycles first. 'R' marks an event
+*  with a registered handler, 'D' one handled by the default handler.
+*
+******************************************************************************/
+void BleDispatch_PrintStats(void)
+{
+    uint8_t  order[BLE_DISPATCH_SLOTS];
+    uint64_t total = 0u;
+    uint32_t count = 0u;
+    uint32_t events = 0u;
+    uint32_t i;
+    uint32_t j;
+
+    /* Insertion sort of the used slots by their total cycles */
+    for(i = 0u; i < BLE_DISPATCH_SLOTS; i++)
+    {
+        if(dispatchTable[i].count == 0u)
+        {
+            continue;
+        }
+        total += dispatchTable[i].totalCycles;
+        events += dispatchTable[i].count;
+        for(j = count; (j > 0u) && (dispatchTable[order[j - 1u]].totalCycles < dispatchTable[i].totalCycles); j--)
+        {
+            order[j] = order[j - 1u];
+        }
+        order[j] = (uint8_t)i;
+        count++;
+    }
+
+    DEBUG_PRINTF("BLE events: %lu dispatched, %lu codes, %lu uncounted, %lu kcycles \r\n",
+        (unsigned long)events, (unsigned long)count, (unsigned long)dispatchUncounted,
+        (unsigned long)(total / 1000u));
+    DEBUG_PRINTF("  event    count    min cycles  avg cycles  max cycles  share \r\n");
+    for(i = 0u; i < count; i++)
+    {
+        const ble_dispatch_entry_t *entry = &dispatchTable[order[i]];
+
+        (void)entry;    /* Unused when DEBUG_PRINTF is compiled out */
+        DEBUG_PRINTF("  0x%05lx %c %7lu %11lu %11lu %11lu  %3lu%% \r\n",
+            (unsigned long)entry->event, (entry->handler != NULL) ? 'R' : 'D',
+            (unsigned long)entry->count, (unsigned long)entry->minCycles,
+            (unsigned long)(entry->totalCycles / entry->count), (unsigned long)entry->maxCycles,
+            (unsigned long)((total != 0u) ? ((entry->totalCycles * 100u) / total) : 0u));
+    }
+}
+
+/* [] END OF FILE */
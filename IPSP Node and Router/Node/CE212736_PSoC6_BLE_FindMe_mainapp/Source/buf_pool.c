@@ -0,0 +1,146 @@
+/*******************************************************************************
+* File Name: buf_pool.c
+*
+* Version: 1.00
+*
+* Description:
+*  This file contains the packet buffer pool of the Node. The pool is an
+*  array of BUF_POOL_BLOCKS blocks of BUF_POOL_BLOCK_SIZE bytes, and each
+*  block holds a whole SDU. The stack sends an SDU from one contiguous
+*  buffer, so a block never has to be gathered into another buffer first.
+*
+*  The free blocks are kept on a stack of block indices, so BufPool_Alloc()
+*  and BufPool_Free() take one step each. The stack is only changed in a
+*  critical section, so the pool may be used from the BLE event callback and
+*  from the main loop alike. The data of a block belongs to its owner and is
+*  not protected.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <string.h>
+#include "cy_syslib.h"
+#include "buf_pool.h"
+
+static uint8_t                      poolBlock[BUF_POOL_BLOCKS][BUF_POOL_BLOCK_SIZE];
+static buf_block_t                  poolFree[BUF_POOL_BLOCKS];      /* Stack of the free blocks */
+static uint32_t                     poolFreeBlocks;
+static buf_pool_stats_t             poolStats;
+
+/******************************************************************************
+* Function Name: BufPool_Init
+*******************************************************************************
+*
+* Summary:
+*  Puts all blocks on the free stack and clears the statistics.
+*
+******************************************************************************/
+void BufPool_Init(void)
+{
+    uint32_t i;
+
+    for(i = 0u; i < BUF_POOL_BLOCKS; i++)
+    {
+        poolFree[i] = (buf_block_t)(BUF_POOL_BLOCKS - 1u - i);
+    }
+    poolFreeBlocks = BUF_POOL_BLOCKS;
+    memset(&poolStats, 0, sizeof(poolStats));
+}
+
+/******************************************************************************
+* Function Name: BufPool_Alloc
+*******************************************************************************
+*
+* Summary:
+*  Takes a block for the given number of bytes from the free stack.
+*
+* Parameters:
+*  length: bytes the block must hold, at most BUF_POOL_BLOCK_SIZE.
+*
+* Return:
+*  The block, BUF_POOL_NONE when the pool is empty or the length too long.
+*
+******************************************************************************/
+buf_block_t BufPool_Alloc(uint32_t length)
+{
+    uint32_t    intrStatus;
+    buf_block_t block = BUF_POOL_NONE;
+
+    intrStatus = Cy_SysLib_EnterCriticalSection();
+    if((length <= BUF_POOL_BLOCK_SIZE) && (poolFreeBlocks != 0u))
+    {
+        poolFreeBlocks--;
+        block = poolFree[poolFreeBlocks];
+        poolStats.allocs++;
+        poolStats.used++;
+        if(poolStats.used > poolStats.highWater)
+        {
+            poolStats.highWater = poolStats.used;
+        }
+    }
+    else
+    {
+        poolStats.failures++;
+    }
+    Cy_SysLib_ExitCriticalSection(intrStatus);
+    return(block);
+}
+
+/******************************************************************************
+* Function Name: BufPool_Free
+*******************************************************************************
+*
+* Summary:
+*  Returns a block to the free stack. BUF_POOL_NONE is ignored.
+*
+******************************************************************************/
+void BufPool_Free(buf_block_t block)
+{
+    uint32_t intrStatus;
+
+    if(block == BUF_POOL_NONE)
+    {
+        return;
+    }
+    intrStatus = Cy_SysLib_EnterCriticalSection();
+    poolFree[poolFreeBlocks] = block;
+    poolFreeBlocks++;
+    poolStats.frees++;
+    poolStats.used--;
+    Cy_SysLib_ExitCriticalSection(intrStatus);
+}
+
+/******************************************************************************
+* Function Name: BufPool_Data
+*******************************************************************************
+*
+* Summary:
+*  Returns the BUF_POOL_BLOCK_SIZE contiguous bytes of a block.
+*
+******************************************************************************/
+uint8_t *BufPool_Data(buf_block_t block)
+{
+    return(poolBlock[block]);
+}
+
+/******************************************************************************
+* Function Name: BufPool_FreeBlocks
+******************************************************************************/
+uint32_t BufPool_FreeBlocks(void)
+{
+    return(poolFreeBlocks);
+}
+
+/******************************************************************************
+* Function Name: BufPool_Stats
+******************************************************************************/
+const buf_pool_stats_t *BufPool_Stats(void)
+{
+    return(&poolStats);
+}
+
+/* [] END OF FILE */
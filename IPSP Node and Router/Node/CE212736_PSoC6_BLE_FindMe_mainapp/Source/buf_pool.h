@@ -0,0 +1,68 @@
+/*******************************************************************************
+* File Name: buf_pool.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the packet buffer pool.
+*  The pool hands out blocks of one SDU each, so the SDUs of all connections
+*  share one RAM area instead of a worst-case queue per connection.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef BUF_POOL_H
+
+    #define BUF_POOL_H
+
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include "cycfg_ble.h"
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    /* Bytes per block, the longest SDU of the IPSP channel (L2CAP_MAX_LEN) */
+    #ifndef BUF_POOL_BLOCK_SIZE
+    #define BUF_POOL_BLOCK_SIZE         (CY_BLE_L2CAP_MTU - 2u)
+    #endif
+    /* Blocks of the pool, shared by all connections. Four is the RAM of the
+     * echo queue of one connection before the pool. */
+    #ifndef BUF_POOL_BLOCKS
+    #define BUF_POOL_BLOCKS             (4u)
+    #endif
+    /* Returned instead of a block when the pool has no free block */
+    #define BUF_POOL_NONE               (0xFFFFu)
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    /* A block is its index in the pool */
+    typedef uint16_t buf_block_t;
+
+    typedef struct
+    {
+        uint32_t    allocs;
+        uint32_t    frees;
+        uint32_t    failures;                       /* Allocations refused */
+        uint32_t    used;                           /* Blocks in use */
+        uint32_t    highWater;                      /* Most blocks in use */
+    } buf_pool_stats_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void BufPool_Init(void);
+    buf_block_t BufPool_Alloc(uint32_t length);
+    void BufPool_Free(buf_block_t block);
+    uint8_t *BufPool_Data(buf_block_t block);
+    uint32_t BufPool_FreeBlocks(void);
+    const buf_pool_stats_t *BufPool_Stats(void);
+
+#endif /* BUF_POOL_H */
+
+/* [] END OF FILE */
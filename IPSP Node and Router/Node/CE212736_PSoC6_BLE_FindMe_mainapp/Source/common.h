@@ -23,15 +23,39 @@
 	#include "cy_syspm.h"
     #include "debug.h"
     #include "LED.h"
+    #include "iphc.h"
+    #include "credit.h"
+    #include "ble_dispatch.h"
+    #include "command.h"
+    #include "buf_pool.h"
 
 	/* IPSP defines */
-	#define LE_DATA_CREDITS_IPSP         (1000u)
-	/* Set the watermark to half of the total credits to be used */
-	#define LE_WATER_MARK_IPSP           (LE_DATA_CREDITS_IPSP/2u)
+	/* Credits are topped up by the credit controller, the low mark event only backs it up */
+	#define LE_WATER_MARK_IPSP           (1u)
 	#define L2CAP_MAX_LEN                (CY_BLE_L2CAP_MTU - 2u)
 	#define ADV_TIMER_HANDLE             (0u)
 	#define ADV_TIMER_TIMEOUT            (1u)              /* counts in s */
 	#define CONN_COUNT                  (1u)             /* up to CY_BLE_CONN_COUNT */
+
+	/* Echo mode: 1 - send the stack's receive buffer back without copying it,
+	*             0 - copy every SDU to ipv6LoopbackBuffer and echo it later */
+	#ifndef ECHO_ZERO_COPY
+	#define ECHO_ZERO_COPY              (1u)
+	#endif
+	/* UDP port of the echo service, compresses to 4 bits */
+	#define ECHO_UDP_PORT               (0xF0B7u)
+	#define ECHO_HOP_LIMIT              (64u)
+	/* SDUs per connection that may wait for their echo to be sent. These are the
+	 * receive buffers of the channel: the Router gets no more credits than free
+	 * entries, so the queue does not overflow. The SDUs themselves are kept in
+	 * the buffer pool, which all connections share (buf_pool.h). */
+	#ifndef ECHO_QUEUE_DEPTH
+	#define ECHO_QUEUE_DEPTH            (4u)
+	#endif
+	/* Average echo cost in CPU cycles is reported every ECHO_REPORT_INTERVAL SDUs */
+	#define ECHO_REPORT_INTERVAL        (100u)
+	/* Entries of the command table of the debug UART */
+	#define NODE_COMMANDS               (2u)
     /***************************************
     *       Function Prototypes
     ***************************************/
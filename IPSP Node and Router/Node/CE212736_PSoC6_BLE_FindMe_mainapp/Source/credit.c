@@ -0,0 +1,252 @@
+/*******************************************************************************
+* File Name: credit.c
+*
+* Version: 1.00
+*
+* Description:
+*  This file contains the L2CAP credit controller of the IPSP channel. Every
+*  receive buffer holds one SDU, and an SDU of the local MTU takes one credit
+*  per K-frame of the local MPS. The peer never holds more credits than the
+*  free receive buffers take in such SDUs, so a free buffer always lets the
+*  peer send a full SDU and an SDU that arrives always has a buffer. Within
+*  that bound the peer only gets the credits the receiver drains in
+*  CREDIT_HORIZON_MS at the measured rate, an idle peer is not given credits
+*  it does not use. Credits are sent in batches of at least half the target
+*  to limit the credit PDUs.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <string.h>
+#include "credit.h"
+
+/******************************************************************************
+* Function Name: Credit_Open
+*******************************************************************************
+*
+* Summary:
+*  Resets the controller for a new channel and returns the credits to offer
+*  in the connection request or response. Until the first drain rate is
+*  measured the peer may fill all receive buffers with SDUs of the local MTU.
+*
+* Parameters:
+*  ctrl: the controller of the channel.
+*  rxBuffers: receive buffers of the channel, one SDU each.
+*
+* Return:
+*  Initial credits of the peer.
+*
+******************************************************************************/
+uint16_t Credit_Open(credit_ctrl_t *ctrl, uint32_t rxBuffers)
+{
+    uint32_t credits;
+
+    memset(ctrl, 0, sizeof(*ctrl));
+    ctrl->sduCredits = CREDIT_KFRAMES(CY_BLE_L2CAP_MTU, CY_BLE_L2CAP_MPS);
+    credits = rxBuffers * ctrl->sduCredits;
+    if(credits > UINT16_MAX)
+    {
+        credits = UINT16_MAX;
+    }
+    ctrl->drainRate = (credits * 1000u) / CREDIT_HORIZON_MS;
+    ctrl->rxCredits = credits;
+    ctrl->creditsGranted = credits;
+    return((uint16_t)credits);
+}
+
+/******************************************************************************
+* Function Name: Credit_Connected
+*******************************************************************************
+*
+* Summary:
+*  Stores the MPS and the initial credits of the peer once the channel is
+*  open.
+*
+******************************************************************************/
+void Credit_Connected(credit_ctrl_t *ctrl, uint16_t peerMps, uint16_t peerCredits)
+{
+    ctrl->txMps = peerMps;
+    ctrl->txCredits = peerCredits;
+    ctrl->creditsReceived = peerCredits;
+}
+
+/******************************************************************************
+* Function Name: Credit_OnRx
+*******************************************************************************
+*
+* Summary:
+*  Accounts the credits the peer spent on a received SDU.
+*
+******************************************************************************/
+void Credit_OnRx(credit_ctrl_t *ctrl, uint16_t length)
+{
+    uint32_t kframes = CREDIT_KFRAMES(length, CY_BLE_L2CAP_MPS);
+
+    ctrl->rxCredits = (ctrl->rxCredits > kframes) ? (ctrl->rxCredits - kframes) : 0u;
+    ctrl->rxKframes += kframes;
+}
+
+/******************************************************************************
+* Function Name: Credit_OnDrain
+*******************************************************************************
+*
+* Summary:
+*  Accounts an SDU that left its receive buffer, for the drain rate.
+*
+******************************************************************************/
+void Credit_OnDrain(credit_ctrl_t *ctrl, uint16_t length)
+{
+    ctrl->drained += CREDIT_KFRAMES(length, CY_BLE_L2CAP_MPS);
+}
+
+/******************************************************************************
+* Function Name: Credit_Grant
+*******************************************************************************
+*
+* Summary:
+*  Tops up the credits of the peer to the lower of the K-frames the free
+*  receive buffers take in SDUs of the local MTU and the drain rate target,
+*  which is never below one such SDU.
+*  Nothing is sent while the peer still holds more than half of the target
+*  and enough credits for such an SDU.
+*
+* Parameters:
+*  ctrl: the controller of the channel.
+*  localCid: local CID of the channel.
+*  freeBuffers: receive buffers not holding an SDU.
+*
+* Return:
+*  Result of Cy_BLE_L2CAP_CbfcSendFlowControlCredit(), CY_BLE_SUCCESS when
+*  no credits were due.
+*
+******************************************************************************/
+cy_en_ble_api_result_t Credit_Grant(credit_ctrl_t *ctrl, uint16_t localCid, uint32_t freeBuffers)
+{
+    cy_stc_ble_l2cap_cbfc_credit_info_t creditParam;
+    cy_en_ble_api_result_t result;
+    uint32_t target;
+    uint32_t grant;
+
+    target = (ctrl->drainRate * CREDIT_HORIZON_MS) / 1000u;
+    if(target < ctrl->sduCredits)
+    {
+        target = ctrl->sduCredits;
+    }
+    if(target > (freeBuffers * ctrl->sduCredits))
+    {
+        target = freeBuffers * ctrl->sduCredits;
+    }
+    if(target <= ctrl->rxCredits)
+    {
+        return(CY_BLE_SUCCESS);
+    }
+    grant = target - ctrl->rxCredits;
+    if((grant < ((target + 1u) / 2u)) && (ctrl->rxCredits >= ctrl->sduCredits))
+    {
+        return(CY_BLE_SUCCESS);
+    }
+
+    creditParam.credit = (uint16_t)grant;
+    creditParam.localCid = localCid;
+    result = Cy_BLE_L2CAP_CbfcSendFlowControlCredit(&creditParam);
+    if(result == CY_BLE_SUCCESS)
+    {
+        ctrl->rxCredits += grant;
+        ctrl->creditsGranted += grant;
+        ctrl->creditPdus++;
+    }
+    return(result);
+}
+
+/******************************************************************************
+* Function Name: Credit_Tick
+*******************************************************************************
+*
+* Summary:
+*  Updates the drain rate from the K-frames drained in the last second and
+*  samples the transmit stall. Called once per second.
+*
+******************************************************************************/
+void Credit_Tick(credit_ctrl_t *ctrl)
+{
+    ctrl->drainRate = (ctrl->drainRate + ctrl->drained + 1u) / 2u;
+    ctrl->drained = 0u;
+    if(ctrl->txStalled == true)
+    {
+        ctrl->txStallTicks++;
+    }
+}
+
+/******************************************************************************
+* Function Name: Credit_TxKframes
+*******************************************************************************
+*
+* Summary:
+*  Returns the credits an SDU of the given length takes from the peer.
+*
+******************************************************************************/
+uint32_t Credit_TxKframes(const credit_ctrl_t *ctrl, uint16_t length)
+{
+    return((ctrl->txMps != 0u) ? CREDIT_KFRAMES(length, ctrl->txMps) : UINT32_MAX);
+}
+
+/******************************************************************************
+* Function Name: Credit_TxAvailable
+*******************************************************************************
+*
+* Summary:
+*  Checks that the peer accepts all K-frames of an SDU before it is written.
+*  A write held back starts a stall, which ends with the next write.
+*
+* Return:
+*  true when the SDU may be written.
+*
+******************************************************************************/
+bool Credit_TxAvailable(credit_ctrl_t *ctrl, uint32_t kframes)
+{
+    if(ctrl->txCredits >= kframes)
+    {
+        return(true);
+    }
+    if(ctrl->txStalled == false)
+    {
+        ctrl->txStalled = true;
+        ctrl->txStalls++;
+    }
+    return(false);
+}
+
+/******************************************************************************
+* Function Name: Credit_TxSent
+*******************************************************************************
+*
+* Summary:
+*  Takes the credits of an SDU accepted by the stack.
+*
+******************************************************************************/
+void Credit_TxSent(credit_ctrl_t *ctrl, uint32_t kframes)
+{
+    ctrl->txCredits -= kframes;
+    ctrl->txKframes += kframes;
+    ctrl->txStalled = false;
+}
+
+/******************************************************************************
+* Function Name: Credit_TxAdd
+*******************************************************************************
+*
+* Summary:
+*  Adds the credits of a flow control credit PDU from the peer.
+*
+******************************************************************************/
+void Credit_TxAdd(credit_ctrl_t *ctrl, uint16_t credits)
+{
+    ctrl->txCredits += credits;
+    ctrl->creditsReceived += credits;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,79 @@
+/*******************************************************************************
+* File Name: credit.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the L2CAP credit
+*  controller of the IPSP channel. Receive credits are granted from the free
+*  receive buffers and the measured drain rate instead of a fixed batch, and
+*  the credits granted by the peer are tracked so that an SDU is only written
+*  when the peer can accept all of its K-frames.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef CREDIT_H
+
+    #define CREDIT_H
+
+    #include "cycfg_ble.h"
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    /* The peer is not given more credits than the receiver drains in this time
+     * at the measured rate. Lower values save buffers held for idle peers. */
+    #ifndef CREDIT_HORIZON_MS
+    #define CREDIT_HORIZON_MS           (1000u)
+    #endif
+    /* Credits needed for an SDU: the first K-frame also carries the SDU length */
+    #define CREDIT_KFRAMES(length, mps) ((((uint32_t)(length)) + 2u + (mps) - 1u) / (mps))
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    typedef struct
+    {
+        /* Receive side, credits granted to the peer */
+        uint32_t        rxCredits;      /* Credits the peer still holds */
+        uint32_t        sduCredits;     /* Credits of an SDU of the local MTU */
+        uint32_t        drained;        /* K-frames drained in the current tick */
+        uint32_t        drainRate;      /* Smoothed K-frames drained per second */
+
+        /* Transmit side, credits granted by the peer */
+        uint32_t        txCredits;      /* K-frames the peer still accepts */
+        uint16_t        txMps;          /* MPS of the peer */
+        bool            txStalled;      /* A write is held back for credits */
+
+        /* Statistics */
+        uint32_t        creditPdus;     /* Credit PDUs sent */
+        uint32_t        creditsGranted;
+        uint32_t        creditsReceived;
+        uint32_t        rxKframes;
+        uint32_t        txKframes;
+        uint32_t        txStalls;       /* Writes held back for credits */
+        uint32_t        txStallTicks;   /* Timer ticks that found a write held back */
+    } credit_ctrl_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    uint16_t Credit_Open(credit_ctrl_t *ctrl, uint32_t rxBuffers);
+    void Credit_Connected(credit_ctrl_t *ctrl, uint16_t peerMps, uint16_t peerCredits);
+    void Credit_OnRx(credit_ctrl_t *ctrl, uint16_t length);
+    void Credit_OnDrain(credit_ctrl_t *ctrl, uint16_t length);
+    cy_en_ble_api_result_t Credit_Grant(credit_ctrl_t *ctrl, uint16_t localCid, uint32_t freeBuffers);
+    void Credit_Tick(credit_ctrl_t *ctrl);
+    uint32_t Credit_TxKframes(const credit_ctrl_t *ctrl, uint16_t length);
+    bool Credit_TxAvailable(credit_ctrl_t *ctrl, uint32_t kframes);
+    void Credit_TxSent(credit_ctrl_t *ctrl, uint32_t kframes);
+    void Credit_TxAdd(credit_ctrl_t *ctrl, uint16_t credits);
+
+#endif /* CREDIT_H */
+
+/* [] END OF FILE */
@@ -24,11 +24,24 @@
 cy_en_ble_api_result_t apiResult;
 uint16_t                            connIntv;   /* in milliseconds / 1.25ms */
 bool                                l2capConnected[CY_BLE_CONN_COUNT] = {false};
-bool                                l2capReadReceived[CY_BLE_CONN_COUNT] = {false};
-uint8_t                             ipv6LoopbackBuffer[CY_BLE_CONN_COUNT][L2CAP_MAX_LEN];
-uint16_t                            ipv6LoopbackLength[CY_BLE_CONN_COUNT];
+credit_ctrl_t                       echoCredit[CY_BLE_CONN_COUNT];      /* Credits of the IPSP channel */
+
+/* Per-connection FIFO of SDUs waiting for their echo, held in buffer pool blocks */
+buf_block_t                         ipv6LoopbackBuffer[CY_BLE_CONN_COUNT][ECHO_QUEUE_DEPTH];
+uint16_t                            ipv6LoopbackLength[CY_BLE_CONN_COUNT][ECHO_QUEUE_DEPTH];
+uint32_t                            echoCycles[CY_BLE_CONN_COUNT][ECHO_QUEUE_DEPTH]; /* Cycles spent on the copied SDU */
+uint8_t                             echoQueueHead[CY_BLE_CONN_COUNT];
+uint8_t                             echoQueueCount[CY_BLE_CONN_COUNT];
+uint8_t                             echoQueueMax[CY_BLE_CONN_COUNT];    /* Highest queue fill seen */
+uint32_t                            echoDropped[CY_BLE_CONN_COUNT];     /* SDUs dropped, queue or pool full */
+uint32_t                            echoInvalid[CY_BLE_CONN_COUNT];     /* SDUs that are not echo requests */
+iphc_link_t                         ipLink[CY_BLE_CONN_COUNT];          /* Interface identifiers for IPHC */
+uint32_t                            echoPackets = 0u;
+uint32_t                            echoCopied = 0u;                 /* Echoes that needed the copy path */
+uint64_t                            echoCyclesTotal = 0u;
 volatile uint32_t                   mainTimer = 1u;
 cy_stc_ble_timer_info_t             timerParam = { .timeout = ADV_TIMER_TIMEOUT };
+static const command_t              nodeCommand[NODE_COMMANDS];     /* Defined with the handlers */
 
 /* L2CAP Channel ID and parameters for the peer device */
 cy_stc_ble_l2cap_cbfc_conn_ind_param_t   l2capParameters[CY_BLE_CONN_COUNT];
@@ -63,8 +76,414 @@ const cy_stc_sysint_t MCWDT_isr_cfg =
 *        Function prototypes
 *******************************************************************************/
 void StackEventHandler(uint32 event, void* eventParam);
+static void L2capDataReadHandler(uint32 event, void* eventParam);
+static void L2capRxCreditHandler(uint32 event, void* eventParam);
+static void L2capTxCreditHandler(uint32 event, void* eventParam);
+static void L2capDataWriteHandler(uint32 event, void* eventParam);
 void EnterLowPowerMode(void);
 
+/*******************************************************************************
+* Function Name: EchoReport
+********************************************************************************
+*
+* Summary:
+*   Prints the average cost per echoed SDU and the queue and credit counters
+*   of a connection.
+*
+* Parameters:
+*  conn: index of the L2CAP connection.
+*
+*******************************************************************************/
+void EchoReport(uint8_t conn)
+{
+    (void)conn;
+    DEBUG_PRINTF("Echo: %lu SDUs, %lu cycles/SDU, %lu copied (%s), conn %d: dropped=%lu, invalid=%lu, max depth=%d\r\n",
+        (unsigned long)echoPackets, (unsigned long)(echoCyclesTotal / ((echoPackets != 0u) ? echoPackets : 1u)),
+        (unsigned long)echoCopied, (ECHO_ZERO_COPY != 0u) ? "zero-copy" : "copy",
+        conn, (unsigned long)echoDropped[conn], (unsigned long)echoInvalid[conn], echoQueueMax[conn]);
+    DEBUG_PRINTF("Credits: granted=%lu in %lu PDUs for %lu K-frames, received=%lu, tx stalls=%lu, stalled %lu s\r\n",
+        (unsigned long)echoCredit[conn].creditsGranted, (unsigned long)echoCredit[conn].creditPdus,
+        (unsigned long)echoCredit[conn].rxKframes, (unsigned long)echoCredit[conn].creditsReceived,
+        (unsigned long)echoCredit[conn].txStalls, (unsigned long)echoCredit[conn].txStallTicks);
+    DEBUG_PRINTF("Pool: %lu of %u blocks of %u bytes used, high water=%lu, alloc failures=%lu\r\n",
+        (unsigned long)BufPool_Stats()->used, (unsigned)BUF_POOL_BLOCKS, (unsigned)BUF_POOL_BLOCK_SIZE,
+        (unsigned long)BufPool_Stats()->highWater, (unsigned long)BufPool_Stats()->failures);
+}
+
+/*******************************************************************************
+* Function Name: EchoAccount
+********************************************************************************
+*
+* Summary:
+*   Adds the CPU cycles spent on one echoed SDU to the statistics and
+*   periodically prints the average cost per SDU and the queue counters.
+*
+* Parameters:
+*  conn: index of the L2CAP connection the SDU was echoed on.
+*  cycles: CPU cycles spent on the SDU from reception until it was queued
+*          for transmission.
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void EchoAccount(uint8_t conn, uint32_t cycles)
+{
+    echoPackets++;
+    echoCyclesTotal += cycles;
+    if((echoPackets % ECHO_REPORT_INTERVAL) == 0u)
+    {
+        EchoReport(conn);
+        DEBUG_PRINT_LOG_STATS();
+    }
+}
+
+/*******************************************************************************
+* Function Name: EchoSend
+********************************************************************************
+*
+* Summary:
+*   Sends one SDU back to the Router if the stack is free and the Router has
+*   granted enough credits for all K-frames of the SDU.
+*
+* Parameters:
+*  conn: index of the L2CAP connection.
+*  data: SDU to send.
+*  length: length of the SDU.
+*
+* Return:
+*   CY_BLE_SUCCESS when the SDU was accepted by the stack.
+*
+*******************************************************************************/
+cy_en_ble_api_result_t EchoSend(uint8_t conn, uint8_t *data, uint16_t length)
+{
+    cy_en_ble_api_result_t result;
+    uint32_t kframes = Credit_TxKframes(&echoCredit[conn], length);
+    cy_stc_ble_l2cap_cbfc_tx_data_info_t l2capDataParam =
+    {
+        .buffer = data,
+        .bufferLength = length,
+        .localCid = l2capParameters[conn].lCid,
+    };
+
+    if(cy_ble_busyStatus[conn] != 0u)
+    {
+        return(CY_BLE_ERROR_INVALID_OPERATION);
+    }
+    if(Credit_TxAvailable(&echoCredit[conn], kframes) == false)
+    {
+        return(CY_BLE_ERROR_INSUFFICIENT_RESOURCES);
+    }
+
+    result = Cy_BLE_L2CAP_ChannelDataWrite(&l2capDataParam);
+    if(result == CY_BLE_SUCCESS)
+    {
+        Credit_TxSent(&echoCredit[conn], kframes);
+    }
+    return(result);
+}
+
+/*******************************************************************************
+* Function Name: EchoReplyHeader
+********************************************************************************
+*
+* Summary:
+*   Checks that a received SDU is a UDP datagram for the echo service of this
+*   Node and compresses the header of the reply: addresses and ports are
+*   swapped, which leaves the UDP checksum unchanged. Datagrams for another
+*   port, sent to a multicast address, or with a wrong checksum are dropped.
+*
+* Parameters:
+*  conn: index of the L2CAP connection.
+*  data: received SDU.
+*  length: length of the SDU.
+*  reply: receives the compressed reply header, IPHC_MAX_HEADER_LEN bytes.
+*  offset: receives the length of the compressed header of the request,
+*          the UDP payload starts there.
+*
+* Return:
+*   Length of the reply header, zero when the SDU is dropped.
+*
+*******************************************************************************/
+uint16_t EchoReplyHeader(uint8_t conn, const uint8_t *data, uint16_t length, uint8_t reply[], uint16_t *offset)
+{
+    iphc_header_t hdr;
+    uint8_t addr[IPV6_ADDR_LEN];
+    uint16_t port;
+
+    if((Iphc_Decompress(data, length, &ipLink[conn], &hdr, offset) != IPHC_OK) ||
+       (hdr.nextHeader != IPV6_NEXT_HEADER_UDP) || (hdr.dstPort != ECHO_UDP_PORT) || (hdr.dst[0u] == 0xFFu) ||
+       (Iphc_UdpChecksum(&hdr, &data[*offset]) != hdr.checksum))
+    {
+        echoInvalid[conn]++;
+        return(0u);
+    }
+
+    memcpy(addr, hdr.src, IPV6_ADDR_LEN);
+    memcpy(hdr.src, hdr.dst, IPV6_ADDR_LEN);
+    memcpy(hdr.dst, addr, IPV6_ADDR_LEN);
+    port = hdr.srcPort;
+    hdr.srcPort = hdr.dstPort;
+    hdr.dstPort = port;
+    hdr.hopLimit = ECHO_HOP_LIMIT;
+    return(Iphc_Compress(&hdr, &ipLink[conn], reply));
+}
+
+/*******************************************************************************
+* Function Name: EchoQueuePush
+********************************************************************************
+*
+* Summary:
+*   Copies an echo reply, its compressed header followed by the payload of
+*   the request, to a buffer pool chain at the tail of the connection's echo
+*   queue. The reply is dropped and counted when the queue is full or the
+*   pool is out of blocks.
+*
+* Parameters:
+*  conn: index of the L2CAP connection.
+*  header: compressed header of the reply.
+*  headerLength: length of the header.
+*  data: UDP payload of the received SDU.
+*  length: length of the payload.
+*  startCycles: cycle counter value when the SDU was received.
+*
+* Return:
+*   true when the reply was queued.
+*
+*******************************************************************************/
+bool EchoQueuePush(uint8_t conn, const uint8_t *header, uint16_t headerLength, const uint8_t *data, uint16_t length,
+                   uint32_t startCycles)
+{
+    uint8_t tail;
+    buf_block_t block;
+    uint8_t *sdu;
+
+    if(echoQueueCount[conn] >= ECHO_QUEUE_DEPTH)
+    {
+        echoDropped[conn]++;
+        DEBUG_PRINTF("Echo queue %d full, SDU dropped (%lu) \r\n", conn, (unsigned long)echoDropped[conn]);
+        return(false);
+    }
+    if((headerLength + length) > L2CAP_MAX_LEN)
+    {
+        length = (uint16_t)(L2CAP_MAX_LEN - headerLength);
+    }
+
+    block = BufPool_Alloc((uint32_t)headerLength + length);
+    if(block == BUF_POOL_NONE)
+    {
+        echoDropped[conn]++;
+        DEBUG_PRINTF("Buffer pool empty, SDU dropped (%lu) \r\n", (unsigned long)echoDropped[conn]);
+        return(false);
+    }
+
+    tail = (uint8_t)((echoQueueHead[conn] + echoQueueCount[conn]) % ECHO_QUEUE_DEPTH);
+    sdu = BufPool_Data(block);
+    memcpy(sdu, header, headerLength);
+    memcpy(&sdu[headerLength], data, length);
+    ipv6LoopbackBuffer[conn][tail] = block;
+    ipv6LoopbackLength[conn][tail] = (uint16_t)(headerLength + length);
+    echoCycles[conn][tail] = CYCLES_GET() - startCycles;
+    echoQueueCount[conn]++;
+    if(echoQueueCount[conn] > echoQueueMax[conn])
+    {
+        echoQueueMax[conn] = echoQueueCount[conn];
+    }
+    return(true);
+}
+
+/*******************************************************************************
+* Function Name: EchoQueueDrain
+********************************************************************************
+*
+* Summary:
+*   Sends queued SDUs back to the Router in order until the queue is empty,
+*   the stack is busy or the TX credits are used up. Each SDU is sent from
+*   its pool block; the stack copies it, so the block is freed as soon as it
+*   is accepted.
+*
+* Parameters:
+*  conn: index of the L2CAP connection.
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void EchoQueueDrain(uint8_t conn)
+{
+    while(echoQueueCount[conn] != 0u)
+    {
+        uint8_t  head = echoQueueHead[conn];
+        uint16_t length = ipv6LoopbackLength[conn][head];
+        uint32_t startCycles = CYCLES_GET();
+
+        apiResult = EchoSend(conn, BufPool_Data(ipv6LoopbackBuffer[conn][head]), length);
+        if(apiResult != CY_BLE_SUCCESS)
+        {
+            /* Retried on the next pass or when credits arrive */
+            break;
+        }
+        BufPool_Free(ipv6LoopbackBuffer[conn][head]);
+        echoQueueHead[conn] = (uint8_t)((head + 1u) % ECHO_QUEUE_DEPTH);
+        echoQueueCount[conn]--;
+        Credit_OnDrain(&echoCredit[conn], ipv6LoopbackLength[conn][head]);
+        echoCopied++;
+        EchoAccount(conn, echoCycles[conn][head] + (CYCLES_GET() - startCycles));
+        DEBUG_PRINTF("-> Cy_BLE_L2CAP_ChannelDataWrite API result: %d \r\n", apiResult);
+    }
+}
+
+/*******************************************************************************
+* Function Name: EchoQueueReset
+********************************************************************************
+*
+* Summary:
+*   Discards the pending echoes of a connection and frees their blocks.
+*
+* Parameters:
+*  conn: index of the L2CAP connection.
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void EchoQueueReset(uint8_t conn)
+{
+    for(; echoQueueCount[conn] != 0u; echoQueueCount[conn]--)
+    {
+        BufPool_Free(ipv6LoopbackBuffer[conn][echoQueueHead[conn]]);
+        echoQueueHead[conn] = (uint8_t)((echoQueueHead[conn] + 1u) % ECHO_QUEUE_DEPTH);
+    }
+    echoQueueHead[conn] = 0u;
+    echoQueueCount[conn] = 0u;
+}
+
+/*******************************************************************************
+* Function Name: EchoRequest
+********************************************************************************
+*
+* Summary:
+*   Answers an SDU received from the Router. With ECHO_ZERO_COPY the reply is
+*   sent from the stack's receive buffer when it can go out right away,
+*   otherwise it is copied to the echo queue.
+*
+* Parameters:
+*  conn: index of the L2CAP connection.
+*  rxDataParam: the received SDU.
+*  startCycles: cycle counter value when the SDU was received.
+*
+* Return:
+*   true when the reply waits in the echo queue.
+*
+*******************************************************************************/
+bool EchoRequest(uint8_t conn, cy_stc_ble_l2cap_cbfc_rx_param_t *rxDataParam, uint32_t startCycles)
+{
+    uint8_t  replyHeader[IPHC_MAX_HEADER_LEN];
+    uint16_t replyLength;
+    uint16_t offset;
+
+    replyLength = EchoReplyHeader(conn, rxDataParam->rxData, rxDataParam->rxDataLength, replyHeader, &offset);
+    if(replyLength == 0u)
+    {
+        DEBUG_PRINTF("Not an echo request, SDU dropped (%lu) \r\n", (unsigned long)echoInvalid[conn]);
+        return(false);
+    }
+#if(ECHO_ZERO_COPY)
+    /* Echo straight from the stack's receive buffer. The stack copies
+     * the SDU into its TX buffers, so rxData may be passed as is while
+     * this event is being handled. The reply header is written over the
+     * request header when both compress to the same length. The SDU is
+     * only copied to the echo queue when the stack is busy, credits are
+     * short or older echoes are still pending.
+     */
+    if((echoQueueCount[conn] == 0u) && (replyLength == offset) &&
+       (rxDataParam->rxDataLength <= L2CAP_MAX_LEN))
+    {
+        memcpy(rxDataParam->rxData, replyHeader, replyLength);
+        if(EchoSend(conn, rxDataParam->rxData, rxDataParam->rxDataLength) == CY_BLE_SUCCESS)
+        {
+            EchoAccount(conn, CYCLES_GET() - startCycles);
+            return(false);
+        }
+    }
+#endif /* ECHO_ZERO_COPY */
+    /* Data is received from Router. Copy the reply to the echo queue */
+    return(EchoQueuePush(conn, replyHeader, replyLength, &rxDataParam->rxData[offset],
+                         (uint16_t)(rxDataParam->rxDataLength - offset), startCycles));
+}
+
+/*******************************************************************************
+* Function Name: EchoFreeBuffers
+********************************************************************************
+*
+* Summary:
+*   Returns the SDUs a connection may still receive: the free entries of its
+*   echo queue, but no more than the free blocks of the buffer pool and its
+*   share of the pool. The credits the Router holds on another connection may
+*   bring SDUs at any time, so a block is kept for each SDU of the MTU they
+*   cover. The share keeps one connection from holding all blocks while
+*   another waits.
+*
+* Parameters:
+*  conn: index of the L2CAP connection.
+*
+* Return:
+*   Free receive buffers of the connection, one SDU each.
+*
+*******************************************************************************/
+uint32_t EchoFreeBuffers(uint8_t conn)
+{
+    uint32_t queueFree = (uint32_t)ECHO_QUEUE_DEPTH - echoQueueCount[conn];
+    uint32_t poolSdus = BufPool_FreeBlocks();
+    uint32_t reserved = 0u;
+    uint32_t links = 1u;
+    uint32_t share;
+    uint8_t i;
+
+    for(i = 0u; i < CY_BLE_CONN_COUNT; i++)
+    {
+        if((i != conn) && (l2capConnected[i] == true))
+        {
+            reserved += (echoCredit[i].rxCredits + echoCredit[i].sduCredits - 1u) / echoCredit[i].sduCredits;
+            links++;
+        }
+    }
+    poolSdus = (poolSdus > reserved) ? (poolSdus - reserved) : 0u;
+
+    /* Blocks this connection holds already count against its share */
+    share = (BUF_POOL_BLOCKS + links - 1u) / links;
+    share = (share > echoQueueCount[conn]) ? (share - echoQueueCount[conn]) : 0u;
+    if(poolSdus > share)
+    {
+        poolSdus = share;
+    }
+    return((queueFree < poolSdus) ? queueFree : poolSdus);
+}
+
+/*******************************************************************************
+* Function Name: EchoGrantCredits
+********************************************************************************
+*
+* Summary:
+*   Tops up the credits of the Router from the free receive buffers of the
+*   connection.
+*
+* Parameters:
+*  conn: index of the L2CAP connection.
+*
+* Return:
+*   None
+*
+*******************************************************************************/
+void EchoGrantCredits(uint8_t conn)
+{
+    apiResult = Credit_Grant(&echoCredit[conn], l2capParameters[conn].lCid, EchoFreeBuffers(conn));
+    if(apiResult != CY_BLE_SUCCESS)
+    {
+        DEBUG_PRINTF("Cy_BLE_L2CAP_CbfcSendFlowControlCredit API Error: 0x%x \r\n", apiResult);
+    }
+}
+
 /*******************************************************************************
 * Function Name: BlessInterrupt
 *******************************************************************************/
@@ -106,12 +525,24 @@ void HostInit(void)
     UART_DEBUG_START();
     DEBUG_PRINTF("\r\n\nPSoC 6 MCU with BLE IPSP Node \r\n");
 
+    /* Start the cycle counter used for the echo statistics */
+    CYCLES_INIT();
+
+    /* The echo queues of all connections share the buffer pool */
+    BufPool_Init();
+
     /* Initialize the BLESS interrupt */
     cy_ble_config.hw->blessIsrConfig = &blessIsrCfg;
     Cy_SysInt_Init(cy_ble_config.hw->blessIsrConfig, BlessInterrupt);
 
-    /* Register the generic event handler */
-    Cy_BLE_RegisterEventCallback(StackEventHandler);
+    /* Register the event handlers: the per-SDU L2CAP events have their own,
+     * the rest go to the generic event handler */
+    BleDispatch_Init(StackEventHandler);
+    (void)BleDispatch_Register(CY_BLE_EVT_L2CAP_CBFC_DATA_READ, L2capDataReadHandler);
+    (void)BleDispatch_Register(CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND, L2capRxCreditHandler);
+    (void)BleDispatch_Register(CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND, L2capTxCreditHandler);
+    (void)BleDispatch_Register(CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND, L2capDataWriteHandler);
+    Cy_BLE_RegisterEventCallback(BleDispatch_Event);
 
     /* Initialize the BLE host */
     apiResult = Cy_BLE_Init(&cy_ble_config);
@@ -160,6 +591,54 @@ void HostInit(void)
 
 }
 
+/*******************************************************************************
+* Function Name: CmdHelp
+********************************************************************************
+*
+* Summary:
+*   'help': lists the commands.
+*
+*******************************************************************************/
+static void CmdHelp(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    Command_Help(nodeCommand, NODE_COMMANDS);
+}
+
+/*******************************************************************************
+* Function Name: CmdStats
+********************************************************************************
+*
+* Summary:
+*   'stats': prints the echo counters of the connected channels, the BLE
+*   event and the log statistics.
+*
+*******************************************************************************/
+static void CmdStats(uint32_t argc, char *argv[])
+{
+    uint8_t l2capIndex;
+
+    (void)argc;
+    (void)argv;
+    for(l2capIndex = 0u; l2capIndex < CY_BLE_CONN_COUNT; l2capIndex++)
+    {
+        if(l2capConnected[l2capIndex] == true)
+        {
+            EchoReport(l2capIndex);
+        }
+    }
+    BleDispatch_PrintStats();
+    DEBUG_PRINT_LOG_STATS();
+}
+
+/* Commands of the debug UART, one per line */
+static const command_t nodeCommand[NODE_COMMANDS] =
+{
+    { "help",       "",     "Help menu.",                               CmdHelp },
+    { "stats",      "",     "Print the echo, BLE event and log statistics.", CmdStats },
+};
+
 /*******************************************************************************
 * Function Name: BleIPSPNode_Process()
 ********************************************************************************
@@ -181,8 +660,17 @@ void BleIPSPNode_Process(void)
     /* Restart timer */
     if(mainTimer != 0u)
     {
+        uint8_t l2capIndex;
+
         mainTimer = 0u;
         Cy_BLE_StartTimer(&timerParam);
+        for(l2capIndex = 0u; l2capIndex < CY_BLE_CONN_COUNT; l2capIndex++)
+        {
+            if(l2capConnected[l2capIndex] == true)
+            {
+                Credit_Tick(&echoCredit[l2capIndex]);
+            }
+        }
     }
 
     /* Cy_Ble_ProcessEvents() allows BLE stack to process pending events */
@@ -194,32 +682,22 @@ void BleIPSPNode_Process(void)
 
     if(Cy_BLE_GetNumOfActiveConn() > 0u)
     {
-        static uint8_t l2capIndex = 0u;
-
-        l2capIndex++;
-        if(l2capIndex >= CY_BLE_CONN_COUNT)
-        {
-            l2capIndex = 0u;
-        }
+        uint8_t l2capIndex;
 
-        /* Keep sending the data to the router, until TX credits are over */
-        if((cy_ble_busyStatus[l2capIndex] == 0u) && (l2capConnected[l2capIndex] == true) &&
-           (l2capReadReceived[l2capIndex] == true))
+        /* Keep sending the queued data to the router, until TX credits are over,
+         * and give the Router credits for the queue entries that are free */
+        for(l2capIndex = 0u; l2capIndex < CY_BLE_CONN_COUNT; l2capIndex++)
         {
-            cy_stc_ble_l2cap_cbfc_tx_data_info_t l2capDataParam =
+            if(l2capConnected[l2capIndex] == true)
             {
-                .buffer = ipv6LoopbackBuffer[l2capIndex],
-                .bufferLength = ipv6LoopbackLength[l2capIndex],
-                .localCid = l2capParameters[l2capIndex].lCid,
-            };
-
-            l2capReadReceived[l2capIndex] = false;
-
-            apiResult = Cy_BLE_L2CAP_ChannelDataWrite(&l2capDataParam);
-            DEBUG_PRINTF("-> Cy_BLE_L2CAP_ChannelDataWrite API result: %d \r\n", apiResult);
+                EchoQueueDrain(l2capIndex);
+                EchoGrantCredits(l2capIndex);
+            }
         }
     }
 
+    /* A command line from the debug UART, nothing waits for one */
+    (void)Command_Process(nodeCommand, NODE_COMMANDS);
 }
 
 /*******************************************************************************
@@ -411,6 +889,17 @@ void StackEventHandler(uint32 event, void* eventParam)
         case CY_BLE_EVT_GAP_DEVICE_CONNECTED:
             connIntv = ((cy_stc_ble_gap_connected_param_t *)eventParam)->connIntv * 5u /4u;
             DEBUG_PRINTF("CY_BLE_EVT_GAP_DEVICE_CONNECTED: connIntv = %d ms \r\n", connIntv);
+            {
+                uint8_t attId = Cy_BLE_GetConnHandleByBdHandle(
+                    (*(cy_stc_ble_gap_connected_param_t *)eventParam).bdHandle).attId;
+
+                /* Link-local addresses on the IPSP channel are derived from the BD addresses */
+                if(attId < CY_BLE_CONN_COUNT)
+                {
+                    Iphc_LinkInit(&ipLink[attId], cy_ble_deviceAddress.bdAddr,
+                                  ((cy_stc_ble_gap_connected_param_t *)eventParam)->peerAddr);
+                }
+            }
             keyInfo.SecKeyParam.bdHandle = (*(cy_stc_ble_gap_connected_param_t *)eventParam).bdHandle;
             apiResult = Cy_BLE_GAP_SetSecurityKeys(&keyInfo);
             if(apiResult != CY_BLE_SUCCESS)
@@ -435,6 +924,7 @@ void StackEventHandler(uint32 event, void* eventParam)
                 (*(cy_stc_ble_gap_disconnect_param_t *)eventParam).bdHandle,
                 (*(cy_stc_ble_gap_disconnect_param_t *)eventParam).reason,
                 (*(cy_stc_ble_gap_disconnect_param_t *)eventParam).status);
+            BleDispatch_PrintStats();
 
             if(Cy_BLE_GetNumOfActiveConn() == (CONN_COUNT - 1u))
             {
@@ -491,11 +981,12 @@ void StackEventHandler(uint32 event, void* eventParam)
                 (*(cy_stc_ble_l2cap_cbfc_conn_ind_param_t *)eventParam).connParam.credit);
             if((*(cy_stc_ble_l2cap_cbfc_conn_ind_param_t *)eventParam).psm == CY_BLE_L2CAP_PSM_LE_PSM_IPSP)
             {
+                uint8_t conn = Cy_BLE_GetConnHandleByBdHandle((*(cy_stc_ble_l2cap_cbfc_conn_ind_param_t *)eventParam).bdHandle).attId;
                 cy_stc_ble_l2cap_cbfc_connection_info_t connParam =
                 {
                    .mtu    = CY_BLE_L2CAP_MTU,
                    .mps    = CY_BLE_L2CAP_MPS,
-                   .credit = LE_DATA_CREDITS_IPSP
+                   .credit = Credit_Open(&echoCredit[conn], EchoFreeBuffers(conn))
                 };
 
                 cy_stc_ble_l2cap_cbfc_conn_resp_info_t l2capCbfcParam =
@@ -507,7 +998,10 @@ void StackEventHandler(uint32 event, void* eventParam)
 
                 apiResult = Cy_BLE_L2CAP_CbfcConnectRsp(&l2capCbfcParam);
                 DEBUG_PRINTF("SUCCESSFUL \r\n");
-                l2capConnected[Cy_BLE_GetConnHandleByBdHandle((*(cy_stc_ble_l2cap_cbfc_conn_ind_param_t *)eventParam).bdHandle).attId] = true;
+                l2capConnected[conn] = true;
+                Credit_Connected(&echoCredit[conn], (*(cy_stc_ble_l2cap_cbfc_conn_ind_param_t *)eventParam).connParam.mps,
+                                 (*(cy_stc_ble_l2cap_cbfc_conn_ind_param_t *)eventParam).connParam.credit);
+                EchoQueueReset(conn);
             }
             else
             {
@@ -535,6 +1029,7 @@ void StackEventHandler(uint32 event, void* eventParam)
                     if(l2capParameters[i].lCid == *(uint16_t *)eventParam)
                     {
                         l2capConnected[i] = false;
+                        EchoQueueReset(i);
                         break;
                     }
                 }
@@ -542,88 +1037,6 @@ void StackEventHandler(uint32 event, void* eventParam)
             }
 
 
-        /* Following two events are required to receive data */
-        case CY_BLE_EVT_L2CAP_CBFC_DATA_READ:
-            {
-                cy_stc_ble_l2cap_cbfc_rx_param_t *rxDataParam = (cy_stc_ble_l2cap_cbfc_rx_param_t *)eventParam;
-                uint8_t i;
-                DEBUG_PRINTF("<- EVT_L2CAP_CBFC_DATA_READ: lCid=%d, result=%d, len=%d",
-                    rxDataParam->lCid,
-                    rxDataParam->result,
-                    rxDataParam->rxDataLength);
-            #if(DEBUG_UART_FULL)
-                DEBUG_PRINTF(", data:");
-                for(i = 0; i < rxDataParam->rxDataLength; i++)
-                {
-                    DEBUG_PRINTF("%2.2x", rxDataParam->rxData[i]);
-                }
-            #endif /* DEBUG_UART_FULL */
-                DEBUG_PRINTF("\r\n");
-                for(i = 0u; i < CY_BLE_CONN_COUNT; i++)
-                {
-                    if(l2capParameters[i].lCid == rxDataParam->lCid)
-                    {
-                        /* Data is received from Router. Copy the data to a memory buffer */
-                        if(rxDataParam->rxDataLength <= L2CAP_MAX_LEN)
-                        {
-                            ipv6LoopbackLength[i] = rxDataParam->rxDataLength;
-                        }
-                        else
-                        {
-                            ipv6LoopbackLength[i] = L2CAP_MAX_LEN;
-                        }
-                        memcpy(ipv6LoopbackBuffer[i], rxDataParam->rxData, ipv6LoopbackLength[i]);
-                        l2capReadReceived[i] = true;
-                        break;
-                    }
-                }
-                break;
-            }
-
-
-        case CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND:
-            {
-                cy_stc_ble_l2cap_cbfc_low_rx_credit_param_t *rxCreditParam = (cy_stc_ble_l2cap_cbfc_low_rx_credit_param_t *)eventParam;
-                cy_stc_ble_l2cap_cbfc_credit_info_t l2capCbfcCreditParam =
-                {
-                    .credit   = LE_DATA_CREDITS_IPSP,
-                    .localCid = rxCreditParam->lCid
-                };
-
-                DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND: lCid=%d, credit=%d \r\n",
-                    rxCreditParam->lCid,
-                    rxCreditParam->credit);
-
-                /* This event informs that receive credits reached the low mark.
-                 * If the device expects more data to receive, send more credits back to the peer device.
-                 */
-                apiResult = Cy_BLE_L2CAP_CbfcSendFlowControlCredit(&l2capCbfcCreditParam);
-                if(apiResult != CY_BLE_SUCCESS)
-                {
-                    DEBUG_PRINTF("Cy_BLE_L2CAP_CbfcSendFlowControlCredit API Error: 0x%x \r\n", apiResult);
-                }
-                break;
-            }
-
-        /* Following events are required to send data */
-        case CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND:
-            DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND: lCid=%d, result=%d, credit=%d \r\n",
-                ((cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t *)eventParam)->lCid,
-                ((cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t *)eventParam)->result,
-                ((cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t *)eventParam)->credit);
-            break;
-
-        case CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND:
-            #if(DEBUG_UART_FULL)
-            {
-                cy_ble_l2cap_cbfc_data_write_param_t *writeDataParam = (cy_ble_l2cap_cbfc_data_write_param_t*)eventParam;
-                DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND: lCid=%d, result=%d \r\n",
-                    writeDataParam->lCid,
-                    writeDataParam->result);
-            }
-            #endif /* DEBUG_UART_FULL */
-            break;
-
         /**********************************************************
         *                       Other Events
         ***********************************************************/
@@ -642,6 +1055,128 @@ void StackEventHandler(uint32 event, void* eventParam)
 }
 
 
+/*******************************************************************************
+* Function Name: L2capDataReadHandler()
+********************************************************************************
+*
+* Summary:
+*   Handles CY_BLE_EVT_L2CAP_CBFC_DATA_READ: echoes the SDU from the Router.
+*
+*******************************************************************************/
+static void L2capDataReadHandler(uint32 event, void* eventParam)
+{
+    cy_stc_ble_l2cap_cbfc_rx_param_t *rxDataParam = (cy_stc_ble_l2cap_cbfc_rx_param_t *)eventParam;
+    uint32_t startCycles;
+    uint8_t i;
+
+    (void)event;
+    DEBUG_PRINTF("<- EVT_L2CAP_CBFC_DATA_READ: lCid=%d, result=%d, len=%d",
+        rxDataParam->lCid,
+        rxDataParam->result,
+        rxDataParam->rxDataLength);
+#if(DEBUG_UART_FULL)
+    DEBUG_PRINTF(", data:");
+    DEBUG_PRINT_DATA(rxDataParam->rxData, rxDataParam->rxDataLength);
+#endif /* DEBUG_UART_FULL */
+    DEBUG_PRINTF("\r\n");
+    startCycles = CYCLES_GET();
+    for(i = 0u; i < CY_BLE_CONN_COUNT; i++)
+    {
+        if(l2capParameters[i].lCid == rxDataParam->lCid)
+        {
+            Credit_OnRx(&echoCredit[i], rxDataParam->rxDataLength);
+            if(EchoRequest(i, rxDataParam, startCycles) == false)
+            {
+                /* Echoed or dropped, the SDU does not hold a receive buffer */
+                Credit_OnDrain(&echoCredit[i], rxDataParam->rxDataLength);
+            }
+            break;
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: L2capRxCreditHandler()
+********************************************************************************
+*
+* Summary:
+*   Handles CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND: receive credits reached the
+*   low mark.
+*
+*******************************************************************************/
+static void L2capRxCreditHandler(uint32 event, void* eventParam)
+{
+    cy_stc_ble_l2cap_cbfc_low_rx_credit_param_t *rxCreditParam = (cy_stc_ble_l2cap_cbfc_low_rx_credit_param_t *)eventParam;
+    uint8_t i;
+
+    (void)event;
+    DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND: lCid=%d, credit=%d \r\n",
+        rxCreditParam->lCid,
+        rxCreditParam->credit);
+
+    /* The credit controller normally tops them up before, let it decide */
+    for(i = 0u; i < CY_BLE_CONN_COUNT; i++)
+    {
+        if(l2capParameters[i].lCid == rxCreditParam->lCid)
+        {
+            EchoGrantCredits(i);
+            break;
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: L2capTxCreditHandler()
+********************************************************************************
+*
+* Summary:
+*   Handles CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND: the Router granted credits.
+*
+*******************************************************************************/
+static void L2capTxCreditHandler(uint32 event, void* eventParam)
+{
+    cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t *txCreditParam =
+        (cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t *)eventParam;
+    uint8_t i;
+
+    (void)event;
+    for(i = 0u; i < CY_BLE_CONN_COUNT; i++)
+    {
+        if(l2capParameters[i].lCid == txCreditParam->lCid)
+        {
+            /* Queued echoes are sent on the next pass */
+            Credit_TxAdd(&echoCredit[i], txCreditParam->credit);
+            break;
+        }
+    }
+    DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND: lCid=%d, result=%d, credit=%d \r\n",
+        txCreditParam->lCid,
+        txCreditParam->result,
+        txCreditParam->credit);
+}
+
+/*******************************************************************************
+* Function Name: L2capDataWriteHandler()
+********************************************************************************
+*
+* Summary:
+*   Handles CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND: an echo was sent.
+*
+*******************************************************************************/
+static void L2capDataWriteHandler(uint32 event, void* eventParam)
+{
+    (void)event;
+#if(DEBUG_UART_FULL)
+    cy_ble_l2cap_cbfc_data_write_param_t *writeDataParam = (cy_ble_l2cap_cbfc_data_write_param_t*)eventParam;
+    DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND: lCid=%d, result=%d \r\n",
+        writeDataParam->lCid,
+        writeDataParam->result);
+#else
+    (void)eventParam;
+#endif /* DEBUG_UART_FULL */
+}
+
+
 /*******************************************************************************
 * Function Name: EnterLowPowerMode()
 ********************************************************************************
@@ -656,7 +1191,8 @@ void StackEventHandler(uint32 event, void* eventParam)
 *
 * Theory:
 *  The function configures the device to enter deep sleep - whenever the
-*  BLE is idle and the UART transmission/reception is not happening.
+*  BLE is idle. With the debug UART enabled the CPU only sleeps, so that the
+*  UART keeps sending the log and receiving commands.
 *
 *  In case of disconnection, the function configures the device to
 *  enter hibernate mode.
@@ -664,13 +1200,13 @@ void StackEventHandler(uint32 event, void* eventParam)
 *******************************************************************************/
 void EnterLowPowerMode(void)
 {
-    //DEBUG_PRINTF("Entering deep sleep mode \r\n");
-    DEBUG_WAIT_UART_TX_COMPLETE();
-
+#if (DEBUG_UART_ENABLED == ENABLED)
+    /* Deep sleep stops the debug UART: the CPU only sleeps, so the TX
+       interrupt drains the log and the RX interrupt takes command lines */
+    Cy_SysPm_CpuEnterSleep(CY_SYSPM_WAIT_FOR_INTERRUPT);
+#else
     /* Configure deep sleep mode to wake up on interrupt */
     Cy_SysPm_DeepSleep(CY_SYSPM_WAIT_FOR_INTERRUPT);
-
-   //DEBUG_PRINTF("Exiting deep sleep mode \r\n");
-    DEBUG_WAIT_UART_TX_COMPLETE();
+#endif /* (DEBUG_UART_ENABLED == ENABLED) */
 }
 /* [] END OF FILE */
@@ -0,0 +1,810 @@
+/*******************************************************************************
+* File Name: iphc.c
+*
+* Version: 1.00
+*
+* Description:
+*  This file contains the 6LoWPAN IPHC header compression of the IPSP channel
+*  (RFC 6282, RFC 7668). Only stateless compression is used: no contexts are
+*  shared between the Router and the Node. The interface identifier of each
+*  end of the link is derived from its BD address, so link-local addresses
+*  between the two are elided completely. UDP headers are compressed with the
+*  UDP next header encoding, the checksum is always carried inline.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <string.h>
+#include "iphc.h"
+
+/* IPHC encoding, first byte: 011 TF(2) NH HLIM(2) */
+#define IPHC_TF_MASK                (0x18u)
+#define IPHC_TF_INLINE              (0x00u)     /* ECN, DSCP and flow label */
+#define IPHC_TF_NO_DSCP             (0x08u)     /* ECN and flow label */
+#define IPHC_TF_NO_FLOW             (0x10u)     /* ECN and DSCP */
+#define IPHC_TF_ELIDED              (0x18u)
+#define IPHC_NH                     (0x04u)     /* Next header is compressed */
+#define IPHC_HLIM_MASK              (0x03u)
+
+/* IPHC encoding, second byte: CID SAC SAM(2) M DAC DAM(2) */
+#define IPHC_CID                    (0x80u)
+#define IPHC_SAC                    (0x40u)
+#define IPHC_SAM_SHIFT              (4u)
+#define IPHC_M                      (0x08u)
+#define IPHC_DAC                    (0x04u)
+#define IPHC_AM_MASK                (0x03u)
+
+/* Unicast address modes, stateless */
+#define IPHC_AM_FULL                (0u)        /* 128 bits inline */
+#define IPHC_AM_IID                 (1u)        /* Link-local, 64-bit IID inline */
+#define IPHC_AM_SHORT               (2u)        /* Link-local, IID 0000:00ff:fe00:XXXX */
+#define IPHC_AM_ELIDED              (3u)        /* Link-local, IID from the BD address */
+
+/* UDP next header encoding: 11110 C P(2) */
+#define NHC_UDP                     (0xF0u)
+#define NHC_UDP_MASK                (0xF8u)
+#define NHC_UDP_CHECKSUM_ELIDED     (0x04u)
+#define NHC_UDP_PORTS_MASK          (0x03u)
+#define NHC_UDP_PORT_PREFIX_8       (0xF000u)   /* 8 bits of the port inline */
+#define NHC_UDP_PORT_PREFIX_4       (0xF0B0u)   /* 4 bits of the port inline */
+
+static const uint8_t shortIidPrefix[6u] = { 0x00u, 0x00u, 0x00u, 0xFFu, 0xFEu, 0x00u };
+/* Inline bytes of a unicast address for each mode */
+static const uint8_t unicastInlineLen[4u] = { IPV6_ADDR_LEN, IPV6_IID_LEN, 2u, 0u };
+
+/******************************************************************************
+* Function Name: Iphc_IsZero
+******************************************************************************/
+static bool Iphc_IsZero(const uint8_t data[], uint32_t len)
+{
+    uint32_t i;
+
+    for(i = 0u; i < len; i++)
+    {
+        if(data[i] != 0u)
+        {
+            return(false);
+        }
+    }
+    return(true);
+}
+
+/******************************************************************************
+* Function Name: Iphc_IsLinkLocal
+*******************************************************************************
+*
+* Summary:
+*  Returns true for an address in fe80::/64.
+*
+******************************************************************************/
+static bool Iphc_IsLinkLocal(const uint8_t addr[])
+{
+    return((addr[0u] == 0xFEu) && (addr[1u] == 0x80u) && Iphc_IsZero(&addr[2u], 6u));
+}
+
+/******************************************************************************
+* Function Name: Iphc_IidFromBdAddr
+*******************************************************************************
+*
+* Summary:
+*  Forms the 64-bit interface identifier of a BD address as defined by
+*  RFC 7668: 0xFF and 0xFE are inserted in the middle of the address, no bit
+*  is changed.
+*
+* Parameters:
+*  bdAddr: BD address, least significant byte first as used by the stack.
+*  iid: receives the interface identifier in network order.
+*
+******************************************************************************/
+void Iphc_IidFromBdAddr(const uint8_t bdAddr[], uint8_t iid[])
+{
+    iid[0u] = bdAddr[5u];
+    iid[1u] = bdAddr[4u];
+    iid[2u] = bdAddr[3u];
+    iid[3u] = 0xFFu;
+    iid[4u] = 0xFEu;
+    iid[5u] = bdAddr[2u];
+    iid[6u] = bdAddr[1u];
+    iid[7u] = bdAddr[0u];
+}
+
+/******************************************************************************
+* Function Name: Iphc_LinkInit
+*******************************************************************************
+*
+* Summary:
+*  Sets up the compression state of a link from the BD addresses of its ends.
+*
+******************************************************************************/
+void Iphc_LinkInit(iphc_link_t *link, const uint8_t ownBdAddr[], const uint8_t peerBdAddr[])
+{
+    Iphc_IidFromBdAddr(ownBdAddr, link->ownIid);
+    Iphc_IidFromBdAddr(peerBdAddr, link->peerIid);
+}
+
+/******************************************************************************
+* Function Name: Iphc_LinkLocal
+*******************************************************************************
+*
+* Summary:
+*  Builds the link-local address fe80::/64 of an interface identifier.
+*
+******************************************************************************/
+void Iphc_LinkLocal(uint8_t addr[], const uint8_t iid[])
+{
+    addr[0u] = 0xFEu;
+    addr[1u] = 0x80u;
+    memset(&addr[2u], 0, 6u);
+    memcpy(&addr[8u], iid, IPV6_IID_LEN);
+}
+
+/******************************************************************************
+* Function Name: Iphc_UdpChecksum
+*******************************************************************************
+*
+* Summary:
+*  Computes the UDP checksum of a datagram over the IPv6 pseudo-header, the
+*  UDP header and the payload. The checksum field of the header is taken as
+*  zero, so the result is compared with it to verify a received datagram.
+*
+* Parameters:
+*  hdr: IPv6 and UDP header, payloadLength includes the UDP header.
+*  payload: UDP payload, payloadLength - UDP_HEADER_LEN bytes.
+*
+* Return:
+*  The checksum, never zero.
+*
+******************************************************************************/
+uint16_t Iphc_UdpChecksum(const iphc_header_t *hdr, const uint8_t payload[])
+{
+    uint32_t sum = 0u;
+    uint32_t len = (uint32_t)hdr->payloadLength - UDP_HEADER_LEN;
+    uint32_t i;
+
+    for(i = 0u; i < IPV6_ADDR_LEN; i += 2u)
+    {
+        sum += ((uint32_t)hdr->src[i] << 8u) | hdr->src[i + 1u];
+        sum += ((uint32_t)hdr->dst[i] << 8u) | hdr->dst[i + 1u];
+    }
+    /* Upper-layer length appears in the pseudo-header and the UDP header */
+    sum += 2u * (uint32_t)hdr->payloadLength;
+    sum += IPV6_NEXT_HEADER_UDP;
+    sum += hdr->srcPort;
+    sum += hdr->dstPort;
+
+    for(i = 0u; (i + 1u) < len; i += 2u)
+    {
+        sum += ((uint32_t)payload[i] << 8u) | payload[i + 1u];
+    }
+    if(i < len)
+    {
+        sum += (uint32_t)payload[i] << 8u;
+    }
+
+    while((sum >> 16u) != 0u)
+    {
+        sum = (sum & 0xFFFFu) + (sum >> 16u);
+    }
+    sum = (~sum) & 0xFFFFu;
+    return((sum != 0u) ? (uint16_t)sum : 0xFFFFu);
+}
+
+/******************************************************************************
+* Function Name: Iphc_UnicastMode
+*******************************************************************************
+*
+* Summary:
+*  Returns the stateless address mode of a unicast address, iid is the
+*  interface identifier the receiver derives from the link.
+*
+******************************************************************************/
+static uint8_t Iphc_UnicastMode(const uint8_t addr[], const uint8_t iid[])
+{
+    if(Iphc_IsLinkLocal(addr) == false)
+    {
+        return(IPHC_AM_FULL);
+    }
+    if(memcmp(&addr[8u], iid, IPV6_IID_LEN) == 0)
+    {
+        return(IPHC_AM_ELIDED);
+    }
+    if(memcmp(&addr[8u], shortIidPrefix, sizeof(shortIidPrefix)) == 0)
+    {
+        return(IPHC_AM_SHORT);
+    }
+    return(IPHC_AM_IID);
+}
+
+/******************************************************************************
+* Function Name: Iphc_PutUnicast
+*******************************************************************************
+*
+* Summary:
+*  Writes the inline part of a unicast address and returns its length.
+*
+******************************************************************************/
+static uint32_t Iphc_PutUnicast(uint8_t mode, const uint8_t addr[], uint8_t buffer[])
+{
+    uint32_t len = unicastInlineLen[mode];
+
+    memcpy(buffer, &addr[IPV6_ADDR_LEN - len], len);
+    return(len);
+}
+
+/******************************************************************************
+* Function Name: Iphc_GetUnicast
+*******************************************************************************
+*
+* Summary:
+*  Rebuilds a unicast address from its mode and inline part. Returns the
+*  number of inline bytes read, or -1 when they run past the end of the SDU.
+*
+******************************************************************************/
+static int32_t Iphc_GetUnicast(uint8_t mode, const uint8_t data[], uint32_t left, const uint8_t iid[],
+                               uint8_t addr[])
+{
+    if(left < unicastInlineLen[mode])
+    {
+        return(-1);
+    }
+    switch(mode)
+    {
+        case IPHC_AM_FULL:
+            memcpy(addr, data, IPV6_ADDR_LEN);
+            break;
+
+        case IPHC_AM_IID:
+            Iphc_LinkLocal(addr, data);
+            break;
+
+        case IPHC_AM_SHORT:
+            addr[0u] = 0xFEu;
+            addr[1u] = 0x80u;
+            memset(&addr[2u], 0, 6u);
+            memcpy(&addr[8u], shortIidPrefix, sizeof(shortIidPrefix));
+            addr[14u] = data[0u];
+            addr[15u] = data[1u];
+            break;
+
+        default:
+            Iphc_LinkLocal(addr, iid);
+            break;
+    }
+    return((int32_t)unicastInlineLen[mode]);
+}
+
+/******************************************************************************
+* Function Name: Iphc_Compress
+*******************************************************************************
+*
+* Summary:
+*  Writes the IPHC compressed form of the IPv6 header and, when the next
+*  header is UDP, of the UDP header. The datagram payload follows the
+*  compressed header in the SDU, the payload length is not sent: the
+*  receiver takes it from the SDU length.
+*
+* Parameters:
+*  hdr: IPv6 and UDP header of the datagram.
+*  link: interface identifiers of the link the datagram is sent on.
+*  buffer: receives the compressed header, IPHC_MAX_HEADER_LEN bytes.
+*
+* Return:
+*  Length of the compressed header.
+*
+******************************************************************************/
+uint16_t Iphc_Compress(const iphc_header_t *hdr, const iphc_link_t *link, uint8_t buffer[])
+{
+    uint8_t  iphc0 = LOWPAN_DISPATCH_IPHC;
+    uint8_t  iphc1 = 0u;
+    uint8_t  ecn = (uint8_t)(hdr->trafficClass & 0x03u);
+    uint8_t  dscp = (uint8_t)(hdr->trafficClass >> 2u);
+    uint32_t fl = hdr->flowLabel & 0x000FFFFFu;
+    uint32_t pos = 2u;
+    uint8_t  mode;
+    uint8_t  nhc;
+
+    /* Traffic class and flow label, ECN comes first when inline */
+    if((hdr->trafficClass == 0u) && (fl == 0u))
+    {
+        iphc0 |= IPHC_TF_ELIDED;
+    }
+    else if(fl == 0u)
+    {
+        iphc0 |= IPHC_TF_NO_FLOW;
+        buffer[pos++] = (uint8_t)((ecn << 6u) | dscp);
+    }
+    else if(dscp == 0u)
+    {
+        iphc0 |= IPHC_TF_NO_DSCP;
+        buffer[pos++] = (uint8_t)((ecn << 6u) | (fl >> 16u));
+        buffer[pos++] = (uint8_t)(fl >> 8u);
+        buffer[pos++] = (uint8_t)fl;
+    }
+    else
+    {
+        buffer[pos++] = (uint8_t)((ecn << 6u) | dscp);
+        buffer[pos++] = (uint8_t)(fl >> 16u);
+        buffer[pos++] = (uint8_t)(fl >> 8u);
+        buffer[pos++] = (uint8_t)fl;
+    }
+
+    if(hdr->nextHeader == IPV6_NEXT_HEADER_UDP)
+    {
+        iphc0 |= IPHC_NH;
+    }
+    else
+    {
+        buffer[pos++] = hdr->nextHeader;
+    }
+
+    switch(hdr->hopLimit)
+    {
+        case 1u:
+            iphc0 |= 0x01u;
+            break;
+        case 64u:
+            iphc0 |= 0x02u;
+            break;
+        case 255u:
+            iphc0 |= 0x03u;
+            break;
+        default:
+            buffer[pos++] = hdr->hopLimit;
+            break;
+    }
+
+    /* Source address, the unspecified address is sent as SAC=1, SAM=00 */
+    if(Iphc_IsZero(hdr->src, IPV6_ADDR_LEN) == true)
+    {
+        iphc1 |= IPHC_SAC;
+    }
+    else
+    {
+        mode = Iphc_UnicastMode(hdr->src, link->ownIid);
+        iphc1 |= (uint8_t)(mode << IPHC_SAM_SHIFT);
+        pos += Iphc_PutUnicast(mode, hdr->src, &buffer[pos]);
+    }
+
+    /* Destination address */
+    if(hdr->dst[0u] == 0xFFu)
+    {
+        iphc1 |= IPHC_M;
+        if((hdr->dst[1u] == 0x02u) && Iphc_IsZero(&hdr->dst[2u], 13u))
+        {
+            iphc1 |= 0x03u;                         /* ff02::00XX */
+            buffer[pos++] = hdr->dst[15u];
+        }
+        else if(Iphc_IsZero(&hdr->dst[2u], 11u))
+        {
+            iphc1 |= 0x02u;                         /* ffXX::00XX:XXXX */
+            buffer[pos++] = hdr->dst[1u];
+            memcpy(&buffer[pos], &hdr->dst[13u], 3u);
+            pos += 3u;
+        }
+        else if(Iphc_IsZero(&hdr->dst[2u], 9u))
+        {
+            iphc1 |= 0x01u;                         /* ffXX::00XX:XXXX:XXXX */
+            buffer[pos++] = hdr->dst[1u];
+            memcpy(&buffer[pos], &hdr->dst[11u], 5u);
+            pos += 5u;
+        }
+        else
+        {
+            memcpy(&buffer[pos], hdr->dst, IPV6_ADDR_LEN);
+            pos += IPV6_ADDR_LEN;
+        }
+    }
+    else
+    {
+        mode = Iphc_UnicastMode(hdr->dst, link->peerIid);
+        iphc1 |= mode;
+        pos += Iphc_PutUnicast(mode, hdr->dst, &buffer[pos]);
+    }
+
+    /* UDP header, the length is elided */
+    if(hdr->nextHeader == IPV6_NEXT_HEADER_UDP)
+    {
+        nhc = NHC_UDP;
+        if(((hdr->srcPort & 0xFFF0u) == NHC_UDP_PORT_PREFIX_4) && ((hdr->dstPort & 0xFFF0u) == NHC_UDP_PORT_PREFIX_4))
+        {
+            buffer[pos + 1u] = (uint8_t)(((hdr->srcPort & 0x0Fu) << 4u) | (hdr->dstPort & 0x0Fu));
+            nhc |= 0x03u;
+            buffer[pos] = nhc;
+            pos += 2u;
+        }
+        else if((hdr->dstPort & 0xFF00u) == NHC_UDP_PORT_PREFIX_8)
+        {
+            buffer[pos + 1u] = (uint8_t)(hdr->srcPort >> 8u);
+            buffer[pos + 2u] = (uint8_t)hdr->srcPort;
+            buffer[pos + 3u] = (uint8_t)hdr->dstPort;
+            nhc |= 0x01u;
+            buffer[pos] = nhc;
+            pos += 4u;
+        }
+        else if((hdr->srcPort & 0xFF00u) == NHC_UDP_PORT_PREFIX_8)
+        {
+            buffer[pos + 1u] = (uint8_t)hdr->srcPort;
+            buffer[pos + 2u] = (uint8_t)(hdr->dstPort >> 8u);
+            buffer[pos + 3u] = (uint8_t)hdr->dstPort;
+            nhc |= 0x02u;
+            buffer[pos] = nhc;
+            pos += 4u;
+        }
+        else
+        {
+            buffer[pos + 1u] = (uint8_t)(hdr->srcPort >> 8u);
+            buffer[pos + 2u] = (uint8_t)hdr->srcPort;
+            buffer[pos + 3u] = (uint8_t)(hdr->dstPort >> 8u);
+            buffer[pos + 4u] = (uint8_t)hdr->dstPort;
+            buffer[pos] = nhc;
+            pos += 5u;
+        }
+        buffer[pos++] = (uint8_t)(hdr->checksum >> 8u);
+        buffer[pos++] = (uint8_t)hdr->checksum;
+    }
+
+    buffer[0u] = iphc0;
+    buffer[1u] = iphc1;
+    return((uint16_t)pos);
+}
+
+/******************************************************************************
+* Function Name: Iphc_WriteUncompressed
+*******************************************************************************
+*
+* Summary:
+*  Writes the IPv6 dispatch followed by the full IPv6 header and, when the
+*  next header is UDP, the full UDP header.
+*
+* Parameters:
+*  hdr: IPv6 and UDP header of the datagram.
+*  buffer: receives the header, IPHC_UNCOMPRESSED_LEN bytes.
+*
+* Return:
+*  Length of the header.
+*
+******************************************************************************/
+uint16_t Iphc_WriteUncompressed(const iphc_header_t *hdr, uint8_t buffer[])
+{
+    uint32_t fl = hdr->flowLabel & 0x000FFFFFu;
+
+    buffer[0u] = LOWPAN_DISPATCH_IPV6;
+    buffer[1u] = (uint8_t)(0x60u | (hdr->trafficClass >> 4u));
+    buffer[2u] = (uint8_t)((hdr->trafficClass << 4u) | (fl >> 16u));
+    buffer[3u] = (uint8_t)(fl >> 8u);
+    buffer[4u] = (uint8_t)fl;
+    buffer[5u] = (uint8_t)(hdr->payloadLength >> 8u);
+    buffer[6u] = (uint8_t)hdr->payloadLength;
+    buffer[7u] = hdr->nextHeader;
+    buffer[8u] = hdr->hopLimit;
+    memcpy(&buffer[9u], hdr->src, IPV6_ADDR_LEN);
+    memcpy(&buffer[9u + IPV6_ADDR_LEN], hdr->dst, IPV6_ADDR_LEN);
+    if(hdr->nextHeader != IPV6_NEXT_HEADER_UDP)
+    {
+        return(1u + IPV6_HEADER_LEN);
+    }
+
+    buffer[41u] = (uint8_t)(hdr->srcPort >> 8u);
+    buffer[42u] = (uint8_t)hdr->srcPort;
+    buffer[43u] = (uint8_t)(hdr->dstPort >> 8u);
+    buffer[44u] = (uint8_t)hdr->dstPort;
+    buffer[45u] = (uint8_t)(hdr->payloadLength >> 8u);
+    buffer[46u] = (uint8_t)hdr->payloadLength;
+    buffer[47u] = (uint8_t)(hdr->checksum >> 8u);
+    buffer[48u] = (uint8_t)hdr->checksum;
+    return(IPHC_UNCOMPRESSED_LEN);
+}
+
+/******************************************************************************
+* Function Name: Iphc_DecompressUncompressed
+*******************************************************************************
+*
+* Summary:
+*  Reads a header sent with the IPv6 dispatch.
+*
+******************************************************************************/
+static iphc_result_t Iphc_DecompressUncompressed(const uint8_t data[], uint16_t len, iphc_header_t *hdr,
+                                                 uint16_t *headerLen)
+{
+    uint32_t pos = 1u + IPV6_HEADER_LEN;
+
+    if(len < pos)
+    {
+        return(IPHC_TRUNCATED);
+    }
+    if((data[1u] >> 4u) != 6u)
+    {
+        return(IPHC_UNSUPPORTED);
+    }
+    hdr->trafficClass = (uint8_t)((data[1u] << 4u) | (data[2u] >> 4u));
+    hdr->flowLabel = ((uint32_t)(data[2u] & 0x0Fu) << 16u) | ((uint32_t)data[3u] << 8u) | data[4u];
+    hdr->payloadLength = (uint16_t)((data[5u] << 8u) | data[6u]);
+    hdr->nextHeader = data[7u];
+    hdr->hopLimit = data[8u];
+    memcpy(hdr->src, &data[9u], IPV6_ADDR_LEN);
+    memcpy(hdr->dst, &data[9u + IPV6_ADDR_LEN], IPV6_ADDR_LEN);
+    if(hdr->payloadLength > (len - pos))
+    {
+        return(IPHC_TRUNCATED);
+    }
+
+    if(hdr->nextHeader == IPV6_NEXT_HEADER_UDP)
+    {
+        if(hdr->payloadLength < UDP_HEADER_LEN)
+        {
+            return(IPHC_TRUNCATED);
+        }
+        hdr->srcPort = (uint16_t)((data[41u] << 8u) | data[42u]);
+        hdr->dstPort = (uint16_t)((data[43u] << 8u) | data[44u]);
+        hdr->checksum = (uint16_t)((data[47u] << 8u) | data[48u]);
+        pos += UDP_HEADER_LEN;
+    }
+    *headerLen = (uint16_t)pos;
+    return(IPHC_OK);
+}
+
+/******************************************************************************
+* Function Name: Iphc_Decompress
+*******************************************************************************
+*
+* Summary:
+*  Rebuilds the IPv6 and UDP headers from the start of a received SDU. Both
+*  the IPHC and the uncompressed IPv6 dispatch are accepted. Addresses elided
+*  by the sender are derived from the link: the source from the peer, the
+*  destination from this device.
+*
+* Parameters:
+*  data: the received SDU.
+*  len: length of the SDU.
+*  link: interface identifiers of the link the SDU was received on.
+*  hdr: receives the headers, payloadLength is taken from the SDU length.
+*  headerLen: receives the offset of the datagram payload in the SDU, after
+*   the UDP header when there is one.
+*
+* Return:
+*  IPHC_OK, IPHC_TRUNCATED or IPHC_UNSUPPORTED.
+*
+******************************************************************************/
+iphc_result_t Iphc_Decompress(const uint8_t data[], uint16_t len, const iphc_link_t *link,
+                              iphc_header_t *hdr, uint16_t *headerLen)
+{
+    uint8_t  iphc0;
+    uint8_t  iphc1;
+    uint8_t  nhc;
+    uint32_t pos = 2u;
+    uint32_t used;
+    int32_t  addrLen;
+
+    hdr->srcPort = 0u;
+    hdr->dstPort = 0u;
+    hdr->checksum = 0u;
+    if(len == 0u)
+    {
+        return(IPHC_TRUNCATED);
+    }
+    if(data[0u] == LOWPAN_DISPATCH_IPV6)
+    {
+        return(Iphc_DecompressUncompressed(data, len, hdr, headerLen));
+    }
+    if((data[0u] & LOWPAN_DISPATCH_IPHC_MASK) != LOWPAN_DISPATCH_IPHC)
+    {
+        return(IPHC_UNSUPPORTED);
+    }
+    if(len < 2u)
+    {
+        return(IPHC_TRUNCATED);
+    }
+    iphc0 = data[0u];
+    iphc1 = data[1u];
+    /* No compression context is shared on the link */
+    if(((iphc1 & (IPHC_CID | IPHC_DAC)) != 0u) ||
+       (((iphc1 & IPHC_SAC) != 0u) && (((iphc1 >> IPHC_SAM_SHIFT) & IPHC_AM_MASK) != 0u)))
+    {
+        return(IPHC_UNSUPPORTED);
+    }
+
+    switch(iphc0 & IPHC_TF_MASK)
+    {
+        case IPHC_TF_INLINE:
+            if((len - pos) < 4u)
+            {
+                return(IPHC_TRUNCATED);
+            }
+            hdr->trafficClass = (uint8_t)(((data[pos] & 0x3Fu) << 2u) | (data[pos] >> 6u));
+            hdr->flowLabel = ((uint32_t)(data[pos + 1u] & 0x0Fu) << 16u) | ((uint32_t)data[pos + 2u] << 8u) |
+                             data[pos + 3u];
+            pos += 4u;
+            break;
+
+        case IPHC_TF_NO_DSCP:
+            if((len - pos) < 3u)
+            {
+                return(IPHC_TRUNCATED);
+            }
+            hdr->trafficClass = (uint8_t)(data[pos] >> 6u);
+            hdr->flowLabel = ((uint32_t)(data[pos] & 0x0Fu) << 16u) | ((uint32_t)data[pos + 1u] << 8u) |
+                             data[pos + 2u];
+            pos += 3u;
+            break;
+
+        case IPHC_TF_NO_FLOW:
+            if((len - pos) < 1u)
+            {
+                return(IPHC_TRUNCATED);
+            }
+            hdr->trafficClass = (uint8_t)(((data[pos] & 0x3Fu) << 2u) | (data[pos] >> 6u));
+            hdr->flowLabel = 0u;
+            pos += 1u;
+            break;
+
+        default:
+            hdr->trafficClass = 0u;
+            hdr->flowLabel = 0u;
+            break;
+    }
+
+    if((iphc0 & IPHC_NH) == 0u)
+    {
+        if(pos >= len)
+        {
+            return(IPHC_TRUNCATED);
+        }
+        hdr->nextHeader = data[pos++];
+    }
+
+    switch(iphc0 & IPHC_HLIM_MASK)
+    {
+        case 0u:
+            if(pos >= len)
+            {
+                return(IPHC_TRUNCATED);
+            }
+            hdr->hopLimit = data[pos++];
+            break;
+        case 1u:
+            hdr->hopLimit = 1u;
+            break;
+        case 2u:
+            hdr->hopLimit = 64u;
+            break;
+        default:
+            hdr->hopLimit = 255u;
+            break;
+    }
+
+    if((iphc1 & IPHC_SAC) != 0u)
+    {
+        memset(hdr->src, 0, IPV6_ADDR_LEN);
+    }
+    else
+    {
+        addrLen = Iphc_GetUnicast((uint8_t)((iphc1 >> IPHC_SAM_SHIFT) & IPHC_AM_MASK), &data[pos], len - pos,
+                                  link->peerIid, hdr->src);
+        if(addrLen < 0)
+        {
+            return(IPHC_TRUNCATED);
+        }
+        pos += (uint32_t)addrLen;
+    }
+
+    if((iphc1 & IPHC_M) != 0u)
+    {
+        static const uint8_t multicastLen[4u] = { IPV6_ADDR_LEN, 6u, 4u, 1u };
+        uint8_t mode = (uint8_t)(iphc1 & IPHC_AM_MASK);
+
+        if((len - pos) < multicastLen[mode])
+        {
+            return(IPHC_TRUNCATED);
+        }
+        memset(hdr->dst, 0, IPV6_ADDR_LEN);
+        hdr->dst[0u] = 0xFFu;
+        switch(mode)
+        {
+            case 0u:
+                memcpy(hdr->dst, &data[pos], IPV6_ADDR_LEN);
+                break;
+            case 1u:
+                hdr->dst[1u] = data[pos];
+                memcpy(&hdr->dst[11u], &data[pos + 1u], 5u);
+                break;
+            case 2u:
+                hdr->dst[1u] = data[pos];
+                memcpy(&hdr->dst[13u], &data[pos + 1u], 3u);
+                break;
+            default:
+                hdr->dst[1u] = 0x02u;
+                hdr->dst[15u] = data[pos];
+                break;
+        }
+        pos += multicastLen[mode];
+    }
+    else
+    {
+        addrLen = Iphc_GetUnicast((uint8_t)(iphc1 & IPHC_AM_MASK), &data[pos], len - pos, link->ownIid, hdr->dst);
+        if(addrLen < 0)
+        {
+            return(IPHC_TRUNCATED);
+        }
+        pos += (uint32_t)addrLen;
+    }
+
+    if((iphc0 & IPHC_NH) != 0u)
+    {
+        /* Only the UDP next header encoding is used on IPSP */
+        if(pos >= len)
+        {
+            return(IPHC_TRUNCATED);
+        }
+        nhc = data[pos++];
+        if(((nhc & NHC_UDP_MASK) != NHC_UDP) || ((nhc & NHC_UDP_CHECKSUM_ELIDED) != 0u))
+        {
+            return(IPHC_UNSUPPORTED);
+        }
+        hdr->nextHeader = IPV6_NEXT_HEADER_UDP;
+        switch(nhc & NHC_UDP_PORTS_MASK)
+        {
+            case 0u:
+                used = 4u;
+                break;
+            case 3u:
+                used = 1u;
+                break;
+            default:
+                used = 3u;
+                break;
+        }
+        if((len - pos) < (used + 2u))
+        {
+            return(IPHC_TRUNCATED);
+        }
+        switch(nhc & NHC_UDP_PORTS_MASK)
+        {
+            case 0u:
+                hdr->srcPort = (uint16_t)((data[pos] << 8u) | data[pos + 1u]);
+                hdr->dstPort = (uint16_t)((data[pos + 2u] << 8u) | data[pos + 3u]);
+                break;
+            case 1u:
+                hdr->srcPort = (uint16_t)((data[pos] << 8u) | data[pos + 1u]);
+                hdr->dstPort = (uint16_t)(NHC_UDP_PORT_PREFIX_8 | data[pos + 2u]);
+                break;
+            case 2u:
+                hdr->srcPort = (uint16_t)(NHC_UDP_PORT_PREFIX_8 | data[pos]);
+                hdr->dstPort = (uint16_t)((data[pos + 1u] << 8u) | data[pos + 2u]);
+                break;
+            default:
+                hdr->srcPort = (uint16_t)(NHC_UDP_PORT_PREFIX_4 | (data[pos] >> 4u));
+                hdr->dstPort = (uint16_t)(NHC_UDP_PORT_PREFIX_4 | (data[pos] & 0x0Fu));
+                break;
+        }
+        pos += used;
+        hdr->checksum = (uint16_t)((data[pos] << 8u) | data[pos + 1u]);
+        pos += 2u;
+        hdr->payloadLength = (uint16_t)((len - pos) + UDP_HEADER_LEN);
+    }
+    else if(hdr->nextHeader == IPV6_NEXT_HEADER_UDP)
+    {
+        /* UDP header sent inline */
+        if((len - pos) < UDP_HEADER_LEN)
+        {
+            return(IPHC_TRUNCATED);
+        }
+        hdr->srcPort = (uint16_t)((data[pos] << 8u) | data[pos + 1u]);
+        hdr->dstPort = (uint16_t)((data[pos + 2u] << 8u) | data[pos + 3u]);
+        hdr->checksum = (uint16_t)((data[pos + 6u] << 8u) | data[pos + 7u]);
+        pos += UDP_HEADER_LEN;
+        hdr->payloadLength = (uint16_t)((len - pos) + UDP_HEADER_LEN);
+    }
+    else
+    {
+        hdr->payloadLength = (uint16_t)(len - pos);
+    }
+
+    *headerLen = (uint16_t)pos;
+    return(IPHC_OK);
+}
+
+/* [] END OF FILE */
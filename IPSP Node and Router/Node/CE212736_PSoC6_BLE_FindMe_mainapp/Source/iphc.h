@@ -0,0 +1,94 @@
+/*******************************************************************************
+* File Name: iphc.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the 6LoWPAN header
+*  compression used on the IPSP channel (RFC 6282, RFC 7668). The IPv6 and
+*  UDP headers of a datagram are kept as a structure and only their
+*  compressed form is sent. Link-local addresses whose interface identifier
+*  is derived from the BD address of the sender or receiver are elided.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef IPHC_H
+
+    #define IPHC_H
+
+    #include "cycfg_ble.h"
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    #define IPV6_HEADER_LEN             (40u)
+    #define IPV6_ADDR_LEN               (16u)
+    #define IPV6_IID_LEN                (8u)
+    /* IPSP links carry datagrams of up to the IPv6 minimum MTU (RFC 7668) */
+    #define IPV6_MTU                    (1280u)
+    #define IPV6_NEXT_HEADER_UDP        (17u)
+    #define UDP_HEADER_LEN              (8u)
+
+    /* Dispatch values */
+    #define LOWPAN_DISPATCH_IPV6        (0x41u)     /* Uncompressed IPv6 header follows */
+    #define LOWPAN_DISPATCH_IPHC        (0x60u)     /* 011xxxxx */
+    #define LOWPAN_DISPATCH_IPHC_MASK   (0xE0u)
+
+    /* Longest compressed header: base, TF, next header, hop limit, both
+     * addresses inline and the UDP header with both ports inline */
+    #define IPHC_MAX_HEADER_LEN         (2u + 4u + 1u + 1u + IPV6_ADDR_LEN + IPV6_ADDR_LEN + 7u)
+    /* Header with the uncompressed IPv6 dispatch */
+    #define IPHC_UNCOMPRESSED_LEN       (1u + IPV6_HEADER_LEN + UDP_HEADER_LEN)
+
+    typedef enum
+    {
+        IPHC_OK,
+        IPHC_TRUNCATED,                 /* Header runs past the end of the SDU */
+        IPHC_UNSUPPORTED                /* Not IPv6, or a context or elided checksum is used */
+    } iphc_result_t;
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    /* IPv6 header and, when nextHeader is UDP, the UDP header of a datagram */
+    typedef struct
+    {
+        uint8_t         trafficClass;
+        uint32_t        flowLabel;
+        uint8_t         nextHeader;
+        uint8_t         hopLimit;
+        uint8_t         src[IPV6_ADDR_LEN];
+        uint8_t         dst[IPV6_ADDR_LEN];
+        uint16_t        payloadLength;  /* IPv6 payload, including the UDP header */
+        uint16_t        srcPort;
+        uint16_t        dstPort;
+        uint16_t        checksum;
+    } iphc_header_t;
+
+    /* Interface identifiers of the two ends of an IPSP link */
+    typedef struct
+    {
+        uint8_t         ownIid[IPV6_IID_LEN];
+        uint8_t         peerIid[IPV6_IID_LEN];
+    } iphc_link_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void Iphc_IidFromBdAddr(const uint8_t bdAddr[], uint8_t iid[]);
+    void Iphc_LinkInit(iphc_link_t *link, const uint8_t ownBdAddr[], const uint8_t peerBdAddr[]);
+    void Iphc_LinkLocal(uint8_t addr[], const uint8_t iid[]);
+    uint16_t Iphc_UdpChecksum(const iphc_header_t *hdr, const uint8_t payload[]);
+    uint16_t Iphc_Compress(const iphc_header_t *hdr, const iphc_link_t *link, uint8_t buffer[]);
+    uint16_t Iphc_WriteUncompressed(const iphc_header_t *hdr, uint8_t buffer[]);
+    iphc_result_t Iphc_Decompress(const uint8_t data[], uint16_t len, const iphc_link_t *link,
+                                  iphc_header_t *hdr, uint16_t *headerLen);
+
+#endif /* IPHC_H */
+
+/* [] END OF FILE */
@@ -80,6 +80,16 @@ CY_APP_CM4_SOURCE = \
 	Source/BLEFindMe.h\
 	Source/debug.c\
 	Source/debug.h\
+	Source/iphc.c\
+	Source/iphc.h\
+	Source/credit.c\
+	Source/credit.h\
+	Source/ble_dispatch.c\
+	Source/ble_dispatch.h\
+	Source/command.c\
+	Source/command.h\
+	Source/buf_pool.c\
+	Source/buf_pool.h\
 	Source/LED.h\
 	Source/stdio_user.h\
 	Source/stdio_user.c\
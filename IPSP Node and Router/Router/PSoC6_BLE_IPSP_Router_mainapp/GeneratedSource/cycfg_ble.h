@@ -48,10 +48,10 @@
  * This parameter displays how many BLE connections (both Central and Peripheral) are allowed.
  * The valid range is from 1 to 4.
  */
-#define CY_BLE_CONN_COUNT                           (0x01u)
+#define CY_BLE_CONN_COUNT                           (0x04u)
 
 /** The number of BLE connections (client) */
-#define CY_BLE_GATTC_COUNT                          (0x01u)
+#define CY_BLE_GATTC_COUNT                          (0x04u)
 
 /** The number of GAP Peripheral configurations structures */
 #define CY_BLE_GAP_PERIPHERAL_COUNT                 (0x00u)
@@ -123,7 +123,7 @@
 #define CY_BLE_CONFIG_L2CAP_MTU                     (0x500u)
 
 /** The number of L2CAP Logical channels */
-#define CY_BLE_CONFIG_L2CAP_LOGICAL_CHANNEL_COUNT   (0x01u)
+#define CY_BLE_CONFIG_L2CAP_LOGICAL_CHANNEL_COUNT   (0x04u)
 
 /** Number of L2CAP PSMs */
 #define CY_BLE_CONFIG_L2CAP_PSM_COUNT               (0x01u)
@@ -748,7 +748,7 @@ BLE_CONFIG_START
 <?xml version="1.0"?>
 <Configuration major="1" minor="1" device="PSoC6">
     <GeneralProperties>
-        <Property id="ConnectionCount" value="1"/>
+        <Property id="ConnectionCount" value="4"/>
         <Property id="GapRolePeripheral" value="false"/>
         <Property id="GapRoleCentral" value="true"/>
         <Property id="GapRoleBroadcaster" value="false"/>
@@ -1172,7 +1172,7 @@ BLE_CONFIG_START
     </GAP>
     <L2capProperties>
         <Property id="EnableL2capLogicalChannels" value="true"/>
-        <Property id="L2capNumChannels" value="1"/>
+        <Property id="L2capNumChannels" value="4"/>
         <Property id="L2capNumPsm" value="1"/>
         <Property id="L2capMtuSize" value="1280"/>
     </L2capProperties>
@@ -0,0 +1,381 @@
+/*******************************************************************************
+* File Name: adv_data.c
+*
+* Version: 1.00
+*
+* Description:
+*  This file contains the advertising data parser of the Router. A report is
+*  a sequence of AD structures (length, type, value). The iterator returns
+*  them one by one and stops at the first structure that does not fit in the
+*  report. AdvData_Match() runs the same step on every scan report and only
+*  checks the lengths and matches the service UUIDs against a set of
+*  targets. AdvData_Parse() also collects the flags, service UUIDs, name and
+*  TX power, the Router runs it on the reports of new Nodes only.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <string.h>
+#include "adv_data.h"
+
+/******************************************************************************
+* Function Name: AdvData_IterInit
+*******************************************************************************
+*
+* Summary:
+*  Starts an iteration over the AD structures of a report.
+*
+* Parameters:
+*  iter: the iterator.
+*  data: advertising or scan response data.
+*  len: length of the data.
+*
+******************************************************************************/
+void AdvData_IterInit(adv_data_iter_t *iter, const uint8_t data[], uint8_t len)
+{
+    iter->data = data;
+    iter->len = len;
+    iter->offset = 0u;
+}
+
+/******************************************************************************
+* Function Name: AdvData_Step
+*******************************************************************************
+*
+* Summary:
+*  The step of AdvData_Next(), inlined in AdvData_Match() and
+*  AdvData_Parse() so that their iterator stays in registers.
+*
+******************************************************************************/
+static inline __attribute__((always_inline)) adv_data_result_t AdvData_Step(adv_data_iter_t *iter,
+                                                                            adv_data_field_t *field)
+{
+    uint32_t fieldLen;
+
+    if(iter->offset >= iter->len)
+    {
+        return(ADV_DATA_END);
+    }
+    fieldLen = iter->data[iter->offset];
+    if(fieldLen == 0u)
+    {
+        iter->offset = iter->len;
+        return(ADV_DATA_END);
+    }
+    if(fieldLen > ((uint32_t)iter->len - iter->offset - 1u))
+    {
+        iter->offset = iter->len;
+        return(ADV_DATA_MALFORMED);
+    }
+
+    field->type = iter->data[iter->offset + 1u];
+    field->len = (uint8_t)(fieldLen - 1u);
+    field->value = &iter->data[iter->offset + 2u];
+    iter->offset = (uint8_t)(iter->offset + fieldLen + 1u);
+    return(ADV_DATA_OK);
+}
+
+/******************************************************************************
+* Function Name: AdvData_Next
+*******************************************************************************
+*
+* Summary:
+*  Returns the next AD structure. A zero length byte ends the significant
+*  part of the data, the remaining bytes are padding. A structure whose
+*  length runs past the end of the data makes the report malformed, and the
+*  iteration ends there.
+*
+* Parameters:
+*  iter: the iterator.
+*  field: receives the type and value of the structure.
+*
+* Return:
+*  ADV_DATA_OK, ADV_DATA_END or ADV_DATA_MALFORMED.
+*
+******************************************************************************/
+adv_data_result_t AdvData_Next(adv_data_iter_t *iter, adv_data_field_t *field)
+{
+    return(AdvData_Step(iter, field));
+}
+
+/******************************************************************************
+* Function Name: AdvData_FieldValid
+*******************************************************************************
+*
+* Summary:
+*  Checks the value length of the fields the parser reads: the flags need a
+*  byte, the TX power level exactly one, the UUID lists whole UUIDs.
+*
+******************************************************************************/
+static inline __attribute__((always_inline)) bool AdvData_FieldValid(const adv_data_field_t *field)
+{
+    switch(field->type)
+    {
+        case CY_BLE_GAP_ADV_FLAGS:
+            return(field->len != 0u);
+
+        case CY_BLE_GAP_ADV_INCOMPL_16UUID:
+        case CY_BLE_GAP_ADV_COMPL_16UUID:
+            return((field->len % ADV_DATA_UUID16_SIZE) == 0u);
+
+        case CY_BLE_GAP_ADV_INCOMPL_128_UUID:
+        case CY_BLE_GAP_ADV_COMPL_128_UUID:
+            return((field->len % ADV_DATA_UUID128_SIZE) == 0u);
+
+        case CY_BLE_GAP_ADV_TX_PWR_LEVEL:
+            return(field->len == 1u);
+
+        default:
+            return(true);
+    }
+}
+
+/******************************************************************************
+* Function Name: AdvData_Match16
+*******************************************************************************
+*
+* Summary:
+*  Returns the bit mask of the 16-bit targets equal to the UUID.
+*
+******************************************************************************/
+static uint32_t AdvData_Match16(const adv_data_uuid_t targets[], uint8_t targetCount, uint16_t uuid)
+{
+    uint32_t match = 0u;
+    uint32_t i;
+
+    for(i = 0u; i < targetCount; i++)
+    {
+        if((targets[i].size == ADV_DATA_UUID16_SIZE) && (targets[i].uuid16 == uuid))
+        {
+            match |= (1uL << i);
+        }
+    }
+    return(match);
+}
+
+/******************************************************************************
+* Function Name: AdvData_Match128
+*******************************************************************************
+*
+* Summary:
+*  Returns the bit mask of the 128-bit targets equal to the UUID.
+*
+******************************************************************************/
+static uint32_t AdvData_Match128(const adv_data_uuid_t targets[], uint8_t targetCount, const uint8_t uuid[])
+{
+    uint32_t match = 0u;
+    uint32_t i;
+
+    for(i = 0u; i < targetCount; i++)
+    {
+        if((targets[i].size == ADV_DATA_UUID128_SIZE) &&
+           (memcmp(targets[i].uuid128, uuid, ADV_DATA_UUID128_SIZE) == 0))
+        {
+            match |= (1uL << i);
+        }
+    }
+    return(match);
+}
+
+/******************************************************************************
+* Function Name: AdvData_MatchWalk
+*******************************************************************************
+*
+* Summary:
+*  The walk of AdvData_Match(). With one16 set the only target is a 16-bit
+*  UUID, compared in place, and the 128-bit lists are only checked.
+*
+******************************************************************************/
+static inline __attribute__((always_inline)) uint32_t AdvData_MatchWalk(const uint8_t data[], uint8_t len,
+                                                                        const adv_data_uuid_t targets[],
+                                                                        uint8_t targetCount, bool one16)
+{
+    adv_data_result_t   result;
+    adv_data_iter_t     iter;
+    adv_data_field_t    field;
+    uint32_t            match = 0u;
+    uint16_t            uuid;
+    uint32_t            i;
+
+    AdvData_IterInit(&iter, data, len);
+    while((result = AdvData_Step(&iter, &field)) == ADV_DATA_OK)
+    {
+        if(AdvData_FieldValid(&field) == false)
+        {
+            return(0u);
+        }
+        if((field.type == CY_BLE_GAP_ADV_INCOMPL_16UUID) || (field.type == CY_BLE_GAP_ADV_COMPL_16UUID))
+        {
+            for(i = 0u; i < field.len; i += ADV_DATA_UUID16_SIZE)
+            {
+                uuid = (uint16_t)(field.value[i] | ((uint16_t)field.value[i + 1u] << 8u));
+                match |= one16 ? (uint32_t)(uuid == targets[0u].uuid16) : AdvData_Match16(targets, targetCount, uuid);
+            }
+        }
+        else if((one16 == false) &&
+                ((field.type == CY_BLE_GAP_ADV_INCOMPL_128_UUID) || (field.type == CY_BLE_GAP_ADV_COMPL_128_UUID)))
+        {
+            for(i = 0u; i < field.len; i += ADV_DATA_UUID128_SIZE)
+            {
+                match |= AdvData_Match128(targets, targetCount, &field.value[i]);
+            }
+        }
+        else
+        {
+        }
+    }
+    return((result == ADV_DATA_END) ? match : 0u);
+}
+
+/******************************************************************************
+* Function Name: AdvData_Match
+*******************************************************************************
+*
+* Summary:
+*  Walks the report once, rejects it on the same structures as
+*  AdvData_Parse() and matches every service UUID against the targets,
+*  without collecting the fields. This is the check run on every scan
+*  report.
+*
+* Parameters:
+*  data: advertising or scan response data.
+*  len: length of the data.
+*  targets: UUIDs to look for, at most 32.
+*  targetCount: number of targets.
+*
+* Return:
+*  Bit n set when target n was found, 0 on a malformed report.
+*
+******************************************************************************/
+uint32_t AdvData_Match(const uint8_t data[], uint8_t len, const adv_data_uuid_t targets[], uint8_t targetCount)
+{
+    if((len > ADV_DATA_MAX_LEN) || ((data == NULL) && (len != 0u)))
+    {
+        return(0u);
+    }
+    /* One 16-bit UUID, the Router's IPSS, gets a walk of its own */
+    if((targetCount == 1u) && (targets[0u].size == ADV_DATA_UUID16_SIZE))
+    {
+        return(AdvData_MatchWalk(data, len, targets, 1u, true));
+    }
+    return(AdvData_MatchWalk(data, len, targets, targetCount, false));
+}
+
+/******************************************************************************
+* Function Name: AdvData_Parse
+*******************************************************************************
+*
+* Summary:
+*  Walks the report once and collects the flags, the 16-bit and 128-bit
+*  service UUID lists, the local name and the TX power level. Every service
+*  UUID is matched against the targets. The report is rejected as soon as a
+*  structure does not fit or a field has an invalid length.
+*
+* Parameters:
+*  data: advertising or scan response data.
+*  len: length of the data.
+*  targets: UUIDs to look for, at most 32.
+*  targetCount: number of targets.
+*  info: receives the collected fields, its pointers refer to data.
+*
+* Return:
+*  ADV_DATA_OK when the whole report is well formed, ADV_DATA_MALFORMED
+*  otherwise. On a malformed report no target is reported as matched.
+*
+******************************************************************************/
+adv_data_result_t AdvData_Parse(const uint8_t data[], uint8_t len, const adv_data_uuid_t targets[],
+                                uint8_t targetCount, adv_data_info_t *info)
+{
+    adv_data_result_t   result;
+    adv_data_iter_t     iter;
+    adv_data_field_t    field;
+    uint32_t            match = 0u;
+    uint32_t            uuid16Count = 0u;
+    uint32_t            uuid128Count = 0u;
+    uint16_t            uuid;
+    uint32_t            i;
+
+    /* Only the scalars are cleared, the lists are filled as they are found */
+    info->hasFlags = false;
+    info->hasTxPower = false;
+    info->name = NULL;
+    info->nameLen = 0u;
+    info->nameComplete = false;
+    if((len > ADV_DATA_MAX_LEN) || ((data == NULL) && (len != 0u)))
+    {
+        info->uuid16Count = 0u;
+        info->uuid128Count = 0u;
+        info->match = 0u;
+        return(ADV_DATA_MALFORMED);
+    }
+
+    AdvData_IterInit(&iter, data, len);
+    while((result = AdvData_Step(&iter, &field)) == ADV_DATA_OK)
+    {
+        if(AdvData_FieldValid(&field) == false)
+        {
+            result = ADV_DATA_MALFORMED;
+            break;
+        }
+        switch(field.type)
+        {
+            case CY_BLE_GAP_ADV_FLAGS:
+                info->hasFlags = true;
+                info->flags = field.value[0u];
+                break;
+
+            case CY_BLE_GAP_ADV_INCOMPL_16UUID:
+            case CY_BLE_GAP_ADV_COMPL_16UUID:
+                for(i = 0u; i < field.len; i += ADV_DATA_UUID16_SIZE)
+                {
+                    uuid = (uint16_t)(field.value[i] | ((uint16_t)field.value[i + 1u] << 8u));
+                    if(uuid16Count < ADV_DATA_MAX_UUID16)
+                    {
+                        info->uuid16[uuid16Count++] = uuid;
+                    }
+                    match |= AdvData_Match16(targets, targetCount, uuid);
+                }
+                break;
+
+            case CY_BLE_GAP_ADV_INCOMPL_128_UUID:
+            case CY_BLE_GAP_ADV_COMPL_128_UUID:
+                for(i = 0u; i < field.len; i += ADV_DATA_UUID128_SIZE)
+                {
+                    if(uuid128Count < ADV_DATA_MAX_UUID128)
+                    {
+                        info->uuid128[uuid128Count++] = &field.value[i];
+                    }
+                    match |= AdvData_Match128(targets, targetCount, &field.value[i]);
+                }
+                break;
+
+            case CY_BLE_GAP_ADV_SHORT_NAME:
+            case CY_BLE_GAP_ADV_COMPL_NAME:
+                info->name = field.value;
+                info->nameLen = field.len;
+                info->nameComplete = (field.type == CY_BLE_GAP_ADV_COMPL_NAME);
+                break;
+
+            case CY_BLE_GAP_ADV_TX_PWR_LEVEL:
+                info->hasTxPower = true;
+                info->txPower = (int8_t)field.value[0u];
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    /* The end of the structures is the end of a well formed report */
+    result = (result == ADV_DATA_END) ? ADV_DATA_OK : ADV_DATA_MALFORMED;
+    info->uuid16Count = (uint8_t)uuid16Count;
+    info->uuid128Count = (uint8_t)uuid128Count;
+    info->match = (result == ADV_DATA_OK) ? match : 0u;
+    return(result);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,98 @@
+/*******************************************************************************
+* File Name: adv_data.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the advertising data
+*  parser. The parser walks the AD structures of a scan report once, checks
+*  that every structure stays inside the report and matches the service
+*  UUIDs, or collects the fields the Router prints as well.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef ADV_DATA_H
+
+    #define ADV_DATA_H
+
+    #include "cycfg_ble.h"
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    /* Legacy advertising and scan response data are at most 31 bytes */
+    #define ADV_DATA_MAX_LEN            (31u)
+    #define ADV_DATA_UUID16_SIZE        (2u)
+    #define ADV_DATA_UUID128_SIZE       (16u)
+    /* UUIDs kept in adv_data_info_t, further ones are only matched */
+    #define ADV_DATA_MAX_UUID16         (8u)
+    #define ADV_DATA_MAX_UUID128        (2u)
+
+    typedef enum
+    {
+        ADV_DATA_OK,                    /* Structure returned */
+        ADV_DATA_END,                   /* No more structures */
+        ADV_DATA_MALFORMED              /* Structure runs past the report or has a bad length */
+    } adv_data_result_t;
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    /* Iterator over the AD structures of a report */
+    typedef struct
+    {
+        const uint8_t   *data;
+        uint8_t         len;
+        uint8_t         offset;
+    } adv_data_iter_t;
+
+    /* One AD structure: type and value, the length byte is not included */
+    typedef struct
+    {
+        uint8_t         type;
+        uint8_t         len;
+        const uint8_t   *value;
+    } adv_data_field_t;
+
+    /* UUID searched for in the service UUID lists */
+    typedef struct
+    {
+        uint8_t         size;           /* ADV_DATA_UUID16_SIZE or ADV_DATA_UUID128_SIZE */
+        uint16_t        uuid16;
+        const uint8_t   *uuid128;       /* Little endian, as sent over the air */
+    } adv_data_uuid_t;
+
+    /* Fields collected from one report, pointers refer to the report */
+    typedef struct
+    {
+        bool            hasFlags;
+        uint8_t         flags;
+        bool            hasTxPower;
+        int8_t          txPower;
+        const uint8_t   *name;
+        uint8_t         nameLen;
+        bool            nameComplete;
+        uint8_t         uuid16Count;
+        uint16_t        uuid16[ADV_DATA_MAX_UUID16];
+        uint8_t         uuid128Count;
+        const uint8_t   *uuid128[ADV_DATA_MAX_UUID128];
+        uint32_t        match;          /* Bit n is set when target n was found */
+    } adv_data_info_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void AdvData_IterInit(adv_data_iter_t *iter, const uint8_t data[], uint8_t len);
+    adv_data_result_t AdvData_Next(adv_data_iter_t *iter, adv_data_field_t *field);
+    uint32_t AdvData_Match(const uint8_t data[], uint8_t len, const adv_data_uuid_t targets[], uint8_t targetCount);
+    adv_data_result_t AdvData_Parse(const uint8_t data[], uint8_t len, const adv_data_uuid_t targets[],
+                                    uint8_t targetCount, adv_data_info_t *info);
+
+#endif /* ADV_DATA_H */
+
+/* [] END OF FILE */
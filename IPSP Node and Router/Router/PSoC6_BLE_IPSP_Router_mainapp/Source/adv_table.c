@@ -0,0 +1,259 @@
+/*******************************************************************************
+* File Name: adv_table.c
+*
+* Version: 1.00
+*
+* Description:
+*  This file contains the advertiser table used by the Router to deduplicate
+*  scan reports. Entries are found through a hash of the BD address with
+*  chaining, and kept on a list ordered by the time they were last seen, so
+*  that the oldest entry is replaced or aged out in constant time.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <string.h>
+#include "adv_table.h"
+
+/*******************************************************************************
+* Variables of the advertiser table
+*******************************************************************************/
+static adv_entry_t                          advTable[ADV_TABLE_SIZE];
+static uint8_t                              advBucket[ADV_TABLE_BUCKETS];
+static uint8_t                              advLruHead;     /* Most recently seen */
+static uint8_t                              advLruTail;     /* Least recently seen */
+static uint8_t                              advFree;        /* Unused entries, linked by hashNext */
+static uint8_t                              advCount;
+
+/******************************************************************************
+* Function Name: AdvTable_Hash
+*******************************************************************************
+*
+* Summary:
+*  Returns the hash bucket of a BD address. The address is folded into 32 bits
+*  and multiplied by the golden ratio, the top bits are the bucket index.
+*
+******************************************************************************/
+static uint32_t AdvTable_Hash(const uint8_t bdAddr[])
+{
+    uint32_t hash = (uint32_t)bdAddr[0u] | ((uint32_t)bdAddr[1u] << 8u) |
+                    ((uint32_t)bdAddr[2u] << 16u) | ((uint32_t)bdAddr[3u] << 24u);
+
+    hash ^= ((uint32_t)bdAddr[4u] | ((uint32_t)bdAddr[5u] << 8u)) * 0x85EBCA6Bu;
+    hash *= 0x9E3779B1u;
+    return(hash >> (32u - ADV_TABLE_HASH_BITS));
+}
+
+/******************************************************************************
+* Function Name: AdvTable_LruUnlink
+******************************************************************************/
+static void AdvTable_LruUnlink(uint8_t index)
+{
+    adv_entry_t *entry = &advTable[index];
+
+    if(entry->lruPrev != ADV_TABLE_NONE)
+    {
+        advTable[entry->lruPrev].lruNext = entry->lruNext;
+    }
+    else
+    {
+        advLruHead = entry->lruNext;
+    }
+    if(entry->lruNext != ADV_TABLE_NONE)
+    {
+        advTable[entry->lruNext].lruPrev = entry->lruPrev;
+    }
+    else
+    {
+        advLruTail = entry->lruPrev;
+    }
+}
+
+/******************************************************************************
+* Function Name: AdvTable_LruPushFront
+******************************************************************************/
+static void AdvTable_LruPushFront(uint8_t index)
+{
+    adv_entry_t *entry = &advTable[index];
+
+    entry->lruPrev = ADV_TABLE_NONE;
+    entry->lruNext = advLruHead;
+    if(advLruHead != ADV_TABLE_NONE)
+    {
+        advTable[advLruHead].lruPrev = index;
+    }
+    else
+    {
+        advLruTail = index;
+    }
+    advLruHead = index;
+}
+
+/******************************************************************************
+* Function Name: AdvTable_Remove
+*******************************************************************************
+*
+* Summary:
+*  Removes an entry from its hash bucket and the LRU list and returns it to
+*  the free list.
+*
+******************************************************************************/
+static void AdvTable_Remove(uint8_t index)
+{
+    adv_entry_t *entry = &advTable[index];
+    uint8_t *link = &advBucket[AdvTable_Hash(entry->addr.bdAddr)];
+
+    while(*link != index)
+    {
+        link = &advTable[*link].hashNext;
+    }
+    *link = entry->hashNext;
+    AdvTable_LruUnlink(index);
+
+    entry->used = false;
+    entry->hashNext = advFree;
+    advFree = index;
+    advCount--;
+}
+
+/******************************************************************************
+* Function Name: AdvTable_Init
+*******************************************************************************
+*
+* Summary:
+*  Empties the advertiser table.
+*
+******************************************************************************/
+void AdvTable_Init(void)
+{
+    uint32_t i;
+
+    memset(advTable, 0, sizeof(advTable));
+    memset(advBucket, ADV_TABLE_NONE, sizeof(advBucket));
+    /* Free entries are handed out lowest index first */
+    for(i = 0u; i < ADV_TABLE_SIZE; i++)
+    {
+        advTable[i].hashNext = (uint8_t)(((i + 1u) < ADV_TABLE_SIZE) ? (i + 1u) : ADV_TABLE_NONE);
+    }
+    advFree = 0u;
+    advLruHead = ADV_TABLE_NONE;
+    advLruTail = ADV_TABLE_NONE;
+    advCount = 0u;
+}
+
+/******************************************************************************
+* Function Name: AdvTable_Update
+*******************************************************************************
+*
+* Summary:
+*  Records an advertising report. A known device gets its last-seen time and
+*  average RSSI updated, an unknown one is added, replacing the least recently
+*  seen device when the table is full.
+*
+* Parameters:
+*  bdAddr: BD address of the advertiser.
+*  addrType: address type of the advertiser.
+*  rssi: RSSI of the report in dBm.
+*  now: current time in s.
+*  newDevice: set to true when the device was not in the table.
+*
+* Return:
+*  Index of the device in the table.
+*
+******************************************************************************/
+uint8_t AdvTable_Update(const uint8_t bdAddr[], uint8_t addrType, int8_t rssi, uint32_t now, bool *newDevice)
+{
+    uint32_t bucket = AdvTable_Hash(bdAddr);
+    adv_entry_t *entry;
+    uint8_t index;
+
+    for(index = advBucket[bucket]; index != ADV_TABLE_NONE; index = advTable[index].hashNext)
+    {
+        if((advTable[index].addr.type == addrType) &&
+           (memcmp(advTable[index].addr.bdAddr, bdAddr, CY_BLE_GAP_BD_ADDR_SIZE) == 0))
+        {
+            break;
+        }
+    }
+
+    if(index != ADV_TABLE_NONE)
+    {
+        entry = &advTable[index];
+        entry->rssi += (int16_t)((((int16_t)rssi * 16) - entry->rssi) / (1 << ADV_RSSI_EWMA_SHIFT));
+        AdvTable_LruUnlink(index);
+        *newDevice = false;
+    }
+    else
+    {
+        if(advFree == ADV_TABLE_NONE)
+        {
+            AdvTable_Remove(advLruTail);
+        }
+        index = advFree;
+        entry = &advTable[index];
+        advFree = entry->hashNext;
+        advCount++;
+
+        memcpy(entry->addr.bdAddr, bdAddr, CY_BLE_GAP_BD_ADDR_SIZE);
+        entry->addr.type = addrType;
+        entry->rssi = (int16_t)((int16_t)rssi * 16);
+        entry->reports = 0u;
+        entry->used = true;
+        entry->hashNext = advBucket[bucket];
+        advBucket[bucket] = index;
+        *newDevice = true;
+    }
+
+    AdvTable_LruPushFront(index);
+    entry->lastSeen = now;
+    entry->reports++;
+    return(index);
+}
+
+/******************************************************************************
+* Function Name: AdvTable_Get
+*******************************************************************************
+*
+* Summary:
+*  Returns the entry at the index, NULL when the entry is not in use.
+*
+******************************************************************************/
+adv_entry_t *AdvTable_Get(uint8_t index)
+{
+    if((index < ADV_TABLE_SIZE) && (advTable[index].used == true))
+    {
+        return(&advTable[index]);
+    }
+    return(NULL);
+}
+
+/******************************************************************************
+* Function Name: AdvTable_Count
+******************************************************************************/
+uint8_t AdvTable_Count(void)
+{
+    return(advCount);
+}
+
+/******************************************************************************
+* Function Name: AdvTable_Age
+*******************************************************************************
+*
+* Summary:
+*  Drops the devices that have not been seen for ADV_TABLE_MAX_AGE seconds.
+*  The LRU list is ordered by last-seen time, so only the tail is checked.
+*
+******************************************************************************/
+void AdvTable_Age(uint32_t now)
+{
+    while((advLruTail != ADV_TABLE_NONE) && ((now - advTable[advLruTail].lastSeen) >= ADV_TABLE_MAX_AGE))
+    {
+        AdvTable_Remove(advLruTail);
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,71 @@
+/*******************************************************************************
+* File Name: adv_table.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the advertiser table.
+*  The table remembers the devices seen while scanning, keyed on the BD
+*  address, in a fixed amount of memory: lookups go through a hash index and
+*  the least recently seen device is replaced when the table is full.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef ADV_TABLE_H
+
+    #define ADV_TABLE_H
+
+    #include "cycfg_ble.h"
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    /* Number of advertisers that are remembered, at most 255 */
+    #ifndef ADV_TABLE_SIZE
+        #define ADV_TABLE_SIZE              (32u)
+    #endif
+    /* Hash buckets, a power of two of about twice the table size */
+    #define ADV_TABLE_HASH_BITS         (6u)
+    #define ADV_TABLE_BUCKETS           (1u << ADV_TABLE_HASH_BITS)
+    /* Devices not seen for this many seconds are dropped by AdvTable_Age() */
+    #define ADV_TABLE_MAX_AGE           (30u)
+    /* RSSI average weight of a new report is 1/2^ADV_RSSI_EWMA_SHIFT */
+    #define ADV_RSSI_EWMA_SHIFT         (3u)
+
+    #define ADV_TABLE_NONE              (0xFFu)
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    typedef struct
+    {
+        cy_stc_ble_gap_bd_addr_t    addr;
+        int16_t                     rssi;           /* Average RSSI in 1/16 dBm */
+        uint32_t                    lastSeen;       /* Time of the last report in s */
+        uint32_t                    reports;
+        uint8_t                     hashNext;       /* Next entry in the same bucket */
+        uint8_t                     lruPrev;        /* Seen more recently */
+        uint8_t                     lruNext;        /* Seen less recently */
+        bool                        used;
+    } adv_entry_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void AdvTable_Init(void);
+    uint8_t AdvTable_Update(const uint8_t bdAddr[], uint8_t addrType, int8_t rssi, uint32_t now, bool *newDevice);
+    adv_entry_t *AdvTable_Get(uint8_t index);
+    uint8_t AdvTable_Count(void);
+    void AdvTable_Age(uint32_t now);
+
+    /* Average RSSI of an entry in dBm */
+    #define ADV_TABLE_RSSI(entry)       ((int8_t)((entry)->rssi / 16))
+
+#endif /* ADV_TABLE_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,167 @@
+/*******************************************************************************
+* File Name: bench.c
+*
+* Version: 1.00
+*
+* Description:
+*  This file contains the round-trip time statistics of the loopback
+*  benchmark. Times below BENCH_RTT_SUB_BUCKETS us have a bucket each, above
+*  that every power of two is split in BENCH_RTT_SUB_BUCKETS equal buckets.
+*  The minimum, maximum and mean are exact, a percentile is the middle of
+*  its bucket, clamped to the minimum and maximum.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <string.h>
+#include "bench.h"
+
+/******************************************************************************
+* Function Name: Bench_RttBucket
+*******************************************************************************
+*
+* Summary:
+*  Returns the bucket of a time.
+*
+******************************************************************************/
+static uint32_t Bench_RttBucket(uint32_t us)
+{
+    uint32_t log2 = 0u;
+    uint32_t v;
+
+    if(us < BENCH_RTT_SUB_BUCKETS)
+    {
+        return(us);
+    }
+    if(us >= (1u << BENCH_RTT_MAX_LOG2))
+    {
+        return(BENCH_RTT_BUCKETS - 1u);
+    }
+    for(v = us; v > 1u; v >>= 1u)
+    {
+        log2++;
+    }
+    return(((log2 - BENCH_RTT_SUB_BITS + 1u) * BENCH_RTT_SUB_BUCKETS) +
+           ((us >> (log2 - BENCH_RTT_SUB_BITS)) & (BENCH_RTT_SUB_BUCKETS - 1u)));
+}
+
+/******************************************************************************
+* Function Name: Bench_RttBucketMiddle
+*******************************************************************************
+*
+* Summary:
+*  Returns the time in the middle of a bucket.
+*
+******************************************************************************/
+static uint32_t Bench_RttBucketMiddle(uint32_t bucket)
+{
+    uint32_t shift;
+    uint32_t low;
+
+    if(bucket < BENCH_RTT_SUB_BUCKETS)
+    {
+        return(bucket);
+    }
+    shift = (bucket / BENCH_RTT_SUB_BUCKETS) - 1u;
+    low = (BENCH_RTT_SUB_BUCKETS + (bucket % BENCH_RTT_SUB_BUCKETS)) << shift;
+    return(low + ((1u << shift) / 2u));
+}
+
+/******************************************************************************
+* Function Name: Bench_RttReset
+*******************************************************************************
+*
+* Summary:
+*  Clears the statistics.
+*
+******************************************************************************/
+void Bench_RttReset(bench_rtt_t *rtt)
+{
+    memset(rtt, 0, sizeof(bench_rtt_t));
+    rtt->minUs = UINT32_MAX;
+}
+
+/******************************************************************************
+* Function Name: Bench_RttAdd
+*******************************************************************************
+*
+* Summary:
+*  Adds a round-trip time.
+*
+* Parameters:
+*  rtt: the statistics.
+*  us: round-trip time in microseconds.
+*
+******************************************************************************/
+void Bench_RttAdd(bench_rtt_t *rtt, uint32_t us)
+{
+    rtt->count++;
+    rtt->totalUs += us;
+    if(us < rtt->minUs)
+    {
+        rtt->minUs = us;
+    }
+    if(us > rtt->maxUs)
+    {
+        rtt->maxUs = us;
+    }
+    rtt->bucket[Bench_RttBucket(us)]++;
+}
+
+/******************************************************************************
+* Function Name: Bench_RttPercentile
+*******************************************************************************
+*
+* Summary:
+*  Returns a percentile of the round-trip times, the nearest rank.
+*
+* Parameters:
+*  rtt: the statistics.
+*  perMille: the percentile in tenths of a percent, 500 for the median.
+*
+* Return:
+*  Time in microseconds, 0 without samples.
+*
+******************************************************************************/
+uint32_t Bench_RttPercentile(const bench_rtt_t *rtt, uint32_t perMille)
+{
+    uint32_t rank;
+    uint32_t seen = 0u;
+    uint32_t i;
+    uint32_t us;
+
+    if(rtt->count == 0u)
+    {
+        return(0u);
+    }
+    /* Rank of the sample, 1 based, rounded up */
+    rank = (uint32_t)((((uint64_t)rtt->count * perMille) + 999u) / 1000u);
+    if(rank == 0u)
+    {
+        rank = 1u;
+    }
+    for(i = 0u; i < BENCH_RTT_BUCKETS; i++)
+    {
+        seen += rtt->bucket[i];
+        if(seen >= rank)
+        {
+            break;
+        }
+    }
+    us = Bench_RttBucketMiddle(i);
+    if(us < rtt->minUs)
+    {
+        us = rtt->minUs;
+    }
+    if(us > rtt->maxUs)
+    {
+        us = rtt->maxUs;
+    }
+    return(us);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,57 @@
+/*******************************************************************************
+* File Name: bench.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the round-trip time
+*  statistics of the loopback benchmark. Times are kept in a log-linear
+*  histogram, so the memory does not grow with the length of a run.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef BENCH_H
+
+    #define BENCH_H
+
+    #include <stdint.h>
+    #include <stdbool.h>
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    /* Every power of two of microseconds is split in BENCH_RTT_SUB_BUCKETS
+     * buckets, a percentile is within half a bucket, 1.6 %, of the sample.
+     * Times from 2^BENCH_RTT_MAX_LOG2 us, 16.7 s, on share the last bucket. */
+    #define BENCH_RTT_SUB_BITS          (5u)
+    #define BENCH_RTT_SUB_BUCKETS       (1u << BENCH_RTT_SUB_BITS)
+    #define BENCH_RTT_MAX_LOG2          (24u)
+    #define BENCH_RTT_BUCKETS           ((BENCH_RTT_MAX_LOG2 - BENCH_RTT_SUB_BITS + 1u) * BENCH_RTT_SUB_BUCKETS)
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    typedef struct
+    {
+        uint32_t    count;
+        uint32_t    minUs;
+        uint32_t    maxUs;
+        uint64_t    totalUs;
+        uint32_t    bucket[BENCH_RTT_BUCKETS];
+    } bench_rtt_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void Bench_RttReset(bench_rtt_t *rtt);
+    void Bench_RttAdd(bench_rtt_t *rtt, uint32_t us);
+    uint32_t Bench_RttPercentile(const bench_rtt_t *rtt, uint32_t perMille);
+
+#endif /* BENCH_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,61 @@
+/*******************************************************************************
+* File Name: ble_dispatch.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the BLE event dispatcher.
+*  Handlers are registered per event code and found in a hash table, events
+*  without a handler go to the default handler. Every event code keeps its
+*  count and the DWT cycles of its handler, the table can be printed.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef BLE_DISPATCH_H
+
+    #define BLE_DISPATCH_H
+
+    #include "cycfg_ble.h"
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    /* Slots of the event table, a power of two. An application sees a few
+     * dozen event codes, events past a full table are not counted. */
+    #ifndef BLE_DISPATCH_SLOTS
+    #define BLE_DISPATCH_SLOTS          (64u)
+    #endif
+    #define BLE_DISPATCH_EMPTY          (0xFFFFFFFFu)
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    typedef void (*ble_dispatch_handler_t)(uint32_t event, void *eventParam);
+
+    typedef struct
+    {
+        uint32_t                event;          /* BLE_DISPATCH_EMPTY for a free slot */
+        ble_dispatch_handler_t  handler;        /* NULL: the default handler */
+        uint32_t                count;
+        uint32_t                minCycles;
+        uint32_t                maxCycles;
+        uint64_t                totalCycles;
+    } ble_dispatch_entry_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void BleDispatch_Init(ble_dispatch_handler_t defaultHandler);
+    bool BleDispatch_Register(uint32_t event, ble_dispatch_handler_t handler);
+    void BleDispatch_Event(uint32_t event, void *eventParam);
+    void BleDispatch_ResetStats(void);
+    void BleDispatch_PrintStats(void);
+
+#endif /* BLE_DISPATCH_H */
+
+/* [] END OF FILE */
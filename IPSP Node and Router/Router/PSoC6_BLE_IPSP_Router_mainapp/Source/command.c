@@ -0,0 +1,235 @@
+/*******************************************************************************
+* File Name: command.c
+*
+* Version: 1.00
+*
+* Description:
+*  This file contains the command interpreter of the debug UART. The UART RX
+*  interrupt collects the input in the ring of debug.c; Command_Process()
+*  only runs a command once its whole line is there, so the main loop never
+*  waits for a key. The line is split into words at spaces and tabs, the
+*  first word selects the command of the table and the handler gets all of
+*  them. Every line is echoed to the log before it runs, so a host script can
+*  match the output to its commands.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <string.h>
+#include "command.h"
+
+#if (DEBUG_UART_ENABLED == ENABLED)
+
+/******************************************************************************
+* Function Name: Command_KeyKnown
+*******************************************************************************
+*
+* Summary:
+*  Returns true when the argument list of a command has "key=". The key is
+*  the start of a key=value word, keyLen bytes long.
+*
+******************************************************************************/
+static bool Command_KeyKnown(const char *args, const char *key, uint32_t keyLen)
+{
+    const char *at;
+
+    for(at = args; *at != '\0'; at++)
+    {
+        if(((at == args) || (at[-1] == ' ') || (at[-1] == '[') || (at[-1] == '|')) &&
+           (strncmp(at, key, keyLen) == 0) && (at[keyLen] == '='))
+        {
+            return(true);
+        }
+    }
+    return(false);
+}
+
+/******************************************************************************
+* Function Name: Command_Process
+*******************************************************************************
+*
+* Summary:
+*  Runs the command of the next complete input line, if there is one.
+*
+* Parameters:
+*  table: the commands of the application.
+*  count: number of entries in the table.
+*
+* Return:
+*  true when a line was taken.
+*
+******************************************************************************/
+bool Command_Process(const command_t table[], uint32_t count)
+{
+    char     line[DEBUG_RX_LINE_MAX];
+    char    *argv[COMMAND_ARGS_MAX];
+    char    *word;
+    char    *eq;
+    uint32_t argc = 0u;
+    uint32_t i;
+    uint32_t n;
+
+    if(DEBUG_RX_LINE(line, sizeof(line)) == 0u)
+    {
+        return(false);
+    }
+    DEBUG_PRINTF("> %s \r\n", line);
+
+    for(word = strtok(line, " \t"); word != NULL; word = strtok(NULL, " \t"))
+    {
+        if(argc == COMMAND_ARGS_MAX)
+        {
+            DEBUG_PRINTF("Too many arguments, at most %u \r\n", (unsigned)(COMMAND_ARGS_MAX - 1u));
+            return(true);
+        }
+        argv[argc++] = word;
+    }
+    if(argc == 0u)
+    {
+        return(true);
+    }
+
+    for(i = 0u; i < count; i++)
+    {
+        if(strcmp(argv[0u], table[i].name) == 0)
+        {
+            break;
+        }
+    }
+    if(i == count)
+    {
+        DEBUG_PRINTF("Unknown command '%s', 'help' lists the commands \r\n", argv[0u]);
+        return(true);
+    }
+
+    /* A mistyped key must not quietly leave a setting at its old value */
+    for(n = 1u; n < argc; n++)
+    {
+        eq = strchr(argv[n], '=');
+        if((eq != NULL) && (Command_KeyKnown(table[i].args, argv[n], (uint32_t)(eq - argv[n])) == false))
+        {
+            DEBUG_PRINTF("Unknown argument '%s': %s %s \r\n", argv[n], table[i].name, table[i].args);
+            return(true);
+        }
+    }
+    table[i].handler(argc, argv);
+    return(true);
+}
+
+/******************************************************************************
+* Function Name: Command_Help
+*******************************************************************************
+*
+* Summary:
+*  Lists the commands of a table with their arguments.
+*
+******************************************************************************/
+void Command_Help(const command_t table[], uint32_t count)
+{
+    uint32_t i;
+
+    DEBUG_PRINTF("\r\n");
+    DEBUG_PRINTF("Available commands, each ends with Enter:\r\n");
+    for(i = 0u; i < count; i++)
+    {
+        DEBUG_PRINTF(" %s%s%s - %s\r\n", table[i].name, (table[i].args[0u] != '\0') ? " " : "",
+            table[i].args, table[i].help);
+    }
+}
+
+#endif /* (DEBUG_UART_ENABLED == ENABLED) */
+
+/******************************************************************************
+* Function Name: Command_Number
+*******************************************************************************
+*
+* Summary:
+*  Converts a decimal or, with 0x, hexadecimal word to a number.
+*
+* Return:
+*  false when the word is not a number or does not fit in 32 bits.
+*
+******************************************************************************/
+bool Command_Number(const char *text, uint32_t *value)
+{
+    uint32_t base = 10u;
+    uint32_t result = 0u;
+    uint32_t digit;
+
+    if((text[0u] == '0') && ((text[1u] == 'x') || (text[1u] == 'X')))
+    {
+        base = 16u;
+        text += 2u;
+    }
+    if(*text == '\0')
+    {
+        return(false);
+    }
+    for(; *text != '\0'; text++)
+    {
+        if((*text >= '0') && (*text <= '9'))
+        {
+            digit = (uint32_t)(*text - '0');
+        }
+        else if((base == 16u) && (*text >= 'a') && (*text <= 'f'))
+        {
+            digit = (uint32_t)(*text - 'a') + 10u;
+        }
+        else if((base == 16u) && (*text >= 'A') && (*text <= 'F'))
+        {
+            digit = (uint32_t)(*text - 'A') + 10u;
+        }
+        else
+        {
+            return(false);
+        }
+        if(result > ((UINT32_MAX - digit) / base))
+        {
+            return(false);
+        }
+        result = (result * base) + digit;
+    }
+    *value = result;
+    return(true);
+}
+
+/******************************************************************************
+* Function Name: Command_Arg
+*******************************************************************************
+*
+* Summary:
+*  Reads the number of a key=value argument. The last one counts when the
+*  key is given more than once.
+*
+* Parameters:
+*  argc, argv: the words of the command line.
+*  key: name of the argument, without the '='.
+*  value: receives the number, kept when the key is not given.
+*
+* Return:
+*  false when the value of the key is not a number.
+*
+******************************************************************************/
+bool Command_Arg(uint32_t argc, char *argv[], const char *key, uint32_t *value)
+{
+    uint32_t keyLen = (uint32_t)strlen(key);
+    uint32_t i;
+
+    for(i = 1u; i < argc; i++)
+    {
+        if((strncmp(argv[i], key, keyLen) == 0) && (argv[i][keyLen] == '='))
+        {
+            if(Command_Number(&argv[i][keyLen + 1u], value) == false)
+            {
+                return(false);
+            }
+        }
+    }
+    return(true);
+}
+
+/* [] END OF FILE */
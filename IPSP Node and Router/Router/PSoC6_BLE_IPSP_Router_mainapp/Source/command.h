@@ -0,0 +1,63 @@
+/*******************************************************************************
+* File Name: command.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the command
+*  interpreter. A command is one line on the debug UART: a name followed by
+*  words and key=value arguments, for example "bench start size=244 dur=30".
+*  Each application registers its commands in a table of its own.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef COMMAND_H
+
+    #define COMMAND_H
+
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include "debug.h"
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    /* Words of a line, the command name included; a longer line is refused */
+    #define COMMAND_ARGS_MAX            (8u)
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    typedef struct
+    {
+        const char  *name;
+        /* Arguments as shown by Command_Help(). Every key of a key=value
+         * argument must be listed here as "key=", others are refused. */
+        const char  *args;
+        const char  *help;
+        /* argv[0] is the command name, the words keep their order */
+        void        (*handler)(uint32_t argc, char *argv[]);
+    } command_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    #if (DEBUG_UART_ENABLED == ENABLED)
+        bool Command_Process(const command_t table[], uint32_t count);
+        void Command_Help(const command_t table[], uint32_t count);
+    #else
+        /* Without the debug UART there is no input */
+        #define Command_Process(table, count)   ((void)(table), (void)(count), false)
+        #define Command_Help(table, count)      ((void)(table), (void)(count))
+    #endif /* (DEBUG_UART_ENABLED == ENABLED) */
+    bool Command_Number(const char *text, uint32_t *value);
+    bool Command_Arg(uint32_t argc, char *argv[], const char *key, uint32_t *value);
+
+#endif /* COMMAND_H */
+
+/* [] END OF FILE */
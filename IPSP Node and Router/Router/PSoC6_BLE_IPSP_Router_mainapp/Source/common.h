@@ -23,8 +23,17 @@
 	#include "cy_syspm.h"
     #include "debug.h"
     #include "LED.h"
+    #include "adv_table.h"
+    #include "adv_data.h"
+    #include "iphc.h"
+    #include "credit.h"
+    #include "ble_dispatch.h"
+    #include "bench.h"
+    #include "gatt_cache.h"
+    #include "conn_time.h"
+    #include "conn_policy.h"
+    #include "command.h"
 	#define DEBUG_UART_FULL              (0)
-	#define CY_BLE_MAX_ADV_DEVICES       10u
 	#define STATE_INIT                  (0u)
 	#define STATE_CONNECTING            (1u)
 	#define STATE_DISCONNECTED          (2u)
@@ -32,17 +41,120 @@
 
 	#define TIMER_TIMEOUT               (1u)
 
+	/* 1: the Router connects the best IPSS Nodes it finds and reconnects
+	 * them on its own ('auto' switches it at runtime), 0: only on 'connect' */
+	#ifndef AUTO_CONNECT
+	#define AUTO_CONNECT                (1u)
+	#endif
+
 	#define YES                         (1u)
 	#define NO                          (0u)
 
 	/* IPSP defines */
-	#define LE_DATA_CREDITS_IPSP        (1000u)
-	/* Set the watermark to half of the total credits to be used */
-	#define LE_WATER_MARK_IPSP          (LE_DATA_CREDITS_IPSP/2u)
+	/* Credits are topped up by the credit controller, the low mark event only backs it up */
+	#define LE_WATER_MARK_IPSP          (1u)
 
 	#define L2CAP_MAX_LEN               (CY_BLE_L2CAP_MTU - 2u)
+
+	/* Loopback transmit window: number of SDUs that may wait for their echo */
+	#define LOOPBACK_WINDOW_DEFAULT     (4u)
+	#define LOOPBACK_WINDOW_MAX         (8u)
+	/* Echoes are verified as they arrive, no more than a full window can be due */
+	#define LOOPBACK_RX_BUFFERS         (LOOPBACK_WINDOW_MAX)
+	/* An outstanding SDU is declared lost this many seconds after its send */
+	#define LOOPBACK_ECHO_TIMEOUT       (2u)
+	/* Each connection runs the loopback for this many seconds, then disconnects */
+	#define LOOPBACK_DURATION           (60u)
+	/* Loopback datagrams are UDP over IPv6 between the link-local addresses of
+	 * the Router and the Node, both ports compress to 4 bits */
+	#define LOOPBACK_UDP_PORT           (0xF0B1u)
+	#define LOOPBACK_ECHO_PORT          (0xF0B7u)         /* Echo service of the Node */
+	#define LOOPBACK_HOP_LIMIT          (64u)
+	#define LOOPBACK_PAYLOAD_LEN        (IPV6_MTU - IPV6_HEADER_LEN - UDP_HEADER_LEN)
+	/* Loopback payload header: sequence number and payload length, little endian.
+	 * The rest of the payload is a pseudo-random pattern seeded from the sequence
+	 * number, so an echo is verified from its own header. */
+	#define LOOPBACK_HEADER_LEN         (4u)
+	#define LOOPBACK_PATTERN_SEED       (0x6A09E667u)
+	/* Results of the echo verification */
+	#define LOOPBACK_ECHO_OK            (0u)
+	#define LOOPBACK_ECHO_CORRUPTED     (1u)
+	#define LOOPBACK_ECHO_TRUNCATED     (2u)
+	#define LOOPBACK_ECHO_UNKNOWN       (3u)
+	/* Benchmark mode ('bench start' command): the loopback sends payloads of a
+	 * chosen length and measures for a chosen number of seconds, starting on
+	 * the first timer tick after the warm-up. The run ends with one BENCH line. */
+	#define BENCH_DURATION_DEFAULT      (60u)
+	#define BENCH_DURATION_MAX          (3600u)
+	#define BENCH_WARMUP_DEFAULT        (5u)
+	#define BENCH_WARMUP_MAX            (600u)
+	/* Entries of the command table of the debug UART */
+	#define ROUTER_COMMANDS             (11u)
 	#define SCAN_TIMER_TIMEOUT          (1u)              /* Сounts in s */
     /***************************************
+    *       Data Types
+    ***************************************/
+	/* Lookup and enabling of the Service Changed indication of a peer */
+	typedef enum
+	{
+	    SC_PHASE_IDLE,
+	    SC_PHASE_CHAR,                  /* Characteristics of the GATT service */
+	    SC_PHASE_CCCD,                  /* Descriptors of Service Changed */
+	    SC_PHASE_ENABLE                 /* CCCD write */
+	} sc_phase_t;
+
+	/* State of one IPSP connection, the table is indexed by attId */
+	typedef struct
+	{
+	    bool                                    connected;
+	    cy_stc_ble_conn_handle_t                connHandle;
+	    bool                                    l2capConnected;
+	    cy_stc_ble_l2cap_cbfc_conn_cnf_param_t  l2capParameters;
+	    credit_ctrl_t                           credit;             /* Credits of the IPSP channel */
+	    iphc_link_t                             ipLink;             /* Interface identifiers for IPHC */
+	    uint8_t                                 peerAddrType;
+	    uint8_t                                 peerAddr[CY_BLE_GAP_BD_ADDR_SIZE];  /* Key of the GATT cache */
+	    cy_stc_ble_disc_srvc_info_t             serverInfo[CY_BLE_SRVI_COUNT];      /* Service ranges of the peer */
+	    conn_time_t                             setupTime;          /* Milestones scan to first echo */
+
+	    /* Service Changed characteristic of the peer, kept in the GATT cache */
+	    sc_phase_t                              scPhase;
+	    uint16_t                                scHandle;           /* Value handle */
+	    uint16_t                                scEnd;              /* Last handle of the characteristic */
+	    uint16_t                                scCccdHandle;
+
+	    /* Requests serviced from the main loop once the stack is free */
+	    bool                                    discoveryPending;
+	    bool                                    refillPending;
+	    bool                                    serviceChangedPending;
+	    bool                                    disconnectPending;
+
+	    /* Loopback generator, verification and statistics */
+	    uint8_t                                 loopBackStarted;
+	    uint32_t                                startTime;
+	    uint16_t                                loopbackSeq;
+	    uint8_t                                 loopbackOutstanding;
+	    uint16_t                                loopbackSduLen;     /* Compressed header and payload */
+	    uint16_t                                loopbackNewestSeq;  /* Newest sequence number echoed */
+	    bool                                    loopbackEchoSeen;
+	    bool                                    loopbackInFlight[LOOPBACK_WINDOW_MAX];
+	    uint16_t                                loopbackInFlightSeq[LOOPBACK_WINDOW_MAX];
+	    uint32_t                                loopbackInFlightUs[LOOPBACK_WINDOW_MAX];   /* ConnTime_NowUs() at send */
+	    uint32_t                                loopbackRttUs;      /* Round-trip time of the last echo */
+	    uint32_t                                loopbackEchoed;
+	    uint32_t                                loopbackLost;       /* No echo before the timeout */
+	    uint32_t                                loopbackInFlightAtStop; /* No echo yet when the loopback stopped */
+	    uint32_t                                loopbackCorrupted;  /* Echo with a wrong pattern */
+	    uint32_t                                loopbackTruncated;  /* Echo shorter than the payload sent */
+	    uint32_t                                loopbackReordered;  /* Echo older than one already received */
+	    uint32_t                                loopbackUnknown;    /* Echo of no outstanding SDU */
+
+	    /* Benchmark window of the connection */
+	    bool                                    benchMeasuring;
+	    uint32_t                                benchStart;
+	} app_conn_t;
+
+    /***************************************
     *       Function Prototypes
     ***************************************/
     void HostInit(void);
@@ -0,0 +1,241 @@
+/*******************************************************************************
+* File Name: conn_policy.c
+*
+* Version: 1.00
+*
+* Description:
+*  This file contains the auto-connect policy of the Router. Candidates are
+*  the advertisers of the table (only IPSS Nodes are logged there) seen in
+*  the last CONN_POLICY_MAX_AGE seconds at CONN_POLICY_MIN_RSSI or better,
+*  that are neither connected nor waiting for their backoff. They are ranked
+*  by their average RSSI less CONN_POLICY_AGE_PENALTY per second since their
+*  last report, so a strong Node that stopped advertising loses to a weaker
+*  one that is still there.
+*
+*  Every connection that times out or ends before CONN_POLICY_STABLE_TIME
+*  doubles the backoff of its Node, up to CONN_POLICY_BACKOFF_MAX; a
+*  connection that lasted resets it to CONN_POLICY_BACKOFF_MIN. The state is
+*  kept per address in a small table of its own, so the backoff outlives the
+*  advertiser table entry of a Node that stays connected.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <string.h>
+#include "conn_policy.h"
+
+static conn_policy_peer_t           policyPeer[CONN_POLICY_PEERS];
+static conn_policy_stats_t          policyStats;
+static uint32_t                     policyUse;
+
+/******************************************************************************
+* Function Name: ConnPolicy_Find
+*******************************************************************************
+*
+* Summary:
+*  Returns the entry of an address, NULL when it has none.
+*
+******************************************************************************/
+static conn_policy_peer_t *ConnPolicy_Find(const uint8_t bdAddr[], uint8_t addrType)
+{
+    uint32_t i;
+
+    for(i = 0u; i < CONN_POLICY_PEERS; i++)
+    {
+        if((policyPeer[i].used == true) && (policyPeer[i].addr.type == addrType) &&
+           (memcmp(policyPeer[i].addr.bdAddr, bdAddr, CY_BLE_GAP_BD_ADDR_SIZE) == 0))
+        {
+            return(&policyPeer[i]);
+        }
+    }
+    return(NULL);
+}
+
+/******************************************************************************
+* Function Name: ConnPolicy_Backoff
+*******************************************************************************
+*
+* Summary:
+*  Ends the connection or connect attempt of a peer and sets its backoff. A
+*  failed attempt counts like a connection that did not last.
+*
+******************************************************************************/
+static void ConnPolicy_Backoff(conn_policy_peer_t *peer, uint32_t now, bool failed)
+{
+    uint32_t backoff = CONN_POLICY_BACKOFF_MIN;
+    uint32_t i;
+
+    peer->connected = false;
+    if((failed == false) && ((now - peer->connectedAt) >= CONN_POLICY_STABLE_TIME))
+    {
+        peer->failures = 0u;
+    }
+    else if(peer->failures < UINT8_MAX)
+    {
+        peer->failures++;
+    }
+    for(i = 0u; (i < peer->failures) && (backoff < CONN_POLICY_BACKOFF_MAX); i++)
+    {
+        backoff <<= 1u;
+    }
+    peer->retryAt = now + ((backoff < CONN_POLICY_BACKOFF_MAX) ? backoff : CONN_POLICY_BACKOFF_MAX);
+}
+
+/******************************************************************************
+* Function Name: ConnPolicy_Init
+******************************************************************************/
+void ConnPolicy_Init(void)
+{
+    memset(policyPeer, 0, sizeof(policyPeer));
+    memset(&policyStats, 0, sizeof(policyStats));
+    policyUse = 0u;
+}
+
+/******************************************************************************
+* Function Name: ConnPolicy_Select
+*******************************************************************************
+*
+* Summary:
+*  Returns the advertiser table index of the best Node to connect.
+*
+* Parameters:
+*  now: current time in s, the clock of the advertiser table.
+*
+* Return:
+*  Index of the Node, ADV_TABLE_NONE when there is no candidate.
+*
+******************************************************************************/
+uint8_t ConnPolicy_Select(uint32_t now)
+{
+    uint8_t best = ADV_TABLE_NONE;
+    int32_t bestScore = INT32_MIN;
+    int32_t score;
+    uint32_t age;
+    uint32_t i;
+
+    for(i = 0u; i < ADV_TABLE_SIZE; i++)
+    {
+        const adv_entry_t *entry = AdvTable_Get((uint8_t)i);
+        const conn_policy_peer_t *peer;
+
+        if(entry == NULL)
+        {
+            continue;
+        }
+        age = now - entry->lastSeen;
+        if((age > CONN_POLICY_MAX_AGE) || (ADV_TABLE_RSSI(entry) < CONN_POLICY_MIN_RSSI))
+        {
+            continue;
+        }
+        peer = ConnPolicy_Find(entry->addr.bdAddr, entry->addr.type);
+        if((peer != NULL) && ((peer->connected == true) || ((int32_t)(now - peer->retryAt) < 0)))
+        {
+            continue;
+        }
+        score = (int32_t)entry->rssi - ((int32_t)age * CONN_POLICY_AGE_PENALTY);
+        if(score > bestScore)
+        {
+            bestScore = score;
+            best = (uint8_t)i;
+        }
+    }
+    return(best);
+}
+
+/******************************************************************************
+* Function Name: ConnPolicy_Attempt
+*******************************************************************************
+*
+* Summary:
+*  Records a connect request. The peer stays out of the selection until
+*  ConnPolicy_Timeout() or ConnPolicy_Lost(); the least recently used entry
+*  of a peer that is not connected makes room for a new one.
+*
+******************************************************************************/
+void ConnPolicy_Attempt(const cy_stc_ble_gap_bd_addr_t *addr, uint32_t now)
+{
+    conn_policy_peer_t *peer = ConnPolicy_Find(addr->bdAddr, addr->type);
+    uint32_t i;
+
+    if(peer == NULL)
+    {
+        for(i = 0u; i < CONN_POLICY_PEERS; i++)
+        {
+            if(policyPeer[i].connected == true)
+            {
+                continue;
+            }
+            if((peer == NULL) || (policyPeer[i].used == false) || (policyPeer[i].lastUse < peer->lastUse))
+            {
+                peer = &policyPeer[i];
+                if(peer->used == false)
+                {
+                    break;
+                }
+            }
+        }
+        if(peer == NULL)
+        {
+            return;
+        }
+        memset(peer, 0, sizeof(conn_policy_peer_t));
+        peer->used = true;
+        peer->addr = *addr;
+    }
+    policyStats.attempts++;
+    peer->connected = true;
+    peer->connectedAt = now;
+    peer->lastUse = ++policyUse;
+}
+
+/******************************************************************************
+* Function Name: ConnPolicy_Timeout
+*******************************************************************************
+*
+* Summary:
+*  Records a connect request that was cancelled without a connection.
+*
+******************************************************************************/
+void ConnPolicy_Timeout(const cy_stc_ble_gap_bd_addr_t *addr, uint32_t now)
+{
+    conn_policy_peer_t *peer = ConnPolicy_Find(addr->bdAddr, addr->type);
+
+    policyStats.timeouts++;
+    if(peer != NULL)
+    {
+        ConnPolicy_Backoff(peer, now, true);
+    }
+}
+
+/******************************************************************************
+* Function Name: ConnPolicy_Lost
+*******************************************************************************
+*
+* Summary:
+*  Records the end of a connection, lost or closed by the Router.
+*
+******************************************************************************/
+void ConnPolicy_Lost(const uint8_t bdAddr[], uint8_t addrType, uint32_t now)
+{
+    conn_policy_peer_t *peer = ConnPolicy_Find(bdAddr, addrType);
+
+    if((peer != NULL) && (peer->connected == true))
+    {
+        policyStats.losses++;
+        ConnPolicy_Backoff(peer, now, false);
+    }
+}
+
+/******************************************************************************
+* Function Name: ConnPolicy_Stats
+******************************************************************************/
+const conn_policy_stats_t *ConnPolicy_Stats(void)
+{
+    return(&policyStats);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,80 @@
+/*******************************************************************************
+* File Name: conn_policy.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the auto-connect
+*  policy. The policy picks the IPSS Node to connect from the advertiser
+*  table and spaces the reconnects to a Node with an exponential backoff.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef CONN_POLICY_H
+
+    #define CONN_POLICY_H
+
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include "adv_table.h"
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    /* Nodes whose connection state and backoff are kept */
+    #ifndef CONN_POLICY_PEERS
+    #define CONN_POLICY_PEERS           (8u)
+    #endif
+    /* An advertiser not seen for longer is not a candidate, in s */
+    #define CONN_POLICY_MAX_AGE         (3u)
+    /* Weaker advertisers are not connected, in dBm */
+    #define CONN_POLICY_MIN_RSSI        (-90)
+    /* Rank penalty per second since the last report, in 1/16 dBm */
+    #define CONN_POLICY_AGE_PENALTY     (3 * 16)
+    /* A connect request without a connection is cancelled after, in s */
+    #define CONN_POLICY_CONNECT_TIMEOUT (5u)
+    /* Backoff before a reconnect: doubles with every connection that failed
+     * or was lost before it was up CONN_POLICY_STABLE_TIME, in s */
+    #define CONN_POLICY_BACKOFF_MIN     (1u)
+    #define CONN_POLICY_BACKOFF_MAX     (64u)
+    #define CONN_POLICY_STABLE_TIME     (10u)
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    typedef struct
+    {
+        bool                        used;
+        cy_stc_ble_gap_bd_addr_t    addr;
+        bool                        connected;      /* Or connecting */
+        uint8_t                     failures;       /* Short connections in a row */
+        uint32_t                    connectedAt;    /* Time of the connect request in s */
+        uint32_t                    retryAt;        /* No reconnect before, in s */
+        uint32_t                    lastUse;
+    } conn_policy_peer_t;
+
+    typedef struct
+    {
+        uint32_t    attempts;
+        uint32_t    timeouts;
+        uint32_t    losses;                         /* Connections that ended */
+    } conn_policy_stats_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void ConnPolicy_Init(void);
+    uint8_t ConnPolicy_Select(uint32_t now);
+    void ConnPolicy_Attempt(const cy_stc_ble_gap_bd_addr_t *addr, uint32_t now);
+    void ConnPolicy_Timeout(const cy_stc_ble_gap_bd_addr_t *addr, uint32_t now);
+    void ConnPolicy_Lost(const uint8_t bdAddr[], uint8_t addrType, uint32_t now);
+    const conn_policy_stats_t *ConnPolicy_Stats(void);
+
+#endif /* CONN_POLICY_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,262 @@
+/*******************************************************************************
+* File Name: conn_time.c
+*
+* Version: 1.00
+*
+* Description:
+*  This file contains the connection setup timing of the Router. The
+*  milestones are timestamped with counter 2 of the MCWDT, a free-running
+*  32-bit counter on the LFCLK that, unlike the DWT cycle counter of the CPU,
+*  keeps counting while the Router waits for the radio in deep sleep.
+*  ConnTime_NowUs() extends it to 64 bit microseconds; the counter wraps
+*  after 36 hours at 32768 Hz, the 1 s timer of the main loop reads it far
+*  more often. The resolution is one LFCLK period, about 31 us.
+*
+*  The scan milestones and the connect request come before the connection
+*  has an entry of its own. They are kept in one pending record that
+*  ConnTime_Open() moves to the connection, so a connection that did not
+*  come from a new scan has no scan phases. A milestone of a connection is
+*  kept the first time it is marked; a phase with a missing milestone is not
+*  counted.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <string.h>
+#include "conn_time.h"
+#include "cycfg_peripherals.h"
+#include "debug.h"
+
+#define CONN_TIME_BIT(m)            (1u << (uint32_t)(m))
+
+static const char * const connTimePhaseName[CONN_TIME_PHASES] =
+{
+    "scan", "select", "connect", "cbfc req", "cbfc", "discovery", "first echo", "total"
+};
+
+static conn_time_t                  connTimePending;       /* Scan and connect request */
+static conn_time_phase_t            connTimePhase[CONN_TIME_PHASES];
+static uint32_t                     connTimeLastTicks;
+static uint64_t                     connTimeTicks;
+
+/******************************************************************************
+* Function Name: ConnTime_Init
+*******************************************************************************
+*
+* Summary:
+*  Clears the statistics and starts counter 2 of the MCWDT. The other
+*  counters of the MCWDT stay disabled.
+*
+******************************************************************************/
+void ConnTime_Init(void)
+{
+    uint32_t i;
+
+    memset(&connTimePending, 0, sizeof(connTimePending));
+    for(i = 0u; i < CONN_TIME_PHASES; i++)
+    {
+        connTimePhase[i].count = 0u;
+        connTimePhase[i].minUs = UINT32_MAX;
+        connTimePhase[i].maxUs = 0u;
+        connTimePhase[i].totalUs = 0u;
+    }
+
+    (void)Cy_MCWDT_Init(MCWDT_HW, &MCWDT_config);
+    Cy_MCWDT_Enable(MCWDT_HW, CY_MCWDT_CTR2, CY_MCWDT_TWO_LF_CLK_CYCLES_DELAY);
+    connTimeLastTicks = Cy_MCWDT_GetCount(MCWDT_HW, CY_MCWDT_COUNTER2);
+    connTimeTicks = 0u;
+}
+
+/******************************************************************************
+* Function Name: ConnTime_NowUs
+*******************************************************************************
+*
+* Summary:
+*  Returns the microseconds since ConnTime_Init(), deep sleep included.
+*
+******************************************************************************/
+uint64_t ConnTime_NowUs(void)
+{
+    uint32_t ticks = Cy_MCWDT_GetCount(MCWDT_HW, CY_MCWDT_COUNTER2);
+
+    connTimeTicks += (uint32_t)(ticks - connTimeLastTicks);
+    connTimeLastTicks = ticks;
+    return((connTimeTicks * 1000000u) / CONN_TIME_LFCLK_HZ);
+}
+
+/******************************************************************************
+* Function Name: ConnTime_MarkScan
+*******************************************************************************
+*
+* Summary:
+*  Timestamps a milestone before the connection exists: the scan start, the
+*  scan state event or the connect request. A new scan start drops the
+*  milestones of the previous scan, a repeated milestone replaces the older.
+*
+******************************************************************************/
+void ConnTime_MarkScan(conn_time_milestone_t milestone)
+{
+    if(milestone == CONN_TIME_SCAN_START)
+    {
+        connTimePending.marked = 0u;
+    }
+    connTimePending.us[milestone] = ConnTime_NowUs();
+    connTimePending.marked |= CONN_TIME_BIT(milestone);
+}
+
+/******************************************************************************
+* Function Name: ConnTime_Open
+*******************************************************************************
+*
+* Summary:
+*  Starts the timing of a connection with the pending scan and connect
+*  request milestones and marks its GATT connection.
+*
+******************************************************************************/
+void ConnTime_Open(conn_time_t *time)
+{
+    *time = connTimePending;
+    time->reported = false;
+    connTimePending.marked = 0u;
+    ConnTime_Mark(time, CONN_TIME_GATT_CONNECT);
+}
+
+/******************************************************************************
+* Function Name: ConnTime_Mark
+*******************************************************************************
+*
+* Summary:
+*  Timestamps a milestone of a connection, unless it already has one.
+*
+******************************************************************************/
+void ConnTime_Mark(conn_time_t *time, conn_time_milestone_t milestone)
+{
+    if((time->marked & CONN_TIME_BIT(milestone)) == 0u)
+    {
+        time->us[milestone] = ConnTime_NowUs();
+        time->marked |= CONN_TIME_BIT(milestone);
+    }
+}
+
+/******************************************************************************
+* Function Name: ConnTime_Phase
+*******************************************************************************
+*
+* Summary:
+*  Adds the time between two milestones to the statistics of a phase.
+*
+* Return:
+*  The time in us, UINT32_MAX when a milestone is missing or out of order.
+*
+******************************************************************************/
+static uint32_t ConnTime_Phase(const conn_time_t *time, uint32_t phase,
+                               conn_time_milestone_t from, conn_time_milestone_t to)
+{
+    conn_time_phase_t *stats = &connTimePhase[phase];
+    uint64_t us;
+
+    if(((time->marked & CONN_TIME_BIT(from)) == 0u) || ((time->marked & CONN_TIME_BIT(to)) == 0u) ||
+       (time->us[to] < time->us[from]))
+    {
+        return(UINT32_MAX);
+    }
+    us = time->us[to] - time->us[from];
+    if(us >= UINT32_MAX)
+    {
+        us = UINT32_MAX - 1u;
+    }
+    stats->count++;
+    stats->totalUs += us;
+    if(us < stats->minUs)
+    {
+        stats->minUs = (uint32_t)us;
+    }
+    if(us > stats->maxUs)
+    {
+        stats->maxUs = (uint32_t)us;
+    }
+    return((uint32_t)us);
+}
+
+/******************************************************************************
+* Function Name: ConnTime_Report
+*******************************************************************************
+*
+* Summary:
+*  Marks the first echo of a connection, prints the phases of its setup and
+*  adds them to the statistics. Only the first call of a connection counts.
+*
+* Parameters:
+*  time: timing of the connection.
+*  id: printed with the phases, the attId of the connection.
+*
+******************************************************************************/
+void ConnTime_Report(conn_time_t *time, uint8_t id)
+{
+    uint32_t us;
+    uint32_t i;
+
+    if(time->reported == true)
+    {
+        return;
+    }
+    time->reported = true;
+    ConnTime_Mark(time, CONN_TIME_FIRST_ECHO);
+
+    DEBUG_PRINTF("Setup %d, us:", id);
+    for(i = 0u; i < CONN_TIME_PHASES; i++)
+    {
+        if(i == CONN_TIME_PHASE_TOTAL)
+        {
+            us = ConnTime_Phase(time, i, CONN_TIME_CONNECT, CONN_TIME_FIRST_ECHO);
+        }
+        else
+        {
+            us = ConnTime_Phase(time, i, (conn_time_milestone_t)i, (conn_time_milestone_t)(i + 1u));
+        }
+        if(us == UINT32_MAX)
+        {
+            DEBUG_PRINTF(" %s=-", connTimePhaseName[i]);
+        }
+        else
+        {
+            DEBUG_PRINTF(" %s=%lu", connTimePhaseName[i], (unsigned long)us);
+        }
+    }
+    DEBUG_PRINTF(" \r\n");
+}
+
+/******************************************************************************
+* Function Name: ConnTime_PrintStats
+*******************************************************************************
+*
+* Summary:
+*  Prints the min/mean/max of every setup phase over all connections; total
+*  is the time from the connect request to the first echo.
+*
+******************************************************************************/
+void ConnTime_PrintStats(void)
+{
+    uint32_t i;
+
+    DEBUG_PRINTF("Setup phases: \r\n");
+    DEBUG_PRINTF("  phase        count      min us     mean us      max us \r\n");
+    for(i = 0u; i < CONN_TIME_PHASES; i++)
+    {
+        const conn_time_phase_t *stats = &connTimePhase[i];
+
+        if(stats->count == 0u)
+        {
+            continue;
+        }
+        DEBUG_PRINTF("  %-10s %7lu %11lu %11lu %11lu \r\n", connTimePhaseName[i],
+            (unsigned long)stats->count, (unsigned long)stats->minUs,
+            (unsigned long)(stats->totalUs / stats->count), (unsigned long)stats->maxUs);
+    }
+}
+
+/* [] END OF FILE */
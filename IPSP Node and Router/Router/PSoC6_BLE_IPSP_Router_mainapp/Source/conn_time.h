@@ -0,0 +1,83 @@
+/*******************************************************************************
+* File Name: conn_time.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the connection setup
+*  timing. Every milestone from the scan start to the first echo is
+*  timestamped with a counter of the MCWDT, which keeps running in deep
+*  sleep; the phases between them are printed per connection and kept as
+*  min/mean/max over all connections.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef CONN_TIME_H
+
+    #define CONN_TIME_H
+
+    #include <stdint.h>
+    #include <stdbool.h>
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    /* LFCLK of the MCWDT, the WCO on the kit */
+    #define CONN_TIME_LFCLK_HZ          (32768u)
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    /* Milestones of a connection setup, in the order they happen */
+    typedef enum
+    {
+        CONN_TIME_SCAN_START,       /* Cy_BLE_GAPC_StartScan() accepted */
+        CONN_TIME_SCAN_STARTED,     /* CY_BLE_EVT_GAPC_SCAN_START_STOP, scanning */
+        CONN_TIME_CONNECT,          /* Cy_BLE_GAPC_ConnectDevice() accepted */
+        CONN_TIME_GATT_CONNECT,     /* CY_BLE_EVT_GATT_CONNECT_IND */
+        CONN_TIME_CBFC_REQ,         /* Cy_BLE_L2CAP_CbfcConnectReq() accepted */
+        CONN_TIME_CBFC_CNF,         /* CY_BLE_EVT_L2CAP_CBFC_CONN_CNF */
+        CONN_TIME_DISCOVERED,       /* Discovery complete or restored from the GATT cache */
+        CONN_TIME_FIRST_ECHO,       /* First verified loopback echo */
+        CONN_TIME_MILESTONES
+    } conn_time_milestone_t;
+
+    /* Phase n runs from milestone n to milestone n + 1, the last phase from
+     * the connect request to the first echo */
+    #define CONN_TIME_PHASES            (CONN_TIME_MILESTONES)
+    #define CONN_TIME_PHASE_TOTAL       (CONN_TIME_MILESTONES - 1u)
+
+    typedef struct
+    {
+        uint64_t    us[CONN_TIME_MILESTONES];
+        uint32_t    marked;             /* One bit per milestone */
+        bool        reported;
+    } conn_time_t;
+
+    typedef struct
+    {
+        uint32_t    count;
+        uint32_t    minUs;
+        uint32_t    maxUs;
+        uint64_t    totalUs;
+    } conn_time_phase_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void ConnTime_Init(void);
+    uint64_t ConnTime_NowUs(void);
+    void ConnTime_MarkScan(conn_time_milestone_t milestone);
+    void ConnTime_Open(conn_time_t *time);
+    void ConnTime_Mark(conn_time_t *time, conn_time_milestone_t milestone);
+    void ConnTime_Report(conn_time_t *time, uint8_t id);
+    void ConnTime_PrintStats(void);
+
+#endif /* CONN_TIME_H */
+
+/* [] END OF FILE */
@@ -4,8 +4,19 @@
 * Version: 1.00
 *
 * Description:
-*  This file contains functions for debug functionality.
+*  This file contains functions for debug functionality. Log lines are
+*  formatted by the caller into a ring buffer and sent by the TX FIFO level
+*  interrupt of the debug UART. The caller only pays for the formatting and
+*  the copy; a line that does not fit is dropped and counted rather than
+*  waited for.
 *
+*  With DEBUG_UART_TRACE the line is not formatted at all: the record holds
+*  the offset of the format in the trace_fmt section, a timestamp and the raw
+*  arguments, and the host decoder rebuilds the text.
+*
+*  The same interrupt moves received bytes into an RX ring and counts the
+*  line ends, so Debug_RxLine() returns at once: a line or nothing. CR, LF or
+*  both end a line, backspace and DEL erase the byte before them.
 *
 ********************************************************************************
 * Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
@@ -14,8 +25,640 @@
 * the software package with which this file was provided.
 *******************************************************************************/
 
+#include <stdarg.h>
+#include <string.h>
 #include "debug.h"
 
+#if (DEBUG_UART_ENABLED == ENABLED)
+
+#define DEBUG_LOG_MASK              (DEBUG_LOG_BUFFER_SIZE - 1u)
+#define DEBUG_RX_MASK               (DEBUG_RX_BUFFER_SIZE - 1u)
+
+/* Written by Debug_LogPut() only */
+static char                         debugLog[DEBUG_LOG_BUFFER_SIZE];
+static volatile uint32_t            debugLogHead;
+/* Written by the UART interrupt only */
+static volatile uint32_t            debugLogTail;
+
+/* Log statistics */
+static uint32_t                     debugLogLines;
+static uint32_t                     debugLogBytes;          /* Bytes queued for the UART */
+static uint32_t                     debugLogCycles;         /* CPU cycles spent in the log calls */
+static uint32_t                     debugLogDropped;        /* Lines that did not fit */
+static uint32_t                     debugLogDroppedBytes;
+static uint32_t                     debugLogUnreported;     /* Drops not yet marked in the log */
+static uint32_t                     debugLogTruncated;      /* Lines longer than DEBUG_LOG_LINE_MAX */
+static uint32_t                     debugLogPeak;           /* Highest fill in bytes */
+
+/* Written by the UART interrupt only */
+static char                         debugRx[DEBUG_RX_BUFFER_SIZE];
+static volatile uint32_t            debugRxHead;
+static volatile uint32_t            debugRxEnds;            /* Line ends received */
+static uint32_t                     debugRxOverflows;       /* Bytes that did not fit */
+/* Written by Debug_RxLine() only */
+static volatile uint32_t            debugRxTail;
+static uint32_t                     debugRxEndsRead;
+static uint32_t                     debugRxLines;
+static uint32_t                     debugRxLong;            /* Lines longer than the caller's buffer */
+
+#if (DEBUG_UART_TRACE == ENABLED)
+/* Start of the trace formats, defined by the linker */
+extern const char                   __start_trace_fmt[];
+/* Cycle counter at the last record sent */
+static uint32_t                     debugTraceCycles;
+static uint32_t                     debugTraceBadIds;       /* Formats past the 16-bit IDs, not sent */
+#endif /* (DEBUG_UART_TRACE == ENABLED) */
+
+static const cy_stc_sysint_t        debugUartIsrCfg =
+{
+    .intrSrc      = KIT_UART_IRQ,
+    .intrPriority = 7u
+};
+
+/*******************************************************************************
+* Function Name: Debug_UartIsr
+********************************************************************************
+*
+* Summary:
+*   Moves received bytes into the RX ring, then log bytes into the TX FIFO
+*   until it is full or the log is empty. The TX interrupt is disabled once
+*   the log is empty and enabled again by the next Debug_LogPut().
+*
+*******************************************************************************/
+static void Debug_UartIsr(void)
+{
+    uint32_t tail = debugLogTail;
+    uint32_t head = debugRxHead;
+    uint32_t data;
+
+    if((Cy_SCB_GetRxInterruptStatusMasked(UART_DEBUG_HW) & CY_SCB_RX_INTR_NOT_EMPTY) != 0u)
+    {
+        while((data = Cy_SCB_UART_Get(UART_DEBUG_HW)) != CY_SCB_UART_RX_NO_DATA)
+        {
+            if((head - debugRxTail) == DEBUG_RX_BUFFER_SIZE)
+            {
+                debugRxOverflows++;
+                continue;
+            }
+            debugRx[head & DEBUG_RX_MASK] = (char)data;
+            head++;
+            if((data == '\r') || (data == '\n'))
+            {
+                /* Publish the line end after its byte */
+                debugRxHead = head;
+                debugRxEnds++;
+            }
+        }
+        debugRxHead = head;
+        Cy_SCB_ClearRxInterrupt(UART_DEBUG_HW, CY_SCB_RX_INTR_NOT_EMPTY);
+    }
+
+    while((tail != debugLogHead) && (Cy_SCB_UART_Put(UART_DEBUG_HW, (uint32_t)(uint8_t)debugLog[tail & DEBUG_LOG_MASK]) != 0u))
+    {
+        tail++;
+    }
+    debugLogTail = tail;
+    if(tail == debugLogHead)
+    {
+        Cy_SCB_SetTxInterruptMask(UART_DEBUG_HW, 0u);
+    }
+    Cy_SCB_ClearTxInterrupt(UART_DEBUG_HW, CY_SCB_TX_INTR_LEVEL);
+}
+
+/*******************************************************************************
+* Function Name: Debug_LogWrite
+********************************************************************************
+*
+* Summary:
+*   Copies bytes to the head of the log, which must have room for them.
+*
+*******************************************************************************/
+static void Debug_LogWrite(uint32_t head, const char *data, uint32_t len)
+{
+    uint32_t first = DEBUG_LOG_BUFFER_SIZE - (head & DEBUG_LOG_MASK);
+
+    if(first > len)
+    {
+        first = len;
+    }
+    memcpy(&debugLog[head & DEBUG_LOG_MASK], data, first);
+    memcpy(debugLog, &data[first], len - first);
+}
+
+#if (DEBUG_UART_TRACE == ENABLED)
+/*******************************************************************************
+* Function Name: Debug_Varint
+********************************************************************************
+*
+* Summary:
+*   Writes a value as a LEB128 varint: 7 bits per byte, low bits first, the
+*   top bit set on all but the last byte.
+*
+* Return:
+*   The byte after the varint.
+*
+*******************************************************************************/
+static uint8_t *Debug_Varint(uint8_t *out, uint64_t value)
+{
+    while(value >= 0x80u)
+    {
+        *out++ = (uint8_t)(value | 0x80u);
+        value >>= 7u;
+    }
+    *out++ = (uint8_t)value;
+    return(out);
+}
+
+#endif /* (DEBUG_UART_TRACE == ENABLED) */
+
+/*******************************************************************************
+* Function Name: Debug_LogPut
+********************************************************************************
+*
+* Summary:
+*   Queues a formatted line or a trace record and starts the UART interrupt. A
+*   line that does not fit is dropped; the next line that fits is preceded by
+*   a note with the number of lines lost.
+*
+* Parameters:
+*  data: the line or record.
+*  len: its length in bytes.
+*  startCycles: cycle counter when the log call was entered.
+*
+* Return:
+*  true when the line was queued.
+*
+*******************************************************************************/
+static bool Debug_LogPut(const char *data, uint32_t len, uint32_t startCycles)
+{
+    char     note[40u];
+    uint32_t head = debugLogHead;
+    uint32_t used = head - debugLogTail;
+    uint32_t noteLen = 0u;
+
+    debugLogLines++;
+    if(debugLogUnreported != 0u)
+    {
+    #if (DEBUG_UART_TRACE == ENABLED)
+        uint8_t *out = (uint8_t *)&note[2u];
+
+        *out++ = (uint8_t)DEBUG_TRACE_ID_DROPPED;
+        *out++ = (uint8_t)(DEBUG_TRACE_ID_DROPPED >> 8u);
+        out = Debug_Varint(out, debugLogUnreported);
+        note[0u] = (char)DEBUG_TRACE_SYNC;
+        note[1u] = (char)(out - (uint8_t *)&note[2u]);
+        noteLen = (uint32_t)(out - (uint8_t *)note);
+    #else
+        noteLen = (uint32_t)snprintf(note, sizeof(note), "<%lu log lines dropped>\r\n",
+                                     (unsigned long)debugLogUnreported);
+    #endif /* (DEBUG_UART_TRACE == ENABLED) */
+    }
+    if((used + noteLen + len) > DEBUG_LOG_BUFFER_SIZE)
+    {
+        debugLogDropped++;
+        debugLogDroppedBytes += len;
+        debugLogUnreported++;
+        debugLogCycles += CYCLES_GET() - startCycles;
+        return(false);
+    }
+    if(noteLen != 0u)
+    {
+        Debug_LogWrite(head, note, noteLen);
+        head += noteLen;
+        debugLogUnreported = 0u;
+    }
+    Debug_LogWrite(head, data, len);
+    head += len;
+    used = head - debugLogTail;
+    if(used > debugLogPeak)
+    {
+        debugLogPeak = used;
+    }
+    debugLogBytes += noteLen + len;
+    debugLogCycles += CYCLES_GET() - startCycles;
+
+    /* Publish the line, then let the interrupt send it */
+    debugLogHead = head;
+    Cy_SCB_SetTxInterruptMask(UART_DEBUG_HW, CY_SCB_TX_INTR_LEVEL);
+    return(true);
+}
+
+/*******************************************************************************
+* Function Name: Debug_Init
+********************************************************************************
+*
+* Summary:
+*   Starts the debug UART with its TX and RX interrupts, and the cycle
+*   counter that times the log calls and the trace records.
+*
+*******************************************************************************/
+void Debug_Init(void)
+{
+    CYCLES_INIT();
+
+    (void) Cy_SCB_UART_Init(UART_DEBUG_HW, &KIT_UART_config, &KIT_UART_context);
+    Cy_SCB_SetTxFifoLevel(UART_DEBUG_HW, DEBUG_UART_TX_FIFO_LEVEL);
+    Cy_SCB_SetTxInterruptMask(UART_DEBUG_HW, 0u);
+    Cy_SCB_SetRxInterruptMask(UART_DEBUG_HW, CY_SCB_RX_INTR_NOT_EMPTY);
+    (void) Cy_SysInt_Init(&debugUartIsrCfg, Debug_UartIsr);
+    NVIC_EnableIRQ(debugUartIsrCfg.intrSrc);
+    Cy_SCB_UART_Enable(UART_DEBUG_HW);
+}
+
+#if (DEBUG_UART_TRACE == ENABLED)
+
+/*******************************************************************************
+* Function Name: Debug_Trace
+********************************************************************************
+*
+* Summary:
+*   Sends a trace record for a DEBUG_PRINTF() call. The format is only walked
+*   to learn the type of each argument; nothing is converted to text. An
+*   argument that does not fit in DEBUG_LOG_LINE_MAX ends the record, the
+*   decoder marks the line as truncated.
+*
+* Parameters:
+*  format: format of the line, in the trace_fmt section.
+*  ...: arguments of the format.
+*
+*******************************************************************************/
+void Debug_Trace(const char *format, ...)
+{
+    uint8_t     rec[DEBUG_LOG_LINE_MAX];
+    uint8_t    *out = &rec[4u];
+    uint8_t    *end = &rec[DEBUG_LOG_LINE_MAX - 20u];      /* Room for the largest scalar */
+    uint32_t    startCycles = CYCLES_GET();
+    uint32_t    id = (uint32_t)(format - __start_trace_fmt);
+    const char *f = format;
+    const char *str;
+    int32_t     prec;
+    int64_t     value;
+    uint64_t    uvalue;
+    uint32_t    len;
+    char        size;
+    double      real;
+    va_list     args;
+
+    if(id >= DEBUG_TRACE_ID_DROPPED)
+    {
+        /* Not a format in trace_fmt or past the reserved IDs, the linker
+         * script checks the section size */
+        debugTraceBadIds++;
+        return;
+    }
+
+    rec[0u] = DEBUG_TRACE_SYNC;
+    rec[2u] = (uint8_t)id;
+    rec[3u] = (uint8_t)(id >> 8u);
+    out = Debug_Varint(out, startCycles - debugTraceCycles);
+
+    va_start(args, format);
+    while(*f != '\0')
+    {
+        if(*f++ != '%')
+        {
+            continue;
+        }
+        if(*f == '%')
+        {
+            f++;
+            continue;
+        }
+        if(out > end)
+        {
+            debugLogTruncated++;
+            break;
+        }
+
+        /* Flags and width */
+        while((*f == '-') || (*f == '+') || (*f == ' ') || (*f == '#') || (*f == '0'))
+        {
+            f++;
+        }
+        if(*f == '*')
+        {
+            out = Debug_Varint(out, DEBUG_TRACE_ZIGZAG(va_arg(args, int)));
+            f++;
+        }
+        while((*f >= '0') && (*f <= '9'))
+        {
+            f++;
+        }
+
+        /* Precision, it also limits the length of a string */
+        prec = -1;
+        if(*f == '.')
+        {
+            f++;
+            prec = 0;
+            if(*f == '*')
+            {
+                prec = va_arg(args, int);
+                out = Debug_Varint(out, DEBUG_TRACE_ZIGZAG(prec));
+                f++;
+            }
+            while((*f >= '0') && (*f <= '9'))
+            {
+                prec = (prec * 10) + (*f++ - '0');
+            }
+        }
+
+        /* Length modifier, "ll" is kept as 'q'. Arguments of 'h' are passed
+         * as int. */
+        size = '\0';
+        while((*f == 'h') || (*f == 'l') || (*f == 'j') || (*f == 'z') || (*f == 't'))
+        {
+            if(*f != 'h')
+            {
+                size = ((size == 'l') && (*f == 'l')) ? 'q' : *f;
+            }
+            f++;
+        }
+
+        switch(*f++)
+        {
+            case 'd':
+            case 'i':
+                switch(size)
+                {
+                    case 'l':   value = va_arg(args, long);         break;
+                    case 'q':   value = va_arg(args, long long);    break;
+                    case 'j':   value = va_arg(args, intmax_t);     break;
+                    case 'z':
+                    case 't':   value = va_arg(args, ptrdiff_t);    break;
+                    default:    value = va_arg(args, int);          break;
+                }
+                out = Debug_Varint(out, DEBUG_TRACE_ZIGZAG(value));
+                break;
+
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'c':
+                switch(size)
+                {
+                    case 'l':   uvalue = va_arg(args, unsigned long);       break;
+                    case 'q':   uvalue = va_arg(args, unsigned long long);  break;
+                    case 'j':   uvalue = va_arg(args, uintmax_t);           break;
+                    case 'z':
+                    case 't':   uvalue = va_arg(args, size_t);              break;
+                    default:    uvalue = va_arg(args, unsigned int);        break;
+                }
+                out = Debug_Varint(out, uvalue);
+                break;
+
+            case 'p':
+                out = Debug_Varint(out, (uintptr_t)va_arg(args, void *));
+                break;
+
+            case 's':
+                str = va_arg(args, const char *);
+                len = (uint32_t)(&rec[DEBUG_LOG_LINE_MAX] - out) - 2u;
+                if((prec >= 0) && ((uint32_t)prec < len))
+                {
+                    len = (uint32_t)prec;
+                }
+                len = (str != NULL) ? (uint32_t)strnlen(str, len) : 0u;
+                out = Debug_Varint(out, len);
+                memcpy(out, str, len);
+                out += len;
+                break;
+
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                real = va_arg(args, double);
+                memcpy(out, &real, sizeof(real));
+                out += sizeof(real);
+                break;
+
+            default:
+                /* Not an argument the decoder knows, it stops here as well */
+                f = "";
+                break;
+        }
+    }
+    va_end(args);
+
+    rec[1u] = (uint8_t)(out - &rec[2u]);
+    if(Debug_LogPut((const char *)rec, (uint32_t)(out - rec), startCycles) == true)
+    {
+        /* A dropped record takes no time, the next one carries it */
+        debugTraceCycles = startCycles;
+    }
+}
+
+#else
+
+/*******************************************************************************
+* Function Name: Debug_Printf
+********************************************************************************
+*
+* Summary:
+*   Formats a log line into the ring buffer. Lines longer than
+*   DEBUG_LOG_LINE_MAX are cut and still end the line.
+*
+*******************************************************************************/
+void Debug_Printf(const char *format, ...)
+{
+    char     line[DEBUG_LOG_LINE_MAX];
+    uint32_t startCycles = CYCLES_GET();
+    int      len;
+    va_list  args;
+
+    va_start(args, format);
+    len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if(len <= 0)
+    {
+        return;
+    }
+    if((uint32_t)len >= sizeof(line))
+    {
+        debugLogTruncated++;
+        len = (int)(sizeof(line) - 1u);
+        line[len - 2] = '\r';
+        line[len - 1] = '\n';
+    }
+    (void)Debug_LogPut(line, (uint32_t)len, startCycles);
+}
+
+#endif /* (DEBUG_UART_TRACE == ENABLED) */
+
+/*******************************************************************************
+* Function Name: Debug_PrintData
+********************************************************************************
+*
+* Summary:
+*   Logs a buffer as hex bytes. A trace record carries the raw bytes and the
+*   decoder prints them in hex.
+*
+*******************************************************************************/
+void Debug_PrintData(const uint8_t *data, uint32_t len)
+{
+#if (DEBUG_UART_TRACE == ENABLED)
+    uint8_t  rec[DEBUG_LOG_LINE_MAX];
+    uint32_t startCycles;
+    uint32_t chunk;
+
+    while(len != 0u)
+    {
+        startCycles = CYCLES_GET();
+        chunk = (len < (DEBUG_LOG_LINE_MAX - 4u)) ? len : (DEBUG_LOG_LINE_MAX - 4u);
+        rec[0u] = DEBUG_TRACE_SYNC;
+        rec[1u] = (uint8_t)(chunk + 2u);
+        rec[2u] = (uint8_t)DEBUG_TRACE_ID_DATA;
+        rec[3u] = (uint8_t)(DEBUG_TRACE_ID_DATA >> 8u);
+        memcpy(&rec[4u], data, chunk);
+        (void)Debug_LogPut((const char *)rec, chunk + 4u, startCycles);
+        data += chunk;
+        len -= chunk;
+    }
+#else
+    static const char hex[] = "0123456789abcdef";
+    char     line[DEBUG_LOG_LINE_MAX];
+    uint32_t startCycles;
+    uint32_t chunk;
+    uint32_t i;
+
+    while(len != 0u)
+    {
+        startCycles = CYCLES_GET();
+        chunk = (len < (DEBUG_LOG_LINE_MAX / 2u)) ? len : (DEBUG_LOG_LINE_MAX / 2u);
+        for(i = 0u; i < chunk; i++)
+        {
+            line[2u * i] = hex[data[i] >> 4u];
+            line[(2u * i) + 1u] = hex[data[i] & 0x0Fu];
+        }
+        (void)Debug_LogPut(line, 2u * chunk, startCycles);
+        data += chunk;
+        len -= chunk;
+    }
+#endif /* (DEBUG_UART_TRACE == ENABLED) */
+}
+
+/*******************************************************************************
+* Function Name: Debug_TxIdle
+********************************************************************************
+*
+* Summary:
+*   Returns true when the log is empty and the UART has sent its last bit, so
+*   the device may enter deep sleep without cutting a line.
+*
+*******************************************************************************/
+bool Debug_TxIdle(void)
+{
+    return((debugLogTail == debugLogHead) && (UART_DEBUG_GET_TX_BUFF_SIZE() == 0u));
+}
+
+/*******************************************************************************
+* Function Name: Debug_RxLine
+********************************************************************************
+*
+* Summary:
+*   Takes the next complete line from the RX ring without its line end. Empty
+*   lines are skipped; a line that does not fit in the buffer is dropped and
+*   counted. A full ring without a line end is dropped as well, so the ring
+*   never stalls.
+*
+* Parameters:
+*  line: receives the line, terminated by a NUL.
+*  size: size of the buffer in bytes.
+*
+* Return:
+*  Length of the line, 0 when no complete line is waiting.
+*
+*******************************************************************************/
+uint32_t Debug_RxLine(char line[], uint32_t size)
+{
+    uint32_t tail = debugRxTail;
+    uint32_t len = 0u;
+    bool     tooLong = false;
+    char     ch;
+
+    while(debugRxEndsRead != debugRxEnds)
+    {
+        ch = debugRx[tail & DEBUG_RX_MASK];
+        tail++;
+        if((ch == '\r') || (ch == '\n'))
+        {
+            debugRxEndsRead++;
+            if(tooLong == true)
+            {
+                debugRxLong++;
+            }
+            else if(len != 0u)
+            {
+                break;
+            }
+            else
+            {
+            }
+            len = 0u;
+            tooLong = false;
+        }
+        else if((ch == '\b') || (ch == '\x7F'))
+        {
+            if(len != 0u)
+            {
+                len--;
+            }
+        }
+        else if(len < (size - 1u))
+        {
+            line[len++] = ch;
+        }
+        else
+        {
+            tooLong = true;
+        }
+    }
+    if((len == 0u) && ((debugRxHead - tail) == DEBUG_RX_BUFFER_SIZE))
+    {
+        debugRxLong++;
+        tail = debugRxHead;
+    }
+    debugRxTail = tail;
+    line[len] = '\0';
+    if(len != 0u)
+    {
+        debugRxLines++;
+    }
+    return(len);
+}
+
+/*******************************************************************************
+* Function Name: Debug_PrintStats
+********************************************************************************
+*
+* Summary:
+*   Prints the log and input counters.
+*
+*******************************************************************************/
+void Debug_PrintStats(void)
+{
+    uint32_t lines = (debugLogLines != 0u) ? debugLogLines : 1u;
+
+    DEBUG_PRINTF("Log: %lu lines, %lu bytes, %lu cycles/line, %lu dropped (%lu bytes), %lu truncated, "
+        "peak %lu of %u bytes \r\n",
+        (unsigned long)debugLogLines, (unsigned long)debugLogBytes, (unsigned long)(debugLogCycles / lines),
+        (unsigned long)debugLogDropped, (unsigned long)debugLogDroppedBytes,
+        (unsigned long)debugLogTruncated, (unsigned long)debugLogPeak, (unsigned)DEBUG_LOG_BUFFER_SIZE);
+    DEBUG_PRINTF("Input: %lu lines, %lu too long, %lu bytes lost \r\n",
+        (unsigned long)debugRxLines, (unsigned long)debugRxLong, (unsigned long)debugRxOverflows);
+#if (DEBUG_UART_TRACE == ENABLED)
+    DEBUG_PRINTF("Trace: %lu lines with a bad format ID \r\n", (unsigned long)debugTraceBadIds);
+#endif /* (DEBUG_UART_TRACE == ENABLED) */
+}
+
+#endif /* (DEBUG_UART_ENABLED == ENABLED) */
+
 /*******************************************************************************
 * Function Name: ShowError()
 ********************************************************************************
@@ -5,7 +5,10 @@
 *
 * Description:
 *  Contains the function prototypes and constants available to the code example
-*  for debugging purposes.
+*  for debugging purposes. DEBUG_PRINTF formats into a ring buffer that the
+*  UART TX interrupt drains, so logging does not wait for the UART. With
+*  DEBUG_UART_TRACE it writes tokenized binary records instead of text. The
+*  UART RX interrupt fills a second ring that DEBUG_RX_LINE reads by lines.
 *
 ********************************************************************************
 * Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
@@ -31,6 +34,44 @@
     ***************************************/
     #define DEBUG_UART_ENABLED          ENABLED
 
+    /* Log ring buffer size in bytes, a power of two. Lines that do not fit are
+     * dropped and counted. */
+    #ifndef DEBUG_LOG_BUFFER_SIZE
+    #define DEBUG_LOG_BUFFER_SIZE       (2048u)
+    #endif
+    /* Longest line, longer lines are truncated */
+    #define DEBUG_LOG_LINE_MAX          (160u)
+    /* The TX interrupt refills the FIFO when fewer entries than this are left */
+    #define DEBUG_UART_TX_FIFO_LEVEL    (8u)
+    /* RX ring buffer size in bytes, a power of two. Bytes that do not fit are
+     * dropped and counted. */
+    #ifndef DEBUG_RX_BUFFER_SIZE
+    #define DEBUG_RX_BUFFER_SIZE        (256u)
+    #endif
+    /* Longest input line, longer lines are dropped */
+    #define DEBUG_RX_LINE_MAX           (96u)
+
+    /* Tokenized trace: DEBUG_PRINTF sends the offset of its format in the
+     * trace_fmt section and the raw arguments instead of the text. The host
+     * decoder (HostSim/build/trace_decode) rebuilds the text from the ELF file.
+     * A terminal shows binary data in this mode. */
+    #ifndef DEBUG_UART_TRACE
+    #define DEBUG_UART_TRACE            DISABLED
+    #endif
+
+    /* Trace record: DEBUG_TRACE_SYNC, length of the rest of the record, the
+     * format ID (16 bit, little endian), the DWT cycles since the previous
+     * record and the arguments in format order. Integers are LEB128 varints,
+     * signed ones zigzag coded; '*' widths and precisions come before their
+     * argument; strings are a varint length and the bytes; doubles are 8 raw
+     * bytes. The two records with a reserved ID carry no timestamp. */
+    #define DEBUG_TRACE_SYNC            (0xA5u)
+    #define DEBUG_TRACE_ID_DATA         (0xFFFFu)   /* Raw bytes, shown in hex */
+    #define DEBUG_TRACE_ID_DROPPED      (0xFFFEu)   /* Varint count of records dropped */
+    #define DEBUG_TRACE_ZIGZAG(value)   ((((uint64_t)(int64_t)(value)) << 1u) ^ \
+                                         ((uint64_t)(((int64_t)(value)) >> 63u)))
+    #define DEBUG_TRACE_SECTION         __attribute__((section("trace_fmt"), used))
+
     /***************************************
     *        External Function Prototypes
     ***************************************/
@@ -41,6 +82,11 @@
     ***************************************/
 	#define UART_DEBUG_HW		KIT_UART_HW
 
+    /* DWT cycle counter of the CPU. It times code only: it stops in deep sleep. */
+    #define CYCLES_INIT()               do { CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; \
+                                             DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; } while(0)
+    #define CYCLES_GET()                (DWT->CYCCNT)
+
     #if (DEBUG_UART_ENABLED == ENABLED)
 
 		/** The instance-specific context structure.
@@ -50,22 +96,39 @@
 		*/
 		cy_stc_scb_uart_context_t KIT_UART_context;
 
-        __STATIC_INLINE void UART_DEBUG_START(void)
-        {
-            (void) Cy_SCB_UART_Init(KIT_UART_HW, &KIT_UART_config, &KIT_UART_context);
-            Cy_SCB_UART_Enable(UART_DEBUG_HW);
-        }
-
-        #define DEBUG_PRINTF(...)               (printf(__VA_ARGS__))
+        void Debug_Init(void);
+        void Debug_Printf(const char *format, ...);
+        void Debug_Trace(const char *format, ...);
+        void Debug_PrintData(const uint8_t *data, uint32_t len);
+        bool Debug_TxIdle(void);
+        uint32_t Debug_RxLine(char line[], uint32_t size);
+        void Debug_PrintStats(void);
+
+        #define UART_DEBUG_START()              Debug_Init()
+
+        #if (DEBUG_UART_TRACE == ENABLED)
+            /* The format must be a string literal, it is stored only once */
+            #define DEBUG_PRINTF(format, ...)   do { static const char DEBUG_TRACE_SECTION debugFormat[] = format; \
+                                                     Debug_Trace(debugFormat, ##__VA_ARGS__); } while(0)
+        #else
+            #define DEBUG_PRINTF(...)           (Debug_Printf(__VA_ARGS__))
+        #endif /* (DEBUG_UART_TRACE == ENABLED) */
+        /* Logs a buffer in hex */
+        #define DEBUG_PRINT_DATA(data, len)     (Debug_PrintData((data), (len)))
 
         #define UART_DEBUG_GET_TX_BUFF_SIZE(...)  (Cy_SCB_GetNumInTxFifo(UART_DEBUG_HW) + Cy_SCB_GetTxSrValid(UART_DEBUG_HW))
 
-        #define DEBUG_WAIT_UART_TX_COMPLETE()     while(UART_DEBUG_GET_TX_BUFF_SIZE() != 0);
-		#define UART_DEB_GET_CHAR(...)          Cy_SCB_UART_Get(UART_DEBUG_HW)
+        /* Log output still to be sent, deep sleep would stop the UART */
+        #define DEBUG_UART_TX_IDLE()            (Debug_TxIdle())
+        #define DEBUG_WAIT_UART_TX_COMPLETE()     while(Debug_TxIdle() == false);
+        #define DEBUG_PRINT_LOG_STATS()         (Debug_PrintStats())
+        /* Next complete input line, 0 when there is none */
+        #define DEBUG_RX_LINE(line, size)       (Debug_RxLine((line), (size)))
     #else
         #define UART_DEBUG_START()
 
         #define DEBUG_PRINTF(...)
+        #define DEBUG_PRINT_DATA(data, len)
 
         #ifndef UART_DEBUG_GET_TX_FIFO_SR_VALID
             #define UART_DEBUG_GET_TX_FIFO_SR_VALID   (0u)
@@ -73,11 +136,12 @@
 
         #define UART_DEBUG_GET_TX_BUFF_SIZE(...)      (0u)
 
+        #define DEBUG_UART_TX_IDLE()                  (true)
         #define DEBUG_WAIT_UART_TX_COMPLETE()
-		#define UART_DEB_GET_CHAR(...)
+        #define DEBUG_PRINT_LOG_STATS()
+        #define DEBUG_RX_LINE(line, size)             (0u)
     #endif /* (DEBUG_UART_ENABLED == ENABLED) */
 
-	#define UART_DEB_NO_DATA                (char8) CY_SCB_UART_RX_NO_DATA
 #endif
 
 /* [] END OF FILE */
@@ -20,20 +20,42 @@
 *******************************************************************************/
 
 uint16_t                                    connIntv;                    /* in milliseconds / 1.25ms */
-bool                                        l2capConnected = false;
-cy_stc_ble_l2cap_cbfc_conn_cnf_param_t      l2capParameters;
-cy_stc_ble_conn_handle_t                    appConnHandle;
-cy_stc_ble_gap_bd_addr_t                    peerAddr[CY_BLE_MAX_ADV_DEVICES];
+app_conn_t                                  appConn[CY_BLE_CONN_COUNT];
+cy_stc_ble_conn_handle_t                    appConnHandle;               /* Connection selected for UART commands */
 volatile uint32_t                           mainTimer = 1u;
-uint8_t                                     advDevices = 0u;
 uint8_t                                     deviceN = 0u;
 uint8_t                                     state = STATE_INIT;
-static uint16_t                             ipv6LoopbackBuffer[L2CAP_MAX_LEN/2];
-uint8_t                                     custom_command = 0u;
+static uint8_t                              ipv6LoopbackBuffer[IPHC_MAX_HEADER_LEN + LOOPBACK_PAYLOAD_LEN];
+uint8_t                                     loopbackWindow = LOOPBACK_WINDOW_DEFAULT;
+uint8_t                                     loopbackActive = 0u;         /* Connections running the loopback */
+uint8_t                                     loopbackNodes = 0u;          /* Connections finished in this run */
+uint32_t                                    loopbackTotalStart;
+uint32_t                                    loopbackTotalEchoed = 0u;
+uint32_t                                    loopbackTotalLost = 0u;
+uint32_t                                    loopbackTotalInFlight = 0u;  /* Sent, not yet echoed at the stop */
+uint16_t                                    loopbackPayloadLen = LOOPBACK_PAYLOAD_LEN;
+/* Benchmark mode and the statistics of its run */
+bool                                        benchMode = false;
+uint32_t                                    benchDuration = BENCH_DURATION_DEFAULT;
+uint32_t                                    benchWarmup = BENCH_WARMUP_DEFAULT;
+uint8_t                                     benchConns;                  /* Connections that opened their window */
+uint32_t                                    benchFirst;                  /* Tick the first window opened */
+uint32_t                                    benchLast;                   /* Tick the last window closed */
+uint32_t                                    benchEchoed;
+uint32_t                                    benchLost;
+uint32_t                                    benchInFlight;
+uint32_t                                    benchErrors;
+uint64_t                                    benchBytes;
+bench_rtt_t                                 benchRtt;
+static const command_t                      routerCommand[ROUTER_COMMANDS];  /* Defined with the handlers */
+/* Auto-connect policy and the connect request in flight */
+bool                                        autoConnect = (AUTO_CONNECT != 0u);
+bool                                        autoConnectCheck = false;    /* A report or tick since the last selection */
+bool                                        connectPending = false;
+uint32_t                                    connectStart;
+cy_stc_ble_gap_bd_addr_t                    connectAddr;
 cy_stc_ble_timer_info_t                     timerParam = { .timeout = TIMER_TIMEOUT };
 volatile uint32_t									totalTime=0;
-volatile uint32_t									startTime;
-uint8_t 									loopBackStarted=0;
 
 /* BLESS interrupt configuration structure */
 const cy_stc_sysint_t  blessIsrCfg =
@@ -50,51 +72,1014 @@ const cy_stc_sysint_t  blessIsrCfg =
 *        Function prototypes
 *******************************************************************************/
 void StackEventHandler(uint32 event, void* eventParam);
+static void L2capDataReadHandler(uint32 event, void* eventParam);
+static void L2capRxCreditHandler(uint32 event, void* eventParam);
+static void L2capTxCreditHandler(uint32 event, void* eventParam);
+static void L2capDataWriteHandler(uint32 event, void* eventParam);
+void LoopbackBenchReport(void);
+void GattCacheReport(void);
 void EnterLowPowerMode(void);
 
 /******************************************************************************
-* Function Name: CheckAdvPacketForServiceUuid
+* Function Name: AppConnByCid
 *******************************************************************************
 *
 * Summary:
-*  This function parses advertising packet and returns nonzero value
-*  when the packet contains service UUID equal to input parameter.
+*  Returns the connection that owns the local L2CAP channel ID.
 *
 * Parameters:
-*  eventParam: the pointer to a data structure specified by the event.
-*  uuid: 16-bit UUID of the service.
+*  lCid: local CID of the L2CAP channel.
 *
 * Return:
-*  Nonzero value when the advertising packet contains service UUID.
+*  Pointer to the connection entry, NULL when no connection uses the CID.
 *
 ******************************************************************************/
-uint32_t CheckAdvPacketForServiceUuid(cy_stc_ble_gapc_adv_report_param_t *eventParam, uint16_t uuid)
+app_conn_t *AppConnByCid(uint16_t lCid)
 {
-    uint32_t servicePresent = NO;
-    uint32_t advIndex = 0u;
     uint32_t i;
 
-    do
+    for(i = 0u; i < CY_BLE_CONN_COUNT; i++)
     {
-        /* Find complete or incomplete Service UUID list field type. */
-        if((eventParam->data[advIndex + 1u] == (uint8)CY_BLE_GAP_ADV_INCOMPL_16UUID) ||
-           (eventParam->data[advIndex + 1u] == (uint8)CY_BLE_GAP_ADV_COMPL_16UUID))
+        if((appConn[i].l2capConnected == true) && (appConn[i].l2capParameters.lCid == lCid))
         {
-            /* Compare uuid values with input parameter */
-            for(i = 0u; (i < (eventParam->data[advIndex] - 1u)) && (servicePresent == NO); i += sizeof(uint16))
+            return(&appConn[i]);
+        }
+    }
+    return(NULL);
+}
+
+/******************************************************************************
+* Function Name: AppConnByBdHandle
+*******************************************************************************
+*
+* Summary:
+*  Returns the connection that owns the BD handle. A connected entry is found
+*  from its stored handle, since the stack releases the attId of a link on
+*  CY_BLE_EVT_GATT_DISCONNECT_IND before CY_BLE_EVT_GAP_DEVICE_DISCONNECTED.
+*  Before CY_BLE_EVT_GATT_CONNECT_IND the entry is taken from the attId the
+*  stack reports for the handle.
+*
+* Parameters:
+*  bdHandle: BD handle of the link.
+*
+* Return:
+*  Pointer to the connection entry, NULL when no connection uses the handle.
+*
+******************************************************************************/
+app_conn_t *AppConnByBdHandle(uint8_t bdHandle)
+{
+    cy_stc_ble_conn_handle_t connHandle;
+    uint32_t i;
+
+    for(i = 0u; i < CY_BLE_CONN_COUNT; i++)
+    {
+        if((appConn[i].connected == true) && (appConn[i].connHandle.bdHandle == bdHandle))
+        {
+            return(&appConn[i]);
+        }
+    }
+
+    connHandle = Cy_BLE_GetConnHandleByBdHandle(bdHandle);
+    if((connHandle.attId >= CY_BLE_CONN_COUNT) || (appConn[connHandle.attId].connected == true))
+    {
+        return(NULL);
+    }
+    return(&appConn[connHandle.attId]);
+}
+
+/******************************************************************************
+* Function Name: LoopbackPrngSeed
+*******************************************************************************
+*
+* Summary:
+*  Returns the xorshift32 state that generates the pattern of a sequence
+*  number. The state must not be zero.
+*
+******************************************************************************/
+static uint32_t LoopbackPrngSeed(uint16_t seq)
+{
+    uint32_t state = ((uint32_t)seq * 0x9E3779B1u) ^ LOOPBACK_PATTERN_SEED;
+
+    return((state != 0u) ? state : LOOPBACK_PATTERN_SEED);
+}
+
+/******************************************************************************
+* Function Name: LoopbackPrngNext
+******************************************************************************/
+static uint32_t LoopbackPrngNext(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13u;
+    x ^= x >> 17u;
+    x ^= x << 5u;
+    *state = x;
+    return(x);
+}
+
+/******************************************************************************
+* Function Name: LoopbackBuild
+*******************************************************************************
+*
+* Summary:
+*  Builds the loopback payload for a sequence number: the header with the
+*  sequence number and the payload length, followed by the pseudo-random
+*  pattern of the sequence number.
+*
+* Parameters:
+*  buffer: receives the payload.
+*  seq: sequence number of the payload.
+*  length: length of the payload, at least LOOPBACK_HEADER_LEN.
+*
+******************************************************************************/
+void LoopbackBuild(uint8_t buffer[], uint16_t seq, uint16_t length)
+{
+    uint32_t state = LoopbackPrngSeed(seq);
+    uint32_t word = 0u;
+    uint32_t i;
+
+    buffer[0u] = (uint8_t)seq;
+    buffer[1u] = (uint8_t)(seq >> 8u);
+    buffer[2u] = (uint8_t)length;
+    buffer[3u] = (uint8_t)(length >> 8u);
+    for(i = LOOPBACK_HEADER_LEN; i < length; i++)
+    {
+        if(((i - LOOPBACK_HEADER_LEN) & 3u) == 0u)
+        {
+            word = LoopbackPrngNext(&state);
+        }
+        buffer[i] = (uint8_t)word;
+        word >>= 8u;
+    }
+}
+
+/******************************************************************************
+* Function Name: LoopbackHeader
+*******************************************************************************
+*
+* Summary:
+*  Fills the IPv6 and UDP headers of a loopback datagram from the Router to
+*  the Node of the connection. Both addresses are link-local and derived from
+*  the BD addresses, so IPHC elides them.
+*
+******************************************************************************/
+void LoopbackHeader(const app_conn_t *conn, iphc_header_t *hdr)
+{
+    memset(hdr, 0, sizeof(iphc_header_t));
+    hdr->nextHeader = IPV6_NEXT_HEADER_UDP;
+    hdr->hopLimit = LOOPBACK_HOP_LIMIT;
+    Iphc_LinkLocal(hdr->src, conn->ipLink.ownIid);
+    Iphc_LinkLocal(hdr->dst, conn->ipLink.peerIid);
+    hdr->payloadLength = UDP_HEADER_LEN + loopbackPayloadLen;
+    hdr->srcPort = LOOPBACK_UDP_PORT;
+    hdr->dstPort = LOOPBACK_ECHO_PORT;
+}
+
+/******************************************************************************
+* Function Name: LoopbackDatagram
+*******************************************************************************
+*
+* Summary:
+*  Builds the loopback datagram for a sequence number in ipv6LoopbackBuffer.
+*  The payload is written after room for the longest compressed header, and
+*  the compressed header is placed right in front of it once the UDP checksum
+*  is known.
+*
+* Parameters:
+*  conn: the connection the datagram is sent on.
+*  seq: sequence number of the datagram.
+*  length: receives the length of the SDU.
+*
+* Return:
+*  Start of the SDU.
+*
+******************************************************************************/
+uint8_t *LoopbackDatagram(const app_conn_t *conn, uint16_t seq, uint16_t *length)
+{
+    uint8_t         *payload = &ipv6LoopbackBuffer[IPHC_MAX_HEADER_LEN];
+    uint8_t         compressed[IPHC_MAX_HEADER_LEN];
+    iphc_header_t   hdr;
+    uint16_t        hdrLen;
+
+    LoopbackHeader(conn, &hdr);
+    LoopbackBuild(payload, seq, loopbackPayloadLen);
+    hdr.checksum = Iphc_UdpChecksum(&hdr, payload);
+    hdrLen = Iphc_Compress(&hdr, &conn->ipLink, compressed);
+    memcpy(payload - hdrLen, compressed, hdrLen);
+    *length = (uint16_t)(hdrLen + loopbackPayloadLen);
+    return(payload - hdrLen);
+}
+
+/******************************************************************************
+* Function Name: LoopbackStart
+*******************************************************************************
+*
+* Summary:
+*  Releases all transmit window slots of the connection, clears its loopback
+*  statistics and starts sending. The first connection to start opens a new
+*  aggregate measurement and benchmark run.
+*
+******************************************************************************/
+void LoopbackStart(app_conn_t *conn)
+{
+    memset(conn->loopbackInFlight, 0, sizeof(conn->loopbackInFlight));
+    conn->loopbackOutstanding = 0u;
+    conn->loopbackEchoed = 0u;
+    conn->loopbackLost = 0u;
+    conn->loopbackInFlightAtStop = 0u;
+    conn->loopbackCorrupted = 0u;
+    conn->loopbackTruncated = 0u;
+    conn->loopbackReordered = 0u;
+    conn->loopbackEchoSeen = false;
+    conn->loopbackUnknown = 0u;
+    conn->loopbackSduLen = 0u;
+    conn->benchMeasuring = false;
+    conn->startTime = totalTime;
+    conn->loopBackStarted = 1u;
+    conn->refillPending = true;
+
+    if(loopbackActive == 0u)
+    {
+        loopbackTotalStart = totalTime;
+        loopbackTotalEchoed = 0u;
+        loopbackTotalLost = 0u;
+        loopbackTotalInFlight = 0u;
+        loopbackNodes = 0u;
+        benchConns = 0u;
+        benchEchoed = 0u;
+        benchLost = 0u;
+        benchInFlight = 0u;
+        benchErrors = 0u;
+        benchBytes = 0u;
+        Bench_RttReset(&benchRtt);
+    }
+    loopbackActive++;
+}
+
+/******************************************************************************
+* Function Name: LoopbackStop
+*******************************************************************************
+*
+* Summary:
+*  Stops the loopback of the connection and prints its statistics. When the
+*  last connection stops, the aggregate throughput of all of them is printed,
+*  and the benchmark summary in benchmark mode. SDUs still in the window are
+*  counted apart from the lost ones: their echoes were not given the time
+*  the echo timeout allows.
+*
+******************************************************************************/
+void LoopbackStop(app_conn_t *conn)
+{
+    uint32_t distance = totalTime - conn->startTime;
+
+    if(conn->loopBackStarted == 0u)
+    {
+        return;
+    }
+    conn->loopBackStarted = 0u;
+    conn->refillPending = false;
+    if(conn->benchMeasuring == true)
+    {
+        /* Stops come in time order, the last one closes the run */
+        conn->benchMeasuring = false;
+        benchLast = totalTime;
+        benchInFlight += conn->loopbackOutstanding;
+    }
+    /* The window is closed: a late echo is unknown, it no longer matches a slot */
+    conn->loopbackInFlightAtStop = conn->loopbackOutstanding;
+    conn->loopbackOutstanding = 0u;
+    memset(conn->loopbackInFlight, 0, sizeof(conn->loopbackInFlight));
+    if(distance == 0u)
+    {
+        distance = 1u;
+    }
+    DEBUG_PRINTF("Loopback %d: window=%d, echoed=%lu, lost=%lu, in flight=%lu, corrupted=%lu, truncated=%lu, reordered=%lu, "
+        "unknown=%lu, %lu packets/s, %lu bytes/s \r\n",
+        conn->connHandle.attId, loopbackWindow, (unsigned long)conn->loopbackEchoed,
+        (unsigned long)conn->loopbackLost, (unsigned long)conn->loopbackInFlightAtStop,
+        (unsigned long)conn->loopbackCorrupted,
+        (unsigned long)conn->loopbackTruncated, (unsigned long)conn->loopbackReordered,
+        (unsigned long)conn->loopbackUnknown,
+        (unsigned long)(conn->loopbackEchoed / distance),
+        (unsigned long)((conn->loopbackEchoed * loopbackPayloadLen) / distance));
+    DEBUG_PRINTF("Loopback %d credits: granted=%lu in %lu PDUs for %lu K-frames, received=%lu, "
+        "tx stalls=%lu, stalled %lu s \r\n",
+        conn->connHandle.attId, (unsigned long)conn->credit.creditsGranted,
+        (unsigned long)conn->credit.creditPdus, (unsigned long)conn->credit.rxKframes,
+        (unsigned long)conn->credit.creditsReceived, (unsigned long)conn->credit.txStalls,
+        (unsigned long)conn->credit.txStallTicks);
+
+    loopbackTotalEchoed += conn->loopbackEchoed;
+    loopbackTotalLost += conn->loopbackLost;
+    loopbackTotalInFlight += conn->loopbackInFlightAtStop;
+    loopbackNodes++;
+    if(--loopbackActive == 0u)
+    {
+        distance = totalTime - loopbackTotalStart;
+        if(distance == 0u)
+        {
+            distance = 1u;
+        }
+        DEBUG_PRINTF("Loopback total: nodes=%d, echoed=%lu, lost=%lu, in flight=%lu, %lu packets/s, %lu bytes/s \r\n",
+            loopbackNodes, (unsigned long)loopbackTotalEchoed, (unsigned long)loopbackTotalLost,
+            (unsigned long)loopbackTotalInFlight,
+            (unsigned long)(loopbackTotalEchoed / distance),
+            (unsigned long)((loopbackTotalEchoed * loopbackPayloadLen) / distance));
+        if(benchMode == true)
+        {
+            LoopbackBenchReport();
+        }
+        DEBUG_PRINT_LOG_STATS();
+        GattCacheReport();
+        ConnTime_PrintStats();
+        BleDispatch_PrintStats();
+    }
+}
+
+/******************************************************************************
+* Function Name: LoopbackFillWindow
+*******************************************************************************
+*
+* Summary:
+*  Sends loopback SDUs to the Node of the connection until its transmit window
+*  is full, the peer runs out of credits or the stack reports busy.
+*
+******************************************************************************/
+void LoopbackFillWindow(app_conn_t *conn)
+{
+    cy_en_ble_api_result_t                  apiResult;
+    cy_stc_ble_l2cap_cbfc_tx_data_info_t    l2capCbfcTxDataParam;
+    uint8_t                                 compressed[IPHC_MAX_HEADER_LEN];
+    iphc_header_t                           hdr;
+    uint32_t                                kframes;
+    uint16_t                                slot;
+
+    if((conn->l2capConnected == false) || (conn->credit.txMps == 0u))
+    {
+        return;
+    }
+    if(conn->loopbackSduLen == 0u)
+    {
+        /* The compressed header has the same length for every datagram */
+        LoopbackHeader(conn, &hdr);
+        conn->loopbackSduLen = (uint16_t)(Iphc_Compress(&hdr, &conn->ipLink, compressed) + loopbackPayloadLen);
+    }
+    kframes = Credit_TxKframes(&conn->credit, conn->loopbackSduLen);
+
+    while((conn->loopbackOutstanding < loopbackWindow) && Credit_TxAvailable(&conn->credit, kframes))
+    {
+        if(cy_ble_busyStatus[conn->connHandle.attId] != 0u)
+        {
+            /* Retry when the stack is free again */
+            conn->refillPending = (conn->loopBackStarted != 0u);
+            break;
+        }
+        for(slot = 0u; (slot < LOOPBACK_WINDOW_MAX) && (conn->loopbackInFlight[slot] == true); slot++)
+        {
+        }
+
+        DEBUG_PRINTF("-> Cy_BLE_L2CAP_ChannelDataWrite %d #%d \r\n", conn->connHandle.attId, conn->loopbackSeq);
+        l2capCbfcTxDataParam.buffer = LoopbackDatagram(conn, conn->loopbackSeq, &l2capCbfcTxDataParam.bufferLength);
+        l2capCbfcTxDataParam.localCid = conn->l2capParameters.lCid;
+        conn->loopbackInFlightUs[slot] = (uint32_t)ConnTime_NowUs();
+        apiResult = Cy_BLE_L2CAP_ChannelDataWrite(&l2capCbfcTxDataParam);
+        if(apiResult != CY_BLE_SUCCESS)
+        {
+            DEBUG_PRINTF("Cy_BLE_L2CAP_ChannelDataWrite API Error: 0x%x \r\n", apiResult);
+            break;
+        }
+        conn->loopbackInFlight[slot] = true;
+        conn->loopbackInFlightSeq[slot] = conn->loopbackSeq;
+        conn->loopbackOutstanding++;
+        conn->loopbackSeq++;
+        Credit_TxSent(&conn->credit, kframes);
+    }
+}
+
+/******************************************************************************
+* Function Name: LoopbackExpire
+*******************************************************************************
+*
+* Summary:
+*  Releases the window slots whose SDU got no echo within
+*  LOOPBACK_ECHO_TIMEOUT of its send and counts them as lost. The other
+*  slots keep waiting for their echo.
+*
+******************************************************************************/
+void LoopbackExpire(app_conn_t *conn)
+{
+    uint32_t now = (uint32_t)ConnTime_NowUs();
+    uint32_t expired = 0u;
+    uint16_t slot;
+
+    for(slot = 0u; slot < LOOPBACK_WINDOW_MAX; slot++)
+    {
+        if((conn->loopbackInFlight[slot] == true) &&
+           ((now - conn->loopbackInFlightUs[slot]) >= (LOOPBACK_ECHO_TIMEOUT * 1000000u)))
+        {
+            conn->loopbackInFlight[slot] = false;
+            expired++;
+        }
+    }
+    if(expired == 0u)
+    {
+        return;
+    }
+    DEBUG_PRINTF("Loopback %d: %d echo(es) timed out \r\n", conn->connHandle.attId, expired);
+    conn->loopbackOutstanding -= (uint8_t)expired;
+    conn->loopbackLost += expired;
+    if(conn->benchMeasuring == true)
+    {
+        benchLost += expired;
+    }
+    conn->refillPending = true;
+}
+
+/******************************************************************************
+* Function Name: LoopbackCheckEcho
+*******************************************************************************
+*
+* Summary:
+*  Verifies an echo received from the Node and updates the statistics of the
+*  connection. The outstanding SDU is found by the sequence number in the
+*  header, and the pattern is regenerated from it while the echo is compared,
+*  so no copy of the sent payload is kept. An echo that comes back after a
+*  newer one is counted as reordered, a lost echo does not make the later
+*  ones reordered. A truncated or corrupted echo still releases its window
+*  slot. The round-trip time of the SDU is left in loopbackRttUs.
+*
+* Parameters:
+*  conn: the connection the echo was received on.
+*  data: payload of the received datagram.
+*  length: length of the payload.
+*  intact: false when the UDP checksum of the datagram did not match. The
+*   echo is then counted as corrupted unless it is truncated.
+*
+* Return:
+*  LOOPBACK_ECHO_OK, LOOPBACK_ECHO_CORRUPTED, LOOPBACK_ECHO_TRUNCATED or
+*  LOOPBACK_ECHO_UNKNOWN when the header is missing or the sequence number is
+*  not outstanding.
+*
+******************************************************************************/
+uint32_t LoopbackCheckEcho(app_conn_t *conn, const uint8_t data[], uint16_t length, bool intact)
+{
+    uint32_t state;
+    uint32_t word = 0u;
+    uint32_t i;
+    uint16_t seq;
+    uint16_t sent;
+    uint16_t slot;
+
+    if(length < LOOPBACK_HEADER_LEN)
+    {
+        /* Without a header the SDU cannot be identified, its slot times out */
+        conn->loopbackTruncated++;
+        return(LOOPBACK_ECHO_TRUNCATED);
+    }
+    seq = (uint16_t)(data[0u] | ((uint16_t)data[1u] << 8u));
+    sent = (uint16_t)(data[2u] | ((uint16_t)data[3u] << 8u));
+    for(slot = 0u; slot < LOOPBACK_WINDOW_MAX; slot++)
+    {
+        if((conn->loopbackInFlight[slot] == true) && (conn->loopbackInFlightSeq[slot] == seq))
+        {
+            break;
+        }
+    }
+    if(slot == LOOPBACK_WINDOW_MAX)
+    {
+        conn->loopbackUnknown++;
+        return(LOOPBACK_ECHO_UNKNOWN);
+    }
+
+    conn->loopbackRttUs = (uint32_t)ConnTime_NowUs() - conn->loopbackInFlightUs[slot];
+    conn->loopbackInFlight[slot] = false;
+    conn->loopbackOutstanding--;
+    if((conn->loopbackEchoSeen == true) && ((int16_t)(seq - conn->loopbackNewestSeq) < 0))
+    {
+        conn->loopbackReordered++;
+    }
+    else
+    {
+        conn->loopbackNewestSeq = seq;
+        conn->loopbackEchoSeen = true;
+    }
+
+    if((sent < LOOPBACK_HEADER_LEN) || (sent > LOOPBACK_PAYLOAD_LEN) || (length > sent))
+    {
+        conn->loopbackCorrupted++;
+        return(LOOPBACK_ECHO_CORRUPTED);
+    }
+    if(length < sent)
+    {
+        conn->loopbackTruncated++;
+        return(LOOPBACK_ECHO_TRUNCATED);
+    }
+    state = LoopbackPrngSeed(seq);
+    for(i = LOOPBACK_HEADER_LEN; i < length; i++)
+    {
+        if(((i - LOOPBACK_HEADER_LEN) & 3u) == 0u)
+        {
+            word = LoopbackPrngNext(&state);
+        }
+        if(data[i] != (uint8_t)word)
+        {
+            conn->loopbackCorrupted++;
+            return(LOOPBACK_ECHO_CORRUPTED);
+        }
+        word >>= 8u;
+    }
+    if(intact == false)
+    {
+        conn->loopbackCorrupted++;
+        return(LOOPBACK_ECHO_CORRUPTED);
+    }
+    conn->loopbackEchoed++;
+    return(LOOPBACK_ECHO_OK);
+}
+
+/******************************************************************************
+* Function Name: LoopbackBenchStart
+*******************************************************************************
+*
+* Summary:
+*  Opens the benchmark window of the connection, called on the first timer
+*  tick after the warm-up.
+*
+******************************************************************************/
+void LoopbackBenchStart(app_conn_t *conn)
+{
+    conn->benchMeasuring = true;
+    conn->benchStart = totalTime;
+    if(benchConns == 0u)
+    {
+        benchFirst = totalTime;
+    }
+    benchConns++;
+}
+
+/******************************************************************************
+* Function Name: LoopbackBenchEcho
+*******************************************************************************
+*
+* Summary:
+*  Adds an echo to the benchmark statistics when the window of its
+*  connection is open.
+*
+* Parameters:
+*  conn: the connection the echo was received on.
+*  result: result of the echo verification, LOOPBACK_ECHO_OK adds the
+*   round-trip time of the SDU.
+*
+******************************************************************************/
+void LoopbackBenchEcho(const app_conn_t *conn, uint32_t result)
+{
+    if(conn->benchMeasuring == false)
+    {
+        return;
+    }
+    if(result == LOOPBACK_ECHO_OK)
+    {
+        benchEchoed++;
+        benchBytes += loopbackPayloadLen;
+        Bench_RttAdd(&benchRtt, conn->loopbackRttUs);
+    }
+    else
+    {
+        benchErrors++;
+    }
+}
+
+/******************************************************************************
+* Function Name: LoopbackBenchReport
+*******************************************************************************
+*
+* Summary:
+*  Prints the summary of a benchmark run as one line of key=value pairs.
+*  The measured time runs from the first window that opened to the last one
+*  that closed, in whole timer ticks; goodput counts the verified payload.
+*
+******************************************************************************/
+void LoopbackBenchReport(void)
+{
+    uint32_t span = (benchConns != 0u) ? (benchLast - benchFirst) : 0u;
+    uint32_t bps = (span != 0u) ? (uint32_t)((benchBytes * 8u) / span) : 0u;
+
+    /* One line in two parts, each within DEBUG_LOG_LINE_MAX */
+    DEBUG_PRINTF("BENCH nodes=%d window=%d payload=%d warmup_s=%lu duration_s=%lu packets=%lu lost=%lu in_flight=%lu "
+        "errors=%lu goodput_kbps=%lu.%03lu",
+        benchConns, loopbackWindow, loopbackPayloadLen, (unsigned long)benchWarmup, (unsigned long)span,
+        (unsigned long)benchEchoed, (unsigned long)benchLost, (unsigned long)benchInFlight, (unsigned long)benchErrors,
+        (unsigned long)(bps / 1000u), (unsigned long)(bps % 1000u));
+    DEBUG_PRINTF(" rtt_min_us=%lu rtt_avg_us=%lu rtt_p50_us=%lu rtt_p90_us=%lu rtt_p99_us=%lu rtt_max_us=%lu \r\n",
+        (unsigned long)((benchRtt.count != 0u) ? benchRtt.minUs : 0u),
+        (unsigned long)((benchRtt.count != 0u) ? (uint32_t)(benchRtt.totalUs / benchRtt.count) : 0u),
+        (unsigned long)Bench_RttPercentile(&benchRtt, 500u), (unsigned long)Bench_RttPercentile(&benchRtt, 900u),
+        (unsigned long)Bench_RttPercentile(&benchRtt, 990u), (unsigned long)benchRtt.maxUs);
+}
+
+/******************************************************************************
+* Function Name: ConnectSelectedDevice
+*******************************************************************************
+*
+* Summary:
+*  Sends a connection request to the peer device chosen with 'select'.
+*
+******************************************************************************/
+void ConnectSelectedDevice(void)
+{
+    cy_en_ble_api_result_t apiResult;
+    adv_entry_t *peer = AdvTable_Get(deviceN);
+    uint16_t i;
+
+    if(peer == NULL)
+    {
+        DEBUG_PRINTF("Device %d not found \r\n", deviceN);
+        return;
+    }
+    DEBUG_PRINTF("Connecting to BD Address: ");
+    for(i = CY_BLE_GAP_BD_ADDR_SIZE; i > 0u; i--)
+    {
+        DEBUG_PRINTF("%2.2x", peer->addr.bdAddr[i-1]);
+    }
+    DEBUG_PRINTF(", rssi - %d dBm\r\n", ADV_TABLE_RSSI(peer));
+    apiResult = Cy_BLE_GAPC_ConnectDevice(&peer->addr, 0u);
+    if(apiResult != CY_BLE_SUCCESS)
+    {
+        DEBUG_PRINTF("ConnectDevice API Error: 0x%x \r\n", apiResult);
+    }
+    else
+    {
+        ConnTime_MarkScan(CONN_TIME_CONNECT);
+        ConnPolicy_Attempt(&peer->addr, totalTime);
+        connectPending = true;
+        connectStart = totalTime;
+        connectAddr = peer->addr;
+    }
+}
+
+/******************************************************************************
+* Function Name: AutoScan
+*******************************************************************************
+*
+* Summary:
+*  Restarts the scan in auto-connect mode while a connection is free.
+*
+******************************************************************************/
+void AutoScan(void)
+{
+    cy_en_ble_api_result_t apiResult;
+
+    if((autoConnect == false) || (connectPending == true) ||
+       (Cy_BLE_GetNumOfActiveConn() >= CY_BLE_CONN_COUNT) ||
+       (Cy_BLE_GetScanState() != CY_BLE_SCAN_STATE_STOPPED))
+    {
+        return;
+    }
+    apiResult = Cy_BLE_GAPC_StartScan(CY_BLE_SCANNING_FAST, 0u);
+    if(apiResult != CY_BLE_SUCCESS)
+    {
+        DEBUG_PRINTF("StartScan API Error: 0x%x \r\n", apiResult);
+    }
+    else
+    {
+        ConnTime_MarkScan(CONN_TIME_SCAN_START);
+    }
+}
+
+/******************************************************************************
+* Function Name: AutoConnect
+*******************************************************************************
+*
+* Summary:
+*  In auto-connect mode, picks the best Node of the scan results and stops the
+*  scan to connect it, the same way as 'connect'. A connect request that got
+*  no connection within CONN_POLICY_CONNECT_TIMEOUT is cancelled.
+*
+******************************************************************************/
+void AutoConnect(void)
+{
+    cy_en_ble_api_result_t apiResult;
+    uint8_t index;
+
+    if(autoConnect == false)
+    {
+        return;
+    }
+    if(connectPending == true)
+    {
+        if((totalTime - connectStart) >= CONN_POLICY_CONNECT_TIMEOUT)
+        {
+            apiResult = Cy_BLE_GAPC_CancelDeviceConnection();
+            DEBUG_PRINTF("Auto connect timed out, Cy_BLE_GAPC_CancelDeviceConnection: %x\r\n", apiResult);
+            connectPending = false;
+            ConnPolicy_Timeout(&connectAddr, totalTime);
+            AutoScan();
+        }
+        return;
+    }
+    if((autoConnectCheck == false) || (state == STATE_CONNECTING) ||
+       (Cy_BLE_GetScanState() != CY_BLE_SCAN_STATE_SCANNING) ||
+       (Cy_BLE_GetNumOfActiveConn() >= CY_BLE_CONN_COUNT))
+    {
+        return;
+    }
+    autoConnectCheck = false;
+    index = ConnPolicy_Select(totalTime);
+    if(index != ADV_TABLE_NONE)
+    {
+        DEBUG_PRINTF("Auto connect to device %d \r\n", index);
+        deviceN = index;
+        Cy_BLE_GAPC_StopScan();
+        state = STATE_CONNECTING;
+    }
+}
+
+/******************************************************************************
+* Function Name: DiscoveryComplete
+*******************************************************************************
+*
+* Summary:
+*  Prints the service ranges of a peer and starts the loopback, after a
+*  service discovery or with the ranges restored from the GATT cache. The
+*  ranges are taken from the connection, which has no cy_ble_serverInfo row
+*  after a cache hit (see gatt_cache.h).
+*
+******************************************************************************/
+void DiscoveryComplete(app_conn_t *conn)
+{
+    DEBUG_PRINTF("GATT %x-%x, \r\n",
+        conn->serverInfo[CY_BLE_SRVI_GATT].range.startHandle,
+        conn->serverInfo[CY_BLE_SRVI_GATT].range.endHandle);
+
+    DEBUG_PRINTF("\r\nIPSP %x-%x: ",
+        conn->serverInfo[CY_BLE_SRVI_IPSS].range.startHandle,
+        conn->serverInfo[CY_BLE_SRVI_IPSS].range.endHandle);
+    DEBUG_PRINTF("\r\n");
+    ConnTime_Mark(&conn->setupTime, CONN_TIME_DISCOVERED);
+
+    /* A discovery after Service Changed does not restart a running loopback */
+    if(conn->loopBackStarted == 0u)
+    {
+        LoopbackStart(conn);
+    }
+    /* The Service Changed lookup waits for the first echo, off its path */
+    conn->scPhase = SC_PHASE_IDLE;
+    conn->serviceChangedPending = (conn->loopbackEchoed != 0u);
+}
+
+/******************************************************************************
+* Function Name: ServiceChangedNext
+*******************************************************************************
+*
+* Summary:
+*  Enables the Service Changed indication of the peer, which a server sends
+*  only to a client that wrote its CCCD, on every connection. A peer from the
+*  GATT cache gets the CCCD write at once. Otherwise the Service Changed
+*  characteristic is looked up in the GATT service range, then its CCCD, and
+*  both handles are kept in the GATT cache. Called to start and again at the
+*  end of each discovery procedure.
+*
+******************************************************************************/
+void ServiceChangedNext(app_conn_t *conn)
+{
+    cy_stc_ble_gatt_attr_handle_range_t gattRange = conn->serverInfo[CY_BLE_SRVI_GATT].range;
+    cy_stc_ble_gattc_read_by_type_req_t charParam = { .range = gattRange, .connHandle = conn->connHandle };
+    cy_stc_ble_gattc_find_info_req_t descrParam = { .connHandle = conn->connHandle };
+    uint16_t handle[GATT_CACHE_HANDLES] = { 0u };
+    uint8_t config[2u] = { 2u, 0u };
+    cy_stc_ble_gattc_write_req_t writeParam =
+    {
+        .handleValPair.value.val  = config,
+        .handleValPair.value.len  = sizeof(config),
+        .connHandle               = conn->connHandle
+    };
+    cy_en_ble_api_result_t apiResult = CY_BLE_SUCCESS;
+
+    switch(conn->scPhase)
+    {
+        case SC_PHASE_IDLE:
+            if(conn->scCccdHandle == 0u)
             {
-                if(Cy_BLE_Get16ByPtr(&eventParam->data[advIndex + 2u + i]) == uuid)
+                if(gattRange.startHandle == 0u)
                 {
-                    servicePresent = 1u;
+                    return;
                 }
+                conn->scHandle = 0u;
+                conn->scEnd = 0u;
+                conn->scPhase = SC_PHASE_CHAR;
+                apiResult = Cy_BLE_GATTC_DiscoverCharacteristics(&charParam);
+                break;
+            }
+            conn->scPhase = SC_PHASE_ENABLE;
+            writeParam.handleValPair.attrHandle = conn->scCccdHandle;
+            apiResult = Cy_BLE_GATTC_WriteCharacteristicDescriptors(&writeParam);
+            break;
+
+        case SC_PHASE_CHAR:
+            if(conn->scEnd == 0u)
+            {
+                conn->scEnd = gattRange.endHandle;
+            }
+            conn->scPhase = SC_PHASE_IDLE;
+            if((conn->scHandle != 0u) && (conn->scHandle < conn->scEnd))
+            {
+                descrParam.range.startHandle = conn->scHandle + 1u;
+                descrParam.range.endHandle = conn->scEnd;
+                conn->scPhase = SC_PHASE_CCCD;
+                apiResult = Cy_BLE_GATTC_DiscoverCharacteristicDescriptors(&descrParam);
+            }
+            break;
+
+        case SC_PHASE_CCCD:
+            conn->scPhase = SC_PHASE_IDLE;
+            if(conn->scCccdHandle != 0u)
+            {
+                handle[0u] = conn->scHandle;
+                handle[1u] = conn->scCccdHandle;
+                GattCache_Store(conn->peerAddr, conn->peerAddrType, conn->serverInfo, handle);
+                conn->scPhase = SC_PHASE_ENABLE;
+                writeParam.handleValPair.attrHandle = conn->scCccdHandle;
+                apiResult = Cy_BLE_GATTC_WriteCharacteristicDescriptors(&writeParam);
+            }
+            break;
+
+        default:
+            break;
+    }
+    if(apiResult != CY_BLE_SUCCESS)
+    {
+        DEBUG_PRINTF("Service Changed lookup API Error: 0x%x \r\n", apiResult);
+        conn->scPhase = SC_PHASE_IDLE;
+    }
+}
+
+/******************************************************************************
+* Function Name: ServiceChangedResponse
+*******************************************************************************
+*
+* Summary:
+*  Takes the handles of the Service Changed lookup from the discovery
+*  responses. Responses to the discovery of the stack are left alone.
+*
+******************************************************************************/
+void ServiceChangedResponse(uint32_t event, void *eventParam)
+{
+    cy_stc_ble_gattc_read_by_type_rsp_param_t *chars = (cy_stc_ble_gattc_read_by_type_rsp_param_t *)eventParam;
+    cy_stc_ble_gattc_find_info_rsp_param_t *descr = (cy_stc_ble_gattc_find_info_rsp_param_t *)eventParam;
+    app_conn_t *conn;
+    const uint8_t *p;
+    uint32_t i;
+
+    if(event == CY_BLE_EVT_GATTC_READ_BY_TYPE_RSP)
+    {
+        conn = (chars->connHandle.attId < CY_BLE_CONN_COUNT) ? &appConn[chars->connHandle.attId] : NULL;
+        if((conn == NULL) || (conn->scPhase != SC_PHASE_CHAR))
+        {
+            return;
+        }
+        /* Declaration handle, properties, value handle, UUID of 16 or 128 bits */
+        for(i = 0u; (chars->attrData.attrLen >= 7u) && ((i + chars->attrData.attrLen) <= chars->attrData.length);
+            i += chars->attrData.attrLen)
+        {
+            p = &chars->attrData.attrValue[i];
+            if((conn->scHandle != 0u) && (conn->scEnd == 0u))
+            {
+                /* The next declaration ends the Service Changed characteristic */
+                conn->scEnd = (uint16_t)((p[0u] | ((uint16_t)p[1u] << 8u)) - 1u);
+            }
+            else if((conn->scHandle == 0u) && (chars->attrData.attrLen == 7u) &&
+                    ((p[5u] | ((uint16_t)p[6u] << 8u)) == CY_BLE_UUID_CHAR_SERVICE_CHANGED))
+            {
+                conn->scHandle = (uint16_t)(p[3u] | ((uint16_t)p[4u] << 8u));
             }
         }
-        advIndex += eventParam->data[advIndex] + 1u;
-    }while((advIndex < eventParam->dataLen) && (servicePresent == NO));
+    }
+    else if(event == CY_BLE_EVT_GATTC_FIND_INFO_RSP)
+    {
+        conn = (descr->connHandle.attId < CY_BLE_CONN_COUNT) ? &appConn[descr->connHandle.attId] : NULL;
+        if((conn == NULL) || (conn->scPhase != SC_PHASE_CCCD) || (descr->uuidFormat != CY_BLE_GATT_16_BIT_UUID_FORMAT))
+        {
+            return;
+        }
+        /* Handle, 16-bit UUID */
+        for(i = 0u; (i + 4u) <= descr->handleValueList.byteCount; i += 4u)
+        {
+            p = &descr->handleValueList.list[i];
+            if((conn->scCccdHandle == 0u) &&
+               ((p[2u] | ((uint16_t)p[3u] << 8u)) == CY_BLE_UUID_CHAR_CLIENT_CONFIG))
+            {
+                conn->scCccdHandle = (uint16_t)(p[0u] | ((uint16_t)p[1u] << 8u));
+            }
+        }
+    }
+    else
+    {
+    }
+}
+
+/******************************************************************************
+* Function Name: GattCacheReport
+*******************************************************************************
+*
+* Summary:
+*  Prints the hit, miss, invalidation and reject counters of the GATT cache.
+*
+******************************************************************************/
+void GattCacheReport(void)
+{
+    const gatt_cache_stats_t *stats = GattCache_Stats();
 
-    return(servicePresent);
+    DEBUG_PRINTF("GATT cache: hits=%lu, misses=%lu, stores=%lu, invalidated=%lu, rejected=%lu \r\n",
+        (unsigned long)stats->hits, (unsigned long)stats->misses,
+        (unsigned long)stats->stores, (unsigned long)stats->invalidations,
+        (unsigned long)stats->rejects);
 }
 
+/******************************************************************************
+* Function Name: ServiceConnections
+*******************************************************************************
+*
+* Summary:
+*  Runs the requests that connections left for the main loop (disconnect,
+*  service discovery, refilling the loopback window) and tops up the
+*  credits of the Node once their stack connection is not busy.
+*
+******************************************************************************/
+void ServiceConnections(void)
+{
+    cy_en_ble_api_result_t apiResult;
+    app_conn_t *conn;
+    uint32_t i;
+
+    for(i = 0u; i < CY_BLE_CONN_COUNT; i++)
+    {
+        conn = &appConn[i];
+        if((conn->connected == false) || (cy_ble_busyStatus[conn->connHandle.attId] != 0u))
+        {
+            continue;
+        }
+        if(conn->l2capConnected == true)
+        {
+            /* Echoes are verified as they arrive, every receive buffer is free */
+            apiResult = Credit_Grant(&conn->credit, conn->l2capParameters.lCid, LOOPBACK_RX_BUFFERS);
+            if(apiResult != CY_BLE_SUCCESS)
+            {
+                DEBUG_PRINTF("Cy_BLE_L2CAP_CbfcSendFlowControlCredit API Error: 0x%x \r\n", apiResult);
+            }
+        }
+        if(conn->disconnectPending == true)
+        {
+            cy_stc_ble_gap_disconnect_info_t disconnectInfoParam =
+            {
+                .bdHandle = conn->connHandle.bdHandle,
+                .reason = CY_BLE_HCI_ERROR_OTHER_END_TERMINATED_USER
+            };
+            conn->disconnectPending = false;
+            DEBUG_PRINTF("disconnect from peripheral %d\r\n", conn->connHandle.attId);
+            apiResult = Cy_BLE_GAP_Disconnect(&disconnectInfoParam);
+            if(apiResult != CY_BLE_SUCCESS)
+            {
+                DEBUG_PRINTF("DisconnectDevice API Error: 0x%x \r\n", apiResult);
+            }
+        }
+        else if(conn->discoveryPending == true)
+        {
+            uint16_t handle[GATT_CACHE_HANDLES];
+
+            conn->discoveryPending = false;
+            if(GattCache_Restore(conn->peerAddr, conn->peerAddrType, conn->serverInfo, handle) == true)
+            {
+                /* Known peer: the handles of its last discovery are used */
+                DEBUG_PRINTF("GATT cache hit %d \r\n", conn->connHandle.attId);
+                conn->scHandle = handle[0u];
+                conn->scCccdHandle = handle[1u];
+                DiscoveryComplete(conn);
+            }
+            else
+            {
+                DEBUG_PRINTF("StartDiscovery %d \r\n", conn->connHandle.attId);
+                apiResult = Cy_BLE_GATTC_StartDiscovery(conn->connHandle);
+                if(apiResult != CY_BLE_SUCCESS)
+                {
+                    DEBUG_PRINTF("StartDiscovery API Error: 0x%x \r\n", apiResult);
+                }
+            }
+        }
+        else if(conn->refillPending == true)
+        {
+            conn->refillPending = false;
+            LoopbackFillWindow(conn);
+        }
+        else if(conn->serviceChangedPending == true)
+        {
+            conn->serviceChangedPending = false;
+            ServiceChangedNext(conn);
+        }
+        else
+        {
+        }
+    }
+}
 
 /*******************************************************************************
 * Function Name: BlessInterrupt
@@ -137,12 +1122,23 @@ void HostInit(void)
     UART_DEBUG_START();
     DEBUG_PRINTF("\r\n\nPSoC 6 MCU with BLE IPSP Router \r\n");
 
+    AdvTable_Init();
+    GattCache_Init();
+    ConnTime_Init();
+    ConnPolicy_Init();
+
     /* Initialize the BLESS interrupt */
     cy_ble_config.hw->blessIsrConfig = &blessIsrCfg;
     Cy_SysInt_Init(cy_ble_config.hw->blessIsrConfig, BlessInterrupt);
 
-    /* Register the generic event handler */
-    Cy_BLE_RegisterEventCallback(StackEventHandler);
+    /* Register the event handlers: the per-SDU L2CAP events have their own,
+     * the rest go to the generic event handler */
+    BleDispatch_Init(StackEventHandler);
+    (void)BleDispatch_Register(CY_BLE_EVT_L2CAP_CBFC_DATA_READ, L2capDataReadHandler);
+    (void)BleDispatch_Register(CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND, L2capRxCreditHandler);
+    (void)BleDispatch_Register(CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND, L2capTxCreditHandler);
+    (void)BleDispatch_Register(CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND, L2capDataWriteHandler);
+    Cy_BLE_RegisterEventCallback(BleDispatch_Event);
 
     /* Initialize the BLE host */
     apiResult = Cy_BLE_Init(&cy_ble_config);
@@ -178,134 +1174,331 @@ void HostInit(void)
 
 	apiResult = Cy_BLE_GetStackLibraryVersion(&stackVersion);
 
-    if(apiResult != CY_BLE_SUCCESS)
-    {
-        DEBUG_PRINTF("Cy_BLE_GetStackLibraryVersion API Error: 0x%2.2x \r\n", apiResult);
-        ShowError();
-    }
-    else
+    if(apiResult != CY_BLE_SUCCESS)
+    {
+        DEBUG_PRINTF("Cy_BLE_GetStackLibraryVersion API Error: 0x%2.2x \r\n", apiResult);
+        ShowError();
+    }
+    else
+    {
+        DEBUG_PRINTF("Stack Version: %d.%d.%d.%d \r\n", stackVersion.majorVersion,
+            stackVersion.minorVersion, stackVersion.patch, stackVersion.buildNumber);
+    }
+
+}
+
+/*******************************************************************************
+* Function Name: CmdHelp
+********************************************************************************
+*
+* Summary:
+*   'help': lists the commands.
+*
+*******************************************************************************/
+static void CmdHelp(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    Command_Help(routerCommand, ROUTER_COMMANDS);
+}
+
+/*******************************************************************************
+* Function Name: SelectDevice
+********************************************************************************
+*
+* Summary:
+*   Takes the advertiser table index of the peer device to connect.
+*
+* Return:
+*   false when the word is not a table index.
+*
+*******************************************************************************/
+static bool SelectDevice(const char *text)
+{
+    uint32_t value;
+
+    if((Command_Number(text, &value) == false) || (value >= ADV_TABLE_SIZE))
+    {
+        DEBUG_PRINTF(" Wrong device, 0-%d \r\n", ADV_TABLE_SIZE - 1u);
+        return(false);
+    }
+    deviceN = (uint8)value;
+    DEBUG_PRINTF("Device %d selected \r\n", deviceN);
+    return(true);
+}
+
+/*******************************************************************************
+* Function Name: CmdSelect
+********************************************************************************
+*
+* Summary:
+*   'select <n>': selects the peer device.
+*
+*******************************************************************************/
+static void CmdSelect(uint32_t argc, char *argv[])
+{
+    if(argc != 2u)
+    {
+        DEBUG_PRINTF(" Usage: select <n> \r\n");
+        return;
+    }
+    (void)SelectDevice(argv[1u]);
+}
+
+/*******************************************************************************
+* Function Name: CmdConnect
+********************************************************************************
+*
+* Summary:
+*   'connect [n]': sends a connect request to the selected peer device. The
+*   scan is stopped first; the request follows its stop event.
+*
+*******************************************************************************/
+static void CmdConnect(uint32_t argc, char *argv[])
+{
+    if((argc > 2u) || ((argc == 2u) && (SelectDevice(argv[1u]) == false)))
+    {
+        return;
+    }
+    if(Cy_BLE_GetScanState() == CY_BLE_SCAN_STATE_SCANNING)
+    {
+        DEBUG_PRINTF("Stop Scan and connect to peripheral\r\n");
+        Cy_BLE_GAPC_StopScan();
+        state = STATE_CONNECTING;
+    }
+    else
+    {
+        ConnectSelectedDevice();
+    }
+}
+
+/*******************************************************************************
+* Function Name: CmdCancel
+********************************************************************************
+*
+* Summary:
+*   'cancel': cancels the connection request.
+*
+*******************************************************************************/
+static void CmdCancel(uint32_t argc, char *argv[])
+{
+    cy_en_ble_api_result_t apiResult;
+
+    (void)argc;
+    (void)argv;
+    apiResult = Cy_BLE_GAPC_CancelDeviceConnection();
+    DEBUG_PRINTF("Cy_BLE_GAPC_CancelDeviceConnection: %x\r\n" , apiResult);
+}
+
+/*******************************************************************************
+* Function Name: CmdDisconnect
+********************************************************************************
+*
+* Summary:
+*   'disconnect': sends a disconnect request to the last connected device.
+*
+*******************************************************************************/
+static void CmdDisconnect(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    appConn[appConnHandle.attId].disconnectPending = appConn[appConnHandle.attId].connected;
+    state = STATE_DISCONNECTED;
+}
+
+/*******************************************************************************
+* Function Name: CmdDiscover
+********************************************************************************
+*
+* Summary:
+*   'discover': starts the discovery procedure on the last connected device.
+*
+*******************************************************************************/
+static void CmdDiscover(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    appConn[appConnHandle.attId].discoveryPending = appConn[appConnHandle.attId].connected;
+}
+
+/*******************************************************************************
+* Function Name: CmdAuto
+********************************************************************************
+*
+* Summary:
+*   'auto [on|off]': switches auto-connect, toggles it without an argument.
+*
+*******************************************************************************/
+static void CmdAuto(uint32_t argc, char *argv[])
+{
+    if(argc == 1u)
+    {
+        autoConnect = (autoConnect == false);
+    }
+    else if((argc == 2u) && (strcmp(argv[1u], "on") == 0))
+    {
+        autoConnect = true;
+    }
+    else if((argc == 2u) && (strcmp(argv[1u], "off") == 0))
+    {
+        autoConnect = false;
+    }
+    else
+    {
+        DEBUG_PRINTF(" Usage: auto [on|off] \r\n");
+        return;
+    }
+    autoConnectCheck = true;
+    DEBUG_PRINTF("Auto connect %s \r\n", (autoConnect == true) ? "on" : "off");
+    AutoScan();
+}
+
+/*******************************************************************************
+* Function Name: CmdSend
+********************************************************************************
+*
+* Summary:
+*   'send': sends data packets to the last connected Node through the IPSP
+*   channel.
+*
+*******************************************************************************/
+static void CmdSend(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    LoopbackFillWindow(&appConn[appConnHandle.attId]);
+}
+
+/*******************************************************************************
+* Function Name: CmdWindow
+********************************************************************************
+*
+* Summary:
+*   'window <n>': sets the loopback transmit window.
+*
+*******************************************************************************/
+static void CmdWindow(uint32_t argc, char *argv[])
+{
+    uint32_t value;
+
+    if((argc != 2u) || (Command_Number(argv[1u], &value) == false) ||
+       (value == 0u) || (value > LOOPBACK_WINDOW_MAX))
     {
-        DEBUG_PRINTF("Stack Version: %d.%d.%d.%d \r\n", stackVersion.majorVersion,
-            stackVersion.minorVersion, stackVersion.patch, stackVersion.buildNumber);
+        DEBUG_PRINTF(" Usage: window <1-%d> \r\n", LOOPBACK_WINDOW_MAX);
+        return;
     }
-
+    loopbackWindow = (uint8)value;
+    DEBUG_PRINTF("Window %d \r\n", loopbackWindow);
 }
 
-void ProcessUartCommands()
+/*******************************************************************************
+* Function Name: CmdBench
+********************************************************************************
+*
+* Summary:
+*   'bench start' enters benchmark mode, 'bench off' leaves it. The duration,
+*   payload, warm-up and window not given keep their last values. The mode
+*   is only changed while no loopback runs.
+*
+*******************************************************************************/
+static void CmdBench(uint32_t argc, char *argv[])
 {
-	cy_en_ble_api_result_t          			apiResult;
-	char8 										command;
+    uint32_t duration = benchDuration;
+    uint32_t size = loopbackPayloadLen;
+    uint32_t warmup = benchWarmup;
+    uint32_t window = loopbackWindow;
 
-    if(((command = UART_DEB_GET_CHAR()) != UART_DEB_NO_DATA) || ((custom_command != 0) &&
-        (cy_ble_busyStatus[appConnHandle.attId] == 0u)))
+    if((argc >= 2u) && (strcmp(argv[1u], "start") == 0))
     {
-        if(custom_command != 0u)
+        if((Command_Arg(argc, argv, "dur", &duration) == false) || (duration == 0u) || (duration > BENCH_DURATION_MAX) ||
+           (Command_Arg(argc, argv, "size", &size) == false) || (size < LOOPBACK_HEADER_LEN) || (size > LOOPBACK_PAYLOAD_LEN) ||
+           (Command_Arg(argc, argv, "warmup", &warmup) == false) || (warmup > BENCH_WARMUP_MAX) ||
+           (Command_Arg(argc, argv, "window", &window) == false) || (window == 0u) || (window > LOOPBACK_WINDOW_MAX))
         {
-            command = custom_command;
-            custom_command = 0u;
+            DEBUG_PRINTF(" Wrong value: dur=1-%d size=%d-%d warmup=0-%d window=1-%d \r\n",
+                BENCH_DURATION_MAX, LOOPBACK_HEADER_LEN, LOOPBACK_PAYLOAD_LEN, BENCH_WARMUP_MAX, LOOPBACK_WINDOW_MAX);
         }
-        switch(command)
+        else if(loopbackActive != 0u)
         {
-        case 'c':                   /* Send connect request to selected peer device.  */
-        	DEBUG_PRINTF("Stop Scan and connect to peripheral\r\n");
-        	Cy_BLE_GAPC_StopScan();
-            state = STATE_CONNECTING;
-            break;
-
-        case 'v':                   /* Cancel connection request. */
-            apiResult = Cy_BLE_GAPC_CancelDeviceConnection();
-            DEBUG_PRINTF("Cy_BLE_GAPC_CancelDeviceConnection: %x\r\n" , apiResult);
-            break;
-
-        case 'd':                   /* Send disconnect request to peer device. */
-            {
-            	DEBUG_PRINTF("disconnect from peripheral\r\n");
-                cy_stc_ble_gap_disconnect_info_t disconnectInfoParam =
-                {
-                    .bdHandle = appConnHandle.bdHandle,
-                    .reason = CY_BLE_HCI_ERROR_OTHER_END_TERMINATED_USER
-                };
-                apiResult = Cy_BLE_GAP_Disconnect(&disconnectInfoParam);
-                if(apiResult != CY_BLE_SUCCESS)
-                {
-                    DEBUG_PRINTF("DisconnectDevice API Error: 0x%x \r\n", apiResult);
-                }
-                state = STATE_DISCONNECTED;
-            }
-            break;
-
-        case 's':                   /* Start discovery procedure. */
-        	DEBUG_PRINTF("StartDiscovery \r\n");
-        	apiResult = Cy_BLE_GATTC_StartDiscovery(appConnHandle);
-            if(apiResult != CY_BLE_SUCCESS)
-            {
-                DEBUG_PRINTF("StartDiscovery API Error: 0x%x \r\n", apiResult);
-            }
-            break;
-
-        case 'z':                   /* Select specific peer device.  */
-            DEBUG_PRINTF("Select Device:\n");
-            while((command = UART_DEB_GET_CHAR()) == UART_DEB_NO_DATA);
-            if((command >= '0') && (command <= '9'))
-            {
-                deviceN = (uint8)(command - '0');
-                DEBUG_PRINTF("%c\n",command); /* print number */
-            }
-            else
-            {
-                DEBUG_PRINTF(" Wrong digit..press 'z' again \r\n");
-                break;
-            }
-            break;
+            DEBUG_PRINTF(" Loopback running..try again later \r\n");
+        }
+        else
+        {
+            benchMode = true;
+            benchDuration = duration;
+            loopbackPayloadLen = (uint16_t)size;
+            benchWarmup = warmup;
+            loopbackWindow = (uint8)window;
+            DEBUG_PRINTF("Benchmark: duration=%lu s, payload=%d bytes, warm-up=%lu s, window=%d \r\n",
+                (unsigned long)benchDuration, loopbackPayloadLen, (unsigned long)benchWarmup, loopbackWindow);
+        }
+    }
+    else if((argc == 2u) && (strcmp(argv[1u], "off") == 0))
+    {
+        if(loopbackActive != 0u)
+        {
+            DEBUG_PRINTF(" Loopback running..try again later \r\n");
+        }
+        else
+        {
+            benchMode = false;
+            loopbackPayloadLen = LOOPBACK_PAYLOAD_LEN;
+            DEBUG_PRINTF("Benchmark off \r\n");
+        }
+    }
+    else
+    {
+        DEBUG_PRINTF(" Usage: bench start|off [dur=] [size=] [warmup=] [window=] \r\n");
+    }
+}
 
-            /**********************************************************
-            *               L2Cap Commands (WrapAround)
-            ***********************************************************/
-        case '1':                   /* Send Data packet to node through IPSP channel */
-            {
-                static uint16_t counter = 0;
-                static uint16_t repeats = 0;
-                uint16_t i;
-                cy_stc_ble_l2cap_cbfc_tx_data_info_t l2capCbfcTxDataParam;
+/*******************************************************************************
+* Function Name: CmdStats
+********************************************************************************
+*
+* Summary:
+*   'stats': prints the GATT cache, setup, BLE event and log statistics.
+*
+*******************************************************************************/
+static void CmdStats(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    GattCacheReport();
+    ConnTime_PrintStats();
+    BleDispatch_PrintStats();
+    DEBUG_PRINT_LOG_STATS();
+}
 
-                DEBUG_PRINTF("-> Cy_BLE_L2CAP_ChannelDataWrite #%d \r\n", repeats++);
-                (void)repeats;
-            #if(DEBUG_UART_FULL)
-                DEBUG_PRINTF(", Data:");
-            #endif /* DEBUG_UART_FULL */
-                /* Fill output buffer by counter */
-                for(i = 0u; i < L2CAP_MAX_LEN / 2u; i++)
-                {
-                    ipv6LoopbackBuffer[i] = counter++;
-                #if(DEBUG_UART_FULL)
-                    DEBUG_PRINTF("%4.4x", ipv6LoopbackBuffer[i]);
-                #endif /* DEBUG_UART_FULL */
-                }
-                l2capCbfcTxDataParam.buffer = (uint8_t *)ipv6LoopbackBuffer;
-                l2capCbfcTxDataParam.bufferLength = L2CAP_MAX_LEN;
-                l2capCbfcTxDataParam.localCid = l2capParameters.lCid;
-                apiResult = Cy_BLE_L2CAP_ChannelDataWrite(&l2capCbfcTxDataParam);
-                if(apiResult != CY_BLE_SUCCESS)
-                {
-                    DEBUG_PRINTF("Cy_BLE_L2CAP_ChannelDataWrite API Error: 0x%x \r\n", apiResult);
-                }
-            }
-            break;
+/* Commands of the debug UART, one per line */
+static const command_t routerCommand[ROUTER_COMMANDS] =
+{
+    { "help",       "",                                         "Help menu.",                           CmdHelp },
+    { "select",     "<n>",                                      "Select peer device.",                  CmdSelect },
+    { "connect",    "[n]",                                      "Send connect request to peer device.", CmdConnect },
+    { "cancel",     "",                                         "Cancel connection request.",           CmdCancel },
+    { "disconnect", "",                                         "Disconnect the last connected device.", CmdDisconnect },
+    { "discover",   "",                                         "Start discovery on the last connected device.", CmdDiscover },
+    { "auto",       "[on|off]",                                 "Auto connect on or off.",              CmdAuto },
+    { "send",       "",                                         "Send data packets to the last connected Node.", CmdSend },
+    { "window",     "<n>",                                      "Set loopback transmit window.",        CmdWindow },
+    { "bench",      "start|off [dur=] [size=] [warmup=] [window=]", "Benchmark mode: seconds, bytes, seconds, window.", CmdBench },
+    { "stats",      "",                                         "Print the statistics.",                CmdStats },
+};
 
-        case 'h':                   /* Help menu */
-            DEBUG_PRINTF("\r\n");
-            DEBUG_PRINTF("Available commands:\r\n");
-            DEBUG_PRINTF(" \'h\' - Help menu.\r\n");
-            DEBUG_PRINTF(" \'z\' + 'Number' - Select peer device.\r\n");
-            DEBUG_PRINTF(" \'c\' - Send connect request to peer device.\r\n");
-            DEBUG_PRINTF(" \'d\' - Send disconnect request to peer device.\r\n");
-            DEBUG_PRINTF(" \'v\' - Cancel connection request.\r\n");
-            DEBUG_PRINTF(" \'s\' - Start discovery procedure.\r\n");
-            DEBUG_PRINTF(" \'1\' - Send Data packet to Node through IPSP channel.\r\n");
-            break;
-        }
-    }
+/*******************************************************************************
+* Function Name: ProcessUartCommands
+********************************************************************************
+*
+* Summary:
+*   Runs the command of a complete line from the debug UART, if one came.
+*
+*******************************************************************************/
+void ProcessUartCommands(void)
+{
+    (void)Command_Process(routerCommand, ROUTER_COMMANDS);
 }
+
 /*******************************************************************************
 * Function Name: BleIPSPRouter_Process()
 ********************************************************************************
@@ -324,6 +1517,8 @@ void ProcessUartCommands()
 #define MAX_INT 0xFFFFFFFF
 void BleIPSPRouter_Process(void)
 {
+    uint32_t i;
+
     /* The call to EnterLowPowerMode also causes the device to enter hibernate
        mode if the BLE stack is shutdown */
     //EnterLowPowerMode();
@@ -335,15 +1530,44 @@ void BleIPSPRouter_Process(void)
     {
     	totalTime++;
         mainTimer = 0u;
+        /* Keeps the setup clock across wraps of the MCWDT counter */
+        (void)ConnTime_NowUs();
+        autoConnectCheck = true;
         Cy_BLE_StartTimer(&timerParam);
-        uint32_t distance = ((totalTime > startTime)? (totalTime-startTime): (startTime-totalTime)+ MAX_INT);
-        if((distance >= 60)&&(loopBackStarted!=0))
+        if(Cy_BLE_GetScanState() == CY_BLE_SCAN_STATE_SCANNING)
+        {
+            /* Forget advertisers that went away */
+            AdvTable_Age(totalTime);
+        }
+        for(i = 0u; i < CY_BLE_CONN_COUNT; i++)
         {
-        	custom_command = 'd';
-        	loopBackStarted = 0;
+            app_conn_t *conn = &appConn[i];
+            uint32_t distance = ((totalTime > conn->startTime)? (totalTime-conn->startTime): (conn->startTime-totalTime)+ MAX_INT);
+            if(conn->l2capConnected == true)
+            {
+                Credit_Tick(&conn->credit);
+            }
+            if(conn->loopBackStarted == 0u)
+            {
+                continue;
+            }
+            if((benchMode == true) && (conn->benchMeasuring == false) && (distance >= benchWarmup))
+            {
+                LoopbackBenchStart(conn);
+            }
+            /* An SDU that timed out by the stop is lost, not in flight */
+            LoopbackExpire(conn);
+            if((benchMode == true) ? ((conn->benchMeasuring == true) && ((totalTime - conn->benchStart) >= benchDuration))
+                                   : (distance >= LOOPBACK_DURATION))
+            {
+                LoopbackStop(conn);
+                conn->disconnectPending = true;
+            }
         }
     }
 
+    ServiceConnections();
+    AutoConnect();
     ProcessUartCommands();
 }
 
@@ -366,7 +1590,14 @@ void StackEventHandler(uint32 event, void* eventParam)
 {
     cy_en_ble_api_result_t apiResult;
     cy_stc_ble_gapc_adv_report_param_t *advReport;
-    uint8_t newDevice = 0u;
+    bool newDevice;
+    uint8_t advIndex;
+    adv_data_info_t advInfo;
+    static const adv_data_uuid_t ipssUuid =
+    {
+        .size   = ADV_DATA_UUID16_SIZE,
+        .uuid16 = CY_BLE_UUID_INTERNET_PROTOCOL_SUPPORT_SERVICE
+    };
     uint16_t i;
     static cy_stc_ble_gap_sec_key_info_t keyInfo =
     {
@@ -411,6 +1642,7 @@ void StackEventHandler(uint32 event, void* eventParam)
                 }
                 else
                 {
+                    ConnTime_MarkScan(CONN_TIME_SCAN_START);
                     DEBUG_PRINTF("Bluetooth On, StartScan with addr: ");
 
                 }
@@ -491,41 +1723,37 @@ void StackEventHandler(uint32 event, void* eventParam)
         case CY_BLE_EVT_GAPC_SCAN_PROGRESS_RESULT:
             advReport = (cy_stc_ble_gapc_adv_report_param_t *)eventParam;
             /* Filter and connect only to nodes that advertise IPSS in ADV payload */
-            if(CheckAdvPacketForServiceUuid(advReport, CY_BLE_UUID_INTERNET_PROTOCOL_SUPPORT_SERVICE) != 0u)
+            if(AdvData_Match(advReport->data, advReport->dataLen, &ipssUuid, 1u) != 0u)
             {
-                for(newDevice = 1u, i = 0u; i < advDevices; i++)
-                {
-                    /* Compare device address with already logged one */
-                    if((memcmp(peerAddr[i].bdAddr, advReport->peerBdAddr, CY_BLE_GAP_BD_ADDR_SIZE) == 0))
-                    {
-                        newDevice = 0u;
-                        break;
-                    }
-                }
-                if(newDevice != 0u)
+                /* Log the device, or refresh its last-seen time and RSSI */
+                advIndex = AdvTable_Update(advReport->peerBdAddr, advReport->peerAddrType, advReport->rssi,
+                                           totalTime, &newDevice);
+                autoConnectCheck = true;
+                if(newDevice == true)
                 {
+                    /* The name and TX power are only printed, parsed for new Nodes only */
+                    (void)AdvData_Parse(advReport->data, advReport->dataLen, &ipssUuid, 1u, &advInfo);
                     DEBUG_PRINTF("Advertisement report: eventType = %x, peerAddrType - %x, ",
                         advReport->eventType, advReport->peerAddrType);
                     DEBUG_PRINTF("peerBdAddr - ");
-                    if(advDevices < CY_BLE_MAX_ADV_DEVICES)
-                    {
-                        memcpy(peerAddr[advDevices].bdAddr, advReport->peerBdAddr, CY_BLE_GAP_BD_ADDR_SIZE);
-                        peerAddr[advDevices].type = advReport->peerAddrType;
-                        DEBUG_PRINTF("%x: ",advDevices);
-                        advDevices++;
-                    }
+                    DEBUG_PRINTF("%x: ", advIndex);
 
                 for(i = CY_BLE_GAP_BD_ADDR_SIZE; i > 0u; i--)
                 {
                     DEBUG_PRINTF("%2.2x", advReport->peerBdAddr[i-1]);
                 }
                 DEBUG_PRINTF(", rssi - %d dBm", advReport->rssi);
-            #if(DEBUG_UART_FULL)
-                DEBUG_PRINTF(", data - ");
-                for( i = 0; i < advReport->dataLen; i++)
+                if(advInfo.name != NULL)
+                {
+                    DEBUG_PRINTF(", name - %.*s", advInfo.nameLen, (const char *)advInfo.name);
+                }
+                if(advInfo.hasTxPower == true)
                 {
-                    DEBUG_PRINTF("%2.2x ", advReport->data[i]);
+                    DEBUG_PRINTF(", tx power - %d dBm", advInfo.txPower);
                 }
+            #if(DEBUG_UART_FULL)
+                DEBUG_PRINTF(", data - ");
+                DEBUG_PRINT_DATA(advReport->data, advReport->dataLen);
             #endif /* DEBUG_UART_FULL */
                 DEBUG_PRINTF("\r\n");
                 }
@@ -534,26 +1762,25 @@ void StackEventHandler(uint32 event, void* eventParam)
 
         case CY_BLE_EVT_GAPC_SCAN_START_STOP:
             DEBUG_PRINTF("CY_BLE_EVT_GAPC_SCAN_START_STOP, state: %x\r\n", Cy_BLE_GetScanState());
+            if(Cy_BLE_GetScanState() == CY_BLE_SCAN_STATE_SCANNING)
+            {
+                ConnTime_MarkScan(CONN_TIME_SCAN_STARTED);
+            }
             if(Cy_BLE_GetScanState() == CY_BLE_SCAN_STATE_STOPPED)
             {
                 if(state == STATE_CONNECTING)
                 {
                     DEBUG_PRINTF("GAPC_END_SCANNING\r\n");
-                    /* Connect to selected device */
-                    DEBUG_PRINTF("Connecting to BD Address: ");
-                    for(i = CY_BLE_GAP_BD_ADDR_SIZE; i > 0u; i--)
-                    {
-                        DEBUG_PRINTF("%2.2x", peerAddr[deviceN].bdAddr[i-1]);
-                    }
-                    DEBUG_PRINTF("\r\n");
-                    apiResult = Cy_BLE_GAPC_ConnectDevice(&peerAddr[deviceN], 0u);
-                    if(apiResult != CY_BLE_SUCCESS)
-                    {
-                        DEBUG_PRINTF("ConnectDevice API Error: 0x%x \r\n", apiResult);
-                    }
+                    /* Connect to selected device. A later scan stop is not
+                     * a connect command, whoever issued this one. */
+                    ConnectSelectedDevice();
+                    state = STATE_CONNECTED;
+                    AutoScan();
                 }
                 else
                 {
+                    /* Scan timeout */
+                    AutoScan();
                 }
             }
             break;
@@ -635,6 +1862,26 @@ void StackEventHandler(uint32 event, void* eventParam)
             {
                 DEBUG_PRINTF("Cy_BLE_GAP_SetSecurityKeys API Error: 0x%x \r\n", apiResult);
             }
+            connectPending = false;
+            if(((cy_stc_ble_gap_connected_param_t *)eventParam)->status != 0u)
+            {
+                ConnPolicy_Timeout(&connectAddr, totalTime);
+                AutoScan();
+                break;
+            }
+            {
+                app_conn_t *conn = AppConnByBdHandle((*(cy_stc_ble_gap_connected_param_t *)eventParam).bdHandle);
+
+                if(conn != NULL)
+                {
+                    conn->peerAddrType = ((cy_stc_ble_gap_connected_param_t *)eventParam)->peerAddrType;
+                    memcpy(conn->peerAddr, ((cy_stc_ble_gap_connected_param_t *)eventParam)->peerAddr,
+                           CY_BLE_GAP_BD_ADDR_SIZE);
+                    /* Link-local addresses on the IPSP channel are derived from the BD addresses */
+                    Iphc_LinkInit(&conn->ipLink, cy_ble_deviceAddress.bdAddr,
+                                  ((cy_stc_ble_gap_connected_param_t *)eventParam)->peerAddr);
+                }
+            }
             break;
 
         case CY_BLE_EVT_GAP_CONNECTION_UPDATE_COMPLETE:
@@ -658,11 +1905,27 @@ void StackEventHandler(uint32 event, void* eventParam)
                 (*(cy_stc_ble_gap_disconnect_param_t *)eventParam).bdHandle,
                 (*(cy_stc_ble_gap_disconnect_param_t *)eventParam).reason,
                 (*(cy_stc_ble_gap_disconnect_param_t *)eventParam).status);
+            {
+                app_conn_t *conn = AppConnByBdHandle((*(cy_stc_ble_gap_disconnect_param_t *)eventParam).bdHandle);
+                if(conn != NULL)
+                {
+                    LoopbackStop(conn);
+                    ConnPolicy_Lost(conn->peerAddr, conn->peerAddrType, totalTime);
+                    memset(conn, 0, sizeof(app_conn_t));
+                }
+            }
 
-            apiResult = Cy_BLE_GAPC_StartScan(CY_BLE_SCANNING_FAST, 0u);                   /* Start Limited Discovery */
-            if(apiResult != CY_BLE_SUCCESS)
+            if(Cy_BLE_GetScanState() == CY_BLE_SCAN_STATE_STOPPED)
             {
-                DEBUG_PRINTF("StartScan API Error: 0x%x \r\n", apiResult);
+                apiResult = Cy_BLE_GAPC_StartScan(CY_BLE_SCANNING_FAST, 0u);               /* Start Limited Discovery */
+                if(apiResult != CY_BLE_SUCCESS)
+                {
+                    DEBUG_PRINTF("StartScan API Error: 0x%x \r\n", apiResult);
+                }
+                else
+                {
+                    ConnTime_MarkScan(CONN_TIME_SCAN_START);
+                }
             }
             break;
 
@@ -675,6 +1938,12 @@ void StackEventHandler(uint32 event, void* eventParam)
         ***********************************************************/
         case CY_BLE_EVT_GATT_CONNECT_IND:
             appConnHandle = *(cy_stc_ble_conn_handle_t *)eventParam;
+            /* The entry was cleared on disconnect and may already hold the IPHC link */
+            appConn[appConnHandle.attId].connected = true;
+            appConn[appConnHandle.attId].connHandle = appConnHandle;
+            ConnTime_Open(&appConn[appConnHandle.attId].setupTime);
+            /* Look for the next Node once the milestones of this one are taken */
+            AutoScan();
             DEBUG_PRINTF("CY_BLE_EVT_GATT_CONNECT_IND: %x, %x \r\n",
                 (*(cy_stc_ble_conn_handle_t *)eventParam).attId,
                 (*(cy_stc_ble_conn_handle_t *)eventParam).bdHandle);
@@ -689,7 +1958,7 @@ void StackEventHandler(uint32 event, void* eventParam)
                 {
                     .mtu = CY_BLE_L2CAP_MTU,
                     .mps = CY_BLE_L2CAP_MPS,
-                    .credit = LE_DATA_CREDITS_IPSP
+                    .credit = Credit_Open(&appConn[appConnHandle.attId].credit, LOOPBACK_RX_BUFFERS)
                 };
 
                 /* L2CAP Channel parameters for the local device */
@@ -709,6 +1978,7 @@ void StackEventHandler(uint32 event, void* eventParam)
                 }
                 else
                 {
+                    ConnTime_Mark(&appConn[appConnHandle.attId].setupTime, CONN_TIME_CBFC_REQ);
                     DEBUG_PRINTF("L2CAP channel connection request sent. \r\n");
                 }
             }
@@ -725,122 +1995,132 @@ void StackEventHandler(uint32 event, void* eventParam)
                 ((cy_stc_ble_gatt_err_param_t *)eventParam)->errInfo.opCode,
                 ((cy_stc_ble_gatt_err_param_t *)eventParam)->errInfo.attrHandle,
                 ((cy_stc_ble_gatt_err_param_t *)eventParam)->errInfo.errorCode);
+            {
+                cy_stc_ble_conn_handle_t *connHandle = &((cy_stc_ble_gatt_err_param_t *)eventParam)->connHandle;
+                app_conn_t *conn = (connHandle->attId < CY_BLE_CONN_COUNT) ? &appConn[connHandle->attId] : NULL;
+
+                /* A Service Changed CCCD from the cache that is no longer
+                 * valid: the discovery finds the current handles. The
+                 * lookup procedures end with Attribute Not Found, then
+                 * CY_BLE_EVT_GATTC_LONG_PROCEDURE_END. */
+                if((conn != NULL) && (conn->scPhase == SC_PHASE_ENABLE))
+                {
+                    conn->scPhase = SC_PHASE_IDLE;
+                    GattCache_Invalidate(conn->peerAddr, conn->peerAddrType);
+                    conn->discoveryPending = true;
+                }
+            }
+            break;
+
+        case CY_BLE_EVT_GATTC_WRITE_RSP:
+            {
+                app_conn_t *conn = (((cy_stc_ble_conn_handle_t *)eventParam)->attId < CY_BLE_CONN_COUNT) ?
+                    &appConn[((cy_stc_ble_conn_handle_t *)eventParam)->attId] : NULL;
+
+                if((conn != NULL) && (conn->scPhase == SC_PHASE_ENABLE))
+                {
+                    DEBUG_PRINTF("Service Changed indication enabled %d \r\n", conn->connHandle.attId);
+                    conn->scPhase = SC_PHASE_IDLE;
+                }
+            }
             break;
 
         /**********************************************************
         *                       L2CAP Events
         ***********************************************************/
         case CY_BLE_EVT_L2CAP_CBFC_CONN_CNF:
-            l2capParameters = *((cy_stc_ble_l2cap_cbfc_conn_cnf_param_t *)eventParam);
-            DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_CONN_CNF: bdHandle=%d, lCid=%d, response=%d",
-                l2capParameters.bdHandle,
-                l2capParameters.lCid,
-                l2capParameters.response);
-
-            DEBUG_PRINTF(", connParam: mtu=%d, mps=%d, credit=%d\r\n",
-                l2capParameters.connParam.mtu,
-                l2capParameters.connParam.mps,
-                l2capParameters.connParam.credit);
-            l2capConnected = true;
-            /* Start service discovery  */
-            custom_command = 's';
+            {
+                cy_stc_ble_l2cap_cbfc_conn_cnf_param_t *connCnfParam =
+                    (cy_stc_ble_l2cap_cbfc_conn_cnf_param_t *)eventParam;
+                app_conn_t *conn = AppConnByBdHandle(connCnfParam->bdHandle);
+
+                DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_CONN_CNF: bdHandle=%d, lCid=%d, response=%d",
+                    connCnfParam->bdHandle,
+                    connCnfParam->lCid,
+                    connCnfParam->response);
+
+                DEBUG_PRINTF(", connParam: mtu=%d, mps=%d, credit=%d\r\n",
+                    connCnfParam->connParam.mtu,
+                    connCnfParam->connParam.mps,
+                    connCnfParam->connParam.credit);
+                if(conn == NULL)
+                {
+                    break;
+                }
+                conn->l2capParameters = *connCnfParam;
+                conn->l2capConnected = true;
+                ConnTime_Mark(&conn->setupTime, CONN_TIME_CBFC_CNF);
+                Credit_Connected(&conn->credit, connCnfParam->connParam.mps, connCnfParam->connParam.credit);
+                /* Start service discovery  */
+                conn->discoveryPending = true;
+            }
             break;
 
         case CY_BLE_EVT_L2CAP_CBFC_DISCONN_IND:
             DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_DISCONN_IND: %d \r\n", *(uint16_t *)eventParam);
-            l2capConnected = false;
-            break;
-
-        /* Following two events are required, to receive data */
-        case CY_BLE_EVT_L2CAP_CBFC_DATA_READ:
             {
-                cy_stc_ble_l2cap_cbfc_rx_param_t *rxDataParam = (cy_stc_ble_l2cap_cbfc_rx_param_t *)eventParam;
-                DEBUG_PRINTF("<- EVT_L2CAP_CBFC_DATA_READ: lCid=%d, result=%d, len=%d",
-                    rxDataParam->lCid,
-                    rxDataParam->result,
-                    rxDataParam->rxDataLength);
-            #if(DEBUG_UART_FULL)
-                DEBUG_PRINTF(", data:");
-                for(i = 0; i < rxDataParam->rxDataLength; i++)
+                app_conn_t *conn = AppConnByCid(*(uint16_t *)eventParam);
+                if(conn != NULL)
                 {
-                    DEBUG_PRINTF("%2.2x", rxDataParam->rxData[i]);
-                }
-            #endif /* DEBUG_UART_FULL */
-                DEBUG_PRINTF("\r\n");
-                /* Data is received from Node, validate the content */
-                if(memcmp(((uint8_t *)ipv6LoopbackBuffer), rxDataParam->rxData, L2CAP_MAX_LEN) != 0u)
-                {
-                    DEBUG_PRINTF("Wraparound failed \r\n");
-                }
-                else
-                {
-                    /* Send new Data packet to Node through IPSP channel  */
-                    custom_command = '1';
+                    conn->l2capConnected = false;
+                    conn->credit.txCredits = 0u;
                 }
             }
             break;
 
-        case CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND:
+        /**********************************************************
+        *                       Discovery Events
+        ***********************************************************/
+        case CY_BLE_EVT_GATTC_DISCOVERY_COMPLETE:
+            DEBUG_PRINTF("CY_BLE_EVT_SERVER_DISCOVERY_COMPLETE \r\n");
             {
-                cy_stc_ble_l2cap_cbfc_low_rx_credit_param_t *rxCreditParam =
-                    (cy_stc_ble_l2cap_cbfc_low_rx_credit_param_t *)eventParam;
-                cy_stc_ble_l2cap_cbfc_credit_info_t l2capCbfcCreditParam =
-                {
-                    .credit   = LE_DATA_CREDITS_IPSP,
-                    .localCid = rxCreditParam->lCid
-                };
+                app_conn_t *conn = &appConn[(*(cy_stc_ble_conn_handle_t *)eventParam).attId];
+                uint32_t discIdx = Cy_BLE_GetDiscoveryIdx(conn->connHandle);
 
-                DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND: lCid=%d, credit=%d \r\n",
-                    rxCreditParam->lCid,
-                    rxCreditParam->credit);
-
-                /* This event informs that receive credits reached low mark.
-                 * If the device expects more data to receive, send more credits back to the peer device.
-                 */
-                apiResult = Cy_BLE_L2CAP_CbfcSendFlowControlCredit(&l2capCbfcCreditParam);
-                if(apiResult != CY_BLE_SUCCESS)
+                if(discIdx < CY_BLE_GATTC_COUNT)
                 {
-                    DEBUG_PRINTF("Cy_BLE_L2CAP_CbfcSendFlowControlCredit API Error: 0x%x \r\n", apiResult);
+                    memcpy(conn->serverInfo, cy_ble_serverInfo[discIdx], sizeof(conn->serverInfo));
+                    GattCache_Store(conn->peerAddr, conn->peerAddrType, conn->serverInfo, NULL);
                 }
+                /* Service Changed is looked up again in the new GATT range */
+                conn->scHandle = 0u;
+                conn->scCccdHandle = 0u;
+                DiscoveryComplete(conn);
             }
             break;
-
-        /* Following events are required, to send data */
-        case CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND:
-            DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND: lCid=%d, result=%d, credit=%d \r\n",
-                ((cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t *)eventParam)->lCid,
-                ((cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t *)eventParam)->result,
-                ((cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t *)eventParam)->credit);
-            break;
-
-        case CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND:
-            #if(DEBUG_UART_FULL)
+        case CY_BLE_EVT_GATTC_HANDLE_VALUE_IND:
             {
-            	cy_stc_ble_l2cap_cbfc_rx_data_param_t *writeDataParam = (cy_stc_ble_l2cap_cbfc_rx_data_param_t*)eventParam;
-                DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND: lCid=%d \r\n", writeDataParam->lCid);
+                cy_stc_ble_gattc_handle_value_ind_param_t *ind = (cy_stc_ble_gattc_handle_value_ind_param_t *)eventParam;
+                app_conn_t *conn = (ind->connHandle.attId < CY_BLE_CONN_COUNT) ?
+                    &appConn[ind->connHandle.attId] : NULL;
+
+                /* Service Changed: the cached handles of the peer are out of
+                 * date. The ranges are only printed, the IPSP channel is
+                 * opened by its PSM. */
+                if((conn != NULL) && (conn->scHandle != 0u) &&
+                   (ind->handleValPair.attrHandle == conn->scHandle))
+                {
+                    DEBUG_PRINTF("Service Changed %d \r\n", ind->connHandle.attId);
+                    GattCache_Invalidate(conn->peerAddr, conn->peerAddrType);
+                    conn->discoveryPending = true;
+                }
+                (void)Cy_BLE_GATTC_SendConfirmation(&ind->connHandle);
             }
-            #endif /* DEBUG_UART_FULL */
             break;
+        case CY_BLE_EVT_GATTC_READ_BY_TYPE_RSP:
+        case CY_BLE_EVT_GATTC_FIND_INFO_RSP:
+            ServiceChangedResponse(event, eventParam);
+            break;
+        case CY_BLE_EVT_GATTC_LONG_PROCEDURE_END:
+            {
+                cy_stc_ble_conn_handle_t *connHandle = &((cy_stc_ble_gattc_long_procedure_end_param_t *)eventParam)->connHandle;
+                app_conn_t *conn = (connHandle->attId < CY_BLE_CONN_COUNT) ? &appConn[connHandle->attId] : NULL;
 
-        /**********************************************************
-        *                       Discovery Events
-        ***********************************************************/
-        case CY_BLE_EVT_GATTC_DISCOVERY_COMPLETE:
-            DEBUG_PRINTF("CY_BLE_EVT_SERVER_DISCOVERY_COMPLETE \r\n");
-            DEBUG_PRINTF("GATT %x-%x, \r\n",
-                cy_ble_serverInfo[Cy_BLE_GetDiscoveryIdx(*(cy_stc_ble_conn_handle_t *)eventParam)][CY_BLE_SRVI_GATT].
-                    range.startHandle,
-                cy_ble_serverInfo[Cy_BLE_GetDiscoveryIdx(*(cy_stc_ble_conn_handle_t *)eventParam)][CY_BLE_SRVI_GATT].
-                    range.endHandle);
-
-            DEBUG_PRINTF("\r\nIPSP %x-%x: ",
-                cy_ble_serverInfo[Cy_BLE_GetDiscoveryIdx(*(cy_stc_ble_conn_handle_t *)eventParam)][CY_BLE_SRVI_IPSS].
-                    range.startHandle,
-                cy_ble_serverInfo[Cy_BLE_GetDiscoveryIdx(*(cy_stc_ble_conn_handle_t *)eventParam)][CY_BLE_SRVI_IPSS].
-                    range.endHandle);
-            DEBUG_PRINTF("\r\n");
-            custom_command = '1';
-            startTime = totalTime;loopBackStarted=1;
+                if((conn != NULL) && ((conn->scPhase == SC_PHASE_CHAR) || (conn->scPhase == SC_PHASE_CCCD)))
+                {
+                    conn->serviceChangedPending = true;
+                }
+            }
             break;
         case CY_BLE_EVT_GATTC_DISC_SKIPPED_SERVICE:
         	DEBUG_PRINTF("CY_BLE_EVT_GATTC_DISC_SKIPPED_SERVICE \r\n");
@@ -865,6 +2145,160 @@ void StackEventHandler(uint32 event, void* eventParam)
 }
 
 
+/*******************************************************************************
+* Function Name: L2capDataReadHandler()
+********************************************************************************
+*
+* Summary:
+*   Handles CY_BLE_EVT_L2CAP_CBFC_DATA_READ: verifies an echo from a Node and
+*   refills the loopback window.
+*
+*******************************************************************************/
+static void L2capDataReadHandler(uint32 event, void* eventParam)
+{
+    cy_stc_ble_l2cap_cbfc_rx_param_t *rxDataParam = (cy_stc_ble_l2cap_cbfc_rx_param_t *)eventParam;
+
+    (void)event;
+    DEBUG_PRINTF("<- EVT_L2CAP_CBFC_DATA_READ: lCid=%d, result=%d, len=%d",
+        rxDataParam->lCid,
+        rxDataParam->result,
+        rxDataParam->rxDataLength);
+#if(DEBUG_UART_FULL)
+    DEBUG_PRINTF(", data:");
+    DEBUG_PRINT_DATA(rxDataParam->rxData, rxDataParam->rxDataLength);
+#endif /* DEBUG_UART_FULL */
+    DEBUG_PRINTF("\r\n");
+    /* Data is received from Node, validate the content */
+    app_conn_t *conn = AppConnByCid(rxDataParam->lCid);
+    if(conn == NULL)
+    {
+        DEBUG_PRINTF("Wraparound failed \r\n");
+        return;
+    }
+    /* The echo is handled within this event, its buffer is free right away */
+    Credit_OnRx(&conn->credit, rxDataParam->rxDataLength);
+    Credit_OnDrain(&conn->credit, rxDataParam->rxDataLength);
+    /* The echo is a UDP datagram from the echo service of the Node */
+    iphc_header_t ipHdr;
+    uint16_t ipHdrLen;
+    iphc_result_t ipResult = Iphc_Decompress(rxDataParam->rxData, rxDataParam->rxDataLength,
+                                             &conn->ipLink, &ipHdr, &ipHdrLen);
+    if((ipResult != IPHC_OK) || (ipHdr.nextHeader != IPV6_NEXT_HEADER_UDP) ||
+       (ipHdr.srcPort != LOOPBACK_ECHO_PORT) || (ipHdr.dstPort != LOOPBACK_UDP_PORT))
+    {
+        DEBUG_PRINTF("Wraparound failed: not a loopback datagram (%d) \r\n", ipResult);
+        if(ipResult == IPHC_TRUNCATED)
+        {
+            conn->loopbackTruncated++;
+        }
+        else
+        {
+            conn->loopbackUnknown++;
+        }
+        LoopbackBenchEcho(conn, LOOPBACK_ECHO_UNKNOWN);
+        return;
+    }
+    uint32_t echoResult = LoopbackCheckEcho(conn, &rxDataParam->rxData[ipHdrLen],
+        (uint16_t)(rxDataParam->rxDataLength - ipHdrLen),
+        (Iphc_UdpChecksum(&ipHdr, &rxDataParam->rxData[ipHdrLen]) == ipHdr.checksum));
+    LoopbackBenchEcho(conn, echoResult);
+    if(echoResult == LOOPBACK_ECHO_OK)
+    {
+        ConnTime_Report(&conn->setupTime, conn->connHandle.attId);
+        if(conn->loopbackEchoed == 1u)
+        {
+            conn->serviceChangedPending = true;
+        }
+    }
+    else
+    {
+        DEBUG_PRINTF("Wraparound failed: %s \r\n",
+            (echoResult == LOOPBACK_ECHO_CORRUPTED) ? "corrupted" :
+            (echoResult == LOOPBACK_ECHO_TRUNCATED) ? "truncated" : "unknown sequence");
+    }
+    if((conn->loopBackStarted != 0u) && (conn->loopbackOutstanding < loopbackWindow))
+    {
+        /* Refill the window with new Data packets to Node through IPSP channel  */
+        conn->refillPending = true;
+    }
+}
+
+/*******************************************************************************
+* Function Name: L2capRxCreditHandler()
+********************************************************************************
+*
+* Summary:
+*   Handles CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND: receive credits reached the
+*   low mark.
+*
+*******************************************************************************/
+static void L2capRxCreditHandler(uint32 event, void* eventParam)
+{
+    cy_stc_ble_l2cap_cbfc_low_rx_credit_param_t *rxCreditParam =
+        (cy_stc_ble_l2cap_cbfc_low_rx_credit_param_t *)eventParam;
+    app_conn_t *conn = AppConnByCid(rxCreditParam->lCid);
+    cy_en_ble_api_result_t apiResult;
+
+    (void)event;
+    DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_RX_CREDIT_IND: lCid=%d, credit=%d \r\n",
+        rxCreditParam->lCid,
+        rxCreditParam->credit);
+
+    /* The credit controller normally tops them up before, let it decide */
+    apiResult = (conn != NULL) ?
+        Credit_Grant(&conn->credit, rxCreditParam->lCid, LOOPBACK_RX_BUFFERS) : CY_BLE_SUCCESS;
+    if(apiResult != CY_BLE_SUCCESS)
+    {
+        DEBUG_PRINTF("Cy_BLE_L2CAP_CbfcSendFlowControlCredit API Error: 0x%x \r\n", apiResult);
+    }
+}
+
+/*******************************************************************************
+* Function Name: L2capTxCreditHandler()
+********************************************************************************
+*
+* Summary:
+*   Handles CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND: the Node granted credits.
+*
+*******************************************************************************/
+static void L2capTxCreditHandler(uint32 event, void* eventParam)
+{
+    cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t *txCreditParam =
+        (cy_stc_ble_l2cap_cbfc_low_tx_credit_param_t *)eventParam;
+    app_conn_t *conn = AppConnByCid(txCreditParam->lCid);
+
+    (void)event;
+    if(conn != NULL)
+    {
+        Credit_TxAdd(&conn->credit, txCreditParam->credit);
+        conn->refillPending = (conn->loopBackStarted != 0u);
+    }
+    DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_TX_CREDIT_IND: lCid=%d, result=%d, credit=%d \r\n",
+        txCreditParam->lCid,
+        txCreditParam->result,
+        txCreditParam->credit);
+}
+
+/*******************************************************************************
+* Function Name: L2capDataWriteHandler()
+********************************************************************************
+*
+* Summary:
+*   Handles CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND: an SDU was sent.
+*
+*******************************************************************************/
+static void L2capDataWriteHandler(uint32 event, void* eventParam)
+{
+    (void)event;
+#if(DEBUG_UART_FULL)
+    cy_stc_ble_l2cap_cbfc_rx_data_param_t *writeDataParam = (cy_stc_ble_l2cap_cbfc_rx_data_param_t*)eventParam;
+    DEBUG_PRINTF("CY_BLE_EVT_L2CAP_CBFC_DATA_WRITE_IND: lCid=%d \r\n", writeDataParam->lCid);
+#else
+    (void)eventParam;
+#endif /* DEBUG_UART_FULL */
+}
+
+
 /*******************************************************************************
 * Function Name: EnterLowPowerMode()
 ********************************************************************************
@@ -879,7 +2313,8 @@ void StackEventHandler(uint32 event, void* eventParam)
 *
 * Theory:
 *  The function configures the device to enter deep sleep - whenever the
-*  BLE is idle and the UART transmission/reception is not happening.
+*  BLE is idle and the UART transmission/reception is not happening. While
+*  log output is pending the CPU only sleeps so that the UART keeps running.
 *
 *  In case of disconnection, the function configures the device to
 *  enter hibernate mode.
@@ -887,13 +2322,16 @@ void StackEventHandler(uint32 event, void* eventParam)
 *******************************************************************************/
 void EnterLowPowerMode(void)
 {
-    //DEBUG_PRINTF("Entering deep sleep mode \r\n");
-    DEBUG_WAIT_UART_TX_COMPLETE();
-
-    /* Configure deep sleep mode to wake up on interrupt */
-    Cy_SysPm_DeepSleep(CY_SYSPM_WAIT_FOR_INTERRUPT);
-
-    //DEBUG_PRINTF("Exiting deep sleep mode \r\n");
-    DEBUG_WAIT_UART_TX_COMPLETE();
+    if(DEBUG_UART_TX_IDLE() == true)
+    {
+        /* Configure deep sleep mode to wake up on interrupt */
+        Cy_SysPm_DeepSleep(CY_SYSPM_WAIT_FOR_INTERRUPT);
+    }
+    else
+    {
+        /* Deep sleep stops the debug UART: sleep instead and let the TX
+           interrupt drain the log, deep sleep is entered on a later pass */
+        Cy_SysPm_CpuEnterSleep(CY_SYSPM_WAIT_FOR_INTERRUPT);
+    }
 }
 /* [] END OF FILE */
@@ -79,6 +79,26 @@ CY_APP_CM4_SOURCE = \
 	Source/BLEFindMe.h\
 	Source/debug.c\
 	Source/debug.h\
+	Source/adv_table.c\
+	Source/adv_table.h\
+	Source/adv_data.c\
+	Source/adv_data.h\
+	Source/iphc.c\
+	Source/iphc.h\
+	Source/credit.c\
+	Source/credit.h\
+	Source/ble_dispatch.c\
+	Source/ble_dispatch.h\
+	Source/bench.c\
+	Source/bench.h\
+	Source/gatt_cache.c\
+	Source/gatt_cache.h\
+	Source/conn_time.c\
+	Source/conn_time.h\
+	Source/conn_policy.c\
+	Source/conn_policy.h\
+	Source/command.c\
+	Source/command.h\
 	Source/LED.h\
 	Source/stdio_user.h\
 	Source/stdio_user.c\
@@ -0,0 +1,791 @@
+/*******************************************************************************
+* File Name: conn_setup.c
+*
+* Version: 1.0
+*
+* Description:
+* This file contains the connection setup of the central. The PHY update,
+* the data length update and the MTU exchange are issued together as soon
+* as the GATT connection is up; the LL procedures run while the ATT
+* exchange is in flight. An LL procedure the stack refuses while the other
+* one runs is issued again when that one completes. Each step is started
+* from the completion event of the step before it:
+*
+*   connected -> PHY update
+*             -> data length update
+*             -> MTU exchange -> discovery -> CCCD write -> first notification
+*
+* The completion time of every step after the connection is printed with
+* the first notification.
+*
+* The discovery looks up only the Battery Service by UUID, its
+* characteristics and the CCCD of Battery Level, three ATT procedures in
+* place of the walk through the whole GATT database of
+* Cy_BLE_GATTC_StartDiscovery(). The service range and the handles are kept
+* here and copied to cy_ble_serverInfo and cy_ble_basc when the connection
+* has a row (see gatt_cache.h).
+* The CCCD is written with the handle found. Once it is written the GATT
+* service is looked up by UUID as well, then its Service Changed
+* characteristic and the CCCD of it, which is written with 0x0002 to enable
+* the indication; this is off the path to the first notification.
+* SETUP_FULL_DISCOVERY set to 1 selects the full discovery, to compare the
+* time to the first notification.
+*
+* The handles the targeted discovery finds are kept in the GATT cache
+* (gatt_cache.c) by the peer address. A reconnect to a known peer writes the
+* CCCD without a discovery, and the Service Changed CCCD after it. A CCCD
+* write that fails drops the peer from the cache and runs the targeted
+* discovery again on the same connection.
+*
+* Hardware Dependency:
+*  CY8CKIT-062 PSoC6 BLE Pioneer Kit
+*
+********************************************************************************
+* Copyright 2017, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "conn_setup.h"
+#include "throughput.h"
+#include "gatt_cache.h"
+
+static const char * const stepName[SETUP_STEP_COUNT] =
+{
+    "phy", "dle", "mtu", "discovery", "cccd", "first ntf"
+};
+
+/* Static global variables */
+#if (SETUP_FULL_DISCOVERY == 0u)
+static disc_phase_t             discPhase;
+static cy_stc_ble_gatt_attr_handle_range_t batteryServiceRange;
+static cy_stc_ble_gatt_attr_handle_range_t gattServiceRange;
+static cy_stc_ble_disc_srvc_info_t peerServerInfo[CY_BLE_SRVI_COUNT];   /* Kept in the GATT cache */
+static cy_ble_gatt_db_attr_handle_t batteryLevelEnd;    /* Last handle of the characteristic */
+static cy_ble_gatt_db_attr_handle_t batteryLevelHandle;
+static cy_ble_gatt_db_attr_handle_t batteryLevelCccdHandle;
+static cy_ble_gatt_db_attr_handle_t serviceChangedHandle;
+static cy_ble_gatt_db_attr_handle_t serviceChangedEnd;
+static cy_ble_gatt_db_attr_handle_t serviceChangedCccdHandle;
+static bool                     cacheHit;
+#endif /* SETUP_FULL_DISCOVERY == 0u */
+static uint8_t                  peerAddrType;
+static uint8_t                  peerAddr[CY_BLE_GAP_BD_ADDR_SIZE];
+static uint8_t                  setupBdHandle;
+static uint16_t                 setupConnIntv;
+static cy_stc_ble_conn_handle_t setupConnHandle;
+static uint64_t                 connectedUs;
+static setup_state_t            stepState[SETUP_STEP_COUNT];
+static uint32_t                 stepUs[SETUP_STEP_COUNT];    /* Completion after the connection */
+
+/*******************************************************************************
+* Function Name: StepEnd
+*******************************************************************************/
+static void StepEnd(setup_step_t step, bool success)
+{
+    if((stepState[step] == SETUP_STATE_RUNNING) || (stepState[step] == SETUP_STATE_DEFERRED))
+    {
+        stepState[step] = success ? SETUP_STATE_DONE : SETUP_STATE_FAILED;
+        stepUs[step] = (uint32_t)(ThroughputNowUs() - connectedUs);
+    }
+}
+
+/*******************************************************************************
+* Function Name: StartPhy
+*******************************************************************************/
+static void StartPhy(void)
+{
+    cy_stc_ble_set_phy_info_t phyParam =
+    {
+        .bdHandle   = setupBdHandle,
+        .allPhyMask = CY_BLE_PHY_NO_PREF_MASK_NONE,
+        .txPhyMask  = CY_BLE_PHY_MASK_LE_2M,
+        .rxPhyMask  = CY_BLE_PHY_MASK_LE_2M,
+        .phyOption  = 0u
+    };
+
+    stepState[SETUP_STEP_PHY] = (Cy_BLE_SetPhy(&phyParam) == CY_BLE_SUCCESS) ?
+                                SETUP_STATE_RUNNING : SETUP_STATE_DEFERRED;
+}
+
+/*******************************************************************************
+* Function Name: StartDle
+*******************************************************************************/
+static void StartDle(void)
+{
+    cy_stc_ble_set_data_length_info_t dleParam =
+    {
+        .bdHandle        = setupBdHandle,
+        .connMaxTxOctets = SETUP_LL_TX_OCTETS,
+        .connMaxTxTime   = SETUP_LL_TX_TIME
+    };
+
+    stepState[SETUP_STEP_DLE] = (Cy_BLE_SetDataLength(&dleParam) == CY_BLE_SUCCESS) ?
+                                SETUP_STATE_RUNNING : SETUP_STATE_DEFERRED;
+}
+
+/*******************************************************************************
+* Function Name: LlProcedureEnd
+********************************************************************************
+*
+* Summary:
+*   Ends an LL procedure and issues the one the stack refused meanwhile. A
+*   procedure refused again, with nothing else running, has failed.
+*
+*******************************************************************************/
+static void LlProcedureEnd(setup_step_t step, bool success)
+{
+    setup_step_t other = (step == SETUP_STEP_PHY) ? SETUP_STEP_DLE : SETUP_STEP_PHY;
+
+    StepEnd(step, success);
+    if(stepState[other] == SETUP_STATE_DEFERRED)
+    {
+        if(other == SETUP_STEP_PHY)
+        {
+            StartPhy();
+        }
+        else
+        {
+            StartDle();
+        }
+        if(stepState[other] == SETUP_STATE_DEFERRED)
+        {
+            StepEnd(other, false);
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: StartMtu
+*******************************************************************************/
+static void StartMtu(void)
+{
+    cy_stc_ble_gatt_xchg_mtu_param_t mtuParam =
+    {
+        .connHandle = setupConnHandle,
+        .mtu        = SETUP_MTU
+    };
+
+    printf("Exchanging MTU size\r\n");
+    stepState[SETUP_STEP_MTU] = SETUP_STATE_RUNNING;
+    if(Cy_BLE_GATTC_ExchangeMtuReq(&mtuParam) != CY_BLE_SUCCESS)
+    {
+        StepEnd(SETUP_STEP_MTU, false);
+    }
+}
+
+#if (SETUP_FULL_DISCOVERY != 0u)
+/*******************************************************************************
+* Function Name: StartDiscovery
+*******************************************************************************/
+static void StartDiscovery(void)
+{
+    printf("Start Discovery\r\n");
+    stepState[SETUP_STEP_DISCOVERY] = SETUP_STATE_RUNNING;
+    if(Cy_BLE_GATTC_StartDiscovery(setupConnHandle) != CY_BLE_SUCCESS)
+    {
+        StepEnd(SETUP_STEP_DISCOVERY, false);
+    }
+}
+
+/*******************************************************************************
+* Function Name: StartCccd
+*******************************************************************************/
+static void StartCccd(void)
+{
+    uint8_t config[2u] = { 1u, 0u };
+
+    printf("Discovery Complete. Enable Notification\r\n");
+    stepState[SETUP_STEP_CCCD] = SETUP_STATE_RUNNING;
+    if(Cy_BLE_BASC_SetCharacteristicDescriptor(setupConnHandle, 0u, CY_BLE_BAS_BATTERY_LEVEL,
+                                               CY_BLE_BAS_BATTERY_LEVEL_CCCD, sizeof(config), config) != CY_BLE_SUCCESS)
+    {
+        StepEnd(SETUP_STEP_CCCD, false);
+    }
+}
+
+#else
+/*******************************************************************************
+* Function Name: ServiceHandlesPublish
+********************************************************************************
+*
+* Summary:
+*   Copies the Battery Service range to the cy_ble_serverInfo row of the
+*   connection and the Battery Level value and CCCD handles to the
+*   cy_ble_basc row, when the stack has bound one to it, so the BAS client
+*   API works on the handles the targeted discovery found.
+*
+*******************************************************************************/
+static void ServiceHandlesPublish(void)
+{
+    uint32_t discIdx = Cy_BLE_GetDiscoveryIdx(setupConnHandle);
+
+    if(discIdx < CY_BLE_GATTC_COUNT)
+    {
+        cy_ble_serverInfo[discIdx][CY_BLE_SRVI_BAS].range = batteryServiceRange;
+        cy_ble_basc[discIdx][0u].batteryLevel.valueHandle = batteryLevelHandle;
+        cy_ble_basc[discIdx][0u].descriptors[CY_BLE_BAS_BATTERY_LEVEL_CCCD] = batteryLevelCccdHandle;
+    }
+}
+
+/*******************************************************************************
+* Function Name: StartCccd
+*******************************************************************************/
+static void StartCccd(void)
+{
+    uint8_t config[2u] = { 1u, 0u };
+    cy_stc_ble_gattc_write_req_t param =
+    {
+        .handleValPair.value.val  = config,
+        .handleValPair.value.len  = sizeof(config),
+        .handleValPair.attrHandle = batteryLevelCccdHandle,
+        .connHandle               = setupConnHandle
+    };
+
+    printf("Discovery Complete. Enable Notification\r\n");
+    stepState[SETUP_STEP_CCCD] = SETUP_STATE_RUNNING;
+    if(Cy_BLE_GATTC_WriteCharacteristicDescriptors(&param) != CY_BLE_SUCCESS)
+    {
+        StepEnd(SETUP_STEP_CCCD, false);
+    }
+}
+
+/*******************************************************************************
+* Function Name: StartDiscovery
+********************************************************************************
+*
+* Summary:
+*   Looks for the Battery Service by its UUID.
+*
+*******************************************************************************/
+static void StartDiscovery(void)
+{
+    uint8_t uuid[CY_BLE_GATT_16_BIT_UUID_SIZE] =
+        { (uint8_t)CY_BLE_UUID_BAS_SERVICE, (uint8_t)(CY_BLE_UUID_BAS_SERVICE >> 8u) };
+    cy_stc_ble_gattc_find_by_type_value_req_t param =
+    {
+        .value      = { .val = uuid, .len = sizeof(uuid), .actualLen = sizeof(uuid) },
+        .range      = { .startHandle = CY_BLE_GATT_ATTR_HANDLE_START_RANGE,
+                        .endHandle   = CY_BLE_GATT_ATTR_HANDLE_END_RANGE },
+        .connHandle = setupConnHandle
+    };
+    uint16_t handle[GATT_CACHE_HANDLES];
+
+    stepState[SETUP_STEP_DISCOVERY] = SETUP_STATE_RUNNING;
+    cacheHit = GattCache_Restore(peerAddr, peerAddrType, peerServerInfo, handle);
+    if(cacheHit == true)
+    {
+        printf("Handles from the GATT cache\r\n");
+        batteryServiceRange = peerServerInfo[CY_BLE_SRVI_BAS].range;
+        gattServiceRange = peerServerInfo[CY_BLE_SRVI_GATT].range;
+        batteryLevelHandle = handle[0u];
+        batteryLevelCccdHandle = handle[1u];
+        serviceChangedHandle = handle[2u];
+        serviceChangedCccdHandle = handle[3u];
+        ServiceHandlesPublish();
+        StepEnd(SETUP_STEP_DISCOVERY, true);
+        StartCccd();
+        return;
+    }
+
+    printf("Start Discovery of the Battery Service\r\n");
+    batteryServiceRange.startHandle = 0u;
+    batteryServiceRange.endHandle = 0u;
+    gattServiceRange.startHandle = 0u;
+    gattServiceRange.endHandle = 0u;
+    batteryLevelHandle = 0u;
+    batteryLevelEnd = 0u;
+    batteryLevelCccdHandle = 0u;
+    serviceChangedHandle = 0u;
+    serviceChangedCccdHandle = 0u;
+    discPhase = DISC_PHASE_SERVICE;
+    if(Cy_BLE_GATTC_DiscoverPrimaryServiceByUuid(&param) != CY_BLE_SUCCESS)
+    {
+        StepEnd(SETUP_STEP_DISCOVERY, false);
+    }
+}
+
+/*******************************************************************************
+* Function Name: StartGattLookup
+********************************************************************************
+*
+* Summary:
+*   Looks for the GATT service by its UUID, the start of the Service Changed
+*   lookup.
+*
+*******************************************************************************/
+static void StartGattLookup(void)
+{
+    uint8_t uuid[CY_BLE_GATT_16_BIT_UUID_SIZE] =
+        { (uint8_t)CY_BLE_UUID_GATT_SERVICE, (uint8_t)(CY_BLE_UUID_GATT_SERVICE >> 8u) };
+    cy_stc_ble_gattc_find_by_type_value_req_t param =
+    {
+        .value      = { .val = uuid, .len = sizeof(uuid), .actualLen = sizeof(uuid) },
+        .range      = { .startHandle = CY_BLE_GATT_ATTR_HANDLE_START_RANGE,
+                        .endHandle   = CY_BLE_GATT_ATTR_HANDLE_END_RANGE },
+        .connHandle = setupConnHandle
+    };
+
+    discPhase = DISC_PHASE_GATT;
+    if(Cy_BLE_GATTC_DiscoverPrimaryServiceByUuid(&param) != CY_BLE_SUCCESS)
+    {
+        discPhase = DISC_PHASE_IDLE;
+    }
+}
+
+/*******************************************************************************
+* Function Name: StartServiceChanged
+********************************************************************************
+*
+* Summary:
+*   Enables the Service Changed indication after the CCCD write of Battery
+*   Level; a server sends it only to a client that wrote its CCCD. The
+*   handles come from the cache, or the lookup starts with the GATT service.
+*
+*******************************************************************************/
+static void StartServiceChanged(void)
+{
+    uint8_t config[2u] = { 2u, 0u };
+    cy_stc_ble_gattc_write_req_t param =
+    {
+        .handleValPair.value.val  = config,
+        .handleValPair.value.len  = sizeof(config),
+        .handleValPair.attrHandle = serviceChangedCccdHandle,
+        .connHandle               = setupConnHandle
+    };
+
+    if(serviceChangedCccdHandle == 0u)
+    {
+        StartGattLookup();
+        return;
+    }
+    discPhase = DISC_PHASE_SC_ENABLE;
+    if(Cy_BLE_GATTC_WriteCharacteristicDescriptors(&param) != CY_BLE_SUCCESS)
+    {
+        discPhase = DISC_PHASE_IDLE;
+    }
+}
+
+/*******************************************************************************
+* Function Name: CacheStore
+*******************************************************************************/
+static void CacheStore(void)
+{
+    uint16_t handle[GATT_CACHE_HANDLES] =
+        { batteryLevelHandle, batteryLevelCccdHandle, serviceChangedHandle, serviceChangedCccdHandle };
+
+    GattCache_Store(peerAddr, peerAddrType, peerServerInfo, handle);
+}
+
+/*******************************************************************************
+* Function Name: DiscoveryResponse
+********************************************************************************
+*
+* Summary:
+*   Takes the handles of the discovery responses.
+*
+*******************************************************************************/
+static void DiscoveryResponse(uint32_t event, void *eventParam)
+{
+    cy_stc_ble_gattc_find_by_type_rsp_param_t *service = (cy_stc_ble_gattc_find_by_type_rsp_param_t *)eventParam;
+    cy_stc_ble_gattc_read_by_type_rsp_param_t *chars = (cy_stc_ble_gattc_read_by_type_rsp_param_t *)eventParam;
+    cy_stc_ble_gattc_find_info_rsp_param_t *descr = (cy_stc_ble_gattc_find_info_rsp_param_t *)eventParam;
+    const uint8_t *p;
+    uint32_t i;
+
+    if((event == CY_BLE_EVT_GATTC_FIND_BY_TYPE_VALUE_RSP) && (discPhase == DISC_PHASE_SERVICE) &&
+       (service->count != 0u) && (batteryServiceRange.startHandle == 0u))
+    {
+        batteryServiceRange = service->range[0u];
+    }
+    else if((event == CY_BLE_EVT_GATTC_FIND_BY_TYPE_VALUE_RSP) && (discPhase == DISC_PHASE_GATT) &&
+            (service->count != 0u) && (gattServiceRange.startHandle == 0u))
+    {
+        gattServiceRange = service->range[0u];
+    }
+    else if((event == CY_BLE_EVT_GATTC_READ_BY_TYPE_RSP) && (discPhase == DISC_PHASE_SC_CHAR))
+    {
+        for(i = 0u; (chars->attrData.attrLen >= 7u) && ((i + chars->attrData.attrLen) <= chars->attrData.length);
+            i += chars->attrData.attrLen)
+        {
+            p = &chars->attrData.attrValue[i];
+            if((serviceChangedHandle != 0u) && (serviceChangedEnd == 0u))
+            {
+                serviceChangedEnd = (cy_ble_gatt_db_attr_handle_t)((p[0u] | ((uint16_t)p[1u] << 8u)) - 1u);
+            }
+            else if((serviceChangedHandle == 0u) && (chars->attrData.attrLen == 7u) &&
+                    ((p[5u] | ((uint16_t)p[6u] << 8u)) == CY_BLE_UUID_CHAR_SERVICE_CHANGED))
+            {
+                serviceChangedHandle = (cy_ble_gatt_db_attr_handle_t)(p[3u] | ((uint16_t)p[4u] << 8u));
+            }
+        }
+    }
+    else if((event == CY_BLE_EVT_GATTC_READ_BY_TYPE_RSP) && (discPhase == DISC_PHASE_CHAR))
+    {
+        /* Declaration handle, properties, value handle, UUID of 16 or 128 bits */
+        for(i = 0u; (chars->attrData.attrLen >= 7u) && ((i + chars->attrData.attrLen) <= chars->attrData.length);
+            i += chars->attrData.attrLen)
+        {
+            p = &chars->attrData.attrValue[i];
+            if((batteryLevelHandle != 0u) && (batteryLevelEnd == 0u))
+            {
+                /* The next declaration ends the Battery Level characteristic */
+                batteryLevelEnd = (cy_ble_gatt_db_attr_handle_t)((p[0u] | ((uint16_t)p[1u] << 8u)) - 1u);
+            }
+            else if((batteryLevelHandle == 0u) && (chars->attrData.attrLen == 7u) &&
+                    ((p[5u] | ((uint16_t)p[6u] << 8u)) == CY_BLE_UUID_CHAR_BATTERY_LEVEL))
+            {
+                batteryLevelHandle = (cy_ble_gatt_db_attr_handle_t)(p[3u] | ((uint16_t)p[4u] << 8u));
+            }
+        }
+    }
+    else if((event == CY_BLE_EVT_GATTC_FIND_INFO_RSP) &&
+            ((discPhase == DISC_PHASE_CCCD) || (discPhase == DISC_PHASE_SC_CCCD)) &&
+            (descr->uuidFormat == CY_BLE_GATT_16_BIT_UUID_FORMAT))
+    {
+        cy_ble_gatt_db_attr_handle_t *cccd = (discPhase == DISC_PHASE_CCCD) ?
+                                             &batteryLevelCccdHandle : &serviceChangedCccdHandle;
+
+        /* Handle, 16-bit UUID */
+        for(i = 0u; (i + 4u) <= descr->handleValueList.byteCount; i += 4u)
+        {
+            p = &descr->handleValueList.list[i];
+            if((*cccd == 0u) &&
+               ((p[2u] | ((uint16_t)p[3u] << 8u)) == CY_BLE_UUID_CHAR_CLIENT_CONFIG))
+            {
+                *cccd = (cy_ble_gatt_db_attr_handle_t)(p[0u] | ((uint16_t)p[1u] << 8u));
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+* Function Name: DiscoveryNext
+********************************************************************************
+*
+* Summary:
+*   Starts the next discovery procedure when the stack ends one: the
+*   characteristics in the service range, then the descriptors between the
+*   Battery Level value and the next characteristic declaration, or the end
+*   of the service after the last characteristic. The Service Changed lookup
+*   takes the same steps in the GATT service range and ends with the write
+*   of its CCCD.
+*
+*******************************************************************************/
+static void DiscoveryNext(void)
+{
+    cy_stc_ble_gattc_read_by_type_req_t charParam;
+    cy_stc_ble_gattc_find_info_req_t descrParam;
+    cy_en_ble_api_result_t result = CY_BLE_ERROR_INVALID_OPERATION;
+
+    switch(discPhase)
+    {
+        case DISC_PHASE_SERVICE:
+            if(batteryServiceRange.startHandle != 0u)
+            {
+                charParam.range = batteryServiceRange;
+                charParam.connHandle = setupConnHandle;
+                discPhase = DISC_PHASE_CHAR;
+                result = Cy_BLE_GATTC_DiscoverCharacteristics(&charParam);
+            }
+            break;
+
+        case DISC_PHASE_CHAR:
+            if(batteryLevelEnd == 0u)
+            {
+                batteryLevelEnd = batteryServiceRange.endHandle;
+            }
+            if((batteryLevelHandle != 0u) && (batteryLevelHandle < batteryLevelEnd))
+            {
+                descrParam.range.startHandle = batteryLevelHandle + 1u;
+                descrParam.range.endHandle = batteryLevelEnd;
+                descrParam.connHandle = setupConnHandle;
+                discPhase = DISC_PHASE_CCCD;
+                result = Cy_BLE_GATTC_DiscoverCharacteristicDescriptors(&descrParam);
+            }
+            break;
+
+        case DISC_PHASE_CCCD:
+            discPhase = DISC_PHASE_IDLE;
+            StepEnd(SETUP_STEP_DISCOVERY, batteryLevelCccdHandle != 0u);
+            if(batteryLevelCccdHandle != 0u)
+            {
+                ServiceHandlesPublish();
+                memset(peerServerInfo, 0, sizeof(peerServerInfo));
+                peerServerInfo[CY_BLE_SRVI_BAS].range = batteryServiceRange;
+                CacheStore();
+                StartCccd();
+            }
+            return;
+
+        case DISC_PHASE_GATT:
+            if(gattServiceRange.startHandle != 0u)
+            {
+                peerServerInfo[CY_BLE_SRVI_GATT].range = gattServiceRange;
+                CacheStore();
+                charParam.range = gattServiceRange;
+                charParam.connHandle = setupConnHandle;
+                serviceChangedHandle = 0u;
+                serviceChangedEnd = 0u;
+                serviceChangedCccdHandle = 0u;
+                discPhase = DISC_PHASE_SC_CHAR;
+                result = Cy_BLE_GATTC_DiscoverCharacteristics(&charParam);
+            }
+            break;
+
+        case DISC_PHASE_SC_CHAR:
+            if(serviceChangedEnd == 0u)
+            {
+                serviceChangedEnd = gattServiceRange.endHandle;
+            }
+            if((serviceChangedHandle != 0u) && (serviceChangedHandle < serviceChangedEnd))
+            {
+                descrParam.range.startHandle = serviceChangedHandle + 1u;
+                descrParam.range.endHandle = serviceChangedEnd;
+                descrParam.connHandle = setupConnHandle;
+                discPhase = DISC_PHASE_SC_CCCD;
+                result = Cy_BLE_GATTC_DiscoverCharacteristicDescriptors(&descrParam);
+            }
+            break;
+
+        case DISC_PHASE_SC_CCCD:
+            discPhase = DISC_PHASE_IDLE;
+            if(serviceChangedCccdHandle != 0u)
+            {
+                CacheStore();
+                StartServiceChanged();
+            }
+            return;
+
+        default:
+            return;
+    }
+    if(result != CY_BLE_SUCCESS)
+    {
+        /* The Service Changed lookup is not a setup step */
+        if(discPhase < DISC_PHASE_GATT)
+        {
+            StepEnd(SETUP_STEP_DISCOVERY, false);
+        }
+        discPhase = DISC_PHASE_IDLE;
+    }
+}
+
+/*******************************************************************************
+* Function Name: HandleValueIndication
+********************************************************************************
+*
+* Summary:
+*   Confirms an indication. Service Changed: the cached handles of the peer
+*   are out of date.
+*
+*******************************************************************************/
+static void HandleValueIndication(cy_stc_ble_gattc_handle_value_ind_param_t *ind)
+{
+    if((serviceChangedHandle != 0u) && (ind->handleValPair.attrHandle == serviceChangedHandle))
+    {
+        printf("Service Changed, GATT cache entry dropped\r\n");
+        GattCache_Invalidate(peerAddr, peerAddrType);
+    }
+    (void) Cy_BLE_GATTC_SendConfirmation(&ind->connHandle);
+}
+#endif /* SETUP_FULL_DISCOVERY != 0u */
+
+/*******************************************************************************
+* Function Name: PrintSteps
+*******************************************************************************/
+static void PrintSteps(void)
+{
+    uint32_t i;
+
+    printf("Setup, ms after connection:");
+    for(i = 0u; i < SETUP_STEP_COUNT; i++)
+    {
+        if(stepState[i] == SETUP_STATE_DONE)
+        {
+            printf(" %s %lu.%lu", stepName[i], (unsigned long)(stepUs[i] / 1000u),
+                   (unsigned long)((stepUs[i] % 1000u) / 100u));
+        }
+        else
+        {
+            printf(" %s %s", stepName[i], (stepState[i] == SETUP_STATE_FAILED) ? "failed" : "-");
+        }
+    }
+    printf("\r\n");
+}
+
+/*******************************************************************************
+* Function Name: ConnSetupEvent
+********************************************************************************
+*
+* Summary:
+*   Runs the setup from the stack events, called for every event.
+*
+* Parameters:
+*   event      - the event code
+*   eventParam - the event parameters
+*
+*******************************************************************************/
+void ConnSetupEvent(uint32_t event, void *eventParam)
+{
+    uint32_t i;
+
+    switch(event)
+    {
+        case CY_BLE_EVT_GAP_DEVICE_CONNECTED:
+            setupBdHandle = ((cy_stc_ble_gap_connected_param_t *)eventParam)->bdHandle;
+            peerAddrType = ((cy_stc_ble_gap_connected_param_t *)eventParam)->peerAddrType;
+            memcpy(peerAddr, ((cy_stc_ble_gap_connected_param_t *)eventParam)->peerAddr, CY_BLE_GAP_BD_ADDR_SIZE);
+            setupConnIntv = ((cy_stc_ble_gap_connected_param_t *)eventParam)->connIntv;
+            connectedUs = ThroughputNowUs();
+            for(i = 0u; i < SETUP_STEP_COUNT; i++)
+            {
+                stepState[i] = SETUP_STATE_IDLE;
+                stepUs[i] = 0u;
+            }
+            break;
+
+        case CY_BLE_EVT_GAP_CONNECTION_UPDATE_COMPLETE:
+            setupConnIntv = ((cy_stc_ble_gap_conn_param_updated_in_controller_t *)eventParam)->connIntv;
+            break;
+
+        case CY_BLE_EVT_GATT_CONNECT_IND:
+            /* The LL procedures and the ATT exchange go out together */
+            setupConnHandle = *(cy_stc_ble_conn_handle_t *)eventParam;
+            StartPhy();
+            StartDle();
+            StartMtu();
+            break;
+
+        case CY_BLE_EVT_SET_PHY_COMPLETE:
+            if(((cy_stc_ble_events_param_generic_t *)eventParam)->status != 0u)
+            {
+                LlProcedureEnd(SETUP_STEP_PHY, false);
+            }
+            break;
+
+        case CY_BLE_EVT_PHY_UPDATE_COMPLETE:
+            LlProcedureEnd(SETUP_STEP_PHY, ((cy_stc_ble_events_param_generic_t *)eventParam)->status == 0u);
+            break;
+
+        case CY_BLE_EVT_SET_DATA_LENGTH_COMPLETE:
+            if(((cy_stc_ble_events_param_generic_t *)eventParam)->status != 0u)
+            {
+                LlProcedureEnd(SETUP_STEP_DLE, false);
+            }
+            break;
+
+        case CY_BLE_EVT_DATA_LENGTH_CHANGE:
+            LlProcedureEnd(SETUP_STEP_DLE, true);
+            break;
+
+        case CY_BLE_EVT_GATTC_XCHNG_MTU_RSP:
+            StepEnd(SETUP_STEP_MTU, true);
+            StartDiscovery();
+            break;
+
+        case CY_BLE_EVT_GATTC_ERROR_RSP:
+            /* A peer without the MTU exchange keeps the default MTU */
+            if(stepState[SETUP_STEP_MTU] == SETUP_STATE_RUNNING)
+            {
+                StepEnd(SETUP_STEP_MTU, false);
+                StartDiscovery();
+            }
+#if (SETUP_FULL_DISCOVERY == 0u)
+            else if(discPhase == DISC_PHASE_SC_ENABLE)
+            {
+                /* A Service Changed CCCD from the cache that is no longer
+                 * valid, the lookup finds the current one */
+                discPhase = DISC_PHASE_IDLE;
+                if(cacheHit == true)
+                {
+                    cacheHit = false;
+                    serviceChangedCccdHandle = 0u;
+                    StartGattLookup();
+                }
+            }
+#endif /* SETUP_FULL_DISCOVERY == 0u */
+            else if(stepState[SETUP_STEP_CCCD] == SETUP_STATE_RUNNING)
+            {
+                StepEnd(SETUP_STEP_CCCD, false);
+#if (SETUP_FULL_DISCOVERY == 0u)
+                /* A handle from the cache that is no longer valid, the
+                 * discovery finds the current one */
+                if(cacheHit == true)
+                {
+                    GattCache_Invalidate(peerAddr, peerAddrType);
+                    StartDiscovery();
+                }
+#endif /* SETUP_FULL_DISCOVERY == 0u */
+            }
+            /* The discovery procedures end with Attribute Not Found, then
+             * CY_BLE_EVT_GATTC_LONG_PROCEDURE_END */
+            break;
+
+#if (SETUP_FULL_DISCOVERY != 0u)
+        case CY_BLE_EVT_GATTC_DISCOVERY_COMPLETE:
+            StepEnd(SETUP_STEP_DISCOVERY, true);
+            StartCccd();
+            break;
+#else
+        case CY_BLE_EVT_GATTC_FIND_BY_TYPE_VALUE_RSP:
+        case CY_BLE_EVT_GATTC_READ_BY_TYPE_RSP:
+        case CY_BLE_EVT_GATTC_FIND_INFO_RSP:
+            DiscoveryResponse(event, eventParam);
+            break;
+
+        /* The stack runs every discovery procedure to the end of its range */
+        case CY_BLE_EVT_GATTC_LONG_PROCEDURE_END:
+            DiscoveryNext();
+            break;
+
+        case CY_BLE_EVT_GATTC_HANDLE_VALUE_IND:
+            HandleValueIndication((cy_stc_ble_gattc_handle_value_ind_param_t *)eventParam);
+            break;
+#endif /* SETUP_FULL_DISCOVERY != 0u */
+
+        case CY_BLE_EVT_GATTC_WRITE_RSP:
+            if(stepState[SETUP_STEP_CCCD] == SETUP_STATE_RUNNING)
+            {
+                StepEnd(SETUP_STEP_CCCD, true);
+                printf("Notifications enabled Successfully\r\n");
+                ThroughputStart(setupConnIntv);
+#if (SETUP_FULL_DISCOVERY == 0u)
+                StartServiceChanged();
+#endif /* SETUP_FULL_DISCOVERY == 0u */
+            }
+#if (SETUP_FULL_DISCOVERY == 0u)
+            else if(discPhase == DISC_PHASE_SC_ENABLE)
+            {
+                discPhase = DISC_PHASE_IDLE;
+                printf("Service Changed indication enabled\r\n");
+            }
+#endif /* SETUP_FULL_DISCOVERY == 0u */
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*******************************************************************************
+* Function Name: ConnSetupNotification
+********************************************************************************
+*
+* Summary:
+*   Ends the setup with the first notification and prints the step times.
+*
+*******************************************************************************/
+void ConnSetupNotification(void)
+{
+    if(stepState[SETUP_STEP_FIRST_NTF] == SETUP_STATE_IDLE)
+    {
+        stepState[SETUP_STEP_FIRST_NTF] = SETUP_STATE_RUNNING;
+        StepEnd(SETUP_STEP_FIRST_NTF, true);
+        PrintSteps();
+    }
+}
+
+/* [] END OF FILE */
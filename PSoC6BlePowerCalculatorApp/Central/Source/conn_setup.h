@@ -0,0 +1,78 @@
+/*******************************************************************************
+* File Name: conn_setup.h
+*
+* Version 1.0
+*
+* Description:
+*  Contains the function prototypes and constants of the connection setup of
+*  the central: PHY, data length and MTU negotiation, discovery and the
+*  notification enable.
+*
+********************************************************************************
+* Copyright 2017, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include "cy_device_headers.h"
+#include "cycfg.h"
+#include "cycfg_ble.h"
+#include <stdbool.h>
+
+
+/***************************************
+*          Constants
+***************************************/
+#ifndef SETUP_FULL_DISCOVERY
+    #define SETUP_FULL_DISCOVERY    (0u)            /* 1: Cy_BLE_GATTC_StartDiscovery() */
+#endif /* ifndef SETUP_FULL_DISCOVERY */
+
+#define SETUP_MTU                   (512u)          /* Requested ATT MTU */
+#define SETUP_LL_TX_OCTETS          (251u)          /* Requested LL data length */
+#define SETUP_LL_TX_TIME            (2120u)         /* 251 octets on the 1M PHY, in us */
+
+
+/***************************************
+*       Data Types
+***************************************/
+typedef enum
+{
+    SETUP_STEP_PHY,
+    SETUP_STEP_DLE,
+    SETUP_STEP_MTU,
+    SETUP_STEP_DISCOVERY,
+    SETUP_STEP_CCCD,
+    SETUP_STEP_FIRST_NTF,
+    SETUP_STEP_COUNT
+} setup_step_t;
+
+typedef enum
+{
+    DISC_PHASE_IDLE,
+    DISC_PHASE_SERVICE,             /* Battery Service by UUID */
+    DISC_PHASE_CHAR,                /* Characteristics of the service */
+    DISC_PHASE_CCCD,                /* Descriptors of the characteristic */
+    DISC_PHASE_GATT,                /* GATT service by UUID, for Service Changed */
+    DISC_PHASE_SC_CHAR,             /* Characteristics of the GATT service */
+    DISC_PHASE_SC_CCCD,             /* Descriptors of Service Changed */
+    DISC_PHASE_SC_ENABLE            /* Service Changed CCCD write */
+} disc_phase_t;
+
+typedef enum
+{
+    SETUP_STATE_IDLE,
+    SETUP_STATE_DEFERRED,           /* The stack refused it while another LL procedure ran */
+    SETUP_STATE_RUNNING,
+    SETUP_STATE_DONE,
+    SETUP_STATE_FAILED
+} setup_state_t;
+
+
+/***************************************
+*       Function Prototypes
+***************************************/
+void ConnSetupEvent(uint32_t event, void *eventParam);
+void ConnSetupNotification(void);
+
+/* [] END OF FILE */
@@ -0,0 +1,216 @@
+/*******************************************************************************
+* File Name: gatt_cache.c
+*
+* Version: 1.00
+*
+* Description:
+*  This file contains the GATT discovery cache. After a discovery the non
+*  empty service ranges, and a few attribute handles the application found
+*  itself, are stored under the BD address of the peer. On a reconnect they
+*  are written back in place of a new discovery, to a service table the
+*  application keeps (see gatt_cache.h). The application removes an entry
+*  once it finds it out of date.
+*
+*  The cache is in RAM: it covers the reconnects of a running device, a
+*  reset starts with a discovery of every peer. A peer with a resolvable
+*  private address is seen as a new peer after each address change.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <string.h>
+#include "gatt_cache.h"
+
+static gatt_cache_entry_t   gattCache[GATT_CACHE_PEERS];
+static gatt_cache_stats_t   gattCacheStats;
+static uint32_t             gattCacheUse;
+
+/******************************************************************************
+* Function Name: GattCache_Find
+*******************************************************************************
+*
+* Summary:
+*  Returns the entry of a peer, NULL when it is not cached.
+*
+******************************************************************************/
+static gatt_cache_entry_t *GattCache_Find(const uint8_t addr[], uint8_t addrType)
+{
+    uint32_t i;
+
+    for(i = 0u; i < GATT_CACHE_PEERS; i++)
+    {
+        if((gattCache[i].valid == true) && (gattCache[i].addrType == addrType) &&
+           (memcmp(gattCache[i].addr, addr, CY_BLE_GAP_BD_ADDR_SIZE) == 0))
+        {
+            return(&gattCache[i]);
+        }
+    }
+    return(NULL);
+}
+
+/******************************************************************************
+* Function Name: GattCache_Init
+*******************************************************************************
+*
+* Summary:
+*  Empties the cache.
+*
+******************************************************************************/
+void GattCache_Init(void)
+{
+    memset(gattCache, 0, sizeof(gattCache));
+    memset(&gattCacheStats, 0, sizeof(gattCacheStats));
+    gattCacheUse = 0u;
+}
+
+/******************************************************************************
+* Function Name: GattCache_Restore
+*******************************************************************************
+*
+* Summary:
+*  Writes the cached discovery of a peer to a service table.
+*
+* Parameters:
+*  addr, addrType: the BD address of the peer.
+*  serverInfo: CY_BLE_SRVI_COUNT service ranges of the connection.
+*  handle: receives the GATT_CACHE_HANDLES handles of the application, may be
+*          NULL.
+*
+* Return:
+*  true when the peer was cached, the discovery can be skipped.
+*
+******************************************************************************/
+bool GattCache_Restore(const uint8_t addr[], uint8_t addrType,
+                       cy_stc_ble_disc_srvc_info_t serverInfo[], uint16_t handle[])
+{
+    gatt_cache_entry_t *entry = GattCache_Find(addr, addrType);
+    uint32_t i;
+
+    if(entry == NULL)
+    {
+        gattCacheStats.misses++;
+        return(false);
+    }
+    for(i = 0u; i < CY_BLE_SRVI_COUNT; i++)
+    {
+        serverInfo[i].range.startHandle = 0u;
+        serverInfo[i].range.endHandle = 0u;
+    }
+    for(i = 0u; i < entry->services; i++)
+    {
+        serverInfo[entry->service[i].srvi].range = entry->service[i].range;
+    }
+    if(handle != NULL)
+    {
+        memcpy(handle, entry->handle, sizeof(entry->handle));
+    }
+    entry->lastUse = ++gattCacheUse;
+    gattCacheStats.hits++;
+    return(true);
+}
+
+/******************************************************************************
+* Function Name: GattCache_Store
+*******************************************************************************
+*
+* Summary:
+*  Keeps the discovery of a peer, replacing its old entry or else the least
+*  recently used one. A peer with more than GATT_CACHE_SERVICES services is
+*  not kept and gets a discovery on each connection; its old entry is removed
+*  and no other entry is replaced.
+*
+* Parameters:
+*  addr, addrType: the BD address of the peer.
+*  serverInfo: CY_BLE_SRVI_COUNT service ranges of the connection.
+*  handle: GATT_CACHE_HANDLES handles of the application, may be NULL.
+*
+******************************************************************************/
+void GattCache_Store(const uint8_t addr[], uint8_t addrType,
+                     const cy_stc_ble_disc_srvc_info_t serverInfo[], const uint16_t handle[])
+{
+    gatt_cache_entry_t *entry = GattCache_Find(addr, addrType);
+    uint32_t services = 0u;
+    uint32_t i;
+
+    for(i = 0u; i < CY_BLE_SRVI_COUNT; i++)
+    {
+        if(serverInfo[i].range.startHandle != 0u)
+        {
+            services++;
+        }
+    }
+    if(services > GATT_CACHE_SERVICES)
+    {
+        if(entry != NULL)
+        {
+            entry->valid = false;
+        }
+        gattCacheStats.rejects++;
+        return;
+    }
+
+    if(entry == NULL)
+    {
+        entry = &gattCache[0u];
+        for(i = 1u; (i < GATT_CACHE_PEERS) && (entry->valid == true); i++)
+        {
+            if((gattCache[i].valid == false) || (gattCache[i].lastUse < entry->lastUse))
+            {
+                entry = &gattCache[i];
+            }
+        }
+    }
+    memset(entry, 0, sizeof(gatt_cache_entry_t));
+    for(i = 0u; i < CY_BLE_SRVI_COUNT; i++)
+    {
+        if(serverInfo[i].range.startHandle == 0u)
+        {
+            continue;
+        }
+        entry->service[entry->services].srvi = (uint8_t)i;
+        entry->service[entry->services].range = serverInfo[i].range;
+        entry->services++;
+    }
+    if(handle != NULL)
+    {
+        memcpy(entry->handle, handle, sizeof(entry->handle));
+    }
+    memcpy(entry->addr, addr, CY_BLE_GAP_BD_ADDR_SIZE);
+    entry->addrType = addrType;
+    entry->lastUse = ++gattCacheUse;
+    entry->valid = true;
+    gattCacheStats.stores++;
+}
+
+/******************************************************************************
+* Function Name: GattCache_Invalidate
+*******************************************************************************
+*
+* Summary:
+*  Removes a peer whose cached handles are out of date.
+*
+******************************************************************************/
+void GattCache_Invalidate(const uint8_t addr[], uint8_t addrType)
+{
+    gatt_cache_entry_t *entry = GattCache_Find(addr, addrType);
+
+    if(entry != NULL)
+    {
+        entry->valid = false;
+        gattCacheStats.invalidations++;
+    }
+}
+
+/******************************************************************************
+* Function Name: GattCache_Stats
+******************************************************************************/
+const gatt_cache_stats_t *GattCache_Stats(void)
+{
+    return(&gattCacheStats);
+}
+
+/* [] END OF FILE */
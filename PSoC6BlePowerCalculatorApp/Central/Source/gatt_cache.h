@@ -0,0 +1,93 @@
+/*******************************************************************************
+* File Name: gatt_cache.h
+*
+* Version: 1.00
+*
+* Description:
+*  Contains the function prototypes and constants of the GATT discovery cache.
+*  The service handle ranges found by a discovery are kept per peer address,
+*  so a reconnect to a known peer can skip the discovery.
+*
+*  The stack binds a row of cy_ble_serverInfo to a connection only in
+*  Cy_BLE_GATTC_StartDiscovery(), so a connection that skips the discovery
+*  has no row the stack fills or keeps for it. The application therefore
+*  keeps the service ranges of each connection itself, restores the cached
+*  ones there and copies a new discovery there on
+*  CY_BLE_EVT_GATTC_DISCOVERY_COMPLETE.
+*
+*  A server only sends the Service Changed indication to a client that wrote
+*  its CCCD, or to a bonded one. The applications look up the Service Changed
+*  characteristic and its CCCD once, keep them with their other handles and
+*  write the CCCD on every connection; the indication drops the entry. A
+*  stale entry is also found when a cached handle is rejected.
+*
+********************************************************************************
+* Copyright 2018-2019, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#ifndef GATT_CACHE_H
+
+    #define GATT_CACHE_H
+
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include "cycfg_ble.h"
+
+    /***************************************
+    *           Constants
+    ***************************************/
+    /* Peers kept, the least recently used one is replaced */
+    #ifndef GATT_CACHE_PEERS
+    #define GATT_CACHE_PEERS            (8u)
+    #endif
+    /* Services kept per peer, a peer with more is not cached */
+    #define GATT_CACHE_SERVICES         (8u)
+    /* Attribute handles of the application kept per peer */
+    #define GATT_CACHE_HANDLES          (4u)
+
+    /***************************************
+    *       Data Types
+    ***************************************/
+    typedef struct
+    {
+        uint8_t                             srvi;       /* Index in cy_ble_serverInfo */
+        cy_stc_ble_gatt_attr_handle_range_t range;
+    } gatt_cache_service_t;
+
+    typedef struct
+    {
+        bool                    valid;
+        uint8_t                 addrType;
+        uint8_t                 addr[CY_BLE_GAP_BD_ADDR_SIZE];
+        uint32_t                lastUse;
+        uint8_t                 services;
+        gatt_cache_service_t    service[GATT_CACHE_SERVICES];
+        uint16_t                handle[GATT_CACHE_HANDLES];
+    } gatt_cache_entry_t;
+
+    typedef struct
+    {
+        uint32_t    hits;
+        uint32_t    misses;
+        uint32_t    stores;
+        uint32_t    invalidations;
+        uint32_t    rejects;        /* Peers with too many services to keep */
+    } gatt_cache_stats_t;
+
+    /***************************************
+    *       Function Prototypes
+    ***************************************/
+    void GattCache_Init(void);
+    bool GattCache_Restore(const uint8_t addr[], uint8_t addrType,
+                           cy_stc_ble_disc_srvc_info_t serverInfo[], uint16_t handle[]);
+    void GattCache_Store(const uint8_t addr[], uint8_t addrType,
+                         const cy_stc_ble_disc_srvc_info_t serverInfo[], const uint16_t handle[]);
+    void GattCache_Invalidate(const uint8_t addr[], uint8_t addrType);
+    const gatt_cache_stats_t *GattCache_Stats(void);
+
+#endif /* GATT_CACHE_H */
+
+/* [] END OF FILE */
@@ -34,6 +34,9 @@
 #include "cy_ble_hal_pvt.h"
 #include "cycfg_ble.h"
 #include "stdio.h"
+#include "throughput.h"
+#include "conn_setup.h"
+#include "gatt_cache.h"
 
 #define PEER_BD_ADDR 			{0x78, 0x88, 0xA4, 0x50, 0xA0, 0x00} //char board
 //#define PEER_BD_ADDR 			{0xDF, 0x00, 0x01, 0x50, 0xA0, 0x00} // pioneer kit
@@ -48,9 +51,7 @@ typedef enum
 	INITIATE_CONNECTION,
     PEER_FOUND,
 	WAIT_FOR_INIT,
-    PEER_CONNECTED,
-	MTU_RSP_RCVD,
-	DISCOVERY_COMPLETE
+    PEER_CONNECTED
 }conn_state_t;
 
 cy_stc_ble_gap_bd_addr_t connectToAddr;
@@ -70,10 +71,6 @@ const cy_stc_sysint_t  blessIsrCfg =
 
 void Handle_ConnState(void)
 {
-	cy_en_ble_api_result_t apiResult;
-    cy_stc_ble_gatt_xchg_mtu_param_t MTUParams;
-    uint8_t   config[2u];
-
 	switch(connState)
 	{
 	case STACK_ON_COMPLETE:
@@ -91,31 +88,6 @@ void Handle_ConnState(void)
 		printf("Initiating Connection\r\n");
 		Cy_BLE_GAPC_ConnectDevice(&connectToAddr, CY_BLE_CENTRAL_CONFIGURATION_0_INDEX);
 		break;
-	case PEER_CONNECTED:
-		printf("Peer Connected. Exchanging MTU size\r\n");
-        MTUParams.connHandle = appConnHandle;
-        MTUParams.mtu = 512;
-        Cy_BLE_GATTC_ExchangeMtuReq(&MTUParams);
-        connState = DEVICE_IDLE;
-        break;
-	case MTU_RSP_RCVD:
-		printf("Start Discovery\r\n");
-		Cy_BLE_GATTC_StartDiscovery(appConnHandle);
-		connState = DEVICE_IDLE;
-		break;
-	case DISCOVERY_COMPLETE:
-		/* Enable Notification  */
-        config[1u] = 0u;
-        config[0u] = 1u;
-        printf("Discovery Complete. Enable Notification\r\n");
-        apiResult = Cy_BLE_BASC_SetCharacteristicDescriptor(appConnHandle,
-    			0u,CY_BLE_BAS_BATTERY_LEVEL,CY_BLE_BAS_BATTERY_LEVEL_CCCD,sizeof(config), config);
-        if(apiResult == CY_BLE_SUCCESS)
-        {
-        	printf("Notifications enabled Successfully\r\n");
-        }
-    	connState = DEVICE_IDLE;
-		break;
 	default:
 		break;
 	}
@@ -132,6 +104,10 @@ void StackEventHandler(uint32 event, void * eventParam)
     };
     cy_stc_ble_gapc_adv_report_param_t  *advReport;
     cy_stc_ble_bless_clk_cfg_params_t clkParam;
+    /* PHY, data length and MTU negotiation, discovery and notification
+     * enable run from the events of the connection */
+    ConnSetupEvent(event, eventParam);
+
     switch(event)
     {
     case CY_BLE_EVT_STACK_ON:
@@ -182,20 +158,26 @@ void StackEventHandler(uint32 event, void * eventParam)
     	}
     	break;
     case CY_BLE_EVT_GAP_DEVICE_CONNECTED:
+        printf("Peer Connected\r\n");
         connState = PEER_CONNECTED;
         break;
+    case CY_BLE_EVT_GAP_CONNECTION_UPDATE_COMPLETE:
+        ThroughputConnIntv(((cy_stc_ble_gap_conn_param_updated_in_controller_t *)eventParam)->connIntv);
+        break;
     case CY_BLE_EVT_GAP_DEVICE_DISCONNECTED:
+    	ThroughputStop();
     	connState = PEER_DISCONNECTED;
     	break;
+    /* No BAS client callback is registered, so the battery level
+     * notifications come here */
+    case CY_BLE_EVT_GATTC_HANDLE_VALUE_NTF:
+    	ConnSetupNotification();
+    	ThroughputNotification(((cy_stc_ble_gattc_handle_value_ntf_param_t *)eventParam)->handleValPair.value.val,
+    	                       ((cy_stc_ble_gattc_handle_value_ntf_param_t *)eventParam)->handleValPair.value.len);
+    	break;
     case CY_BLE_EVT_GATT_CONNECT_IND:
         appConnHandle = *(cy_stc_ble_conn_handle_t *)eventParam;
         break;
-    case CY_BLE_EVT_GATTC_XCHNG_MTU_RSP:
-    	connState = MTU_RSP_RCVD;
-    	break;
-    case CY_BLE_EVT_GATTC_DISCOVERY_COMPLETE:
-    	connState = DISCOVERY_COMPLETE;
-    	break;
     default:
     	break;
     }
@@ -212,6 +194,9 @@ int main(void)
     Cy_SCB_UART_Init(DEBUG_UART_HW, &DEBUG_UART_config, &uartContext);
     Cy_SCB_UART_Enable(DEBUG_UART_HW);
 
+    ThroughputInit();
+    GattCache_Init();
+
     /* Initialize the BLESS interrupt */
     cy_ble_config.hw->blessIsrConfig = &blessIsrCfg;
     (void) Cy_SysInt_Init(cy_ble_config.hw->blessIsrConfig, Cy_BLE_BlessIsrHandler);
@@ -233,5 +218,6 @@ int main(void)
     	/* Process pending BLE events */
     	Cy_BLE_ProcessEvents();
     	Handle_ConnState();
+    	ThroughputProcess();
     }
 }
@@ -0,0 +1,270 @@
+/*******************************************************************************
+* File Name: throughput.c
+*
+* Version: 1.0
+*
+* Description:
+* This file contains the throughput analyzer of the notifications that the
+* Power Calculator peripheral sends. Every THROUGHPUT_REPORT_MS one CSV line
+* is printed with:
+*   - time_ms: time since the notifications were enabled
+*   - bytes_s: notification value bytes per second
+*   - pkts: notifications of the period
+*   - pkts_intv: notifications per connection interval, from the rate
+*   - pkts_event: notifications per connection event that carried data;
+*     notifications closer together than half an interval share an event
+*   - jitter_us: smoothed deviation of the event arrivals from the
+*     connection interval grid, as the RFC 3550 inter-arrival jitter
+*   - lost: notifications missing from the sequence numbers, since the start
+*   - bad: repeated or out of order sequence numbers, since the start
+*
+* Time is read from the DWT cycle counter, the central never enters deep
+* sleep.
+*
+* Hardware Dependency:
+*  CY8CKIT-062 PSoC6 BLE Pioneer Kit
+*
+********************************************************************************
+* Copyright 2017, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+#include <stdio.h>
+#include "throughput.h"
+
+/* Static global variables */
+static bool     running = false;
+static bool     synced;                 /* A sequence number was received */
+static uint32_t nextSeq;
+static uint32_t connIntvUs;
+static uint32_t lastCycles;             /* DWT->CYCCNT at the last update of nowUs */
+static uint32_t cycleRest;              /* Cycles not yet counted in nowUs */
+static uint64_t nowUs;
+static uint64_t startUs;
+static uint64_t reportUs;               /* Start of the report period */
+static uint64_t lastArrivalUs;
+static uint64_t lastEventUs;
+static uint32_t jitterUs16;             /* Jitter in 1/16 us */
+
+/* Counters of the report period */
+static uint32_t periodBytes;
+static uint32_t periodPkts;
+static uint32_t periodEvents;
+
+/* Counters since the start */
+static uint32_t lost;
+static uint32_t bad;
+
+/*******************************************************************************
+* Function Name: ThroughputClock
+********************************************************************************
+*
+* Summary:
+*   Advances the microsecond clock from the DWT cycle counter. Called often
+*   enough that the 32-bit counter does not wrap between two calls.
+*
+*******************************************************************************/
+static void ThroughputClock(void)
+{
+    uint32_t cycles = CYCLES_GET();
+    uint32_t perUs = SystemCoreClock / 1000000u;
+
+    cycleRest += cycles - lastCycles;
+    lastCycles = cycles;
+    nowUs += cycleRest / perUs;
+    cycleRest %= perUs;
+}
+
+/*******************************************************************************
+* Function Name: ThroughputNowUs
+********************************************************************************
+*
+* Summary:
+*   Returns the time since ThroughputInit() in microseconds.
+*
+*******************************************************************************/
+uint64_t ThroughputNowUs(void)
+{
+    ThroughputClock();
+    return(nowUs);
+}
+
+/*******************************************************************************
+* Function Name: ThroughputInit
+********************************************************************************
+*
+* Summary:
+*   Starts the DWT cycle counter.
+*
+*******************************************************************************/
+void ThroughputInit(void)
+{
+    CYCLES_INIT();
+    lastCycles = CYCLES_GET();
+    running = false;
+}
+
+/*******************************************************************************
+* Function Name: ThroughputStart
+********************************************************************************
+*
+* Summary:
+*   Clears the counters and prints the CSV header, called when the
+*   notifications are enabled.
+*
+* Parameters:
+*   connIntv - connection interval in 1.25 ms units
+*
+*******************************************************************************/
+void ThroughputStart(uint16_t connIntv)
+{
+    ThroughputClock();
+    connIntvUs = (uint32_t)connIntv * CONN_INTV_US_PER_UNIT;
+    synced = false;
+    startUs = nowUs;
+    reportUs = nowUs;
+    lastArrivalUs = 0u;
+    lastEventUs = 0u;
+    jitterUs16 = 0u;
+    periodBytes = 0u;
+    periodPkts = 0u;
+    periodEvents = 0u;
+    lost = 0u;
+    bad = 0u;
+    running = true;
+    printf("time_ms,bytes_s,pkts,pkts_intv,pkts_event,jitter_us,lost,bad\r\n");
+}
+
+/*******************************************************************************
+* Function Name: ThroughputConnIntv
+********************************************************************************
+*
+* Summary:
+*   Takes a new connection interval of a connection parameter update.
+*
+*******************************************************************************/
+void ThroughputConnIntv(uint16_t connIntv)
+{
+    connIntvUs = (uint32_t)connIntv * CONN_INTV_US_PER_UNIT;
+}
+
+/*******************************************************************************
+* Function Name: ThroughputStop
+*******************************************************************************/
+void ThroughputStop(void)
+{
+    running = false;
+}
+
+/*******************************************************************************
+* Function Name: ThroughputNotification
+********************************************************************************
+*
+* Summary:
+*   Counts a notification of the peripheral. The value starts with a 32-bit
+*   little endian sequence number.
+*
+* Parameters:
+*   val, len - the notification value
+*
+*******************************************************************************/
+void ThroughputNotification(const uint8_t *val, uint16_t len)
+{
+    uint32_t seq;
+    uint32_t gap;
+    uint32_t k;
+    uint32_t d;
+
+    if(running == false)
+    {
+        return;
+    }
+    ThroughputClock();
+    periodBytes += len;
+    periodPkts++;
+
+    /* A new connection event, its offset from the interval grid adds to the
+     * jitter */
+    if((lastArrivalUs == 0u) || ((nowUs - lastArrivalUs) > (connIntvUs / 2u)))
+    {
+        periodEvents++;
+        if((lastEventUs != 0u) && (connIntvUs != 0u))
+        {
+            gap = (uint32_t)(nowUs - lastEventUs);
+            k = (gap + (connIntvUs / 2u)) / connIntvUs;
+            d = (gap > (k * connIntvUs)) ? (gap - (k * connIntvUs)) : ((k * connIntvUs) - gap);
+            jitterUs16 = jitterUs16 + d - ((jitterUs16 + 8u) / 16u);
+        }
+        lastEventUs = nowUs;
+    }
+    lastArrivalUs = nowUs;
+
+    if(len < THROUGHPUT_SEQ_LEN)
+    {
+        bad++;
+        return;
+    }
+    seq = (uint32_t)val[0u] | ((uint32_t)val[1u] << 8u) | ((uint32_t)val[2u] << 16u) | ((uint32_t)val[3u] << 24u);
+    if(synced == false)
+    {
+        synced = true;
+    }
+    else if(seq != nextSeq)
+    {
+        if((int32_t)(seq - nextSeq) > 0)
+        {
+            lost += seq - nextSeq;
+        }
+        else
+        {
+            bad++;
+            return;
+        }
+    }
+    nextSeq = seq + 1u;
+}
+
+/*******************************************************************************
+* Function Name: ThroughputProcess
+********************************************************************************
+*
+* Summary:
+*   Prints the CSV line of a report period when it is over. Called from the
+*   main loop.
+*
+*******************************************************************************/
+void ThroughputProcess(void)
+{
+    uint32_t periodUs;
+    uint32_t perIntv100 = 0u;
+    uint32_t perEvent100 = 0u;
+
+    ThroughputClock();
+    if((running == false) || ((nowUs - reportUs) < (THROUGHPUT_REPORT_MS * 1000u)))
+    {
+        return;
+    }
+    periodUs = (uint32_t)(nowUs - reportUs);
+    if(connIntvUs != 0u)
+    {
+        perIntv100 = (uint32_t)(((uint64_t)periodPkts * connIntvUs * 100u) / periodUs);
+    }
+    if(periodEvents != 0u)
+    {
+        perEvent100 = (periodPkts * 100u) / periodEvents;
+    }
+    printf("%lu,%lu,%lu,%lu.%02lu,%lu.%02lu,%lu,%lu,%lu\r\n",
+           (unsigned long)((nowUs - startUs) / 1000u),
+           (unsigned long)(((uint64_t)periodBytes * 1000000u) / periodUs),
+           (unsigned long)periodPkts,
+           (unsigned long)(perIntv100 / 100u), (unsigned long)(perIntv100 % 100u),
+           (unsigned long)(perEvent100 / 100u), (unsigned long)(perEvent100 % 100u),
+           (unsigned long)(jitterUs16 / 16u), (unsigned long)lost, (unsigned long)bad);
+    reportUs = nowUs;
+    periodBytes = 0u;
+    periodPkts = 0u;
+    periodEvents = 0u;
+}
+
+/* [] END OF FILE */
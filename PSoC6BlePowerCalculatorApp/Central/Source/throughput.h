@@ -0,0 +1,50 @@
+/*******************************************************************************
+* File Name: throughput.h
+*
+* Version 1.0
+*
+* Description:
+*  Contains the function prototypes and constants of the notification
+*  throughput analyzer of the central.
+*
+********************************************************************************
+* Copyright 2017, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include "cy_device_headers.h"
+#include "cycfg.h"
+#include "cycfg_ble.h"
+#include <stdbool.h>
+
+
+/***************************************
+*          Constants
+***************************************/
+#ifndef THROUGHPUT_REPORT_MS
+    #define THROUGHPUT_REPORT_MS    (1000u)         /* Period of the CSV lines */
+#endif /* ifndef THROUGHPUT_REPORT_MS */
+
+#define THROUGHPUT_SEQ_LEN          (4u)            /* Sequence number at the start of the value */
+#define CONN_INTV_US_PER_UNIT       (1250u)
+
+/* DWT cycle counter of the CPU, the same macros as the IPSP applications */
+#define CYCLES_INIT()               do { CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; \
+                                         DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; } while(0)
+#define CYCLES_GET()                (DWT->CYCCNT)
+
+
+/***************************************
+*       Function Prototypes
+***************************************/
+void ThroughputInit(void);
+uint64_t ThroughputNowUs(void);
+void ThroughputStart(uint16_t connIntv);
+void ThroughputConnIntv(uint16_t connIntv);
+void ThroughputStop(void);
+void ThroughputNotification(const uint8_t *val, uint16_t len);
+void ThroughputProcess(void);
+
+/* [] END OF FILE */
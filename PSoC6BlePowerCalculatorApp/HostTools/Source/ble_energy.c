@@ -0,0 +1,796 @@
+/*******************************************************************************
+* File Name: ble_energy.c
+*
+* Version: 1.00
+*
+* Description:
+*  Host estimate of the average current and battery life of the Power
+*  Calculator peripheral in the scenarios of README.txt: BLE off, non
+*  connectable and connectable advertising, idle connection and continuous
+*  notifications.
+*
+*  Radio time: every advertising or connection event is built from its LL
+*  PDUs. A PDU is on air for its bytes at the PHY rate (1 or 2 Mbit/s)
+*  and PDUs are T_IFS apart. Notifications are split into LL data PDUs of
+*  the LL TX octets (stackParam.dleMaxTxCapability), each acknowledged by an
+*  empty PDU of the central.
+*
+*  Current: the sleep current, plus a charge per event for the wake-up of
+*  the device and the crystal and the CPU time of the stack, plus the TX and
+*  RX currents of the radio over its time on air. The model is linear in
+*  the sleep current, the charge per event and a scale of the radio
+*  currents, so these are fitted by least squares to measured points of a
+*  calibration file.
+*
+********************************************************************************
+* Copyright 2017, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <getopt.h>
+
+/***************************************
+*           Constants
+***************************************/
+#define T_IFS_US                    (150.0)
+#define LL_OVERHEAD_1M              (10u)       /* Preamble, AA, header, CRC */
+#define LL_OVERHEAD_2M              (11u)       /* Two byte preamble */
+#define ADV_CHANNELS                (3u)
+#define ADV_ADDR_LEN                (6u)        /* AdvA of every ADV PDU */
+#define ADV_DELAY_MS                (5.0)       /* Mean of the random 0..10 ms advDelay */
+#define ADV_RX_WINDOW_US            (T_IFS_US + 40.0)   /* Listen for SCAN_REQ / CONNECT_IND */
+#define ATT_NTF_HEADER_LEN          (3u)        /* Opcode, handle */
+#define L2CAP_HEADER_LEN            (4u)
+#define LL_TX_OCTETS_MIN            (27u)
+#define LL_TX_OCTETS_MAX            (251u)
+#define CONN_WIDENING_MIN_US        (16.0)      /* Window widening floor of the slave */
+#define CONN_SCA_PPM                (100.0)     /* Master plus slave sleep clock accuracy */
+#define CONN_SUPERVISION_MAX_MS     (32000.0)   /* Longest supervision timeout */
+#define NTF_PER_EVENT_MAX           (64u)
+#define CALIB_POINTS_MAX            (64u)
+#define MODEL_PARAMS                (3u)
+
+/* Defaults of the model: PSoC 6 BLE datasheet typical values at 3.3 V */
+#define DEFAULT_SLEEP_UA            (7.0)
+#define DEFAULT_EVENT_UC            (1.5)
+#define DEFAULT_TX_MA               (5.7)       /* 0 dBm */
+#define DEFAULT_RX_MA               (6.7)
+#define DEFAULT_BATTERY_MAH         (225.0)     /* CR2032 */
+#define DEFAULT_USABLE_PCT          (80.0)
+
+/***************************************
+*       Data Types
+***************************************/
+typedef enum
+{
+    SCENARIO_BASE,
+    SCENARIO_ADV_NONCONN,
+    SCENARIO_ADV,
+    SCENARIO_IDLE,
+    SCENARIO_NOTIFY,
+    SCENARIO_COUNT
+} scenario_kind_t;
+
+typedef struct
+{
+    scenario_kind_t kind;
+    double          advIntervalMs;
+    uint32_t        advDataLen;
+    double          connIntervalMs;
+    uint32_t        latency;        /* Slave latency of the idle connection */
+    uint32_t        ntfLen;         /* Value bytes of a notification */
+    uint32_t        txOctets;       /* LL TX octets, dleMaxTxCapability */
+    uint32_t        phy;            /* 1 or 2 Mbit/s */
+    uint32_t        ntfPerEvent;    /* 0: as many as fit in the event */
+} scenario_t;
+
+typedef struct
+{
+    double  eventsPerSec;
+    double  txUs;                   /* Per event */
+    double  rxUs;
+    double  ntfPerSec;
+} activity_t;
+
+typedef struct
+{
+    double  sleepUa;
+    double  eventUc;                /* Charge per event besides the radio */
+    double  txMa;
+    double  rxMa;
+    double  radioScale;
+} model_t;
+
+typedef struct
+{
+    scenario_t  sc;
+    double      measuredUa;
+} calib_point_t;
+
+/* The profiles of profile.c of the peripheral, with its "Connectable ADV /
+ * idle" profile split into the advertising and the idle connection */
+static const struct
+{
+    scenario_kind_t kind;
+    uint32_t        ntfLen;
+    uint32_t        txOctets;
+    uint32_t        phy;
+} profileTable[] =
+{
+    { SCENARIO_BASE,        20u,  27u,  1u },
+    { SCENARIO_ADV_NONCONN, 20u,  27u,  1u },
+    { SCENARIO_ADV,         20u,  27u,  1u },
+    { SCENARIO_IDLE,        20u,  27u,  1u },
+    { SCENARIO_NOTIFY,      20u,  27u,  1u },
+    { SCENARIO_NOTIFY,      244u, 251u, 1u },
+    { SCENARIO_NOTIFY,      20u,  27u,  2u },
+    { SCENARIO_NOTIFY,      244u, 251u, 2u },
+};
+
+#define PROFILE_COUNT               ((int)(sizeof(profileTable) / sizeof(profileTable[0u])))
+
+static const char * const scenarioName[SCENARIO_COUNT] =
+{
+    "base", "adv-nonconn", "adv", "idle", "notify"
+};
+
+/*******************************************************************************
+* Function Name: AirTimeUs
+********************************************************************************
+*
+* Summary:
+*  Returns the time on air of an LL PDU.
+*
+*******************************************************************************/
+static double AirTimeUs(uint32_t payload, uint32_t phy)
+{
+    if(phy == 2u)
+    {
+        return((double)(LL_OVERHEAD_2M + payload) * 4.0);
+    }
+    return((double)(LL_OVERHEAD_1M + payload) * 8.0);
+}
+
+/*******************************************************************************
+* Function Name: NotificationTime
+********************************************************************************
+*
+* Summary:
+*  Adds the radio time of one notification in a connection event: every LL
+*  data PDU of the slave follows an empty PDU of the master.
+*
+* Return:
+*  The time of the exchanges including T_IFS.
+*
+*******************************************************************************/
+static double NotificationTime(const scenario_t *sc, double *txUs, double *rxUs)
+{
+    uint32_t left = sc->ntfLen + ATT_NTF_HEADER_LEN + L2CAP_HEADER_LEN;
+    double time = 0.0;
+    uint32_t len;
+
+    while(left > 0u)
+    {
+        len = (left > sc->txOctets) ? sc->txOctets : left;
+        left -= len;
+        *rxUs += AirTimeUs(0u, sc->phy);
+        *txUs += AirTimeUs(len, sc->phy);
+        time += AirTimeUs(0u, sc->phy) + AirTimeUs(len, sc->phy) + (2.0 * T_IFS_US);
+    }
+    return(time);
+}
+
+/*******************************************************************************
+* Function Name: Activity
+********************************************************************************
+*
+* Summary:
+*  Returns the event rate and the radio TX and RX time per event of a
+*  scenario.
+*
+*******************************************************************************/
+static activity_t Activity(const scenario_t *sc)
+{
+    activity_t a = { 0.0, 0.0, 0.0, 0.0 };
+    double intervalUs;
+    double used;
+    double txUs;
+    double rxUs;
+    double t;
+    uint32_t n;
+
+    switch(sc->kind)
+    {
+        case SCENARIO_ADV_NONCONN:
+        case SCENARIO_ADV:
+            /* Legacy advertising is on the 1M PHY, the connectable PDU
+             * waits for a request after each channel */
+            a.eventsPerSec = 1000.0 / (sc->advIntervalMs + ADV_DELAY_MS);
+            a.txUs = ADV_CHANNELS * AirTimeUs(ADV_ADDR_LEN + sc->advDataLen, 1u);
+            if(sc->kind == SCENARIO_ADV)
+            {
+                a.rxUs = ADV_CHANNELS * ADV_RX_WINDOW_US;
+            }
+            break;
+
+        case SCENARIO_IDLE:
+            /* Empty PDUs, the slave listens through the window widening */
+            intervalUs = sc->connIntervalMs * 1000.0 * (double)(sc->latency + 1u);
+            a.eventsPerSec = 1000000.0 / intervalUs;
+            a.rxUs = AirTimeUs(0u, sc->phy) + CONN_WIDENING_MIN_US + ((CONN_SCA_PPM * intervalUs) / 1000000.0);
+            a.txUs = AirTimeUs(0u, sc->phy);
+            break;
+
+        case SCENARIO_NOTIFY:
+            /* Slave latency is not used while data is pending */
+            intervalUs = sc->connIntervalMs * 1000.0;
+            a.eventsPerSec = 1000000.0 / intervalUs;
+            a.rxUs = CONN_WIDENING_MIN_US + ((CONN_SCA_PPM * intervalUs) / 1000000.0);
+            used = a.rxUs;
+            for(n = 0u; n < NTF_PER_EVENT_MAX; n++)
+            {
+                if((sc->ntfPerEvent != 0u) && (n == sc->ntfPerEvent))
+                {
+                    break;
+                }
+                txUs = 0.0;
+                rxUs = 0.0;
+                t = NotificationTime(sc, &txUs, &rxUs);
+                /* The event closes T_IFS before the next anchor */
+                if((used + t + T_IFS_US) > intervalUs)
+                {
+                    break;
+                }
+                used += t;
+                a.txUs += txUs;
+                a.rxUs += rxUs;
+            }
+            /* The event ends with an empty exchange */
+            a.rxUs += AirTimeUs(0u, sc->phy);
+            a.txUs += AirTimeUs(0u, sc->phy);
+            a.ntfPerSec = (double)n * a.eventsPerSec;
+            break;
+
+        default:
+            break;
+    }
+    return(a);
+}
+
+/*******************************************************************************
+* Function Name: Regressors
+********************************************************************************
+*
+* Summary:
+*  Returns the factors of the sleep current, the charge per event and the
+*  radio scale in the average current of a scenario, in uA.
+*
+*******************************************************************************/
+static void Regressors(const model_t *m, const scenario_t *sc, double x[MODEL_PARAMS])
+{
+    activity_t a = Activity(sc);
+
+    x[0u] = 1.0;
+    x[1u] = a.eventsPerSec;
+    x[2u] = ((m->txMa * a.txUs) + (m->rxMa * a.rxUs)) * a.eventsPerSec / 1000.0;
+}
+
+/*******************************************************************************
+* Function Name: AverageUa
+*******************************************************************************/
+static double AverageUa(const model_t *m, const scenario_t *sc)
+{
+    double x[MODEL_PARAMS];
+
+    Regressors(m, sc, x);
+    return((m->sleepUa * x[0u]) + (m->eventUc * x[1u]) + (m->radioScale * x[2u]));
+}
+
+/*******************************************************************************
+* Function Name: ParseSetting
+********************************************************************************
+*
+* Summary:
+*  Applies one key=value setting of a calibration point to a scenario.
+*
+* Return:
+*  false for an unknown key or a bad value.
+*
+*******************************************************************************/
+static bool ParseSetting(scenario_t *sc, const char *key, const char *value)
+{
+    char *end;
+    double v;
+    uint32_t i;
+
+    if(strcmp(key, "scenario") == 0)
+    {
+        for(i = 0u; i < SCENARIO_COUNT; i++)
+        {
+            if(strcmp(value, scenarioName[i]) == 0)
+            {
+                sc->kind = (scenario_kind_t)i;
+                return(true);
+            }
+        }
+        return(false);
+    }
+
+    v = strtod(value, &end);
+    if((end == value) || (*end != '\0') || (v < 0.0))
+    {
+        return(false);
+    }
+    if(strcmp(key, "adv") == 0)
+    {
+        sc->advIntervalMs = v;
+        return(v >= 20.0);
+    }
+    if(strcmp(key, "advdata") == 0)
+    {
+        sc->advDataLen = (uint32_t)v;
+        return(v <= 31.0);
+    }
+    if(strcmp(key, "conn") == 0)
+    {
+        sc->connIntervalMs = v;
+        return((v >= 7.5) && (v <= 4000.0));
+    }
+    if(strcmp(key, "latency") == 0)
+    {
+        sc->latency = (uint32_t)v;
+        return(v <= 499.0);
+    }
+    if(strcmp(key, "len") == 0)
+    {
+        sc->ntfLen = (uint32_t)v;
+        return((v >= 1.0) && (v <= 512.0));
+    }
+    if(strcmp(key, "octets") == 0)
+    {
+        sc->txOctets = (uint32_t)v;
+        return((v >= LL_TX_OCTETS_MIN) && (v <= LL_TX_OCTETS_MAX));
+    }
+    if(strcmp(key, "phy") == 0)
+    {
+        sc->phy = (uint32_t)v;
+        return((v == 1.0) || (v == 2.0));
+    }
+    if(strcmp(key, "k") == 0)
+    {
+        sc->ntfPerEvent = (uint32_t)v;
+        return(v <= NTF_PER_EVENT_MAX);
+    }
+    return(false);
+}
+
+/*******************************************************************************
+* Function Name: ConnectionValid
+********************************************************************************
+*
+* Summary:
+*  Checks that the connection interval times the slave latency plus one
+*  fits the supervision timeout: the timeout must be longer than twice that
+*  and at most CONN_SUPERVISION_MAX_MS.
+*
+*******************************************************************************/
+static bool ConnectionValid(const scenario_t *sc)
+{
+    return((2.0 * sc->connIntervalMs * (double)(sc->latency + 1u)) < CONN_SUPERVISION_MAX_MS);
+}
+
+/*******************************************************************************
+* Function Name: ReadCalibration
+********************************************************************************
+*
+* Summary:
+*  Reads the measured points of a calibration file. A line holds key=value
+*  settings of a scenario and the measured average current "ua=<uA>";
+*  settings that are left out take the values of the command line. Text
+*  after '#' is a comment.
+*
+* Return:
+*  Number of points, -1 on an error.
+*
+*******************************************************************************/
+static int ReadCalibration(const char *file, const scenario_t *defaults, calib_point_t pts[])
+{
+    FILE *f = fopen(file, "r");
+    char line[256];
+    char *tok;
+    char *eq;
+    char *end;
+    int n = 0;
+    int lineNo = 0;
+    bool hasUa;
+
+    if(f == NULL)
+    {
+        perror(file);
+        return(-1);
+    }
+    while(fgets(line, sizeof(line), f) != NULL)
+    {
+        lineNo++;
+        if((tok = strchr(line, '#')) != NULL)
+        {
+            *tok = '\0';
+        }
+        tok = strtok(line, " \t\r\n");
+        if(tok == NULL)
+        {
+            continue;
+        }
+        if(n == CALIB_POINTS_MAX)
+        {
+            fprintf(stderr, "%s:%d: more than %u points\n", file, lineNo, CALIB_POINTS_MAX);
+            fclose(f);
+            return(-1);
+        }
+        pts[n].sc = *defaults;
+        hasUa = false;
+        for(; tok != NULL; tok = strtok(NULL, " \t\r\n"))
+        {
+            eq = strchr(tok, '=');
+            if(eq == NULL)
+            {
+                fprintf(stderr, "%s:%d: expected key=value, got \"%s\"\n", file, lineNo, tok);
+                fclose(f);
+                return(-1);
+            }
+            *eq = '\0';
+            if(strcmp(tok, "ua") == 0)
+            {
+                pts[n].measuredUa = strtod(eq + 1, &end);
+                hasUa = (end != (eq + 1)) && (*end == '\0') && (pts[n].measuredUa > 0.0);
+                if(hasUa == false)
+                {
+                    fprintf(stderr, "%s:%d: bad current \"%s\"\n", file, lineNo, eq + 1);
+                    fclose(f);
+                    return(-1);
+                }
+            }
+            else if(ParseSetting(&pts[n].sc, tok, eq + 1) == false)
+            {
+                fprintf(stderr, "%s:%d: bad setting %s=%s\n", file, lineNo, tok, eq + 1);
+                fclose(f);
+                return(-1);
+            }
+        }
+        if(hasUa == false)
+        {
+            fprintf(stderr, "%s:%d: no measured current ua=\n", file, lineNo);
+            fclose(f);
+            return(-1);
+        }
+        if(ConnectionValid(&pts[n].sc) == false)
+        {
+            fprintf(stderr, "%s:%d: conn times latency plus one exceeds the supervision timeout\n", file, lineNo);
+            fclose(f);
+            return(-1);
+        }
+        n++;
+    }
+    fclose(f);
+    return(n);
+}
+
+/*******************************************************************************
+* Function Name: Calibrate
+********************************************************************************
+*
+* Summary:
+*  Fits the model to the measured points by least squares, relative to each
+*  measurement so that the base current counts as much as a notification
+*  flood. With fewer points than parameters the first ones are fitted in
+*  the order sleep current, charge per event, radio scale and the others
+*  keep their values.
+*
+* Return:
+*  false when the points do not determine the parameters.
+*
+*******************************************************************************/
+static bool Calibrate(model_t *m, const calib_point_t pts[], uint32_t n)
+{
+    double ata[MODEL_PARAMS][MODEL_PARAMS + 1u];
+    double x[MODEL_PARAMS];
+    double fixedUa;
+    double w;
+    double f;
+    double *p[MODEL_PARAMS] = { &m->sleepUa, &m->eventUc, &m->radioScale };
+    uint32_t k = (n < MODEL_PARAMS) ? n : MODEL_PARAMS;
+    uint32_t i;
+    uint32_t r;
+    uint32_t c;
+    uint32_t best;
+
+    memset(ata, 0, sizeof(ata));
+    for(i = 0u; i < n; i++)
+    {
+        Regressors(m, &pts[i].sc, x);
+        fixedUa = 0.0;
+        for(c = k; c < MODEL_PARAMS; c++)
+        {
+            fixedUa += *p[c] * x[c];
+        }
+        w = 1.0 / pts[i].measuredUa;
+        for(r = 0u; r < k; r++)
+        {
+            for(c = 0u; c < k; c++)
+            {
+                ata[r][c] += x[r] * w * x[c] * w;
+            }
+            ata[r][k] += x[r] * w * (pts[i].measuredUa - fixedUa) * w;
+        }
+    }
+
+    /* Gauss-Jordan elimination with partial pivoting */
+    for(c = 0u; c < k; c++)
+    {
+        best = c;
+        for(r = c + 1u; r < k; r++)
+        {
+            if(fabs(ata[r][c]) > fabs(ata[best][c]))
+            {
+                best = r;
+            }
+        }
+        if(fabs(ata[best][c]) < 1e-12)
+        {
+            return(false);
+        }
+        for(i = 0u; i <= k; i++)
+        {
+            f = ata[c][i];
+            ata[c][i] = ata[best][i];
+            ata[best][i] = f;
+        }
+        for(r = 0u; r < k; r++)
+        {
+            if(r != c)
+            {
+                f = ata[r][c] / ata[c][c];
+                for(i = c; i <= k; i++)
+                {
+                    ata[r][i] -= f * ata[c][i];
+                }
+            }
+        }
+    }
+    for(c = 0u; c < k; c++)
+    {
+        *p[c] = ata[c][k] / ata[c][c];
+    }
+    return(true);
+}
+
+/*******************************************************************************
+* Function Name: Describe
+*******************************************************************************/
+static void Describe(const scenario_t *sc, char *text, size_t size)
+{
+    switch(sc->kind)
+    {
+        case SCENARIO_BASE:
+            snprintf(text, size, "Base, BLE off");
+            break;
+        case SCENARIO_ADV_NONCONN:
+            snprintf(text, size, "Non-connectable ADV %.0f ms", sc->advIntervalMs);
+            break;
+        case SCENARIO_ADV:
+            snprintf(text, size, "Connectable ADV %.0f ms", sc->advIntervalMs);
+            break;
+        case SCENARIO_IDLE:
+            snprintf(text, size, "Idle, %.2f ms, latency %u", sc->connIntervalMs, sc->latency);
+            break;
+        default:
+            snprintf(text, size, "Notify %u B, %u oct, %uM PHY", sc->ntfLen, sc->txOctets, sc->phy);
+            break;
+    }
+}
+
+/*******************************************************************************
+* Function Name: PrintScenario
+*******************************************************************************/
+static void PrintScenario(const model_t *m, const scenario_t *sc, double usableMah)
+{
+    activity_t a = Activity(sc);
+    double ua = AverageUa(m, sc);
+    char name[40];
+
+    Describe(sc, name, sizeof(name));
+    printf("%-32s %8.2f %8.1f %8.1f %10.1f %10.1f %9.1f\n", name, a.eventsPerSec, a.txUs, a.rxUs,
+           ua, (usableMah * 1000.0) / ua / 24.0, a.ntfPerSec * (double)sc->ntfLen * 8.0 / 1000.0);
+}
+
+/*******************************************************************************
+* Function Name: Usage
+*******************************************************************************/
+static void Usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [-s scenario] [-a advMs] [-A advData] [-c connMs] [-l latency] [-n len] [-d octets] [-p phy] [-k perEvent]\n"
+        "       [-b mAh] [-u percent] [-m file] [-S uA] [-E uC] [-T mA] [-R mA]\n"
+        "  -s  base, adv-nonconn, adv, idle or notify (default: all scenarios of README.txt)\n"
+        "  -a  Advertising interval in ms (default 100)\n"
+        "  -A  Advertising data bytes, 0..31 (default 12)\n"
+        "  -c  Connection interval in ms, 7.5..4000 (default 30)\n"
+        "  -l  Slave latency of the idle connection, 2 x connMs x (latency + 1) below 32 s (default 0)\n"
+        "  -n  Notification value bytes (default 20)\n"
+        "  -d  LL TX octets, dleMaxTxCapability, 27..251 (default 27)\n"
+        "  -p  PHY, 1 or 2 Mbit/s (default 1)\n"
+        "  -k  Notifications per connection event, 0 fills the event (default 0)\n"
+        "  -b  Battery capacity in mAh (default %.0f)\n"
+        "  -u  Usable part of the capacity in percent (default %.0f)\n"
+        "  -m  Calibration file of measured points\n"
+        "  -S  Sleep current in uA (default %.1f)\n"
+        "  -E  Charge per event besides the radio in uC (default %.1f)\n"
+        "  -T  Radio TX current in mA (default %.1f)\n"
+        "  -R  Radio RX current in mA (default %.1f)\n",
+        prog, DEFAULT_BATTERY_MAH, DEFAULT_USABLE_PCT, DEFAULT_SLEEP_UA, DEFAULT_EVENT_UC,
+        DEFAULT_TX_MA, DEFAULT_RX_MA);
+}
+
+/*******************************************************************************
+* Function Name: main
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+    static const char optKey[] = "sacAlndpk";
+    static const char * const settingKey[] =
+    {
+        "scenario", "adv", "conn", "advdata", "latency", "len", "octets", "phy", "k"
+    };
+    scenario_t sc =
+    {
+        .kind = SCENARIO_NOTIFY,
+        .advIntervalMs = 100.0,
+        .advDataLen = 12u,
+        .connIntervalMs = 30.0,
+        .latency = 0u,
+        .ntfLen = 20u,
+        .txOctets = LL_TX_OCTETS_MIN,
+        .phy = 1u,
+        .ntfPerEvent = 0u
+    };
+    model_t m =
+    {
+        .sleepUa = DEFAULT_SLEEP_UA,
+        .eventUc = DEFAULT_EVENT_UC,
+        .txMa = DEFAULT_TX_MA,
+        .rxMa = DEFAULT_RX_MA,
+        .radioScale = 1.0
+    };
+    static calib_point_t pts[CALIB_POINTS_MAX];
+    scenario_t table[PROFILE_COUNT];
+    const char *calibFile = NULL;
+    bool single = false;
+    double batteryMah = DEFAULT_BATTERY_MAH;
+    double usablePct = DEFAULT_USABLE_PCT;
+    double usableMah;
+    double ua;
+    activity_t a;
+    const char *k;
+    char name[40];
+    int opt;
+    int n;
+    int i;
+
+    while((opt = getopt(argc, argv, "s:a:A:c:l:n:d:p:k:b:u:m:S:E:T:R:h")) != -1)
+    {
+        k = strchr(optKey, opt);
+        if((opt != ':') && (opt != '?') && (k != NULL))
+        {
+            if(ParseSetting(&sc, settingKey[k - optKey], optarg) == false)
+            {
+                fprintf(stderr, "Bad value -%c %s\n", opt, optarg);
+                return(EXIT_FAILURE);
+            }
+            single = single || (opt == 's');
+            continue;
+        }
+        switch(opt)
+        {
+            case 'b':
+                batteryMah = atof(optarg);
+                break;
+            case 'u':
+                usablePct = atof(optarg);
+                break;
+            case 'm':
+                calibFile = optarg;
+                break;
+            case 'S':
+                m.sleepUa = atof(optarg);
+                break;
+            case 'E':
+                m.eventUc = atof(optarg);
+                break;
+            case 'T':
+                m.txMa = atof(optarg);
+                break;
+            case 'R':
+                m.rxMa = atof(optarg);
+                break;
+            default:
+                Usage(argv[0]);
+                return((opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    if((optind != argc) || (batteryMah <= 0.0) || (usablePct <= 0.0) || (usablePct > 100.0))
+    {
+        Usage(argv[0]);
+        return(EXIT_FAILURE);
+    }
+    if(ConnectionValid(&sc) == false)
+    {
+        fprintf(stderr, "Bad -c %.2f -l %u: the connection interval times the latency plus one must be below"
+                " half the %.0f s supervision timeout\n", sc.connIntervalMs, sc.latency, CONN_SUPERVISION_MAX_MS / 1000.0);
+        return(EXIT_FAILURE);
+    }
+    usableMah = batteryMah * usablePct / 100.0;
+
+    if(calibFile != NULL)
+    {
+        n = ReadCalibration(calibFile, &sc, pts);
+        if(n < 0)
+        {
+            return(EXIT_FAILURE);
+        }
+        if((n == 0) || (Calibrate(&m, pts, (uint32_t)n) == false))
+        {
+            fprintf(stderr, "%s: the points do not determine the model, add points of other scenarios\n", calibFile);
+            return(EXIT_FAILURE);
+        }
+        printf("Calibration with %d points of %s:\n", n, calibFile);
+        for(i = 0; i < n; i++)
+        {
+            ua = AverageUa(&m, &pts[i].sc);
+            Describe(&pts[i].sc, name, sizeof(name));
+            printf("  %-32s measured %9.1f uA  model %9.1f uA  %+6.1f %%\n", name, pts[i].measuredUa, ua,
+                   (ua - pts[i].measuredUa) * 100.0 / pts[i].measuredUa);
+        }
+        if((m.sleepUa < 0.0) || (m.eventUc < 0.0) || (m.radioScale <= 0.0))
+        {
+            fprintf(stderr, "Warning: a fitted parameter is negative, check the measured points\n");
+        }
+    }
+
+    printf("Model: sleep %.2f uA, event %.3f uC, TX %.2f mA, RX %.2f mA, radio scale %.3f\n",
+           m.sleepUa, m.eventUc, m.txMa, m.rxMa, m.radioScale);
+    printf("Battery: %.0f mAh, %.0f %% usable\n\n", batteryMah, usablePct);
+    printf("%-32s %8s %8s %8s %10s %10s %9s\n", "Scenario", "ev/s", "TX us", "RX us", "avg uA", "life days", "kbit/s");
+
+    if(single)
+    {
+        PrintScenario(&m, &sc, usableMah);
+        a = Activity(&sc);
+        ua = AverageUa(&m, &sc);
+        printf("\nRESULT scenario=%s events_per_s=%.3f tx_us=%.1f rx_us=%.1f avg_ua=%.2f life_h=%.0f goodput_kbps=%.2f\n",
+               scenarioName[sc.kind], a.eventsPerSec, a.txUs, a.rxUs, ua, (usableMah * 1000.0) / ua,
+               a.ntfPerSec * (double)sc.ntfLen * 8.0 / 1000.0);
+        return(EXIT_SUCCESS);
+    }
+
+    /* The profiles of the peripheral, with the intervals of the command line */
+    for(i = 0; i < PROFILE_COUNT; i++)
+    {
+        table[i] = sc;
+        table[i].kind = profileTable[i].kind;
+        table[i].ntfLen = profileTable[i].ntfLen;
+        table[i].txOctets = profileTable[i].txOctets;
+        table[i].phy = profileTable[i].phy;
+        PrintScenario(&m, &table[i], usableMah);
+    }
+    return(EXIT_SUCCESS);
+}
+
+/* [] END OF FILE */
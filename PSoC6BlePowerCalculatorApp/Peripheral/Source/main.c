@@ -27,6 +27,8 @@
 *******************************************************************************/
 
 #include "bas.h"
+#include "profile.h"
+#include "notify.h"
 
 uint8 bdHandle 	=0;
 uint8 connectionId = 0;
@@ -34,18 +36,11 @@ uint16 negotiatedMTU = 0;
 uint8 dataBuffer[245];
 extern cy_stc_ble_stack_params_t stackParam;
 
-#define MEASURE_DLE_POWER		        0u
-#define TWO_MBPS_MEASUREMENT			0u
-#define ENABLE_DATA_TXFR				0u
-#define ENABLE_BASE_MEASUREMENT			0u
-#define ENABLE_NON_CONN_ADV 		    0u
-#define ADV_INTERVAL_MS			       100u
-
-#if MEASURE_DLE_POWER
-	#define MAX_NUMBER_OF_BYTES_PER_PACKET 244u
-#else
-	#define MAX_NUMBER_OF_BYTES_PER_PACKET 20u
-#endif
+/* The measurement scenario is the current profile of profile.c, the user
+ * button steps through them */
+static const power_profile_t *profile;
+static uint16 featureMask;                  /* Stack features of the configuration */
+static volatile bool bleShutdown = false;
 /* BLESS interrupt configuration structure */
 const cy_stc_sysint_t  blessIsrCfg =
 {
@@ -108,34 +103,39 @@ void Clear_HSIOM()
 void StackEventHandler(uint32_t event, void * eventParam)
 {
 	cy_stc_ble_gatt_xchg_mtu_param_t mtu;
-#if TWO_MBPS_MEASUREMENT
     const cy_stc_ble_set_suggested_phy_info_t phyInfo =
     {
         .allPhyMask = CY_BLE_PHY_NO_PREF_MASK_NONE,
         .txPhyMask = CY_BLE_PHY_MASK_LE_2M,
         .rxPhyMask = CY_BLE_PHY_MASK_LE_2M
     };
-#endif
     switch(event)
     {
     case CY_BLE_EVT_STACK_ON:
-#if TWO_MBPS_MEASUREMENT
-    	Cy_BLE_SetDefaultPhy(&phyInfo);
-#endif
+    	if(profile->twoMbps)
+    	{
+    		Cy_BLE_SetDefaultPhy(&phyInfo);
+    	}
     	/* Enter into discoverable mode so that remote can search it. */
 
-            cy_ble_configPtr->gappAdvParams[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].fastAdvIntervalMin = (uint16)((ADV_INTERVAL_MS*8ul)/5ul);
-            cy_ble_configPtr->gappAdvParams[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].fastAdvIntervalMax = (uint16)((ADV_INTERVAL_MS*8ul)/5ul);
+            cy_ble_configPtr->gappAdvParams[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].fastAdvIntervalMin = (uint16)((profile->advIntervalMs*8ul)/5ul);
+            cy_ble_configPtr->gappAdvParams[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].fastAdvIntervalMax = (uint16)((profile->advIntervalMs*8ul)/5ul);
             cy_ble_configPtr->discoveryModeInfo[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].advParam->advChannelMap = 0x07;
-#if ENABLE_NON_CONN_ADV
-            cy_ble_configPtr->discoveryModeInfo[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].advParam->advType = CY_BLE_GAPP_NON_CONNECTABLE_UNDIRECTED_ADV;
-            cy_ble_configPtr->discoveryModeInfo[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].advParam->advFilterPolicy = CY_BLE_GAPP_SCAN_CONN_WHITELIST_ONLY;
-#else
-            cy_ble_configPtr->discoveryModeInfo[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].advParam->advType = CY_BLE_GAPP_CONNECTABLE_UNDIRECTED_ADV;
-            cy_ble_configPtr->discoveryModeInfo[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].advParam->advFilterPolicy = CY_BLE_GAPP_SCAN_ANY_CONN_ANY;
-#endif
+            if(profile->connectable == false)
+            {
+                cy_ble_configPtr->discoveryModeInfo[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].advParam->advType = CY_BLE_GAPP_NON_CONNECTABLE_UNDIRECTED_ADV;
+                cy_ble_configPtr->discoveryModeInfo[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].advParam->advFilterPolicy = CY_BLE_GAPP_SCAN_CONN_WHITELIST_ONLY;
+            }
+            else
+            {
+                cy_ble_configPtr->discoveryModeInfo[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].advParam->advType = CY_BLE_GAPP_CONNECTABLE_UNDIRECTED_ADV;
+                cy_ble_configPtr->discoveryModeInfo[CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX].advParam->advFilterPolicy = CY_BLE_GAPP_SCAN_ANY_CONN_ANY;
+            }
     	Cy_BLE_GAPP_StartAdvertisement(CY_BLE_ADVERTISING_FAST, CY_BLE_PERIPHERAL_CONFIGURATION_0_INDEX);
 
+    	break;
+    case CY_BLE_EVT_STACK_SHUTDOWN_COMPLETE:
+    	bleShutdown = true;
     	break;
     case CY_BLE_EVT_GAP_DEVICE_CONNECTED:
     	if(((cy_stc_ble_gap_connected_param_t*)eventParam)->status == 0)
@@ -151,11 +151,15 @@ void StackEventHandler(uint32_t event, void * eventParam)
     	break;
     case CY_BLE_EVT_GATT_DISCONNECT_IND:
     	negotiatedMTU = 0;
+    	NotifyStop();
     	if(BasNotificationEnabled())
     	{
     		Disable_BattereyLevelNotification();
     	}
     	break;
+    case CY_BLE_EVT_STACK_BUSY_STATUS:
+    	NotifyBusyStatus(((cy_stc_ble_l2cap_state_info_t *)eventParam)->flowControlFlag);
+    	break;
     case CY_BLE_EVT_GATTS_XCNHG_MTU_REQ:
         mtu.connHandle = ((cy_stc_ble_gatt_xchg_mtu_param_t *)eventParam)->connHandle;
         Cy_BLE_GATT_GetMtuSize(&mtu);
@@ -166,6 +170,71 @@ void StackEventHandler(uint32_t event, void * eventParam)
     }
 }
 
+/*******************************************************************************
+* Function Name: BleStart
+********************************************************************************
+*
+* Summary:
+*  Starts the BLE stack with the LL data length and PHY features of the
+*  current profile. These are read by Cy_BLE_Init(), so a new profile
+*  restarts the stack.
+*
+*******************************************************************************/
+void BleStart(void)
+{
+    if(profile->dle)
+    {
+        stackParam.dleMaxRxCapability = 251;
+        stackParam.dleMaxTxCapability = 251;
+    }
+    else
+    {
+        stackParam.dleMaxRxCapability = 27;
+        stackParam.dleMaxTxCapability = 27;
+    }
+
+    stackParam.featureMask = featureMask;
+    if(profile->twoMbps == false)
+    {
+        stackParam.featureMask &= ~(CY_BLE_PHY_UPDATE_FEATURE_MASK);
+    }
+    /* Initialize and enable the BLE controller */
+    (void) Cy_BLE_Init(&cy_ble_config);
+
+    Cy_BLE_EnableLowPowerMode();
+
+    (void) Cy_BLE_Enable();
+
+    BasInit();
+    NotifyInit();
+}
+
+/*******************************************************************************
+* Function Name: BleStop
+********************************************************************************
+*
+* Summary:
+*  Shuts the BLE stack down, dropping any connection, and forgets the state
+*  of the connection.
+*
+*******************************************************************************/
+void BleStop(void)
+{
+    bleShutdown = false;
+    if(Cy_BLE_Disable() == CY_BLE_SUCCESS)
+    {
+        while(bleShutdown == false)
+        {
+            Cy_BLE_ProcessEvents();
+        }
+    }
+    negotiatedMTU = 0;
+    if(BasNotificationEnabled())
+    {
+        Disable_BattereyLevelNotification();
+    }
+}
+
 /*******************************************************************************
 * Function Name: main
 ********************************************************************************
@@ -187,13 +256,9 @@ int main(void)
 
     __enable_irq();
 
-#if ENABLE_BASE_MEASUREMENT
-    Clear_HSIOM();
-    while(1)
-    {
-    	Cy_SysPm_CpuEnterDeepSleep(CY_SYSPM_WAIT_FOR_INTERRUPT);
-    }
-#endif
+    /* User button and LED of the profile selection */
+    ProfileInit();
+    profile = ProfileGet();
 
     /* Initialize the BLESS interrupt */
     cy_ble_config.hw->blessIsrConfig = &blessIsrCfg;
@@ -202,50 +267,51 @@ int main(void)
     /* Register the generic event handler */
     Cy_BLE_RegisterEventCallback(StackEventHandler);
 
-#if MEASURE_DLE_POWER
-    stackParam.dleMaxRxCapability = 251;
-    stackParam.dleMaxTxCapability = 251;
-#else
-    stackParam.dleMaxRxCapability = 27;
-    stackParam.dleMaxTxCapability = 27;
-#endif
-
-#if !(TWO_MBPS_MEASUREMENT)
-    stackParam.featureMask &= ~(CY_BLE_PHY_UPDATE_FEATURE_MASK);
-#endif
-    /* Initialize and enable the BLE controller */
-    (void) Cy_BLE_Init(&cy_ble_config);
-
-    Cy_BLE_EnableLowPowerMode();
-
-    (void) Cy_BLE_Enable();
-
-    BasInit();
-
+    featureMask = stackParam.featureMask;
+    if(profile->bleOff)
+    {
+        Clear_HSIOM();
+    }
+    else
+    {
+        BleStart();
+    }
 
     for(;;)
     {
     	/* Process pending BLE events */
-    	Cy_BLE_ProcessEvents();
+    	if(profile->bleOff == false)
+    	{
+    		Cy_BLE_ProcessEvents();
+    	}
+
+    	/* Fill the stack buffers, then sleep until it reports them free */
+    	if(profile->dataTransfer && Cy_BLE_GetNumOfActiveConn() > 0 && negotiatedMTU != 0 && BasNotificationEnabled())
+    	{
+    		NotifyPump(cy_ble_connHandle[connectionId], cy_ble_bassConfigPtr->attrInfo[0].batteryLevelHandle,
+    		           &dataBuffer[0], (profile->dle ?
+    		                            (negotiatedMTU > NTF_LEN_DLE ? NTF_LEN_DLE : negotiatedMTU) : NTF_LEN_NO_DLE));
+    	}
     	Cy_SysPm_CpuEnterDeepSleep(CY_SYSPM_WAIT_FOR_INTERRUPT);
-#if ENABLE_DATA_TXFR
-    	if(Cy_BLE_GetNumOfActiveConn() > 0 && negotiatedMTU != 0 && BasNotificationEnabled())
+
+    	if(ProfileButtonPressed())
     	{
-            cy_stc_ble_gatts_handle_value_ntf_t ntfReqParam =
-            {
-                /* Fill all fields of the Write request structure ... */
-                .handleValPair.attrHandle = cy_ble_bassConfigPtr->attrInfo[0].batteryLevelHandle,
-                .handleValPair.value.val  = &dataBuffer[0],
-#if MEASURE_DLE_POWER
-                .handleValPair.value.len  = (negotiatedMTU > MAX_NUMBER_OF_BYTES_PER_PACKET ? MAX_NUMBER_OF_BYTES_PER_PACKET : negotiatedMTU),
-#else
-				.handleValPair.value.len  = MAX_NUMBER_OF_BYTES_PER_PACKET,
-#endif
-				.connHandle               = cy_ble_connHandle[connectionId]
-            };
-            /* Send notification to the Client */
-           Cy_BLE_GATTS_Notification(&ntfReqParam);
+    		/* Next measurement: restart the stack with the new profile. The
+    		 * SWD pins stay cleared after the base profile until reset. */
+    		if(profile->bleOff == false)
+    		{
+    			BleStop();
+    		}
+    		profile = ProfileNext();
+    		ProfileIndicate();
+    		if(profile->bleOff)
+    		{
+    			Clear_HSIOM();
+    		}
+    		else
+    		{
+    			BleStart();
+    		}
     	}
-#endif
     }
 }
@@ -0,0 +1,158 @@
+/*******************************************************************************
+* File Name: notify.c
+*
+* Version: 1.0
+*
+* Description:
+* This file contains the notification flood of the data transfer profiles.
+* Notifications are queued in the stack until it reports busy, then the
+* device sleeps until CY_BLE_EVT_STACK_BUSY_STATUS reports the stack free
+* again. So every connection event is filled and the CPU wakes once per
+* connection event rather than once per rejected call.
+*
+* Hardware Dependency:
+*  CY8CKIT-062 PSoC6 BLE Pioneer Kit
+*
+********************************************************************************
+* Copyright 2017, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+#include <string.h>
+#include "notify.h"
+
+/* Global variables, in the watch window of the debugger */
+notify_stats_t notifyStats;
+
+/* Static global variables */
+static bool stackBusy = false;
+static uint32_t burst = 0u;            /* Accepted since the stack was free */
+static uint32_t sequence = 0u;         /* Of the next notification */
+
+/*******************************************************************************
+* Function Name: NotifyInit
+********************************************************************************
+*
+* Summary:
+*   Clears the flood state and the counters, called when the stack starts.
+*
+*******************************************************************************/
+void NotifyInit(void)
+{
+    memset(&notifyStats, 0, sizeof(notifyStats));
+    stackBusy = false;
+    burst = 0u;
+    sequence = 0u;
+}
+
+/*******************************************************************************
+* Function Name: NotifyPump
+********************************************************************************
+*
+* Summary:
+*   Sends notifications until the stack is busy. Called on every wake-up
+*   while the client has notifications enabled; it does nothing until the
+*   stack is free again. Every value starts with a 32-bit little endian
+*   sequence number, so the central can count lost notifications.
+*
+* Parameters:
+*   connHandle - the connection of the client
+*   attrHandle - the characteristic value handle
+*   data, len  - the value of every notification
+*
+*******************************************************************************/
+void NotifyPump(cy_stc_ble_conn_handle_t connHandle, cy_ble_gatt_db_attr_handle_t attrHandle,
+                uint8_t *data, uint16_t len)
+{
+    cy_stc_ble_gatts_handle_value_ntf_t ntfReqParam =
+    {
+        .handleValPair.attrHandle = attrHandle,
+        .handleValPair.value.val  = data,
+        .handleValPair.value.len  = len,
+        .connHandle               = connHandle
+    };
+    uint32_t sent = 0u;
+
+    notifyStats.wakeups++;
+    while(stackBusy == false)
+    {
+        if(len >= NOTIFY_SEQ_LEN)
+        {
+            data[0u] = (uint8_t)sequence;
+            data[1u] = (uint8_t)(sequence >> 8u);
+            data[2u] = (uint8_t)(sequence >> 16u);
+            data[3u] = (uint8_t)(sequence >> 24u);
+        }
+        if(Cy_BLE_GATTS_Notification(&ntfReqParam) != CY_BLE_SUCCESS)
+        {
+            /* Out of buffers before the busy event was processed */
+            notifyStats.rejected++;
+            break;
+        }
+        notifyStats.accepted++;
+        sequence++;
+        burst++;
+        sent++;
+        if(Cy_BLE_GATT_GetBusyStatus(connHandle.attId) == CY_BLE_STACK_STATE_BUSY)
+        {
+            stackBusy = true;
+        }
+    }
+    if(sent == 0u)
+    {
+        notifyStats.idleWakeups++;
+    }
+}
+
+/*******************************************************************************
+* Function Name: NotifyStop
+********************************************************************************
+*
+* Summary:
+*   Forgets the busy state of a dropped connection, the stack does not report
+*   it free. The counters are kept for the debugger.
+*
+*******************************************************************************/
+void NotifyStop(void)
+{
+    stackBusy = false;
+    burst = 0u;
+}
+
+/*******************************************************************************
+* Function Name: NotifyBusyStatus
+********************************************************************************
+*
+* Summary:
+*   Takes the state of CY_BLE_EVT_STACK_BUSY_STATUS.
+*
+* Parameters:
+*   state - CY_BLE_STACK_STATE_BUSY or CY_BLE_STACK_STATE_FREE
+*
+*******************************************************************************/
+void NotifyBusyStatus(uint8_t state)
+{
+    if(state == CY_BLE_STACK_STATE_BUSY)
+    {
+        notifyStats.busyEvents++;
+        stackBusy = true;
+    }
+    else
+    {
+        if(burst != 0u)
+        {
+            notifyStats.bursts++;
+            notifyStats.burstTotal += burst;
+            notifyStats.burstMean = notifyStats.burstTotal / notifyStats.bursts;
+            if(burst > notifyStats.burstMax)
+            {
+                notifyStats.burstMax = burst;
+            }
+            burst = 0u;
+        }
+        stackBusy = false;
+    }
+}
+
+/* [] END OF FILE */
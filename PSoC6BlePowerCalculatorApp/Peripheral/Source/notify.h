@@ -0,0 +1,58 @@
+/*******************************************************************************
+* File Name: notify.h
+*
+* Version 1.0
+*
+* Description:
+*  Contains the function prototypes and constants of the notification flood
+*  of the data transfer profiles.
+*
+********************************************************************************
+* Copyright 2017, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include "cycfg.h"
+#include "cycfg_ble.h"
+#include <stdbool.h>
+
+
+/***************************************
+*          Constants
+***************************************/
+#define NOTIFY_SEQ_LEN              (4u)            /* Sequence number at the start of the value */
+
+
+/***************************************
+*       Data Types
+***************************************/
+/* Counters of the flood since the stack was started, for the debugger
+ * watch window. A burst is the notifications accepted between two busy to
+ * free changes of the stack; the stack sends its TX buffers in a connection
+ * event, so a burst is close to the notifications of one connection event. */
+typedef struct
+{
+    uint32_t    accepted;           /* Cy_BLE_GATTS_Notification() successes */
+    uint32_t    rejected;           /* Calls that returned an error */
+    uint32_t    busyEvents;         /* Stack changes to CY_BLE_STACK_STATE_BUSY */
+    uint32_t    bursts;             /* Stack changes back to free */
+    uint32_t    burstTotal;         /* Notifications of the completed bursts */
+    uint32_t    burstMean;          /* About the notifications per connection event */
+    uint32_t    burstMax;           /* Most notifications of one burst */
+    uint32_t    wakeups;            /* Calls of NotifyPump() */
+    uint32_t    idleWakeups;        /* ... that could not send */
+} notify_stats_t;
+
+
+/***************************************
+*       Function Prototypes
+***************************************/
+void NotifyInit(void);
+void NotifyPump(cy_stc_ble_conn_handle_t connHandle, cy_ble_gatt_db_attr_handle_t attrHandle,
+                uint8_t *data, uint16_t len);
+void NotifyStop(void);
+void NotifyBusyStatus(uint8_t state);
+
+/* [] END OF FILE */
@@ -0,0 +1,181 @@
+/*******************************************************************************
+* File Name: profile.c
+*
+* Version: 1.0
+*
+* Description:
+* This file contains the measurement profile table and the user button that
+* steps through it. The button interrupt wakes the device from deep sleep,
+* so a profile can be changed in any state without a rebuild.
+*
+* Hardware Dependency:
+*  CY8CKIT-062 PSoC6 BLE Pioneer Kit
+*
+********************************************************************************
+* Copyright 2017, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+#include "profile.h"
+
+/* The scenarios of README.txt, in the order the button steps through them */
+static const power_profile_t profileTable[] =
+{
+    /* name                          bleOff connectable adv   dle    twoMbps dataTransfer */
+    { "Base, BLE off",               true,  false,      100u, false, false,  false },
+    { "Non-connectable ADV 100 ms",  false, false,      100u, false, false,  false },
+    { "Connectable ADV / idle",      false, true,       100u, false, false,  false },
+    { "Notify 20 B, 1M PHY",         false, true,       100u, false, false,  true  },
+    { "Notify 244 B, 1M PHY",        false, true,       100u, true,  false,  true  },
+    { "Notify 20 B, 2M PHY",         false, true,       100u, false, true,   true  },
+    { "Notify 244 B, 2M PHY",        false, true,       100u, true,  true,   true  },
+};
+
+#define PROFILE_COUNT               (sizeof(profileTable) / sizeof(profileTable[0u]))
+
+/* Button interrupt configuration structure */
+static const cy_stc_sysint_t buttonIsrCfg =
+{
+    .intrSrc       = PROFILE_BUTTON_IRQ,
+    .intrPriority  = 7u
+};
+
+/* Static global variables */
+static uint8_t profileIndex = PROFILE_DEFAULT;
+static volatile bool profileButton = false;
+
+/*******************************************************************************
+* Function Name: ProfileButtonIsr
+********************************************************************************
+*
+* Summary:
+*   Interrupt of the user button, the press is handled from the main loop.
+*
+*******************************************************************************/
+static void ProfileButtonIsr(void)
+{
+    Cy_GPIO_ClearInterrupt(PROFILE_BUTTON_PORT, PROFILE_BUTTON_PIN);
+    NVIC_ClearPendingIRQ(buttonIsrCfg.intrSrc);
+    profileButton = true;
+}
+
+/*******************************************************************************
+* Function Name: ProfileInit
+********************************************************************************
+*
+* Summary:
+*   Sets up the user button and the LED and selects PROFILE_DEFAULT.
+*
+*******************************************************************************/
+void ProfileInit(void)
+{
+    if(profileIndex >= PROFILE_COUNT)
+    {
+        profileIndex = 0u;
+    }
+
+    Cy_GPIO_Pin_FastInit(PROFILE_LED_PORT, PROFILE_LED_PIN, CY_GPIO_DM_STRONG_IN_OFF, 1u, HSIOM_SEL_GPIO);
+    Cy_GPIO_Pin_FastInit(PROFILE_BUTTON_PORT, PROFILE_BUTTON_PIN, CY_GPIO_DM_PULLUP, 1u, HSIOM_SEL_GPIO);
+    Cy_GPIO_SetInterruptEdge(PROFILE_BUTTON_PORT, PROFILE_BUTTON_PIN, CY_GPIO_INTR_FALLING);
+    Cy_GPIO_ClearInterrupt(PROFILE_BUTTON_PORT, PROFILE_BUTTON_PIN);
+    Cy_GPIO_SetInterruptMask(PROFILE_BUTTON_PORT, PROFILE_BUTTON_PIN, 1u);
+    (void) Cy_SysInt_Init(&buttonIsrCfg, ProfileButtonIsr);
+    NVIC_EnableIRQ(buttonIsrCfg.intrSrc);
+}
+
+/*******************************************************************************
+* Function Name: ProfileGet
+********************************************************************************
+*
+* Summary:
+*   Returns the current profile.
+*
+*******************************************************************************/
+const power_profile_t *ProfileGet(void)
+{
+    return(&profileTable[profileIndex]);
+}
+
+/*******************************************************************************
+* Function Name: ProfileIndex
+********************************************************************************
+*
+* Summary:
+*   Returns the index of the current profile in the table, 0 for the first.
+*
+*******************************************************************************/
+uint8_t ProfileIndex(void)
+{
+    return(profileIndex);
+}
+
+/*******************************************************************************
+* Function Name: ProfileButtonPressed
+********************************************************************************
+*
+* Summary:
+*   Returns true once per press of the user button. A press must still hold
+*   the button down after PROFILE_DEBOUNCE_MS; the function returns when the
+*   button is released, so one press never counts twice.
+*
+*******************************************************************************/
+bool ProfileButtonPressed(void)
+{
+    if(profileButton == false)
+    {
+        return(false);
+    }
+    profileButton = false;
+
+    Cy_SysLib_Delay(PROFILE_DEBOUNCE_MS);
+    if(Cy_GPIO_Read(PROFILE_BUTTON_PORT, PROFILE_BUTTON_PIN) != 0u)
+    {
+        return(false);
+    }
+    while(Cy_GPIO_Read(PROFILE_BUTTON_PORT, PROFILE_BUTTON_PIN) == 0u)
+    {
+    }
+    Cy_SysLib_Delay(PROFILE_DEBOUNCE_MS);
+    profileButton = false;
+    return(true);
+}
+
+/*******************************************************************************
+* Function Name: ProfileNext
+********************************************************************************
+*
+* Summary:
+*   Selects the next profile of the table, after the last one the first.
+*
+* Returns:
+*  The new profile.
+*******************************************************************************/
+const power_profile_t *ProfileNext(void)
+{
+    profileIndex = (uint8_t)((profileIndex + 1u) % PROFILE_COUNT);
+    return(&profileTable[profileIndex]);
+}
+
+/*******************************************************************************
+* Function Name: ProfileIndicate
+********************************************************************************
+*
+* Summary:
+*   Blinks the LED once per profile number, one for the first profile.
+*
+*******************************************************************************/
+void ProfileIndicate(void)
+{
+    uint8_t i;
+
+    for(i = 0u; i <= profileIndex; i++)
+    {
+        Cy_GPIO_Write(PROFILE_LED_PORT, PROFILE_LED_PIN, 0u);
+        Cy_SysLib_Delay(PROFILE_BLINK_MS);
+        Cy_GPIO_Write(PROFILE_LED_PORT, PROFILE_LED_PIN, 1u);
+        Cy_SysLib_Delay(PROFILE_BLINK_MS);
+    }
+}
+
+/* [] END OF FILE */
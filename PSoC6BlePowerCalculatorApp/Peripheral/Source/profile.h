@@ -0,0 +1,73 @@
+/*******************************************************************************
+* File Name: profile.h
+*
+* Version 1.0
+*
+* Description:
+*  Contains the function prototypes and constants of the measurement profiles.
+*  A profile holds the settings that used to be compile-time switches of
+*  main.c; the user button steps through the profile table at runtime.
+*
+********************************************************************************
+* Copyright 2017, Cypress Semiconductor Corporation.  All rights reserved.
+* You may use this file only in accordance with the license, terms, conditions,
+* disclaimers, and limitations in the end user license agreement accompanying
+* the software package with which this file was provided.
+*******************************************************************************/
+
+#include "cy_device_headers.h"
+#include "cy_gpio.h"
+#include "cy_syslib.h"
+#include "cy_sysint.h"
+#include <stdbool.h>
+
+
+/***************************************
+*          Constants
+***************************************/
+#ifndef PROFILE_DEFAULT
+    #define PROFILE_DEFAULT         (2u)            /* Profile after reset: connectable ADV */
+#endif /* ifndef PROFILE_DEFAULT */
+
+/* User button SW2 of the CY8CKIT-062-BLE, active low */
+#define PROFILE_BUTTON_PORT         (GPIO_PRT0)
+#define PROFILE_BUTTON_PIN          (4u)
+#define PROFILE_BUTTON_IRQ          (ioss_interrupts_gpio_0_IRQn)
+#define PROFILE_DEBOUNCE_MS         (20u)
+
+/* Red LED of the kit, active low. It blinks the number of the new profile,
+ * then stays off so it does not add to the measured current. */
+#define PROFILE_LED_PORT            (GPIO_PRT0)
+#define PROFILE_LED_PIN             (3u)
+#define PROFILE_BLINK_MS            (150u)
+
+#define NTF_LEN_NO_DLE              (20u)           /* Notification length in a 27 byte LL PDU */
+#define NTF_LEN_DLE                 (244u)          /* Notification length in a 251 byte LL PDU */
+
+
+/***************************************
+*       Data Types
+***************************************/
+typedef struct
+{
+    const char  *name;              /* For the debugger watch window */
+    bool        bleOff;             /* Base current: BLE off, pins cleared, deep sleep */
+    bool        connectable;        /* Connectable or non-connectable ADV */
+    uint16_t    advIntervalMs;
+    bool        dle;                /* 251 byte LL PDUs, notifications of NTF_LEN_DLE */
+    bool        twoMbps;            /* 2M PHY preferred */
+    bool        dataTransfer;       /* Continuous notifications when enabled by the client */
+} power_profile_t;
+
+
+/***************************************
+*       Function Prototypes
+***************************************/
+void ProfileInit(void);
+const power_profile_t *ProfileGet(void);
+uint8_t ProfileIndex(void);
+bool ProfileButtonPressed(void);
+const power_profile_t *ProfileNext(void);
+void ProfileIndicate(void);
+
+/* [] END OF FILE */